@@ -12,6 +12,7 @@
 #include "asc_chain.h"
 #include "dbc_assert.h"
 #include "o1heap.h"
+#include <stddef.h>
 #include <stdio.h>
 #include <string.h>
 #include "asc_port.h"
@@ -27,15 +28,34 @@ DBC_MODULE_NAME("ASC_CHAIN")
 /*******************************************************************************
  * Local function prototypes ('static')
  ******************************************************************************/
-static bool asc_chain_step_function_proc(asc_chain_t* chain, chain_step_t* const step);
-static bool asc_chain_step_exec_proc(asc_chain_t* chain, chain_step_t* const step);
-static bool asc_chain_step_loop_start_proc(asc_chain_t* chain, chain_step_t* const step);
-static bool asc_chain_step_loop_end_proc(asc_chain_t* chain, chain_step_t* const step);
-static bool asc_chain_step_delay_proc(asc_chain_t* chain, chain_step_t* const step);
+static bool asc_chain_step_function_proc(asc_chain_t* chain, const chain_step_t* const step, asc_chain_step_state_t* const state);
+static bool asc_chain_step_exec_proc(asc_chain_t* chain, const chain_step_t* const step, asc_chain_step_state_t* const state);
+static bool asc_chain_step_loop_start_proc(asc_chain_t* chain, const chain_step_t* const step, asc_chain_step_state_t* const state);
+static bool asc_chain_step_loop_end_proc(asc_chain_t* chain, const chain_step_t* const step, asc_chain_step_state_t* const state);
+static bool asc_chain_step_delay_proc(asc_chain_t* chain, const chain_step_t* const step, asc_chain_step_state_t* const state);
+static bool asc_chain_step_fork_proc(asc_chain_t* chain, const chain_step_t* const step, asc_chain_step_state_t* const state);
+static bool asc_chain_step_join_proc(asc_chain_t* chain, const chain_step_t* const step, asc_chain_step_state_t* const state);
+static bool asc_chain_step_wait_urc_proc(asc_chain_t* chain, const chain_step_t* const step, asc_chain_step_state_t* const state);
+static bool asc_chain_step_call_proc(asc_chain_t* chain, const chain_step_t* const step, asc_chain_step_state_t* const state);
+static bool asc_chain_call_return(asc_chain_t* const chain, bool ok);
+static bool asc_chain_step_checkpoint_proc(asc_chain_t* chain, const chain_step_t* const step, asc_chain_step_state_t* const state);
+static void asc_chain_checkpoint_restore(asc_chain_t* const chain, const asc_chain_checkpoint_t* const checkpoint);
+static void asc_chain_fork_drop(asc_chain_t* const chain);
+static void asc_chain_branch_done(asc_chain_t* const chain);
+static void asc_chain_sched_push(asc_chain_t* const chain);
+static void asc_chain_delay_cb(void* const arg);
+static void asc_chain_urc_cb(const bool result, void* const arg);
+static void asc_chain_step_timer_cb(void* const arg);
 
 /*******************************************************************************
  * Local types definitions
  ******************************************************************************/
+typedef struct {
+  uint32_t loops;   // Max loop nesting depth
+  uint32_t states;  // Number of step states
+  uint32_t calls;   // Max depth of sub-chain calls
+} asc_chain_size_t;
+
 /*******************************************************************************
  * Local variable definitions ('static')
  ******************************************************************************/
@@ -51,62 +71,283 @@ static bool asc_chain_step_delay_proc(asc_chain_t* chain, chain_step_t* const st
 static void asc_chain_step_cb(const bool result, void* const meta, const void* const data) 
 {
   DBC_REQUIRE(101, meta);
-  const asc_chain_t *chain = (asc_chain_t*)meta;
-  chain_step_t* const step = &chain->steps[chain->current_step];
-  if(step->state == ASC_CHAIN_STEP_RUNNING) 
+  asc_chain_t *chain = (asc_chain_t*)meta;
+  const chain_step_t* const step = &chain->steps[chain->current_step];
+  asc_chain_step_state_t* const state = &chain->step_state[chain->current_step];
+  if(state->state == ASC_CHAIN_STEP_RUNNING) 
   {
-    step->state = result ? ASC_CHAIN_STEP_SUCCESS : ASC_CHAIN_STEP_ERROR;
-    step->execution_count++;
+    state->state = result ? ASC_CHAIN_STEP_SUCCESS : ASC_CHAIN_STEP_ERROR;
+    state->execution_count++;
+    asc_timer_stop(chain->ctx, &chain->delay); // Watchdog
     ASC_DEBUG(chain->ctx, "[ASC][INFO] Step '%s' completed with %s", step->name, result ? "SUCCESS" : "ERROR");
     if(step->action.func.cb) step->action.func.cb(result, step->action.func.meta, data);
+    if(chain->sched) asc_chain_sched_push(chain);
+  }
+}
+
+/*******************************************************************************
+ ** @brief  Notify chain about delay expiry. Called from timer wheel of context
+ ** @param  arg Chain
+ ** @return none
+ ******************************************************************************/
+static void asc_chain_delay_cb(void* const arg) 
+{
+  DBC_REQUIRE(102, arg);
+  asc_chain_t *chain = (asc_chain_t*)arg;
+  if(chain->current_step >= chain->step_count) return;
+  asc_chain_step_state_t* const state = &chain->step_state[chain->current_step];
+  if(chain->steps[chain->current_step].type == ASC_CHAIN_STEP_DELAY && state->state == ASC_CHAIN_STEP_RUNNING) 
+  {
+    state->state = ASC_CHAIN_STEP_SUCCESS;
+    if(chain->sched) asc_chain_sched_push(chain);
+  }
+}
+
+/*******************************************************************************
+ ** @brief  Notify function step about watchdog or backoff expiry. Called from
+ **         timer wheel of context. Watchdog cancels entity of the attempt, so
+ **         the queue is freed and late answer can't complete the next attempt
+ ** @param  arg Chain
+ ** @return none
+ ******************************************************************************/
+static void asc_chain_step_timer_cb(void* const arg) 
+{
+  DBC_REQUIRE(104, arg);
+  asc_chain_t *chain = (asc_chain_t*)arg;
+  if(chain->current_step >= chain->step_count) return;
+  const chain_step_t* const step = &chain->steps[chain->current_step];
+  asc_chain_step_state_t* const state = &chain->step_state[chain->current_step];
+  if(step->type != ASC_CHAIN_STEP_FUNCTION) return;
+  if(state->state == ASC_CHAIN_STEP_RUNNING) 
+  {
+    ASC_DEBUG(chain->ctx, "[ASC][ERROR] Step '%s' watchdog expired", step->name);
+    asc_entity_cancel(chain->ctx, chain->entity); // Error comes through cb of step
+    if(state->state != ASC_CHAIN_STEP_RUNNING) return;
+    state->state = ASC_CHAIN_STEP_ERROR; // Entity is lost, e.g. after asc_deinit
+    state->execution_count++;
+  }
+  else if(state->state == ASC_CHAIN_STEP_BACKOFF) 
+  {
+    state->state = ASC_CHAIN_STEP_IDLE;
+  }
+  else return;
+  if(chain->sched) asc_chain_sched_push(chain);
+}
+
+/*******************************************************************************
+ ** @brief  Get delay before retry of function step
+ ** @param  chain   Chain
+ ** @param  backoff Backoff policy
+ ** @param  attempt Number of failed attempts, starts from 1
+ ** @return Delay in milliseconds
+ ******************************************************************************/
+static uint32_t asc_chain_backoff_delay(asc_chain_t* const chain, const asc_chain_backoff_t* const backoff, const uint8_t attempt)
+{
+  uint32_t delay = backoff->base;
+  if(backoff->type == ASC_CHAIN_BACKOFF_EXP)
+  {
+    for(uint8_t i = 1; i < attempt && delay <= UINT32_MAX / 2; i++) delay *= 2;
+  }
+  if(backoff->cap && delay > backoff->cap) delay = backoff->cap;
+  if(backoff->jitter && delay)
+  {
+    if(!chain->rnd) chain->rnd = (uint32_t)(uintptr_t)chain ^ asc_get_cur_time_ms(chain->ctx) ^ 0x9E3779B9u;
+    chain->rnd ^= chain->rnd << 13; // xorshift32
+    chain->rnd ^= chain->rnd >> 17;
+    chain->rnd ^= chain->rnd << 5;
+    const uint32_t range = (uint32_t)((uint64_t)delay * (backoff->jitter > 100 ? 100 : backoff->jitter) / 100);
+    delay -= chain->rnd % (range + 1);
+  }
+  return delay;
+}
+
+/*******************************************************************************
+ ** @brief  Notify chain about awaited URC or its timeout. Called from
+ **         @asc_core_proc
+ ** @param  result true - URC is found, false - timeout
+ ** @param  arg    Chain
+ ** @return none
+ ******************************************************************************/
+static void asc_chain_urc_cb(const bool result, void* const arg) 
+{
+  DBC_REQUIRE(103, arg);
+  asc_chain_t *chain = (asc_chain_t*)arg;
+  if(chain->current_step >= chain->step_count) return;
+  asc_chain_step_state_t* const state = &chain->step_state[chain->current_step];
+  if(chain->steps[chain->current_step].type == ASC_CHAIN_STEP_WAIT_URC && state->state == ASC_CHAIN_STEP_RUNNING) 
+  {
+    state->state = result ? ASC_CHAIN_STEP_SUCCESS : ASC_CHAIN_STEP_ERROR;
+    if(chain->sched) asc_chain_sched_push(chain);
   }
 }
 
 /******************************************************************************* 
- ** @brief  Calculate maximum loop nesting depth in chain
- ** @param  steps Array of steps
+ ** @brief  Calculate maximum loop nesting depth, number of step states and depth
+ **         of calls of chain and all sub-chains called by it
+ ** @param  steps      Array of steps
  ** @param  step_count Number of steps
- ** @return Maximum loop nesting depth
+ ** @param  level      Call level of these steps, 0 - chain itself
+ ** @param  size       Result
+ ** @return true - ok, false - calls are too deep or recursive, or sub-chain is too long
  *******************************************************************************/
-static uint32_t asc_chain_cal_max_loop_depth(const chain_step_t* const steps, const uint32_t step_count) 
+static bool asc_chain_measure(const chain_step_t* const steps, const uint32_t step_count, const uint8_t level, asc_chain_size_t* const size) 
 {
-  DBC_REQUIRE(201, steps && step_count);
+  DBC_REQUIRE(201, steps && step_count && size);
+  if(level > ASC_CHAIN_CALL_DEPTH || step_count >= ASC_CHAIN_TARGET_PREV) return false;
   uint32_t current_depth = 0;
-  uint32_t max_depth = 0;
+  size->loops = 0;
+  size->states = step_count;
+  size->calls = 0;
   for(uint32_t i = 0; i < step_count; i++) 
   {
     if(steps[i].type == ASC_CHAIN_STEP_LOOP_START) 
     {
       current_depth++;
-      if(current_depth > max_depth) max_depth = current_depth;
+      if(current_depth > size->loops) size->loops = current_depth;
     } 
     else if(steps[i].type == ASC_CHAIN_STEP_LOOP_END) 
     {
       if(current_depth > 0) current_depth--;
     }
+    else if(steps[i].type == ASC_CHAIN_STEP_CALL) 
+    {
+      const asc_chain_sub_t* const sub = steps[i].action.call.sub;
+      asc_chain_size_t sub_size;
+      if(!sub || !asc_chain_measure(sub->steps, sub->step_count, level + 1, &sub_size)) return false;
+      size->states += sub_size.states;
+      if(current_depth + sub_size.loops > size->loops) size->loops = current_depth + sub_size.loops; // Loops of sub-chain are stacked over loops of caller
+      if(sub_size.calls + 1 > size->calls) size->calls = sub_size.calls + 1;
+    }
+  }
+  return true;
+}
+
+/******************************************************************************* 
+ ** @brief  Get number of step states of steps and all sub-chains called by them
+ ** @param  steps      Array of steps, measured by @asc_chain_measure
+ ** @param  step_count Number of steps
+ ** @return Number of states
+ *******************************************************************************/
+static uint32_t asc_chain_tree_states(const chain_step_t* const steps, const uint32_t step_count) 
+{
+  uint32_t res = step_count;
+  for(uint32_t i = 0; i < step_count; i++) 
+  {
+    if(steps[i].type == ASC_CHAIN_STEP_CALL) res += asc_chain_tree_states(steps[i].action.call.sub->steps, steps[i].action.call.sub->step_count);
   }
-  return (max_depth > 0) ? (max_depth + 2) : 3;
+  return res;
+}
+
+/******************************************************************************* 
+ ** @brief  Get runtime states of steps of sub-chain called by step. States of
+ **         each call step are placed after states of its steps in order of calls
+ ** @param  steps      Steps of caller
+ ** @param  step_count Number of steps of caller
+ ** @param  state      States of steps of caller
+ ** @param  index      Index of call step
+ ** @return States of steps of called sub-chain
+ *******************************************************************************/
+static asc_chain_step_state_t* asc_chain_call_states(const chain_step_t* const steps, const uint32_t step_count, asc_chain_step_state_t* const state, const uint32_t index) 
+{
+  asc_chain_step_state_t* res = state + step_count;
+  for(uint32_t i = 0; i < index; i++) 
+  {
+    if(steps[i].type == ASC_CHAIN_STEP_CALL) res += asc_chain_tree_states(steps[i].action.call.sub->steps, steps[i].action.call.sub->step_count);
+  }
+  return res;
 }
 
 /*******************************************************************************
  ** @brief  Find step index by name
- ** @param  none
- ** @retval none
+ ** @param  steps      Array of steps
+ ** @param  step_count Number of steps
+ ** @param  step_name  Name to find
+ ** @return Index of the first step with this name, UINT32_MAX if not found
  *******************************************************************************/
-static uint32_t asc_chain_find_step_index_by_name(const asc_chain_t* const chain, const char* const step_name) 
+static uint32_t asc_chain_find_step_index_by_name(const chain_step_t* const steps, const uint32_t step_count, const char* const step_name) 
 {
-  DBC_REQUIRE(301, chain);
+  DBC_REQUIRE(301, steps);
   DBC_REQUIRE(302, step_name);
-  for(uint32_t i = 0; i < chain->step_count; i++) 
+  for(uint32_t i = 0; i < step_count; i++) 
+  {
+    if(steps[i].name && strcmp(steps[i].name, step_name) == 0) return i;
+  }
+  return UINT32_MAX;
+}
+
+/*******************************************************************************
+ ** @brief  Resolve target name to step index or special target
+ ** @param  chain  Chain
+ ** @param  name   Target name: NULL/"NEXT", "PREV", "STOP" or step name
+ ** @param  target Resolved target
+ ** @return true - resolved, false - step with this name doesn't exist
+ *******************************************************************************/
+static bool asc_chain_resolve_target(const asc_chain_t* const chain, const chain_step_t* const steps, const uint32_t step_count, const char* const name, asc_chain_target_t* const target)
+{
+  DBC_REQUIRE(303, chain);
+  DBC_REQUIRE(304, target);
+  if(!name || strcmp(name, "NEXT") == 0) *target = ASC_CHAIN_TARGET_NEXT;
+  else if(strcmp(name, "PREV") == 0)     *target = ASC_CHAIN_TARGET_PREV;
+  else if(strcmp(name, "STOP") == 0)     *target = ASC_CHAIN_TARGET_STOP;
+  else
   {
-    if(chain->steps[i].name && strcmp(chain->steps[i].name, step_name) == 0) 
+    uint32_t index = asc_chain_find_step_index_by_name(steps, step_count, name);
+    if(index == UINT32_MAX)
     {
-      ASC_CRITICAL_EXIT
-      return i;
+      ASC_DEBUG(chain->ctx, "[ASC][ERROR] Step '%s' not found!", name);
+      return false;
     }
+    *target = (asc_chain_target_t)index;
   }
-  ASC_DEBUG(chain->ctx, "[ASC][ERROR] Step '%s' not found!", step_name);
-  return UINT32_MAX;
+  return true;
+}
+
+/*******************************************************************************
+ ** @brief  Resolve targets of steps and of all sub-chains called by them
+ ** @param  chain      Chain
+ ** @param  steps      Array of steps
+ ** @param  step_count Number of steps
+ ** @param  state      States of these steps followed by states of called sub-chains
+ ** @return true - all targets are resolved, false - unknown target name
+ *******************************************************************************/
+static bool asc_chain_resolve_targets(const asc_chain_t* const chain, const chain_step_t* const steps, const uint32_t step_count, asc_chain_step_state_t* const state)
+{
+  DBC_REQUIRE(305, chain && steps && state);
+  for(uint32_t i = 0; i < step_count; i++)
+  {
+    const chain_step_t* const step = &steps[i];
+    const char* names[2] = {NULL, NULL};
+    if(step->type == ASC_CHAIN_STEP_FUNCTION)
+    {
+      names[0] = step->action.func.success_target;
+      names[1] = step->action.func.error_target;
+    }
+    else if(step->type == ASC_CHAIN_STEP_EXEC)
+    {
+      names[0] = step->action.exec.true_target;
+      names[1] = step->action.exec.false_target;
+    }
+    else if(step->type == ASC_CHAIN_STEP_JOIN)
+    {
+      names[0] = step->action.join.success_target;
+      names[1] = step->action.join.error_target;
+    }
+    else if(step->type == ASC_CHAIN_STEP_WAIT_URC)
+    {
+      names[0] = step->action.urc.success_target;
+      names[1] = step->action.urc.error_target;
+    }
+    else if(step->type == ASC_CHAIN_STEP_CALL)
+    {
+      names[0] = step->action.call.success_target;
+      names[1] = step->action.call.error_target;
+      const asc_chain_sub_t* const sub = step->action.call.sub;
+      if(!asc_chain_resolve_targets(chain, sub->steps, sub->step_count, asc_chain_call_states(steps, step_count, state, i))) return false;
+    }
+    if(!asc_chain_resolve_target(chain, steps, step_count, names[0], &state[i].targets[0])) return false;
+    if(!asc_chain_resolve_target(chain, steps, step_count, names[1], &state[i].targets[1])) return false;
+  }
+  return true;
 }
 
 /*******************************************************************************
@@ -128,13 +369,13 @@ static bool asc_chain_execute_step_prepare(asc_chain_t* const chain, const uint3
           chain->loop_stack[chain->loop_stack_ptr].start_step_index = i;
           chain->loop_stack[chain->loop_stack_ptr].iteration_count = 0;
           chain->loop_stack_ptr++;
-          chain->steps[i].state = ASC_CHAIN_STEP_SUCCESS;
+          chain->step_state[i].state = ASC_CHAIN_STEP_SUCCESS;
         }
         else if(chain->steps[i].type == ASC_CHAIN_STEP_LOOP_END)
         {
           if(!chain->loop_stack_ptr) return false;
           asc_loop_stack_item_t *current_loop = &chain->loop_stack[chain->loop_stack_ptr - 1];
-          chain_step_t *loop_start = &chain->steps[current_loop->start_step_index];
+          asc_chain_step_state_t *loop_start = &chain->step_state[current_loop->start_step_index];
           chain->loop_stack_ptr--;
           loop_start->state = ASC_CHAIN_STEP_IDLE;
           current_loop->iteration_count = 0;
@@ -147,10 +388,10 @@ static bool asc_chain_execute_step_prepare(asc_chain_t* const chain, const uint3
       {
         if(chain->steps[i].type == ASC_CHAIN_STEP_LOOP_START)
         {
-          if(chain->steps[i].state == ASC_CHAIN_STEP_IDLE) continue;
+          if(chain->step_state[i].state == ASC_CHAIN_STEP_IDLE) continue;
           if(!chain->loop_stack_ptr) return false;
           asc_loop_stack_item_t *current_loop = &chain->loop_stack[chain->loop_stack_ptr - 1];
-          chain_step_t *loop_start = &chain->steps[current_loop->start_step_index];
+          asc_chain_step_state_t *loop_start = &chain->step_state[current_loop->start_step_index];
           chain->loop_stack_ptr--;
           loop_start->state = ASC_CHAIN_STEP_IDLE;
           current_loop->iteration_count = 0;
@@ -160,12 +401,12 @@ static bool asc_chain_execute_step_prepare(asc_chain_t* const chain, const uint3
       {
         if(chain->steps[i].type == ASC_CHAIN_STEP_LOOP_START)
         {
-          if(chain->steps[i].state != ASC_CHAIN_STEP_IDLE) continue;
+          if(chain->step_state[i].state != ASC_CHAIN_STEP_IDLE) continue;
           if(chain->loop_stack_ptr >= chain->loop_stack_size) return false;
           chain->loop_stack[chain->loop_stack_ptr].start_step_index = i;
           chain->loop_stack[chain->loop_stack_ptr].iteration_count = 0;
           chain->loop_stack_ptr++;
-          chain->steps[i].state = ASC_CHAIN_STEP_SUCCESS;
+          chain->step_state[i].state = ASC_CHAIN_STEP_SUCCESS;
         }
       }
     } 
@@ -175,34 +416,28 @@ static bool asc_chain_execute_step_prepare(asc_chain_t* const chain, const uint3
 
 /*******************************************************************************
  ** @brief  Execute jump to target step
- ** @param  none
- ** @retval none
+ ** @param  chain  Chain
+ ** @param  target Target resolved by @asc_chain_resolve_targets
+ ** @return true - jumped, false - chain should stop
  *******************************************************************************/
-static bool asc_chain_execute_step_jump(asc_chain_t* const chain, const char* const target_name) 
+static bool asc_chain_execute_step_jump(asc_chain_t* const chain, const asc_chain_target_t target) 
 {
-  if(!target_name || strcmp(target_name, "STOP") == 0) 
+  switch(target)
   {
-    return false;
+    case ASC_CHAIN_TARGET_STOP: 
+         return false;
+    case ASC_CHAIN_TARGET_NEXT: 
+         chain->current_step++;
+         return true;
+    case ASC_CHAIN_TARGET_PREV: 
+         if(!chain->current_step) return false; //first
+         chain->current_step--;
+         return true;
+    default:
+         if(!asc_chain_execute_step_prepare(chain, target)) return false;
+         chain->current_step = target;
+         return true;
   }
-  if(!target_name || strcmp(target_name, "NEXT") == 0) 
-  {
-    chain->current_step++;
-    return true;
-  }
-  if(strcmp(target_name, "PREV") == 0) 
-  {
-    if(chain->current_step) chain->current_step--; //not first
-    else return false;
-    return true;
-  }
-  
-  uint32_t target_index = asc_chain_find_step_index_by_name(chain, target_name);
-  if(target_index == UINT32_MAX) return false;
-    
-  if(!asc_chain_execute_step_prepare(chain, target_index)) return false;
-
-  chain->current_step = target_index;
-  return true;
 }
 
 /*******************************************************************************
@@ -213,12 +448,23 @@ static bool asc_chain_execute_step_jump(asc_chain_t* const chain, const char* co
 static void asc_chain_reset_state(asc_chain_t* const chain) 
 {
   DBC_REQUIRE(401, chain);
+  if(chain->call_ptr) // Leave called sub-chains, back to the chain itself
+  {
+    chain->steps = chain->call_stack[0].steps;
+    chain->step_state = chain->call_stack[0].step_state;
+    chain->step_count = chain->call_stack[0].step_count;
+    chain->call_ptr = 0;
+  }
   chain->current_step = 0;
   chain->loop_stack_ptr = 0;
-  for(uint32_t i = 0; i < chain->step_count; i++) //Reset all steps to initial state
+  chain->resume = NULL;
+  asc_timer_stop(chain->ctx, &chain->delay);
+  asc_urc_wait_stop(chain->ctx, &chain->urc);
+  asc_chain_fork_drop(chain);
+  for(uint32_t i = 0; i < chain->state_cnt; i++) //Reset all steps of chain and sub-chains to initial state
   {
-    chain->steps[i].state = ASC_CHAIN_STEP_IDLE;
-    chain->steps[i].execution_count = 0;
+    chain->step_state[i].state = ASC_CHAIN_STEP_IDLE;
+    chain->step_state[i].execution_count = 0;
   }
 }
 
@@ -233,68 +479,114 @@ static bool asc_chain_process_step(asc_chain_t* const chain)
   bool res = true;
   if(chain->current_step >= chain->step_count) // Check if chain completed
   { 
+    if(chain->call_ptr) return asc_chain_call_return(chain, true); // Sub-chain completed, back to caller
     chain->is_running = false;
     ASC_DEBUG(chain->ctx, "[ASC][INFO] Chain '%s' completed", chain->name);
+    asc_chain_branch_done(chain);
     res = false;
     return res;
   }
-  chain_step_t *step = &chain->steps[chain->current_step];
+  const chain_step_t *step = &chain->steps[chain->current_step];
+  asc_chain_step_state_t *state = &chain->step_state[chain->current_step];
   DBC_ASSERT(502, step);
   switch(step->type) 
   {
-    case ASC_CHAIN_STEP_FUNCTION:   res = asc_chain_step_function_proc(chain, step);   break;
-    case ASC_CHAIN_STEP_EXEC:       res = asc_chain_step_exec_proc(chain, step);       break;
-    case ASC_CHAIN_STEP_LOOP_START: res = asc_chain_step_loop_start_proc(chain, step); break;
-    case ASC_CHAIN_STEP_LOOP_END:   res = asc_chain_step_loop_end_proc(chain, step);   break;
-    case ASC_CHAIN_STEP_DELAY:      res = asc_chain_step_delay_proc(chain, step);      break;
+    case ASC_CHAIN_STEP_FUNCTION:   res = asc_chain_step_function_proc(chain, step, state);   break;
+    case ASC_CHAIN_STEP_EXEC:       res = asc_chain_step_exec_proc(chain, step, state);       break;
+    case ASC_CHAIN_STEP_LOOP_START: res = asc_chain_step_loop_start_proc(chain, step, state); break;
+    case ASC_CHAIN_STEP_LOOP_END:   res = asc_chain_step_loop_end_proc(chain, step, state);   break;
+    case ASC_CHAIN_STEP_DELAY:      res = asc_chain_step_delay_proc(chain, step, state);      break;
+    case ASC_CHAIN_STEP_FORK:       res = asc_chain_step_fork_proc(chain, step, state);       break;
+    case ASC_CHAIN_STEP_JOIN:       res = asc_chain_step_join_proc(chain, step, state);       break;
+    case ASC_CHAIN_STEP_WAIT_URC:   res = asc_chain_step_wait_urc_proc(chain, step, state);   break;
+    case ASC_CHAIN_STEP_CALL:       res = asc_chain_step_call_proc(chain, step, state);       break;
+    case ASC_CHAIN_STEP_CHECKPOINT: res = asc_chain_step_checkpoint_proc(chain, step, state); break;
     default: 
       ASC_DEBUG(chain->ctx, "[ASC][ERROR] Unknown step type: %d", step->type);
       chain->is_running = false;
+      asc_chain_branch_done(chain);
       return false;
   }
+  if(!chain->is_running && chain->call_ptr) // Sub-chain failed, back to caller with error
+  {
+    chain->is_running = true;
+    return asc_chain_call_return(chain, false);
+  }
+  if(!chain->is_running) asc_chain_branch_done(chain); // Stopped by step
   return true;
 }
 
 /** 
  * @brief Chain step function proc
  */
-static bool asc_chain_step_function_proc(asc_chain_t* chain, chain_step_t* const step)
+static bool asc_chain_step_function_proc(asc_chain_t* chain, const chain_step_t* const step, asc_chain_step_state_t* const state)
 {
-  switch(step->state) 
+  switch(state->state) 
   {
      case ASC_CHAIN_STEP_IDLE: 
+          if(!asc_entity_free_cnt(chain->ctx)) // Entity queue is full, hold the step back and try later
+          {
+            if(!chain->throttled) ASC_DEBUG(chain->ctx, "[ASC][INFO] Step '%s' waits for entity queue", step->name);
+            chain->throttled = true;
+            break;
+          }
+          chain->throttled = false;
           ASC_DEBUG(chain->ctx, "[ASC][INFO] Starting step '%s'", step->name); // Start executing the function
-          step->state = ASC_CHAIN_STEP_RUNNING;
-          if(!step->action.func.function(chain->ctx, asc_chain_step_cb, step->action.func.param, chain))
+          state->state = ASC_CHAIN_STEP_RUNNING;
+          chain->entity = ASC_ENTITY_HANDLE_NONE;
+          asc_entity_handle_t* const track = asc_entity_track_set(chain->ctx, &chain->entity); // Handle of group enqueued by function, not by other threads
+          const bool started = step->action.func.function(chain->ctx, asc_chain_step_cb, step->action.func.param, chain);
+          if(asc_get_init(chain->ctx).init) asc_entity_track_set(chain->ctx, track); // Enqueue deinits context on error
+          if(started)
+          {
+            if(state->state == ASC_CHAIN_STEP_RUNNING && step->action.func.watchdog) asc_timer_start(chain->ctx, &chain->delay, step->action.func.watchdog, asc_chain_step_timer_cb, chain);
+          }
+          else
           {
+            if(state->state == ASC_CHAIN_STEP_RUNNING && !asc_entity_free_cnt(chain->ctx)) // Queue was taken by others, not an error of step
+            {
+              ASC_DEBUG(chain->ctx, "[ASC][INFO] Step '%s' waits for entity queue", step->name);
+              state->state = ASC_CHAIN_STEP_IDLE;
+              chain->throttled = true;
+              break;
+            }
             ASC_DEBUG(chain->ctx, "[ASC][ERROR] Failed to start step '%s'", step->name);
-            step->state = ASC_CHAIN_STEP_ERROR;
-            step->execution_count++;
+            state->state = ASC_CHAIN_STEP_ERROR;
+            state->execution_count++;
           }
           break; 
      case ASC_CHAIN_STEP_RUNNING: // Waiting for callback - do nothing this cycle
+     case ASC_CHAIN_STEP_BACKOFF: // Waiting for retry
           break;
      case ASC_CHAIN_STEP_SUCCESS: 
-          step->state = ASC_CHAIN_STEP_IDLE;
-          step->execution_count = 0; 
-          if(!asc_chain_execute_step_jump(chain, step->action.func.success_target)) // Jump to success target
+          state->state = ASC_CHAIN_STEP_IDLE;
+          state->execution_count = 0; 
+          if(chain->resume) // Probe after MCU reset succeeded, go on from checkpoint
+          {
+            asc_chain_checkpoint_restore(chain, chain->resume);
+            break;
+          }
+          if(!asc_chain_execute_step_jump(chain, state->targets[0])) // Jump to success target
           {
             chain->is_running = false;
             return false;
           }
           break;
      case ASC_CHAIN_STEP_ERROR: 
-          ASC_DEBUG(chain->ctx, "[ASC][ERROR] Step '%s' failed (attempt %u/%u)", step->name, step->execution_count, step->action.func.max_retries);  // Function completed with error
-          if(step->execution_count < step->action.func.max_retries) // Check if we should retry
+          ASC_DEBUG(chain->ctx, "[ASC][ERROR] Step '%s' failed (attempt %u/%u)", step->name, state->execution_count, step->action.func.max_retries);  // Function completed with error
+          if(state->execution_count < step->action.func.max_retries) // Check if we should retry
           { 
-            step->state = ASC_CHAIN_STEP_IDLE;
-            ASC_DEBUG(chain->ctx, "[ASC][INFO] Retrying '%s'", step->name);
+            const uint32_t delay = step->action.func.backoff ? asc_chain_backoff_delay(chain, step->action.func.backoff, state->execution_count) : 0;
+            state->state = delay ? ASC_CHAIN_STEP_BACKOFF : ASC_CHAIN_STEP_IDLE;
+            if(delay) asc_timer_start(chain->ctx, &chain->delay, delay, asc_chain_step_timer_cb, chain);
+            ASC_DEBUG(chain->ctx, "[ASC][INFO] Retrying '%s' in %u ms", step->name, delay);
           } 
           else 
           {
-            step->state = ASC_CHAIN_STEP_IDLE;
-            step->execution_count = 0; 
-            if(!asc_chain_execute_step_jump(chain, step->action.func.error_target)) 
+            state->state = ASC_CHAIN_STEP_IDLE;
+            state->execution_count = 0; 
+            chain->resume = NULL; // Probe failed, session is lost
+            if(!asc_chain_execute_step_jump(chain, state->targets[1])) 
             {
               chain->is_running = false;
               return false;
@@ -311,13 +603,13 @@ static bool asc_chain_step_function_proc(asc_chain_t* chain, chain_step_t* const
 /** 
  * @brief Chain step exec proc
  */
-static bool asc_chain_step_exec_proc(asc_chain_t* chain, chain_step_t* const step)
+static bool asc_chain_step_exec_proc(asc_chain_t* chain, const chain_step_t* const step, asc_chain_step_state_t* const state)
 {
   if(step->action.exec.function) // Exec are executed synchronously
   {
     bool exec_result = step->action.exec.function();
     ASC_DEBUG(chain->ctx, "[ASC][INFO] Execution '%s': %s", step->name, exec_result ? "true" : "false");
-    const char *target = exec_result ? step->action.exec.true_target : step->action.exec.false_target;  // Jump based on exec result
+    const asc_chain_target_t target = state->targets[exec_result ? 0 : 1];  // Jump based on exec result
     if(!asc_chain_execute_step_jump(chain, target)) 
     {
       chain->is_running = false;
@@ -336,16 +628,17 @@ static bool asc_chain_step_exec_proc(asc_chain_t* chain, chain_step_t* const ste
 /** 
  * @brief Chain step loop start proc
  */
-static bool asc_chain_step_loop_start_proc(asc_chain_t* chain, chain_step_t* const step)
+static bool asc_chain_step_loop_start_proc(asc_chain_t* chain, const chain_step_t* const step, asc_chain_step_state_t* const state)
 {
+  (void)step;
   if(chain->loop_stack_ptr < chain->loop_stack_size) // Start of loop - push current position to stack
   {
-    if(step->state == ASC_CHAIN_STEP_IDLE) 
+    if(state->state == ASC_CHAIN_STEP_IDLE) 
     {
       chain->loop_stack[chain->loop_stack_ptr].start_step_index = chain->current_step;
       chain->loop_stack[chain->loop_stack_ptr].iteration_count = 0;
       chain->loop_stack_ptr++;
-      step->state = ASC_CHAIN_STEP_SUCCESS;
+      state->state = ASC_CHAIN_STEP_SUCCESS;
       ASC_DEBUG(chain->ctx, "[ASC][INFO] Loop start, iterations: %u", step->action.loop_count);
     }
     chain->current_step++;
@@ -362,13 +655,14 @@ static bool asc_chain_step_loop_start_proc(asc_chain_t* chain, chain_step_t* con
 /** 
  * @brief Chain step loop end proc
  */
-static bool asc_chain_step_loop_end_proc(asc_chain_t* chain, chain_step_t* const step)
+static bool asc_chain_step_loop_end_proc(asc_chain_t* chain, const chain_step_t* const step, asc_chain_step_state_t* const state)
 {
   (void)step;
+  (void)state;
   if(chain->loop_stack_ptr > 0) // End of loop - check if we should continue looping
   {
     asc_loop_stack_item_t *current_loop = &chain->loop_stack[chain->loop_stack_ptr - 1];
-    chain_step_t *loop_start = &chain->steps[current_loop->start_step_index];
+    const chain_step_t *loop_start = &chain->steps[current_loop->start_step_index];
     current_loop->iteration_count++;
 
     if(loop_start->action.loop_count == 0 || current_loop->iteration_count < loop_start->action.loop_count) // 0 = infinite loop, otherwise check iteration count
@@ -379,7 +673,7 @@ static bool asc_chain_step_loop_end_proc(asc_chain_t* chain, chain_step_t* const
     else 
     {
       chain->loop_stack_ptr--;
-      loop_start->state = ASC_CHAIN_STEP_IDLE;
+      chain->step_state[current_loop->start_step_index].state = ASC_CHAIN_STEP_IDLE;
       current_loop->iteration_count = 0;
       chain->current_step++;
       ASC_DEBUG(chain->ctx, "[ASC][INFO] Loop completed after %u iterations", current_loop->iteration_count);
@@ -397,32 +691,402 @@ static bool asc_chain_step_loop_end_proc(asc_chain_t* chain, chain_step_t* const
 /** 
  * @brief Chain step delay proc
  */
-static bool asc_chain_step_delay_proc(asc_chain_t* chain, chain_step_t* const step)
+static bool asc_chain_step_delay_proc(asc_chain_t* chain, const chain_step_t* const step, asc_chain_step_state_t* const state)
 {
-  #ifndef ASC_TEST
-  if(!step->action.delay.start) 
+  if(state->state == ASC_CHAIN_STEP_IDLE) 
   {
     ASC_DEBUG(chain->ctx, "[ASC][INFO] Chain step delay %d ms", step->action.delay.value);
     ASC_DEBUG(chain->ctx, "[ASC][INFO] Wait....", NULL);
-    step->action.delay.start = asc_get_cur_time(chain->ctx);
+    state->state = ASC_CHAIN_STEP_RUNNING;
+    asc_timer_start(chain->ctx, &chain->delay, step->action.delay.value, asc_chain_delay_cb, chain);
   }
-  if(asc_get_cur_time(chain->ctx) >= (step->action.delay.start + step->action.delay.value)) 
-  #endif
+  if(state->state == ASC_CHAIN_STEP_SUCCESS) 
   {
-    step->state = ASC_CHAIN_STEP_IDLE;
-    step->action.delay.start = 0;
+    state->state = ASC_CHAIN_STEP_IDLE;
     chain->current_step++;
   }
   return true;
 }
 
+/** 
+ * @brief Chain step fork proc
+ */
+static bool asc_chain_step_fork_proc(asc_chain_t* chain, const chain_step_t* const step, asc_chain_step_state_t* const state)
+{
+  (void)state;
+  DBC_REQUIRE(2001, step->action.fork.branches || !step->action.fork.count);
+  asc_chain_fork_drop(chain); // Branches of previous fork are not waited anymore
+  ASC_DEBUG(chain->ctx, "[ASC][INFO] Fork '%s' with %u branches", step->name, step->action.fork.count);
+  chain->fork = step->action.fork.branches;
+  chain->fork_cnt = step->action.fork.count;
+  for(uint8_t i = 0; i < chain->fork_cnt; i++)
+  {
+    asc_chain_t* const branch = chain->fork[i];
+    DBC_ASSERT(2002, branch && branch != chain);
+    asc_chain_start(branch);
+    ASC_CRITICAL_ENTER(chain->ctx)
+    branch->parent = chain;
+    ASC_CRITICAL_EXIT(chain->ctx)
+  }
+  chain->current_step++;
+  return true;
+}
+
+/** 
+ * @brief Chain step join proc
+ */
+static bool asc_chain_step_join_proc(asc_chain_t* chain, const chain_step_t* const step, asc_chain_step_state_t* const state)
+{
+  if(state->state == ASC_CHAIN_STEP_RUNNING) return true; // Waiting for branches
+  bool decided = true;
+  bool result = false;
+  ASC_CRITICAL_ENTER(chain->ctx)
+  if(step->action.join.mode == ASC_CHAIN_JOIN_ANY)
+  {
+    result = chain->fork_ok > 0;
+    decided = result || chain->fork_done == chain->fork_cnt;
+  }
+  else
+  {
+    result = chain->fork_ok == chain->fork_cnt;
+    decided = result || chain->fork_done > chain->fork_ok;
+  }
+  state->state = decided ? ASC_CHAIN_STEP_IDLE : ASC_CHAIN_STEP_RUNNING; // Branches wake chain up when finished
+  ASC_CRITICAL_EXIT(chain->ctx)
+  if(!decided) return true;
+  ASC_DEBUG(chain->ctx, "[ASC][INFO] Join '%s': %u/%u branches completed, %s", step->name, chain->fork_ok, chain->fork_cnt, result ? "SUCCESS" : "ERROR");
+  asc_chain_fork_drop(chain); // Rest of branches are not needed anymore
+  if(!asc_chain_execute_step_jump(chain, state->targets[result ? 0 : 1])) 
+  {
+    chain->is_running = false;
+    return false;
+  }
+  return true;
+}
+
+/** 
+ * @brief Chain step wait urc proc
+ */
+static bool asc_chain_step_wait_urc_proc(asc_chain_t* chain, const chain_step_t* const step, asc_chain_step_state_t* const state)
+{
+  switch(state->state) 
+  {
+     case ASC_CHAIN_STEP_IDLE: 
+          ASC_DEBUG(chain->ctx, "[ASC][INFO] Chain step wait URC '%s' %u ms", step->action.urc.prefix, step->action.urc.timeout);
+          state->state = ASC_CHAIN_STEP_RUNNING;
+          asc_urc_wait_start(chain->ctx, &chain->urc, step->action.urc.prefix, step->action.urc.timeout, asc_chain_urc_cb, chain);
+          break;
+     case ASC_CHAIN_STEP_SUCCESS: 
+     case ASC_CHAIN_STEP_ERROR: 
+          {
+            const bool found = state->state == ASC_CHAIN_STEP_SUCCESS;
+            ASC_DEBUG(chain->ctx, "[ASC][INFO] Chain step wait URC '%s': %s", step->action.urc.prefix, found ? "found" : "timeout");
+            state->state = ASC_CHAIN_STEP_IDLE;
+            if(!asc_chain_execute_step_jump(chain, state->targets[found ? 0 : 1])) 
+            {
+              chain->is_running = false;
+              return false;
+            }
+          }
+          break;
+     default: // Waiting for URC - do nothing this cycle
+          break;
+  }
+  return true;
+}
+
+/** 
+ * @brief Chain step call proc
+ */
+static bool asc_chain_step_call_proc(asc_chain_t* chain, const chain_step_t* const step, asc_chain_step_state_t* const state)
+{
+  DBC_ASSERT(2101, chain->call_ptr < chain->call_size);
+  const asc_chain_sub_t* const sub = step->action.call.sub;
+  asc_chain_frame_t* const frame = &chain->call_stack[chain->call_ptr++]; // Push return frame
+  frame->steps = chain->steps;
+  frame->step_state = chain->step_state;
+  frame->loop_stack_ptr = chain->loop_stack_ptr;
+  frame->step_count = chain->step_count;
+  frame->call_step = chain->current_step;
+  state->state = ASC_CHAIN_STEP_RUNNING;
+  ASC_DEBUG(chain->ctx, "[ASC][INFO] Chain step call '%s', depth %u", sub->name, chain->call_ptr);
+  chain->step_state = asc_chain_call_states(chain->steps, chain->step_count, chain->step_state, chain->current_step);
+  chain->steps = sub->steps;
+  chain->step_count = sub->step_count;
+  chain->current_step = 0;
+  for(uint32_t i = 0; i < chain->step_count; i++) // Every call starts sub-chain from scratch
+  {
+    chain->step_state[i].state = ASC_CHAIN_STEP_IDLE;
+    chain->step_state[i].execution_count = 0;
+  }
+  return true;
+}
+
+/**
+ * @brief Return from called sub-chain to the target of call step. Error of
+ *        target jump goes on up to the callers
+ */
+static bool asc_chain_call_return(asc_chain_t* const chain, bool ok)
+{
+  while(chain->call_ptr)
+  {
+    const asc_chain_frame_t* const frame = &chain->call_stack[--chain->call_ptr]; // Pop return frame
+    ASC_DEBUG(chain->ctx, "[ASC][INFO] Chain step call '%s': %s", frame->steps[frame->call_step].name, ok ? "success" : "error");
+    chain->steps = frame->steps;
+    chain->step_state = frame->step_state;
+    chain->step_count = frame->step_count;
+    chain->loop_stack_ptr = frame->loop_stack_ptr;
+    chain->current_step = frame->call_step;
+    chain->step_state[frame->call_step].state = ASC_CHAIN_STEP_IDLE;
+    if(asc_chain_execute_step_jump(chain, chain->step_state[frame->call_step].targets[ok ? 0 : 1])) return true;
+    ok = false;
+  }
+  chain->is_running = false;
+  asc_chain_branch_done(chain);
+  return false;
+}
+
+/** 
+ * @brief Chain step checkpoint proc
+ */
+static bool asc_chain_step_checkpoint_proc(asc_chain_t* chain, const chain_step_t* const step, asc_chain_step_state_t* const state)
+{
+  (void)state;
+  if(asc_chain_checkpoint_save(chain, step->action.checkpoint.checkpoint, step->action.checkpoint.data, step->action.checkpoint.size))
+  {
+    ASC_DEBUG(chain->ctx, "[ASC][INFO] Checkpoint '%s' saved", step->name);
+  }
+  else
+  {
+    ASC_DEBUG(chain->ctx, "[ASC][ERROR] Checkpoint '%s' doesn't fit, dropped", step->name);
+    step->action.checkpoint.checkpoint->magic = 0; // Don't resume from the older position
+  }
+  chain->current_step++;
+  return true;
+}
+
+/**
+ * @brief FNV-1a hash of data
+ */
+static uint32_t asc_chain_hash(uint32_t hash, const void* const data, const size_t size)
+{
+  for(size_t i = 0; i < size; i++)
+  {
+    hash ^= ((const uint8_t*)data)[i];
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+/**
+ * @brief Hash of types and names of steps and of all sub-chains called by them
+ */
+static uint32_t asc_chain_layout_hash(uint32_t hash, const chain_step_t* const steps, const uint32_t step_count)
+{
+  for(uint32_t i = 0; i < step_count; i++)
+  {
+    hash = asc_chain_hash(hash, &steps[i].type, sizeof(steps[i].type));
+    if(steps[i].name) hash = asc_chain_hash(hash, steps[i].name, strlen(steps[i].name));
+    if(steps[i].type == ASC_CHAIN_STEP_CALL) hash = asc_chain_layout_hash(hash, steps[i].action.call.sub->steps, steps[i].action.call.sub->step_count);
+  }
+  return hash;
+}
+
+/**
+ * @brief Hash of chain name and steps, the same for the same chain of the same firmware
+ */
+static uint32_t asc_chain_layout(const asc_chain_t* const chain)
+{
+  const chain_step_t* const steps = chain->call_ptr ? chain->call_stack[0].steps : chain->steps;
+  const uint32_t step_count = chain->call_ptr ? chain->call_stack[0].step_count : chain->step_count;
+  uint32_t hash = asc_chain_hash(2166136261u, chain->name, strlen(chain->name));
+  return asc_chain_layout_hash(hash, steps, step_count);
+}
+
+/**
+ * @brief Hash of checkpoint without magic and hash fields
+ */
+static uint32_t asc_chain_checkpoint_hash(const asc_chain_checkpoint_t* const checkpoint)
+{
+  const size_t offset = offsetof(asc_chain_checkpoint_t, layout);
+  return asc_chain_hash(2166136261u, (const uint8_t*)checkpoint + offset, sizeof(asc_chain_checkpoint_t) - offset);
+}
+
+/**
+ * @brief Restore position of chain from valid checkpoint: calls of sub-chains,
+ *        loops of chain and of each sub-chain, current step
+ */
+static void asc_chain_checkpoint_restore(asc_chain_t* const chain, const asc_chain_checkpoint_t* const checkpoint)
+{
+  asc_chain_reset_state(chain);
+  for(uint8_t level = 0; ; level++)
+  {
+    const uint8_t loop_end = (level < checkpoint->call_ptr) ? checkpoint->loop_base[level + 1] : checkpoint->loop_ptr;
+    for(uint8_t i = checkpoint->loop_base[level]; i < loop_end; i++) // Loops of this level are started
+    {
+      chain->loop_stack[i] = checkpoint->loop[i];
+      chain->step_state[checkpoint->loop[i].start_step_index].state = ASC_CHAIN_STEP_SUCCESS;
+    }
+    chain->loop_stack_ptr = loop_end;
+    chain->current_step = checkpoint->step[level];
+    if(level == checkpoint->call_ptr) break;
+    asc_chain_step_call_proc(chain, &chain->steps[chain->current_step], &chain->step_state[chain->current_step]);
+  }
+  ASC_DEBUG(chain->ctx, "[ASC][INFO] Chain '%s' resumed at '%s'", chain->name, chain->steps[chain->current_step].name);
+}
+
+/**
+ * @brief Stop branches of the last fork step which are still running and forget them
+ */
+static void asc_chain_fork_drop(asc_chain_t* const chain)
+{
+  for(uint8_t i = 0; i < chain->fork_cnt; i++)
+  {
+    asc_chain_t* const branch = chain->fork[i];
+    ASC_CRITICAL_ENTER(chain->ctx)
+    const bool own = branch->parent == chain;
+    if(own) branch->parent = NULL;
+    ASC_CRITICAL_EXIT(chain->ctx)
+    if(own && branch->is_running) asc_chain_stop(branch);
+  }
+  chain->fork = NULL;
+  chain->fork_cnt = 0;
+  chain->fork_done = 0;
+  chain->fork_ok = 0;
+}
+
+/**
+ * @brief Report finished branch to its parent chain. Branch is completed if it
+ *        passed its last step, stop by "STOP" target, by error or by user is a failure
+ */
+static void asc_chain_branch_done(asc_chain_t* const chain)
+{
+  ASC_CRITICAL_ENTER(chain->ctx)
+  asc_chain_t* const parent = chain->parent;
+  bool wake = false;
+  chain->parent = NULL;
+  if(parent)
+  {
+    parent->fork_done++;
+    if(chain->current_step >= chain->step_count) parent->fork_ok++;
+    const uint8_t id = parent->current_step;
+    wake = parent->is_running && id < parent->step_count && parent->steps[id].type == ASC_CHAIN_STEP_JOIN && parent->step_state[id].state == ASC_CHAIN_STEP_RUNNING;
+    if(wake) parent->step_state[id].state = ASC_CHAIN_STEP_SUCCESS; // Join should check branches again
+  }
+  ASC_CRITICAL_EXIT(chain->ctx)
+  if(wake && parent->sched) asc_chain_sched_push(parent);
+}
+
+/*******************************************************************************
+ ** @brief  Get moment when delay, backoff, watchdog or URC timeout of current
+ **         step of chain expires
+ ** @param  chain Chain
+ ** @return Time in units of @asc_get_cur_time_ms, @ASC_CHAIN_SCHED_NO_WAKEUP
+ **         if chain doesn't wait for them
+ *******************************************************************************/
+static uint32_t asc_chain_wakeup(const asc_chain_t* const chain)
+{
+  const asc_timer_t* const timer = asc_timer_is_active(&chain->delay) ? &chain->delay : &chain->urc.timer;
+  if(!asc_timer_is_active(timer)) return ASC_CHAIN_SCHED_NO_WAKEUP;
+  return asc_get_cur_time_ms(chain->ctx) + asc_timer_left_ms(chain->ctx, timer);
+}
+
+/*******************************************************************************
+ ** @brief  Check if chain can't make a transition now
+ ** @param  chain Chain
+ ** @return true - chain waits for cb of function, for delay or retry backoff
+ **         expiry or for free place in entity queue
+ *******************************************************************************/
+static bool asc_chain_is_blocked(const asc_chain_t* const chain)
+{
+  if(chain->throttled) return true;
+  if(chain->current_step >= chain->step_count) return false;
+  const asc_chain_step_type_t type = chain->steps[chain->current_step].type;
+  if(type != ASC_CHAIN_STEP_FUNCTION && type != ASC_CHAIN_STEP_DELAY && type != ASC_CHAIN_STEP_JOIN && type != ASC_CHAIN_STEP_WAIT_URC) return false;
+  const asc_step_exec_state_t state = chain->step_state[chain->current_step].state;
+  return state == ASC_CHAIN_STEP_RUNNING || state == ASC_CHAIN_STEP_BACKOFF;
+}
+
+/**
+ * @brief Unlink chain from queue of scheduler if it is there. Call it in critical section
+ */
+static void asc_chain_queue_unlink(asc_chain_t** const head, asc_chain_t** const tail, asc_chain_t* const chain)
+{
+  asc_chain_t* prev = NULL;
+  for(asc_chain_t* it = *head; it; prev = it, it = it->next_ready)
+  {
+    if(it != chain) continue;
+    if(prev) prev->next_ready = it->next_ready;
+    else *head = it->next_ready;
+    if(*tail == it) *tail = prev;
+    break;
+  }
+}
+
+/**
+ * @brief Append chain to the tail of queue of scheduler. Call it in critical section
+ */
+static void asc_chain_queue_append(asc_chain_t** const head, asc_chain_t** const tail, asc_chain_t* const chain)
+{
+  chain->next_ready = NULL;
+  if(*tail) (*tail)->next_ready = chain;
+  else *head = chain;
+  *tail = chain;
+}
+
+/*******************************************************************************
+ ** @brief  Put chain to the tail of ready queue of its priority. Throttled
+ **         chain leaves throttled queue, it was restarted or got cb
+ ** @param  chain Chain added to scheduler
+ ** @retval none
+ *******************************************************************************/
+static void asc_chain_sched_push(asc_chain_t* const chain)
+{
+  DBC_REQUIRE(1501, chain && chain->sched);
+  asc_chain_sched_t* const sched = chain->sched;
+  ASC_CRITICAL_ENTER(sched->ctx)
+  if(!chain->ready)
+  {
+    if(chain->throttled) asc_chain_queue_unlink(&sched->throttled_head, &sched->throttled_tail, chain);
+    chain->throttled = false;
+    chain->ready = true;
+    asc_chain_queue_append(&sched->ready_head[chain->prio], &sched->ready_tail[chain->prio], chain);
+  }
+  ASC_CRITICAL_EXIT(sched->ctx)
+}
+
 /*******************************************************************************
- ** @brief Create a new chain with copied steps (heap allocated)
+ ** @brief  Remove chain from its scheduler
+ ** @param  chain Chain added to scheduler
+ ** @retval none
+ *******************************************************************************/
+static void asc_chain_sched_remove(asc_chain_t* const chain)
+{
+  DBC_REQUIRE(1502, chain && chain->sched);
+  asc_chain_sched_t* const sched = chain->sched;
+  ASC_CRITICAL_ENTER(sched->ctx)
+  for(asc_chain_t** it = &sched->chains; *it; it = &(*it)->next)
+  {
+    if(*it == chain) { *it = chain->next; break; }
+  }
+  asc_chain_queue_unlink(&sched->ready_head[chain->prio], &sched->ready_tail[chain->prio], chain);
+  asc_chain_queue_unlink(&sched->throttled_head, &sched->throttled_tail, chain);
+  chain->sched = NULL;
+  chain->ready = false;
+  chain->throttled = false;
+  ASC_CRITICAL_EXIT(sched->ctx)
+}
+
+/*******************************************************************************
+ ** @brief Create a new chain. Steps are referenced in place and never written,
+ **        so they can be placed in ROM. Chain, loop stack and runtime state of
+ **        steps are allocated as one heap block. Targets of each step are
+ **        resolved to step indices here, so jumps don't compare names at runtime
  ** @param name       Chain name
- ** @param steps      Array of steps (will be copied)
- ** @param step_count Number of steps
+ ** @param steps      Array of steps. Should exist all the time while chain exists
+ ** @param step_count Number of steps, less than @ASC_CHAIN_TARGET_PREV
  ** @param ctx        core context
- ** @return Pointer to created chain, NULL on error
+ ** @return Pointer to created chain, NULL on error or unknown target name
  *******************************************************************************/
 asc_chain_t* asc_chain_create(const char* const name, const chain_step_t* const steps, const uint32_t step_count, asc_context_t* const ctx) 
 {
@@ -431,48 +1095,49 @@ asc_chain_t* asc_chain_create(const char* const name, const chain_step_t* const
   DBC_REQUIRE(602, name);
   DBC_REQUIRE(603, steps);
   DBC_REQUIRE(604, step_count > 0);
+  DBC_REQUIRE(605, step_count < ASC_CHAIN_TARGET_PREV);
     
-  // Calculate required loop stack size based on actual loop nesting
-  uint32_t required_stack_size = asc_chain_cal_max_loop_depth(steps, step_count);
-  
-  // Allocate memory for chain structure
-  asc_chain_t *chain = (asc_chain_t*)asc_malloc(ctx, sizeof(asc_chain_t));
-  if(!chain) 
+  // Calculate required loop stack size based on actual loop nesting, states and return stack of called sub-chains
+  asc_chain_size_t size;
+  if(!asc_chain_measure(steps, step_count, 0, &size))
   {
+    ASC_DEBUG(ctx, "[ASC][ERROR] Chain '%s' calls are too deep", name);
     return NULL;
   }
+  uint32_t required_stack_size = (size.loops > 0) ? (size.loops + 2) : 3;
   
-  // Allocate memory for step copy (ensures steps survive function return)
-  chain_step_t *steps_copy = (chain_step_t*)asc_malloc(ctx, step_count * sizeof(chain_step_t));
-  if(!steps_copy) 
+  // Allocate one block for chain structure, return stack, loop stack and step states
+  size_t call_bytes = (size.calls + 1) * sizeof(asc_chain_frame_t);
+  size_t stack_bytes = required_stack_size * sizeof(asc_loop_stack_item_t);
+  size_t state_bytes = size.states * sizeof(asc_chain_step_state_t);
+  asc_chain_t *chain = (asc_chain_t*)asc_malloc(ctx, sizeof(asc_chain_t) + call_bytes + stack_bytes + state_bytes);
+  if(!chain) 
   {
-    asc_deinit(ctx);
     return NULL;
   }
   
-  // Copy steps to heap
-  memcpy(steps_copy, steps, step_count * sizeof(chain_step_t));
-  
   // Initialize chain structure
-  memset(chain, 0, sizeof(asc_chain_t));
+  memset(chain, 0, sizeof(asc_chain_t) + call_bytes + stack_bytes + state_bytes);
   chain->name = name;
-  chain->steps = steps_copy;
+  chain->steps = steps;
   chain->step_count = step_count;
+  chain->call_stack = (asc_chain_frame_t*)(chain + 1);
+  chain->call_size = size.calls + 1;
   chain->loop_stack_size = required_stack_size; // Dynamic size based on actual needs
+  chain->loop_stack = (asc_loop_stack_item_t*)((uint8_t*)chain->call_stack + call_bytes);
+  chain->step_state = (asc_chain_step_state_t*)((uint8_t*)chain->loop_stack + stack_bytes);
+  chain->state_cnt = size.states;
   chain->ctx = ctx;
 
-  // Allocate loop stack with calculated size
-  chain->loop_stack = (asc_loop_stack_item_t*)asc_malloc(ctx, chain->loop_stack_size * sizeof(asc_loop_stack_item_t));  
-  if(!chain->loop_stack) 
+  // Resolve step targets
+  if(!asc_chain_resolve_targets(chain, steps, step_count, chain->step_state))
   {
-    asc_deinit(ctx);
+    asc_chain_destroy(chain);
     return NULL;
   }
 
-  memset(chain->loop_stack, 0, chain->loop_stack_size * sizeof(asc_loop_stack_item_t));
-
-  ASC_DEBUG(chain->ctx, "[ASC][INFO] Created chain '%s' with %u steps, loop stack: %u, memory used: %d/%d", 
-             name, step_count, required_stack_size, o1heapGetDiagnostics(asc_get_init(ctx).heap).allocated, o1heapGetDiagnostics(asc_get_init(ctx).heap).capacity);
+  ASC_DEBUG(chain->ctx, "[ASC][INFO] Created chain '%s' with %u steps, %u with sub-chains, loop stack: %u, memory used: %d/%d", 
+             name, step_count, chain->state_cnt, required_stack_size, o1heapGetDiagnostics(asc_get_init(ctx).heap).allocated, o1heapGetDiagnostics(asc_get_init(ctx).heap).capacity);
   return chain;
 }
 
@@ -486,11 +1151,16 @@ void asc_chain_destroy(asc_chain_t* const chain)
 {
   DBC_REQUIRE(701, chain);
   DBC_REQUIRE(702, asc_get_init(chain->ctx).init);
-  if(chain->steps) asc_free(chain->ctx, chain->steps);
-  if(chain->loop_stack) asc_free(chain->ctx, chain->loop_stack);
-  asc_free(chain->ctx, chain);
-  ASC_DEBUG(chain->ctx, "[ASC][INFO] Chain destroyed, memory used: %d/%d", 
-             o1heapGetDiagnostics(asc_get_init(chain->ctx).heap).allocated, o1heapGetDiagnostics(asc_get_init(chain->ctx).heap).capacity);
+  asc_context_t* const ctx = chain->ctx;
+  if(chain->sched) asc_chain_sched_remove(chain);
+  asc_timer_stop(ctx, &chain->delay);
+  asc_urc_wait_stop(ctx, &chain->urc);
+  asc_chain_fork_drop(chain);
+  chain->is_running = false;
+  asc_chain_branch_done(chain);
+  asc_free(ctx, chain);
+  ASC_DEBUG(ctx, "[ASC][INFO] Chain destroyed, memory used: %d/%d", 
+             o1heapGetDiagnostics(asc_get_init(ctx).heap).allocated, o1heapGetDiagnostics(asc_get_init(ctx).heap).capacity);
 }
 
 /*******************************************************************************
@@ -503,6 +1173,7 @@ bool asc_chain_start(asc_chain_t* const chain)
   DBC_REQUIRE(801, chain);
   asc_chain_reset_state(chain);
   chain->is_running = true;
+  if(chain->sched) asc_chain_sched_push(chain);
   ASC_DEBUG(chain->ctx, "[ASC][INFO] Chain '%s' started", chain->name);
   return true;
 }
@@ -516,6 +1187,10 @@ void asc_chain_stop(asc_chain_t* const chain)
 {
   DBC_REQUIRE(1001, chain);
   chain->is_running = false;
+  asc_timer_stop(chain->ctx, &chain->delay);
+  asc_urc_wait_stop(chain->ctx, &chain->urc);
+  asc_chain_fork_drop(chain);
+  asc_chain_branch_done(chain);
   ASC_DEBUG(chain->ctx, "[ASC][INFO] Chain '%s' stopped", chain->name);
 }
 
@@ -580,3 +1255,229 @@ const char* asc_chain_get_current_step_name(const asc_chain_t* const chain)
   const char* res = chain->steps[chain->current_step].name;
   return res;
 }
+
+/*******************************************************************************
+ ** @brief Save position of chain (current step, loop stack and sub-chain calls)
+ **        and session data to checkpoint. Current step is run again on resume
+ ** @param chain      Chain
+ ** @param checkpoint Checkpoint, e.g. in retained RAM or a copy to be written to flash
+ ** @param data       Session data, e.g. modem state known by application. Can be NULL
+ ** @param size       Size of session data, not more than @ASC_CHAIN_CHECKPOINT_DATA
+ ** @return true - saved, false - position doesn't fit in checkpoint
+ *******************************************************************************/
+bool asc_chain_checkpoint_save(const asc_chain_t* const chain, asc_chain_checkpoint_t* const checkpoint, const void* const data, const uint16_t size)
+{
+  DBC_REQUIRE(2201, chain && checkpoint);
+  DBC_REQUIRE(2202, data || !size);
+  if(size > ASC_CHAIN_CHECKPOINT_DATA || chain->loop_stack_ptr > ASC_CHAIN_CHECKPOINT_LOOPS || chain->call_ptr > ASC_CHAIN_CALL_DEPTH) return false;
+  memset(checkpoint, 0, sizeof(asc_chain_checkpoint_t));
+  for(uint8_t level = 0; level < chain->call_ptr; level++)
+  {
+    checkpoint->step[level] = chain->call_stack[level].call_step;
+    checkpoint->loop_base[level + 1] = (uint8_t)chain->call_stack[level].loop_stack_ptr;
+  }
+  checkpoint->step[chain->call_ptr] = chain->current_step;
+  checkpoint->call_ptr = chain->call_ptr;
+  checkpoint->loop_ptr = (uint8_t)chain->loop_stack_ptr;
+  memcpy(checkpoint->loop, chain->loop_stack, chain->loop_stack_ptr * sizeof(asc_loop_stack_item_t));
+  checkpoint->size = size;
+  if(size) memcpy(checkpoint->data, data, size);
+  checkpoint->layout = asc_chain_layout(chain);
+  checkpoint->hash = asc_chain_checkpoint_hash(checkpoint);
+  checkpoint->magic = ASC_CHAIN_CHECKPOINT_MAGIC;
+  return true;
+}
+
+/*******************************************************************************
+ ** @brief Check that checkpoint is filled, is not damaged and belongs to chain
+ ** @param chain      Chain
+ ** @param checkpoint Checkpoint
+ ** @return true - chain can be resumed from checkpoint
+ *******************************************************************************/
+bool asc_chain_checkpoint_valid(const asc_chain_t* const chain, const asc_chain_checkpoint_t* const checkpoint)
+{
+  DBC_REQUIRE(2301, chain && checkpoint);
+  if(checkpoint->magic != ASC_CHAIN_CHECKPOINT_MAGIC || checkpoint->hash != asc_chain_checkpoint_hash(checkpoint)) return false;
+  if(checkpoint->layout != asc_chain_layout(chain)) return false;
+  if(checkpoint->call_ptr >= chain->call_size || checkpoint->loop_ptr > chain->loop_stack_size || 
+     checkpoint->loop_ptr > ASC_CHAIN_CHECKPOINT_LOOPS || checkpoint->loop_base[0] || checkpoint->size > ASC_CHAIN_CHECKPOINT_DATA) return false;
+  const chain_step_t* steps = chain->call_ptr ? chain->call_stack[0].steps : chain->steps;
+  uint32_t step_count = chain->call_ptr ? chain->call_stack[0].step_count : chain->step_count;
+  for(uint8_t level = 0; level <= checkpoint->call_ptr; level++) // Position should point to steps of the same chain
+  {
+    const uint8_t loop_end = (level < checkpoint->call_ptr) ? checkpoint->loop_base[level + 1] : checkpoint->loop_ptr;
+    if(checkpoint->loop_base[level] > loop_end || checkpoint->step[level] >= step_count) return false;
+    for(uint8_t i = checkpoint->loop_base[level]; i < loop_end; i++)
+    {
+      if(checkpoint->loop[i].start_step_index >= step_count || steps[checkpoint->loop[i].start_step_index].type != ASC_CHAIN_STEP_LOOP_START) return false;
+    }
+    if(level == checkpoint->call_ptr) break;
+    const chain_step_t* const step = &steps[checkpoint->step[level]];
+    if(step->type != ASC_CHAIN_STEP_CALL) return false;
+    steps = step->action.call.sub->steps;
+    step_count = step->action.call.sub->step_count;
+  }
+  return true;
+}
+
+/*******************************************************************************
+ ** @brief Start chain after MCU reset from probe step instead of the first one.
+ **        If the probe succeeds, chain goes on from the checkpoint, otherwise
+ **        it goes to the error target of probe, e.g. to the full modem init
+ ** @param chain      Chain
+ ** @param checkpoint Checkpoint, should exist until probe step is done
+ ** @param probe      Name of function step of chain which checks modem session
+ **                   by one cheap request, e.g. AT+CIPSTATUS
+ ** @param data       Buffer for session data of checkpoint. Can be NULL
+ ** @param size       Size of buffer
+ ** @return true - chain is resumed, false - checkpoint is not valid, chain is not
+ **         started and should be started by @asc_chain_start
+ *******************************************************************************/
+bool asc_chain_resume(asc_chain_t* const chain, const asc_chain_checkpoint_t* const checkpoint, const char* const probe, void* const data, const uint16_t size)
+{
+  DBC_REQUIRE(2401, chain && checkpoint && probe);
+  DBC_REQUIRE(2402, data || !size);
+  if(!asc_chain_checkpoint_valid(chain, checkpoint)) 
+  {
+    ASC_DEBUG(chain->ctx, "[ASC][INFO] Chain '%s' has no valid checkpoint", chain->name);
+    return false;
+  }
+  asc_chain_reset_state(chain);
+  const uint32_t index = asc_chain_find_step_index_by_name(chain->steps, chain->step_count, probe);
+  DBC_ASSERT(2403, index != UINT32_MAX && chain->steps[index].type == ASC_CHAIN_STEP_FUNCTION);
+  if(data) memcpy(data, checkpoint->data, size < checkpoint->size ? size : checkpoint->size);
+  chain->current_step = (uint8_t)index;
+  chain->resume = checkpoint;
+  chain->is_running = true;
+  if(chain->sched) asc_chain_sched_push(chain);
+  ASC_DEBUG(chain->ctx, "[ASC][INFO] Chain '%s' probes '%s' to resume", chain->name, probe);
+  return true;
+}
+
+/*******************************************************************************
+ ** @brief Init scheduler of chains of one context. Scheduler runs a chain only
+ **        when it has work to do: after start, after step completion cb and
+ **        after delay expiry
+ ** @param sched Scheduler
+ ** @param ctx   core context
+ ** @retval none
+ *******************************************************************************/
+void asc_chain_sched_init(asc_chain_sched_t* const sched, asc_context_t* const ctx)
+{
+  DBC_REQUIRE(1601, sched);
+  DBC_REQUIRE(1602, ctx);
+  memset(sched, 0, sizeof(asc_chain_sched_t));
+  sched->ctx = ctx;
+}
+
+/*******************************************************************************
+ ** @brief Add chain to scheduler. Chain can be started before or after adding.
+ **        Ready chains run in order of priority, chains of the same priority
+ **        run round-robin
+ ** @param sched Scheduler
+ ** @param chain Chain of the same context, not added to any scheduler
+ ** @param prio  Priority less than @ASC_CHAIN_SCHED_PRIOS, 0 - the highest
+ ** @return true if added, false otherwise
+ *******************************************************************************/
+bool asc_chain_sched_add(asc_chain_sched_t* const sched, asc_chain_t* const chain, const uint8_t prio)
+{
+  DBC_REQUIRE(1701, sched);
+  DBC_REQUIRE(1702, chain);
+  DBC_REQUIRE(1703, prio < ASC_CHAIN_SCHED_PRIOS);
+  if(chain->sched || chain->ctx != sched->ctx) return false;
+  ASC_CRITICAL_ENTER(sched->ctx)
+  chain->sched = sched;
+  chain->prio = prio;
+  chain->throttled = false;
+  chain->next = sched->chains;
+  sched->chains = chain;
+  ASC_CRITICAL_EXIT(sched->ctx)
+  if(chain->is_running) asc_chain_sched_push(chain);
+  return true;
+}
+
+/*******************************************************************************
+ ** @brief Run ready chains until each of them waits for cb or delay, but not
+ **        more than @ASC_CHAIN_SCHED_BUDGET transitions per chain. Function
+ **        step is held back while entity queue is full and chain is throttled
+ **        till the place is free, then throttled chains get it in order of
+ **        priority and arrival. Completed and stopped chains stay in scheduler
+ **        until destroy and can be started again
+ ** @param sched Scheduler
+ ** @return true if scheduler has running chains, false otherwise
+ *******************************************************************************/
+bool asc_chain_sched_run(asc_chain_sched_t* const sched)
+{
+  DBC_REQUIRE(1801, sched);
+  asc_chain_t* ready[ASC_CHAIN_SCHED_PRIOS];
+  ASC_CRITICAL_ENTER(sched->ctx)
+  if(sched->throttled_head && asc_entity_free_cnt(sched->ctx)) //place is free, throttled chains try again
+  {
+    asc_chain_t* chain = sched->throttled_head;
+    sched->throttled_head = NULL;
+    sched->throttled_tail = NULL;
+    while(chain)
+    {
+      asc_chain_t* const next = chain->next_ready;
+      chain->throttled = false;
+      asc_chain_sched_push(chain);
+      chain = next;
+    }
+  }
+  for(uint8_t prio = 0; prio < ASC_CHAIN_SCHED_PRIOS; prio++) //take chains ready for now, requeued ones will run next time
+  {
+    ready[prio] = sched->ready_head[prio];
+    sched->ready_head[prio] = NULL;
+    sched->ready_tail[prio] = NULL;
+  }
+  ASC_CRITICAL_EXIT(sched->ctx)
+  for(uint8_t prio = 0; prio < ASC_CHAIN_SCHED_PRIOS; prio++)
+  {
+    asc_chain_t* chain = ready[prio];
+    while(chain)
+    {
+      asc_chain_t* const next = chain->next_ready;
+      for(uint8_t budget = ASC_CHAIN_SCHED_BUDGET; budget && chain->is_running; budget--)
+      {
+        asc_chain_process_step(chain);
+        if(asc_chain_is_blocked(chain)) break;
+      }
+      ASC_CRITICAL_ENTER(sched->ctx)
+      chain->ready = false;
+      bool requeue = chain->is_running && !asc_chain_is_blocked(chain); //budget is over or cb came while executing
+      if(chain->throttled && chain->is_running) asc_chain_queue_append(&sched->throttled_head, &sched->throttled_tail, chain);
+      else chain->throttled = false;
+      ASC_CRITICAL_EXIT(sched->ctx)
+      if(requeue) asc_chain_sched_push(chain);
+      chain = next;
+    }
+  }
+  bool res = false;
+  for(asc_chain_t* chain = sched->chains; chain; chain = chain->next) res |= chain->is_running;
+  return res;
+}
+
+/*******************************************************************************
+ ** @brief Get moment when @asc_chain_sched_run should be called next time
+ ** @param sched Scheduler
+ ** @return Time in units of @asc_get_cur_time_ms, current time if some chain
+ **         is ready, next tick if some chain is throttled,
+ **         @ASC_CHAIN_SCHED_NO_WAKEUP if chains wait only for cbs
+ *******************************************************************************/
+uint32_t asc_chain_sched_next_wakeup(asc_chain_sched_t* const sched)
+{
+  DBC_REQUIRE(1901, sched);
+  const uint32_t now = asc_get_cur_time_ms(sched->ctx);
+  for(uint8_t prio = 0; prio < ASC_CHAIN_SCHED_PRIOS; prio++)
+  {
+    if(sched->ready_head[prio]) return now;
+  }
+  uint32_t res = ASC_CHAIN_SCHED_NO_WAKEUP;
+  if(sched->throttled_head) res = asc_entity_free_cnt(sched->ctx) ? now : now + ASC_CORE_TICK_MS; //queue is freed by asc_core_proc
+  for(const asc_chain_t* chain = sched->chains; chain; chain = chain->next)
+  {
+    uint32_t wakeup = chain->is_running ? asc_chain_wakeup(chain) : ASC_CHAIN_SCHED_NO_WAKEUP;
+    if(wakeup < res) res = wakeup;
+  }
+  return res;
+}
@@ -20,6 +20,14 @@
 /*******************************************************************************
  * Global pre-processor symbols/macros ('#define')
  ******************************************************************************/
+#define ASC_CHAIN_SCHED_BUDGET      16          //Max amount of step transitions of one chain per scheduler run
+#define ASC_CHAIN_SCHED_NO_WAKEUP   UINT32_MAX  //Scheduler has nothing to wait for by time
+#define ASC_CHAIN_SCHED_PRIOS       4           //Amount of chain priorities in scheduler, 0 - the highest
+#define ASC_CHAIN_CALL_DEPTH        4           //Max nesting of sub-chain calls, deeper or recursive calls fail asc_chain_create
+#define ASC_CHAIN_CHECKPOINT_LOOPS  4           //Max nesting of loops kept by checkpoint
+#define ASC_CHAIN_CHECKPOINT_DATA   64          //Size of session data kept by checkpoint
+#define ASC_CHAIN_CHECKPOINT_MAGIC  0x41534343u //Marks filled checkpoint
+
 /**
  * @brief Create function step with success and error targets
  * @param name Step name
@@ -39,8 +47,31 @@
   .action.func.success_target = success_target_, \
   .action.func.error_target = error_target_, \
   .action.func.max_retries = retries_, \
-  .state = ASC_CHAIN_STEP_IDLE, \
-  .execution_count = 0, \
+}
+
+/**
+ * @brief Create function step with retry backoff and watchdog
+ * @param name Step name
+ * @param success_target Target step name on success (NULL for next step)
+ * @param error_target Target step name on error
+ * @param func Function to execute
+ * @param retries Maximum retry attempts
+ * @param backoff Ptr to @asc_chain_backoff_t, delay before each retry (NULL = retry at once)
+ * @param watchdog Max time of one attempt in milliseconds, then it fails (0 = no watchdog)
+ */
+#define ASC_CHAIN_RETRY(name_, success_target_, error_target_, func_, cb_, param_, meta_, retries_, backoff_, watchdog_) \
+{ \
+  .type = ASC_CHAIN_STEP_FUNCTION, \
+  .name = name_, \
+  .action.func.function = func_, \
+  .action.func.cb = cb_, \
+  .action.func.param = param_, \
+  .action.func.meta = meta_, \
+  .action.func.success_target = success_target_, \
+  .action.func.error_target = error_target_, \
+  .action.func.max_retries = retries_, \
+  .action.func.backoff = backoff_, \
+  .action.func.watchdog = watchdog_, \
 }
 
 /**
@@ -57,8 +88,6 @@
   .action.exec.function = exec_func_, \
   .action.exec.true_target = true_target_, \
   .action.exec.false_target = false_target_, \
-  .state = ASC_CHAIN_STEP_IDLE, \
-  .execution_count = 0, \
 }
 
 /**
@@ -70,8 +99,6 @@
   .type = ASC_CHAIN_STEP_LOOP_START, \
   .name = "LOOP_START", \
   .action.loop_count = iterations_, \
-  .state = ASC_CHAIN_STEP_IDLE, \
-  .execution_count = 0, \
 }
 
 /**
@@ -82,8 +109,6 @@
   .type = ASC_CHAIN_STEP_LOOP_END, \
   .name = "LOOP_END", \
   .action.loop_count = 0, \
-  .state = ASC_CHAIN_STEP_IDLE, \
-  .execution_count = 0, \
 }
 
 /**
@@ -94,10 +119,100 @@
 { \
   .type = ASC_CHAIN_STEP_DELAY, \
   .name = "DELAY", \
-  .action.delay.start = 0, \
   .action.delay.value = ms_, \
-  .state = ASC_CHAIN_STEP_IDLE, \
-  .execution_count = 0, \
+}
+
+/**
+ * @brief Create fork step, starts branch chains and goes to the next step
+ * @param name Step name
+ * @param branches Array of branch chains, each one of its own context and scheduler
+ * @param count Number of branches
+ */
+#define ASC_CHAIN_FORK(name_, branches_, count_) \
+{ \
+  .type = ASC_CHAIN_STEP_FORK, \
+  .name = name_, \
+  .action.fork.branches = branches_, \
+  .action.fork.count = count_, \
+}
+
+/**
+ * @brief Create join step, waits for branches of the last fork step
+ * @param name Step name
+ * @param mode Join mode @asc_chain_join_mode_t
+ * @param success_target Target step name when branches are joined successfully
+ * @param error_target Target step name when join failed
+ */
+#define ASC_CHAIN_JOIN(name_, mode_, success_target_, error_target_) \
+{ \
+  .type = ASC_CHAIN_STEP_JOIN, \
+  .name = name_, \
+  .action.join.mode = mode_, \
+  .action.join.success_target = success_target_, \
+  .action.join.error_target = error_target_, \
+}
+
+/**
+ * @brief Create step waiting for URC without modem traffic. Prefix is the step name
+ * @param prefix Prefix of URC, e.g. "+CREG: 1" or "CONNECT OK"
+ * @param timeout Timeout in milliseconds (0 = no timeout)
+ * @param success_target Target step name when URC is found
+ * @param error_target Target step name on timeout
+ */
+#define ASC_CHAIN_WAIT_URC(prefix_, timeout_, success_target_, error_target_) \
+{ \
+  .type = ASC_CHAIN_STEP_WAIT_URC, \
+  .name = prefix_, \
+  .action.urc.prefix = prefix_, \
+  .action.urc.timeout = timeout_, \
+  .action.urc.success_target = success_target_, \
+  .action.urc.error_target = error_target_, \
+}
+
+/**
+ * @brief Define sub-chain, shared sequence of steps which is called by chains
+ * @param name Sub-chain name
+ * @param steps Static array of steps
+ */
+#define ASC_CHAIN_SUB(name_, steps_) \
+{ \
+  .name = name_, \
+  .steps = steps_, \
+  .step_count = sizeof(steps_) / sizeof((steps_)[0]), \
+}
+
+/**
+ * @brief Create step calling sub-chain. Sub-chain returns when it passes its last
+ *        step (success) or stops by "STOP" target or error (error)
+ * @param name Step name
+ * @param sub Ptr to @asc_chain_sub_t
+ * @param success_target Target step name when sub-chain succeeded
+ * @param error_target Target step name when sub-chain failed
+ */
+#define ASC_CHAIN_CALL(name_, sub_, success_target_, error_target_) \
+{ \
+  .type = ASC_CHAIN_STEP_CALL, \
+  .name = name_, \
+  .action.call.sub = sub_, \
+  .action.call.success_target = success_target_, \
+  .action.call.error_target = error_target_, \
+}
+
+/**
+ * @brief Create checkpoint step, saves position of chain and session data to
+ *        checkpoint and goes to the next step. Resume goes to this step
+ * @param name Step name
+ * @param checkpoint Ptr to @asc_chain_checkpoint_t, e.g. in retained RAM
+ * @param data Ptr to session data to save, can be NULL
+ * @param size Size of session data, not more than @ASC_CHAIN_CHECKPOINT_DATA
+ */
+#define ASC_CHAIN_CHECKPOINT(name_, checkpoint_, data_, size_) \
+{ \
+  .type = ASC_CHAIN_STEP_CHECKPOINT, \
+  .name = name_, \
+  .action.checkpoint.checkpoint = checkpoint_, \
+  .action.checkpoint.data = data_, \
+  .action.checkpoint.size = size_, \
 }
 
 /*******************************************************************************
@@ -109,6 +224,7 @@ enum {
   ASC_CHAIN_STEP_RUNNING,    // Function started, waiting for callback
   ASC_CHAIN_STEP_SUCCESS,    // Step completed successfully
   ASC_CHAIN_STEP_ERROR,      // Step completed with error
+  ASC_CHAIN_STEP_BACKOFF,    // Function failed, waiting before retry
 };
 
 typedef uint8_t asc_chain_step_type_t;
@@ -118,6 +234,37 @@ enum {
   ASC_CHAIN_STEP_LOOP_START, // Loop start
   ASC_CHAIN_STEP_LOOP_END,   // Loop end
   ASC_CHAIN_STEP_DELAY,      // Delay
+  ASC_CHAIN_STEP_FORK,       // Start branch chains
+  ASC_CHAIN_STEP_JOIN,       // Wait for branch chains
+  ASC_CHAIN_STEP_WAIT_URC,   // Wait for URC
+  ASC_CHAIN_STEP_CALL,       // Call sub-chain
+  ASC_CHAIN_STEP_CHECKPOINT, // Save checkpoint
+};
+
+typedef uint8_t asc_chain_backoff_type_t;
+enum {
+  ASC_CHAIN_BACKOFF_FIXED,   // The same delay before each retry
+  ASC_CHAIN_BACKOFF_EXP,     // Delay is doubled after each retry
+};
+
+typedef struct {
+  asc_chain_backoff_type_t type; // Backoff type
+  uint8_t jitter;                // Random part of delay in percent, delay is reduced by it
+  uint32_t base;                 // Delay before the first retry in milliseconds
+  uint32_t cap;                  // Max delay in milliseconds (0 = no cap)
+} asc_chain_backoff_t;
+
+typedef uint8_t asc_chain_join_mode_t;
+enum {
+  ASC_CHAIN_JOIN_ALL,        // Success when all branches complete, error on the first failed one
+  ASC_CHAIN_JOIN_ANY,        // Success on the first completed branch, error when all branches fail
+};
+
+typedef uint8_t asc_chain_target_t;
+enum {
+  ASC_CHAIN_TARGET_PREV = 0xFD, // Step -1
+  ASC_CHAIN_TARGET_NEXT = 0xFE, // Step +1
+  ASC_CHAIN_TARGET_STOP = 0xFF, // End of chain execution
 };
 
 typedef struct {
@@ -125,6 +272,10 @@ typedef struct {
   uint32_t iteration_count;     // current loop iteration
 } asc_loop_stack_item_t;
 
+struct asc_chain_t;
+struct asc_chain_sub_t;
+struct asc_chain_checkpoint_t;
+
 typedef struct {
   union
   {
@@ -135,6 +286,8 @@ typedef struct {
       void* meta;                  // meta for function executing
       const char *success_target;  // Target step on success
       const char *error_target;    // Target step on error
+      const asc_chain_backoff_t *backoff; // Delay before retry, NULL - retry at once
+      uint32_t watchdog;           // Max time of one attempt in milliseconds (0 = no watchdog)
       uint8_t max_retries;         // Maximum retry attempts
     } func;   
     struct {   
@@ -143,29 +296,114 @@ typedef struct {
       const char *false_target;    // Target step when false
     } exec;
     struct {   
-      uint32_t start;              // Start moment
       uint32_t value;              // Delay in milliseconds
     } delay;    
+    struct {   
+      struct asc_chain_t* const* branches; // Branch chains
+      uint8_t count;               // Number of branches
+    } fork;    
+    struct {   
+      const char *success_target;  // Target step when joined
+      const char *error_target;    // Target step when join failed
+      asc_chain_join_mode_t mode;  // Join mode
+    } join;    
+    struct {   
+      const char *prefix;          // Prefix of URC
+      uint32_t timeout;            // Timeout in milliseconds
+      const char *success_target;  // Target step when URC is found
+      const char *error_target;    // Target step on timeout
+    } urc;    
+    struct {   
+      const struct asc_chain_sub_t* sub; // Called sub-chain
+      const char *success_target;  // Target step when sub-chain succeeded
+      const char *error_target;    // Target step when sub-chain failed
+    } call;    
+    struct {   
+      struct asc_chain_checkpoint_t* checkpoint; // Checkpoint to save
+      const void* data;            // Session data to save
+      uint16_t size;               // Size of session data
+    } checkpoint;    
     uint8_t loop_count;            // Loop iterations (0 = infinite)
   } action;      
   const char *name;                // Step name for identification
   asc_chain_step_type_t type;      // Step type           
+} chain_step_t;
+
+typedef struct asc_chain_sub_t {
+  const char *name;                // Sub-chain name
+  const chain_step_t *steps;       // Array of steps
+  uint8_t step_count;              // Number of steps
+} asc_chain_sub_t;
+
+typedef struct {
+  asc_chain_target_t targets[2];   // Resolved targets: [success/true][error/false]
   asc_step_exec_state_t state;     // Current execution state
   uint8_t execution_count;         // Number of execution attempts
-} chain_step_t;
+} asc_chain_step_state_t;
+
+typedef struct {
+  const chain_step_t *steps;          // Steps of caller
+  asc_chain_step_state_t* step_state; // Runtime state of steps of caller
+  uint32_t loop_stack_ptr;            // Loop stack pointer of caller
+  uint8_t step_count;                 // Number of steps of caller
+  uint8_t call_step;                  // Index of call step in caller
+} asc_chain_frame_t;
+
+typedef struct asc_chain_checkpoint_t {
+  uint32_t magic;                                      // @ASC_CHAIN_CHECKPOINT_MAGIC
+  uint32_t hash;                                       // Hash of the rest of checkpoint, detects garbage in retained RAM
+  uint32_t layout;                                     // Hash of chain name and steps, detects checkpoint of other firmware
+  uint8_t step[ASC_CHAIN_CALL_DEPTH + 1];              // Current step of chain and of each called sub-chain
+  uint8_t loop_base[ASC_CHAIN_CALL_DEPTH + 1];         // Loop stack pointer at entry of chain and of each called sub-chain
+  uint8_t call_ptr;                                    // Depth of calls
+  uint8_t loop_ptr;                                    // Loop stack pointer
+  asc_loop_stack_item_t loop[ASC_CHAIN_CHECKPOINT_LOOPS]; // Loop stack
+  uint16_t size;                                       // Size of session data
+  uint8_t data[ASC_CHAIN_CHECKPOINT_DATA];             // Session data, e.g. modem state known by application
+} asc_chain_checkpoint_t;
 
 typedef struct asc_chain_t {
   const char *name;                   // Chain name
-  chain_step_t *steps;                // Array of steps 
+  const chain_step_t *steps;          // Array of steps of current frame, referenced in place (can be in ROM)
   uint32_t loop_stack_ptr;            // Loop stack pointer
-  uint8_t step_count;                 // Number of steps
+  uint8_t step_count;                 // Number of steps of current frame
   uint8_t current_step;               // Current step index
   uint16_t loop_stack_size;           // Maximum loop stack size
   asc_loop_stack_item_t* loop_stack;  // Loop stack for nested loops
+  asc_chain_step_state_t* step_state; // Runtime state of each step of current frame
+  asc_chain_frame_t* call_stack;      // Return stack of sub-chain calls, [0] - frame of chain itself
+  uint8_t call_ptr;                   // Return stack pointer, 0 - steps of chain itself are executed
+  uint8_t call_size;                  // Return stack size
+  uint16_t state_cnt;                 // Number of step states of chain and all called sub-chains
+  asc_timer_t delay;                  // Timer of current step: delay, retry backoff or watchdog
+  asc_entity_handle_t entity;         // Entity of current attempt of function step, cancelled by watchdog
+  uint32_t rnd;                       // State of random generator for backoff jitter
+  const asc_chain_checkpoint_t* resume; // Checkpoint to go to when probe step succeeds, NULL - none
+  asc_urc_wait_t urc;                 // Waiter of current URC step
   asc_context_t* ctx;                 // Core context
+  struct asc_chain_t* const* fork;    // Branches of the last fork step
+  struct asc_chain_t* parent;         // Chain which forked this one as a branch, NULL - none
+  uint8_t fork_cnt;                   // Number of branches of the last fork step
+  uint8_t fork_done;                  // Number of finished branches
+  uint8_t fork_ok;                    // Number of completed branches
+  struct asc_chain_sched_t* sched;    // Scheduler of chain, NULL - chain is polled by asc_chain_run
+  struct asc_chain_t* next;           // Next chain of scheduler
+  struct asc_chain_t* next_ready;     // Next chain in ready or throttled queue of scheduler
+  uint8_t prio;                       // Priority in scheduler, 0 - the highest
+  bool ready;                         // Chain is in ready queue or is executing by scheduler
+  bool throttled;                     // Function step waits for free place in entity queue
   bool is_running;                    // Chain execution flag
 } asc_chain_t;
 
+typedef struct asc_chain_sched_t {
+  asc_chain_t* chains;                                // Chains of scheduler
+  asc_chain_t* ready_head[ASC_CHAIN_SCHED_PRIOS];     // Ready queue head of each priority
+  asc_chain_t* ready_tail[ASC_CHAIN_SCHED_PRIOS];     // Ready queue tail of each priority
+  asc_chain_t* throttled_head;                        // Chains waiting for free place in entity queue
+  asc_chain_t* throttled_tail;                        // Tail of throttled chains
+  asc_context_t* ctx;                                 // Core context
+} asc_chain_sched_t;
+
 /*******************************************************************************
  * Local type definitions ('typedef')
  ******************************************************************************/
@@ -176,12 +414,15 @@ typedef struct asc_chain_t {
  * Global function prototypes (definition in C source)
  ******************************************************************************/
 /*******************************************************************************
- ** @brief Create a new chain with copied steps (heap allocated)
+ ** @brief Create a new chain. Steps are referenced in place and never written,
+ **        so they can be placed in ROM. Chain, loop stack and runtime state of
+ **        steps are allocated as one heap block. Targets of each step are
+ **        resolved to step indices here, so jumps don't compare names at runtime
  ** @param name       Chain name
- ** @param steps      Array of steps (will be copied)
- ** @param step_count Number of steps
+ ** @param steps      Array of steps. Should exist all the time while chain exists
+ ** @param step_count Number of steps, less than @ASC_CHAIN_TARGET_PREV
  ** @param ctx        core context
- ** @return Pointer to created chain, NULL on error
+ ** @return Pointer to created chain, NULL on error or unknown target name
  *******************************************************************************/
 asc_chain_t* asc_chain_create(const char* const name, const chain_step_t* const steps, const uint32_t step_count, asc_context_t* const ctx);
 
@@ -241,4 +482,80 @@ uint32_t asc_chain_get_current_step(const asc_chain_t* const chain);
  *******************************************************************************/
 const char* asc_chain_get_current_step_name(const asc_chain_t* const chain);
 
+/*******************************************************************************
+ ** @brief Save position of chain (current step, loop stack and sub-chain calls)
+ **        and session data to checkpoint. Current step is run again on resume
+ ** @param chain      Chain
+ ** @param checkpoint Checkpoint, e.g. in retained RAM or a copy to be written to flash
+ ** @param data       Session data, e.g. modem state known by application. Can be NULL
+ ** @param size       Size of session data, not more than @ASC_CHAIN_CHECKPOINT_DATA
+ ** @return true - saved, false - position doesn't fit in checkpoint
+ *******************************************************************************/
+bool asc_chain_checkpoint_save(const asc_chain_t* const chain, asc_chain_checkpoint_t* const checkpoint, const void* const data, const uint16_t size);
+
+/*******************************************************************************
+ ** @brief Check that checkpoint is filled, is not damaged and belongs to chain
+ ** @param chain      Chain
+ ** @param checkpoint Checkpoint
+ ** @return true - chain can be resumed from checkpoint
+ *******************************************************************************/
+bool asc_chain_checkpoint_valid(const asc_chain_t* const chain, const asc_chain_checkpoint_t* const checkpoint);
+
+/*******************************************************************************
+ ** @brief Start chain after MCU reset from probe step instead of the first one.
+ **        If the probe succeeds, chain goes on from the checkpoint, otherwise
+ **        it goes to the error target of probe, e.g. to the full modem init
+ ** @param chain      Chain
+ ** @param checkpoint Checkpoint, should exist until probe step is done
+ ** @param probe      Name of function step of chain which checks modem session
+ **                   by one cheap request, e.g. AT+CIPSTATUS
+ ** @param data       Buffer for session data of checkpoint. Can be NULL
+ ** @param size       Size of buffer
+ ** @return true - chain is resumed, false - checkpoint is not valid, chain is not
+ **         started and should be started by @asc_chain_start
+ *******************************************************************************/
+bool asc_chain_resume(asc_chain_t* const chain, const asc_chain_checkpoint_t* const checkpoint, const char* const probe, void* const data, const uint16_t size);
+
+/*******************************************************************************
+ ** @brief Init scheduler of chains of one context. Scheduler runs a chain only
+ **        when it has work to do: after start, after step completion cb and
+ **        after delay expiry
+ ** @param sched Scheduler
+ ** @param ctx   core context
+ ** @retval none
+ *******************************************************************************/
+void asc_chain_sched_init(asc_chain_sched_t* const sched, asc_context_t* const ctx);
+
+/*******************************************************************************
+ ** @brief Add chain to scheduler. Chain can be started before or after adding.
+ **        Ready chains run in order of priority, chains of the same priority
+ **        run round-robin
+ ** @param sched Scheduler
+ ** @param chain Chain of the same context, not added to any scheduler
+ ** @param prio  Priority less than @ASC_CHAIN_SCHED_PRIOS, 0 - the highest
+ ** @return true if added, false otherwise
+ *******************************************************************************/
+bool asc_chain_sched_add(asc_chain_sched_t* const sched, asc_chain_t* const chain, const uint8_t prio);
+
+/*******************************************************************************
+ ** @brief Run ready chains until each of them waits for cb or delay, but not
+ **        more than @ASC_CHAIN_SCHED_BUDGET transitions per chain. Function
+ **        step is held back while entity queue is full and chain is throttled
+ **        till the place is free, then throttled chains get it in order of
+ **        priority and arrival. Completed and stopped chains stay in scheduler
+ **        until destroy and can be started again
+ ** @param sched Scheduler
+ ** @return true if scheduler has running chains, false otherwise
+ *******************************************************************************/
+bool asc_chain_sched_run(asc_chain_sched_t* const sched);
+
+/*******************************************************************************
+ ** @brief Get moment when @asc_chain_sched_run should be called next time
+ ** @param sched Scheduler
+ ** @return Time in units of @asc_get_cur_time_ms, current time if some chain
+ **         is ready, next tick if some chain is throttled,
+ **         @ASC_CHAIN_SCHED_NO_WAKEUP if chains wait only for cbs
+ *******************************************************************************/
+uint32_t asc_chain_sched_next_wakeup(asc_chain_sched_t* const sched);
+
 #endif // ASC_CHAIN_H
\ No newline at end of file
@@ -20,6 +20,14 @@
  ******************************************************************************/
 DBC_MODULE_NAME("ASC_CORE")
 
+#if (ASC_ENTITY_LANES < 1) || (ASC_ENTITY_LANES > 4) || (ASC_ENTITY_LANE_DEFAULT >= ASC_ENTITY_LANES)
+  #error "Wrong config of entity lanes"
+#endif
+
+#if (ASC_EVENT_RING_SIZE < 2) || (ASC_EVENT_RING_SIZE > 255) || (ASC_EVENT_URC_SIZE < 1) || (ASC_EVENT_URC_SIZE > 254)
+  #error "Wrong config of event ring"
+#endif
+
 /*******************************************************************************
  * Global variable definitions (declared in header file with 'extern')
  ******************************************************************************/
@@ -35,8 +43,17 @@ static void asc_simcom_parcer_find_rs_data(const ringslice_t* const me, const ri
 static bool asc_simcom_parcer_post_proc(asc_context_t* const ctx, const ringslice_t* const me, const ringslice_t* const rs_req, const ringslice_t* const rs_res, 
                                         const ringslice_t* const rs_data, const asc_item_t* const item, const asc_entity_t* const entity);
 
+static bool asc_simcom_batch_parcer(asc_context_t* const ctx, const ringslice_t rs_me, const asc_item_t* const item, const asc_entity_t* const entity);
+static ringslice_t asc_simcom_parcer_next_line(ringslice_t* const rs_rest);
+static bool asc_simcom_lines_parcer(asc_context_t* const ctx, const ringslice_t rs_me, const asc_item_t* const item, const asc_entity_t* const entity);
+static char* asc_entity_batch_req_build(asc_context_t* const ctx, const asc_item_t* const item, const uint8_t item_cnt);
+
 static bool asc_string_boolean_ops(const ringslice_t* const rs_data, const char* const pattern);
 static bool asc_cmd_sscanf(const ringslice_t* const rs_data, const asc_item_t* const item);
+static uint8_t asc_entity_first(asc_context_t* const ctx);
+static void asc_entity_free(asc_context_t* const ctx, asc_entity_t* const cur_entity);
+static void asc_tx_proc(asc_context_t* const ctx);
+static void asc_submit_flush(asc_context_t* const ctx);
 
 /*******************************************************************************
  * Local types definitions
@@ -47,6 +64,128 @@ static bool asc_cmd_sscanf(const ringslice_t* const rs_data, const asc_item_t* c
 /*******************************************************************************
  * Function implementation - global ('extern') and local ('static')
  ******************************************************************************/
+/**
+ * @brief Get write position of rx ring. Data before it is visible to core after the call
+ */
+static uint16_t asc_ring_head(const asc_ring_buffer_t* const ring)
+{
+  const uint16_t head = ring->head;
+  ASC_RING_ACQUIRE()
+  return head;
+}
+
+/**
+ * @brief Mark data of rx ring as processed up to last. Read position never goes backwards,
+ *        the place is kept till @asc_ring_consume, so slices passed to cbs stay valid
+ */
+static void asc_ring_read(asc_context_t* const ctx, const ringslice_cnt_t last)
+{
+  const asc_ring_buffer_t* const rx = ctx->init_struct.rx_buff;
+  const uint16_t pos = (uint16_t)(last % rx->size);
+  const uint16_t done = (uint16_t)((ctx->rx_read + rx->size - rx->tail) % rx->size);
+  if((uint16_t)((pos + rx->size - rx->tail) % rx->size) > done) ctx->rx_read = pos;
+}
+
+/**
+ * @brief Release processed data of rx ring to producer once cbs are done with it. Only core writes tail
+ */
+static void asc_ring_consume(asc_context_t* const ctx)
+{
+  if(ctx->rx_read == ctx->init_struct.rx_buff->tail) return;
+  ASC_RING_RELEASE() //data is read before producer can reuse its place
+  ctx->init_struct.rx_buff->tail = ctx->rx_read;
+}
+
+/**
+ * @brief Event ring is full, core holds parse till @asc_event_dispatch
+ */
+static bool asc_event_full(const asc_context_t* const ctx)
+{
+  return ctx->events.defer && (uint8_t)((ctx->events.head + 1u) % ASC_EVENT_RING_SIZE) == ctx->events.tail;
+}
+
+/**
+ * @brief Caller runs in a deferred cb, asc_core_proc can run in other thread now.
+ *        Call it in critical section
+ */
+static bool asc_event_in_dispatch(const asc_context_t* const ctx)
+{
+  return ctx->events.dispatch && ctx->events.dispatcher == asc_port_thread();
+}
+
+/**
+ * @brief Put event to event ring of context. Producers are serialized by critical section,
+ *        @asc_event_dispatch is the single consumer
+ * @return false - call cb in place, the ring is full
+ */
+static bool asc_event_push(asc_context_t* const ctx, const asc_event_t* const event)
+{
+  asc_event_ring_t* const ring = &ctx->events;
+  ASC_CRITICAL_ENTER(ctx)
+  const uint8_t head = ring->head;
+  const uint8_t next = (uint8_t)((head + 1u) % ASC_EVENT_RING_SIZE);
+  if(next == ring->tail)
+  {
+    ++ring->overflow;
+    ASC_CRITICAL_EXIT(ctx)
+    return false;
+  }
+  ASC_RING_ACQUIRE() //place is free only after dispatch has copied its event
+  ring->event[head] = *event;
+  ASC_RING_RELEASE() //event is written before dispatch sees new head
+  ring->head = next;
+  ASC_CRITICAL_EXIT(ctx)
+  return true;
+}
+
+/**
+ * @brief Complete entity: call its cb or defer it. Deferred cb owns usefull data of entity
+ */
+static void asc_event_entity(asc_context_t* const ctx, asc_entity_t* const entity, const bool result)
+{
+  if(!entity->cb) return;
+  if(ctx->events.defer)
+  {
+    const asc_event_t event = {.type = ASC_EVENT_ENTITY, .result = result, .entity_cb = entity->cb, .meta = entity->meta, .data = entity->data_size ? entity->data : NULL};
+    if(asc_event_push(ctx, &event))
+    {
+      entity->data_size = 0; //data is freed after deferred cb, not with entity
+      return;
+    }
+  }
+  entity->cb(result, entity->meta, entity->data);
+}
+
+/**
+ * @brief Call cb of URC or defer it with copy of URC, slice of rx ring is released after proc
+ */
+static void asc_event_urc(asc_context_t* const ctx, const asc_urc_cb cb, const ringslice_t rs_urc)
+{
+  if(ctx->events.defer)
+  {
+    asc_event_t event = {.type = ASC_EVENT_URC, .urc_cb = cb};
+    const ringslice_cnt_t len = ringslice_len(&rs_urc);
+    event.urc_len = len < ASC_EVENT_URC_SIZE ? (uint8_t)len : ASC_EVENT_URC_SIZE;
+    for(uint8_t i = 0; i < event.urc_len; i++) event.urc[i] = (char)rs_urc.buf[(rs_urc.first + i) % rs_urc.buf_size];
+    if(asc_event_push(ctx, &event)) return;
+  }
+  cb(rs_urc);
+}
+
+/**
+ * @brief Call cb of URC waiter or defer it
+ */
+static void asc_event_urc_wait(asc_context_t* const ctx, const asc_urc_wait_t* const wait, const bool result)
+{
+  if(!wait->cb) return;
+  if(ctx->events.defer)
+  {
+    const asc_event_t event = {.type = ASC_EVENT_URC_WAIT, .result = result, .wait_cb = wait->cb, .meta = wait->arg};
+    if(asc_event_push(ctx, &event)) return;
+  }
+  wait->cb(result, wait->arg);
+}
+
 /*******************************************************************************
  ** @brief  Function to parce the RX ring buffer for proc with existing entities in queue.
  **         Using choosen parcer for item.
@@ -75,6 +214,8 @@ static bool asc_cmd_ring_parcer(asc_context_t* const ctx, const asc_entity_t* co
     {
       case ASC_PARCE_SIMCOM: res = asc_simcom_parcer(ctx, rs_me, item, entity); break;
       case ASC_PARCE_RAW:    res = asc_raw_parcer(ctx, rs_me, item, entity);    break;
+      case ASC_PARCE_SIMCOM_BATCH: res = asc_simcom_batch_parcer(ctx, rs_me, item, entity); break;
+      case ASC_PARCE_SIMCOM_LINES: res = asc_simcom_lines_parcer(ctx, rs_me, item, entity); break;
       default: break;
     }
   }
@@ -102,7 +243,6 @@ static bool asc_raw_parcer(asc_context_t* const ctx, const ringslice_t rs_me, co
   
   int res = true;  
 
-  ringslice_cnt_t proced_data = 0;
   ringslice_t rs_data = rs_me;
   
   if(item->answ.prefix)
@@ -110,17 +250,11 @@ static bool asc_raw_parcer(asc_context_t* const ctx, const ringslice_t rs_me, co
     char* prefix = strncmp(item->answ.prefix, ASC_CMD_SAVE, strlen(ASC_CMD_SAVE)) ? item->answ.prefix : item->answ.prefix +strlen(ASC_CMD_SAVE);
     res = asc_string_boolean_ops(&rs_data, prefix);
     if(item->answ.format) res = asc_cmd_sscanf(&rs_data, item);
-    if(res) proced_data = (uint16_t)rs_data.last;
+    #ifndef ASC_TEST
+    if(res) asc_ring_read(ctx, rs_data.last);
+    #endif
   }
 
-  #ifndef ASC_TEST
-  if(proced_data)
-  {
-    ctx->init_struct.rx_buff->tail = proced_data;
-    ringslice_t tmp = ringslice_initializer(rs_me.buf, rs_me.buf_size, rs_me.first, proced_data);
-    ctx->init_struct.rx_buff->count -= ringslice_len(&tmp);
-  }
-  #endif
   if(item->answ.cb) item->answ.cb(ringslice_initializer(rs_me.buf, rs_me.buf_size, rs_data.first, rs_me.last), res, entity->data);
   return res; 
 }
@@ -254,8 +388,6 @@ static bool asc_simcom_parcer_post_proc(asc_context_t* const ctx, const ringslic
   bool rs_res_exist  = !ringslice_is_empty(rs_res);
   bool rs_data_exist = !ringslice_is_empty(rs_data);
 
-  ringslice_cnt_t proced_data = 0;
-  
   char* prefix = item->answ.prefix;
   if(prefix && !strncmp(prefix, ASC_CMD_SAVE, strlen(ASC_CMD_SAVE))) prefix += strlen(ASC_CMD_SAVE);
 
@@ -265,19 +397,25 @@ static bool asc_simcom_parcer_post_proc(asc_context_t* const ctx, const ringslic
            if(!prefix) break;
            res = asc_string_boolean_ops(rs_data, prefix);
            if(item->answ.format) res = asc_cmd_sscanf(rs_data, item);
-           if(res) proced_data = (uint16_t)rs_data->last;
+           #ifndef ASC_TEST
+           if(res) asc_ring_read(ctx, rs_data->last);
+           #endif
            break;
       case 0x05: //0b101 - REQ NULL DATA (REQ +PREFIX)
            if(!item->req || !prefix) break;
            res = asc_string_boolean_ops(rs_data, prefix);
            if(item->answ.format) res = asc_cmd_sscanf(rs_data, item);
-           if(res) proced_data = (uint16_t)rs_data->last;
+           #ifndef ASC_TEST
+           if(res) asc_ring_read(ctx, rs_data->last);
+           #endif
            break;
       case 0x06: //0b110 - REQ RES NULL (REQ, NO PREFIX, NO FORMAT)
            if(!item->req || ringslice_strcmp(rs_res, ASC_CMD_ERROR) == 0) res = false;
            else if(prefix || item->answ.format) res = false;
            else res = true;
-           if(res) proced_data = (uint16_t)rs_res->last;
+           #ifndef ASC_TEST
+           if(res) asc_ring_read(ctx, rs_res->last);
+           #endif
            break;
       case 0x07: //0b111 - REQ RES DATA (REQ)
            if(!item->req) break;
@@ -288,21 +426,13 @@ static bool asc_simcom_parcer_post_proc(asc_context_t* const ctx, const ringslic
              if(item->answ.format) res = asc_cmd_sscanf(rs_data, item);
            }
            #ifndef ASC_TEST
-           if(ringslice_is_later_than(rs_res, rs_data)) proced_data = (uint16_t)rs_res->last;
-           else                                         proced_data = (uint16_t)rs_data->last;
+           asc_ring_read(ctx, rs_res->last); //RES can be before or after DATA
+           asc_ring_read(ctx, rs_data->last);
            #endif
            break;
       default: 
            break;
   }
-  #ifndef ASC_TEST
-  if(proced_data)
-  {
-    ctx->init_struct.rx_buff->tail = proced_data;
-    ringslice_t tmp = ringslice_initializer(me->buf, me->buf_size, me->first, proced_data);
-    ctx->init_struct.rx_buff->count -= ringslice_len(&tmp);
-  }
-  #endif
   if(item->answ.cb) 
   {
     ringslice_t cb_rs_data = rs_data_exist ? ringslice_initializer(me->buf, me->buf_size, rs_data->first, me->last) : (ringslice_t){0};
@@ -311,6 +441,121 @@ static bool asc_simcom_parcer_post_proc(asc_context_t* const ctx, const ringslic
   return res; 
 }
 
+/*******************************************************************************
+ ** @brief  Implementations for simcom batch parcer kind of: 
+ **         ECHO(AT+A;+B)\r\r\nDATA_A\r\n\r\nDATA_B\r\n\r\nRES\r\n
+ **         Each sub-item of the batch head takes the next non empty data line
+ **         in the order they were concatenated.
+ ** @param  ctx     core context
+ ** @param  rs_me   slice of origin buffer
+ ** @param  entity  current proc entity
+ ** @param  item    current proc item (batch head)
+ ** @return true - success parce
+ **         false - failure parce and handle / or no data in buff
+ ******************************************************************************/
+static bool asc_simcom_batch_parcer(asc_context_t* const ctx, const ringslice_t rs_me, const asc_item_t* const item, const asc_entity_t* const entity)
+{
+  DBC_REQUIRE(170, ctx);
+  DBC_REQUIRE(171, item);
+  DBC_REQUIRE(172, entity);
+
+  ringslice_t rs_req = {0};
+  ringslice_t rs_res = {0};
+
+  asc_simcom_parcer_find_rs_req(&rs_me, &rs_req, item->req);
+  asc_simcom_parcer_find_rs_res(&rs_me, &rs_req, &rs_res);
+  if(ringslice_is_empty(&rs_req) || ringslice_is_empty(&rs_res)) return false; // Wait for the whole answer, single RES closes the batch
+
+  bool res = ringslice_strcmp(&rs_res, ASC_CMD_ERROR) != 0;
+  ringslice_t rs_rest = ringslice_subslice_gap(&rs_req, &rs_res);
+  for(uint8_t i = 1; i <= item->meta.batch_cnt; i++)
+  {
+    const asc_item_t* const sub = &item[i];
+    ringslice_t rs_line = asc_simcom_parcer_next_line(&rs_rest);
+    bool sub_res = res && !ringslice_is_empty(&rs_line);
+    char* prefix = sub->answ.prefix;
+    if(prefix && !strncmp(prefix, ASC_CMD_SAVE, strlen(ASC_CMD_SAVE))) prefix += strlen(ASC_CMD_SAVE);
+    if(sub_res && prefix) sub_res = asc_string_boolean_ops(&rs_line, prefix);
+    if(sub_res && sub->answ.format) sub_res = asc_cmd_sscanf(&rs_line, sub);
+    if(sub->answ.cb) sub->answ.cb(rs_line, sub_res, entity->data);
+    if(!sub_res) ASC_DEBUG(ctx, "[ASC][ERROR] Batch sub cmd %d/%d failed", i, item->meta.batch_cnt);
+    res = res && sub_res;
+  }
+  #ifndef ASC_TEST
+  asc_ring_read(ctx, rs_res.last);
+  #endif
+  return res;
+}
+
+/** 
+ * @brief Cut next non empty CRLF line from the data slice, slice is walked once
+ */
+static ringslice_t asc_simcom_parcer_next_line(ringslice_t* const rs_rest)
+{
+  DBC_REQUIRE(175, rs_rest);
+  while(!ringslice_is_empty(rs_rest))
+  {
+    ringslice_t rs_crlf = ringslice_strstr(rs_rest, ASC_CMD_CRLF);
+    ringslice_t rs_line = *rs_rest;
+    if(ringslice_is_empty(&rs_crlf)) *rs_rest = (ringslice_t){0};
+    else
+    {
+      rs_line = ringslice_initializer(rs_rest->buf, rs_rest->buf_size, rs_rest->first, rs_crlf.first);
+      *rs_rest = ringslice_subslice_after(rs_rest, &rs_crlf, 0);
+    }
+    if(!ringslice_is_empty(&rs_line)) return rs_line;
+  }
+  return (ringslice_t){0};
+}
+
+/*******************************************************************************
+ ** @brief  Implementations for simcom multi-line parcer kind of:
+ **         ECHO\r\r\nDATA_1\r\nDATA_2\r\n...\r\nRES\r\n
+ **         Data between the echo and the result is split into lines in a single
+ **         pass, each line which has [PREFIX] (if specified) is formatted with 
+ **         [FORMAT] (if specified) and passed to the item callback.
+ ** @param  ctx     core context
+ ** @param  rs_me   slice of origin buffer
+ ** @param  entity  current proc entity
+ ** @param  item    current proc item
+ ** @return true - success parce (OK result, even with no data lines)
+ **         false - failure parce and handle / or no data in buff
+ ******************************************************************************/
+static bool asc_simcom_lines_parcer(asc_context_t* const ctx, const ringslice_t rs_me, const asc_item_t* const item, const asc_entity_t* const entity)
+{
+  DBC_REQUIRE(180, ctx);
+  DBC_REQUIRE(181, item);
+  DBC_REQUIRE(182, entity);
+
+  ringslice_t rs_req = {0};
+  ringslice_t rs_res = {0};
+
+  asc_simcom_parcer_find_rs_req(&rs_me, &rs_req, item->req);
+  asc_simcom_parcer_find_rs_res(&rs_me, &rs_req, &rs_res);
+  if(ringslice_is_empty(&rs_req) || ringslice_is_empty(&rs_res)) return false; // List is closed only by RES
+
+  bool res = ringslice_strcmp(&rs_res, ASC_CMD_ERROR) != 0;
+  char* prefix = item->answ.prefix;
+  if(prefix && !strncmp(prefix, ASC_CMD_SAVE, strlen(ASC_CMD_SAVE))) prefix += strlen(ASC_CMD_SAVE);
+  ringslice_t rs_rest = ringslice_subslice_gap(&rs_req, &rs_res);
+  uint16_t line_cnt = 0;
+  while(res)
+  {
+    ringslice_t rs_line = asc_simcom_parcer_next_line(&rs_rest);
+    if(ringslice_is_empty(&rs_line)) break;
+    if(prefix && !asc_string_boolean_ops(&rs_line, prefix)) continue;
+    bool line_res = item->answ.format ? asc_cmd_sscanf(&rs_line, item) : true;
+    if(item->answ.cb) item->answ.cb(rs_line, line_res, entity->data);
+    ++line_cnt;
+  }
+  if(!res && item->answ.cb) item->answ.cb((ringslice_t){0}, false, entity->data);
+  ASC_DEBUG(ctx, "[ASC][INFO] Lines handled: %d", line_cnt);
+  #ifndef ASC_TEST
+  asc_ring_read(ctx, rs_res.last);
+  #endif
+  return res;
+}
+
 /*******************************************************************************
  ** @brief  Boolean operation for strings in ATL
  ** @param  rs_data  data ringslices
@@ -376,6 +621,33 @@ static bool asc_cmd_sscanf(const ringslice_t* const rs_data, const asc_item_t* c
   }
 }
 
+/**
+ * @brief Remove waiter from the list of context and stop its timeout. Call it in critical section
+ */
+static void asc_urc_wait_unlink(asc_context_t* const ctx, asc_urc_wait_t* const wait)
+{
+  for(asc_urc_wait_t** it = &ctx->urc_wait; *it; it = &(*it)->next)
+  {
+    if(*it == wait) { *it = wait->next; break; }
+  }
+  wait->next = NULL;
+  wait->active = false;
+  asc_timer_stop(ctx, &wait->timer);
+}
+
+/**
+ * @brief Timeout of URC waiter
+ */
+static void asc_urc_wait_timeout_cb(void* const arg)
+{
+  asc_urc_wait_t* const wait = (asc_urc_wait_t*)arg;
+  ASC_DEBUG(wait->ctx, "[ASC][INFO] Awaited URC timeout: %s", wait->prefix);
+  ASC_CRITICAL_ENTER(wait->ctx)
+  asc_urc_wait_unlink(wait->ctx, wait);
+  ASC_CRITICAL_EXIT(wait->ctx)
+  asc_event_urc_wait(wait->ctx, wait, false);
+}
+
 /*******************************************************************************
  ** @brief  Find and proc standart URC 
  ** @param  ctx     core context
@@ -389,24 +661,45 @@ static void asc_process_urcs(asc_context_t* const ctx, const ringslice_t* me)
   
   if(ringslice_is_empty(me)) return; // no data
 
-  for(uint8_t i = 0; i < ASC_URC_QUEUE_SIZE; ++i) 
+  for(uint8_t i = 0; i < ASC_URC_QUEUE_SIZE; ++i) //search runs with interrupts enabled, UART ISR only appends after the slice
   {
-    if(ctx->urc_queue[i].prefix)
+    ASC_CRITICAL_ENTER(ctx)
+    const asc_urc_queue_t urc = ctx->urc_queue[i];
+    ASC_CRITICAL_EXIT(ctx)
+    if(urc.prefix)
     {
-      ringslice_t rs_urc = ringslice_strstr(me, ctx->urc_queue[i].prefix);
-      if(!ringslice_is_empty(&rs_urc) && ctx->urc_queue[i].cb) 
+      ringslice_t rs_urc = ringslice_strstr(me, urc.prefix);
+      if(!ringslice_is_empty(&rs_urc) && urc.cb) 
       {
-        #ifndef ASC_TEST
-        ctx->init_struct.rx_buff->tail = rs_urc.last;
-        ringslice_t tmp = ringslice_initializer(me->buf, me->buf_size, me->first, rs_urc.last);
-        ctx->init_struct.rx_buff->count -= ringslice_len(&tmp);
-        #endif
+        asc_ring_read(ctx, rs_urc.last);
         rs_urc = ringslice_initializer(rs_urc.buf, rs_urc.buf_size, rs_urc.first, me->last);
-        ASC_DEBUG(ctx, "[ASC][INFO] Found URC: %s", ctx->urc_queue[i].prefix);
-        ctx->urc_queue[i].cb(rs_urc);
+        ASC_DEBUG(ctx, "[ASC][INFO] Found URC: %s", urc.prefix);
+        asc_event_urc(ctx, urc.cb, rs_urc);
       }
     }
   }
+  ASC_CRITICAL_ENTER(ctx)
+  ctx->urc_proc = true;
+  for(asc_urc_wait_t* wait = ctx->urc_wait; wait;) //one-shot waiters, scan again after each cb as it can change the list
+  {
+    if(wait->fresh) { wait = wait->next; continue; }
+    const char* const prefix = wait->prefix;
+    ASC_CRITICAL_EXIT(ctx)
+    ringslice_t rs_urc = ringslice_strstr(me, prefix);
+    ASC_CRITICAL_ENTER(ctx)
+    if(!wait->active) { wait = ctx->urc_wait; continue; } //stopped meanwhile, the list is changed
+    if(ringslice_is_empty(&rs_urc)) { wait = wait->next; continue; }
+    asc_ring_read(ctx, rs_urc.last);
+    asc_urc_wait_unlink(ctx, wait);
+    ASC_CRITICAL_EXIT(ctx)
+    ASC_DEBUG(ctx, "[ASC][INFO] Found awaited URC: %s", prefix);
+    asc_event_urc_wait(ctx, wait, true);
+    ASC_CRITICAL_ENTER(ctx)
+    wait = ctx->urc_wait;
+  }
+  for(asc_urc_wait_t* wait = ctx->urc_wait; wait; wait = wait->next) wait->fresh = false;
+  ctx->urc_proc = false;
+  ASC_CRITICAL_EXIT(ctx)
 }
 
 /*******************************************************************************
@@ -419,9 +712,9 @@ static void asc_process_urcs(asc_context_t* const ctx, const ringslice_t* me)
  ******************************************************************************/
 void asc_init(asc_context_t* const ctx, const asc_printf_t asc_printf, const asc_write_t asc_write, asc_ring_buffer_t* rx_buff)
 {
-  ASC_CRITICAL_ENTER
   DBC_REQUIRE(200, ctx);
-  if(ctx->init_struct.init) { ASC_CRITICAL_EXIT return; }
+  ASC_CRITICAL_ENTER(ctx)
+  if(ctx->init_struct.init) { ASC_CRITICAL_EXIT(ctx) return; }
   DBC_REQUIRE(202, asc_printf);
   DBC_REQUIRE(203, asc_write);
   DBC_REQUIRE(204, rx_buff);
@@ -430,32 +723,73 @@ void asc_init(asc_context_t* const ctx, const asc_printf_t asc_printf, const asc
   ctx->init_struct.asc_write = asc_write;
   ctx->init_struct.asc_printf = asc_printf;
   ctx->init_struct.rx_buff = rx_buff;
+  ctx->rx_read = rx_buff->tail;
+  ctx->entity_queue.entity_cur = ASC_ENTITY_NONE;
+  ctx->entity_queue.entity_last = ASC_ENTITY_NONE;
+  ctx->entity_queue.submit_lane = ASC_ENTITY_LANE_DEFAULT;
+  ctx->entity_queue.submit_nopreempt = false;
+  ctx->entity_queue.submit_track = NULL;
+  memset(ctx->storage, 0, sizeof(ctx->storage)); //heap is new, storages of previous init are dropped
+  if(!ctx->submit_tail) //the first init, then the queue is kept as a producer can be linking its descriptor
+  {
+    ctx->submit_stub.next = NULL;
+    ctx->submit_head = &ctx->submit_stub;
+    ctx->submit_tail = &ctx->submit_stub;
+  }
+  ctx->submit_held = NULL;
+  ctx->submit_closed = false;
+  asc_timer_reset(ctx);
   ctx->init_struct.init = true;
+  DBC_ENSURE(209, ctx->init_struct.init);
+  ASC_CRITICAL_EXIT(ctx)
   ASC_DEBUG(ctx, "[ASC][INFO] ATL library initialized successfully", NULL);
   ASC_DEBUG(ctx, "[ASC][INFO] Memory pool size: %d bytes", ASC_MEMORY_POOL_SIZE);
   ASC_DEBUG(ctx, "[ASC][INFO] Memory overhead: %d/%d", o1heapGetDiagnostics(ctx->init_struct.heap).allocated, o1heapGetDiagnostics(ctx->init_struct.heap).capacity);
   ASC_DEBUG(ctx, "[ASC][INFO] Entity queue size: %d", ASC_ENTITY_QUEUE_SIZE);
-  DBC_ENSURE(209, ctx->init_struct.init);
-  ASC_CRITICAL_EXIT
 }
 
 /*******************************************************************************
- ** @brief  DeInit atl lib  
+ ** @brief  DeInit atl lib. Waits for @asc_event_dispatch of other thread,
+ **         deferred cbs not dispatched yet are dropped
  ** @param  ctx core context
  ** @return none
  ******************************************************************************/
 void asc_deinit(asc_context_t* const ctx)
 {
-  ASC_CRITICAL_ENTER
   DBC_REQUIRE(300, ctx);
   DBC_REQUIRE(301, ctx->init_struct.init);
   ASC_DEBUG(ctx, "[ASC][INFO] Deinitializing ATL library", NULL);
+  ASC_CRITICAL_ENTER(ctx)
   ctx->init_struct.init = false;
+  ctx->submit_closed = true;
+  asc_timer_reset(ctx);
+  while(ctx->urc_wait) asc_urc_wait_unlink(ctx, ctx->urc_wait);
+  for(asc_tx_t* tx = ctx->tx_head; tx; tx = tx->next) tx->queued = false;
+  ctx->tx_head = NULL;
+  ctx->tx_tail = NULL;
+  ctx->tx_flight = false;
+  asc_submit_flush(ctx);
+  asc_storage_t storage[ASC_STORAGE_SLOTS];
+  memcpy(storage, ctx->storage, sizeof(storage)); //released out of critical section, dropped with mem_pool as well
+  memset(ctx->storage, 0, sizeof(ctx->storage));
   memset(&ctx->entity_queue, 0, sizeof(asc_entity_queue_t));
   memset(ctx->urc_queue, 0, sizeof(asc_urc_queue_t));
-  ASC_DEBUG(ctx, "[ASC][INFO] ATL library deinitialized", NULL);
   DBC_ENSURE(302, !ctx->init_struct.init);
-  ASC_CRITICAL_EXIT
+  ASC_CRITICAL_EXIT(ctx)
+  for(;;)
+  {
+    ASC_CRITICAL_ENTER(ctx)
+    const bool busy = ctx->events.dispatch && !asc_event_in_dispatch(ctx);
+    if(!busy) ctx->events.head = ctx->events.tail; //deferred cbs are dropped with memory of context
+    ASC_CRITICAL_EXIT(ctx)
+    if(!busy) break;
+    asc_port_yield(); //cbs dispatched by other thread hold data and meta in mem_pool
+  }
+  for(uint8_t i = 0; i < ASC_STORAGE_SLOTS; i++)
+  {
+    if(storage[i].release) storage[i].release(ctx, storage[i].storage);
+  }
+  ASC_DEBUG(ctx, "[ASC][INFO] ATL library deinitialized", NULL);
 }
 
 /*******************************************************************************
@@ -468,29 +802,61 @@ void asc_deinit(asc_context_t* const ctx)
  **                      And pass the ptr of this data to VA ARGS of each item with proper format to
  **                      get this data. If no need pass the 0.
  ** @param  meta         Ptr to some meta data of execution. Will be called in CB. Can be NULL.
- ** @return true: ok false: error while trying to append
+ ** @return handle of entity, @ASC_ENTITY_HANDLE_NONE (false) on error while trying to append.
+ **         Full queue is not an error of context, try again later
+ ******************************************************************************/
+asc_entity_handle_t asc_entity_enqueue(asc_context_t* const ctx, const asc_item_t* const item, const uint8_t item_amount, const asc_entity_cb_t cb, uint16_t data_size, void* const meta)
+{
+  return asc_entity_enqueue_prefill(ctx, item, item_amount, cb, data_size, meta, NULL);
+}
+
+/*******************************************************************************
+ ** @brief  Append queue with new group like @asc_entity_enqueue, usefull data
+ **         is filled from prefill before publication, so cbs of items see it
+ **         even when asc_core_proc runs in other thread. Use it instead of
+ **         writing to data after enqueue
+ ** @param  ctx          core context
+ ** @param  item         ptr to your group of at cmds
+ ** @param  item_amount  amount of your at cmds in group
+ ** @param  cb           callback function for the whole group
+ ** @param  data_size    size of usefull data
+ ** @param  meta         meta of entity. Can be NULL
+ ** @param  prefill      initial usefull data of data_size bytes. NULL - zeros
+ ** @return handle of entity, @ASC_ENTITY_HANDLE_NONE (false) on error
  ******************************************************************************/
-bool asc_entity_enqueue(asc_context_t* const ctx, const asc_item_t* const item, const uint8_t item_amount, const asc_entity_cb_t cb, uint16_t data_size, void* const meta)
+asc_entity_handle_t asc_entity_enqueue_prefill(asc_context_t* const ctx, const asc_item_t* const item, const uint8_t item_amount, const asc_entity_cb_t cb, const uint16_t data_size, void* const meta, const void* const prefill)
 {
-  ASC_CRITICAL_ENTER
   DBC_REQUIRE(400, ctx);
   DBC_REQUIRE(401, ctx->init_struct.init);
   DBC_REQUIRE(402, item != NULL);
   DBC_REQUIRE(403, item_amount > 0);
   DBC_REQUIRE(404, item_amount <= ASC_MAX_ITEMS_PER_ENTITY);
   ASC_DEBUG(ctx, "[ASC][INFO] Enqueueing entity with %d items", item_amount);
-  asc_entity_t* cur_entity = &ctx->entity_queue.entity[ctx->entity_queue.entity_head];
-  if(ctx->entity_queue.entity_cnt >= ASC_ENTITY_QUEUE_SIZE) goto error_exit;
+  if(!asc_entity_free_cnt(ctx)) //backpressure, context stays as is. Don't allocate for nothing, checked again on publication
+  {
+    ASC_DEBUG(ctx, "[ASC][ERROR] Entity queue is full", NULL);
+    return ASC_ENTITY_HANDLE_NONE;
+  }
+  asc_entity_t new_entity = {0}; //built outside of critical section, only its publication is locked
+  asc_entity_t* cur_entity = &new_entity;
   cur_entity->data = asc_malloc(ctx, data_size);
   if(!cur_entity->data && data_size) goto error_exit;
   cur_entity->data_size = data_size;
   memset(cur_entity->data, 0, data_size);
+  if(prefill && data_size) memcpy(cur_entity->data, prefill, data_size);
   cur_entity->item = asc_malloc(ctx, item_amount * sizeof(asc_item_t));
   if(!cur_entity->item) goto error_exit;
   for(int i = 0; i < item_amount; i++)
   {
-    if(!item[i].req && !item[i].answ.prefix) goto error_exit; //unhandle comb
+    if(!item[i].req && !item[i].answ.prefix && item[i].parce_type != ASC_PARCE_SIMCOM_BATCH) goto error_exit; //unhandle comb
     memcpy(&cur_entity->item[i], &item[i], sizeof(asc_item_t));
+    if(item[i].parce_type == ASC_PARCE_SIMCOM_BATCH)
+    {
+      if(!item[i].meta.batch_cnt || i + item[i].meta.batch_cnt >= item_amount) goto error_exit; //batch must own following items
+      cur_entity->item[i].req = asc_entity_batch_req_build(ctx, &item[i + 1], item[i].meta.batch_cnt);
+      if(!cur_entity->item[i].req) goto error_exit;
+      ASC_DEBUG(ctx, "[ASC][INFO] Batch of %d cmds for item[%d]", item[i].meta.batch_cnt, i);
+    }
     if(item[i].answ.ptrs && item[i].answ.ptrs[0] != ASC_NO_ARG && item[i].answ.format && data_size)
     {
       int ptr_count = 0;
@@ -531,39 +897,126 @@ bool asc_entity_enqueue(asc_context_t* const ctx, const asc_item_t* const item,
   cur_entity->cb = cb;
   cur_entity->meta = meta;
   cur_entity->state = ASC_STATE_WRITE;
-  ctx->entity_queue.entity_head = (ctx->entity_queue.entity_head + 1) % ASC_ENTITY_QUEUE_SIZE;
+  ASC_CRITICAL_ENTER(ctx) //publication of entity
+  if(ctx->entity_queue.entity_cnt >= ASC_ENTITY_QUEUE_SIZE) //taken by another producer meanwhile, context stays as is
+  {
+    ASC_CRITICAL_EXIT(ctx)
+    asc_entity_free(ctx, cur_entity);
+    ASC_DEBUG(ctx, "[ASC][ERROR] Entity queue is full", NULL);
+    return ASC_ENTITY_HANDLE_NONE;
+  }
+  uint8_t id = 0;
+  while(ctx->entity_queue.entity[id].state) id++; //free place exists, queue is not full
+  cur_entity->lane = ctx->entity_queue.submit_lane;
+  cur_entity->nopreempt = ctx->entity_queue.submit_nopreempt;
+  cur_entity->enq_time = ctx->time * ASC_CORE_TICK_MS;
+  ctx->entity_queue.entity[id] = new_entity;
+  uint8_t lane = cur_entity->lane;
+  ctx->entity_queue.lane[lane][ctx->entity_queue.lane_head[lane]] = id;
+  ctx->entity_queue.lane_head[lane] = (ctx->entity_queue.lane_head[lane] + 1) % ASC_ENTITY_QUEUE_SIZE;
+  ++ctx->entity_queue.lane_cnt[lane];
+  ctx->entity_queue.entity_last = id;
+  ++ctx->entity_queue.entity_gen[id];
   ++ctx->entity_queue.entity_cnt;
-  ASC_DEBUG(ctx, "[ASC][INFO] Entity enqueued. Queue count: %d. Memory used: %d/%d. User data at %d. ", 
-             ctx->entity_queue.entity_cnt, o1heapGetDiagnostics(ctx->init_struct.heap).allocated, o1heapGetDiagnostics(ctx->init_struct.heap).capacity, cur_entity->data);
-  ASC_CRITICAL_EXIT
-  return true;
+  asc_entity_handle_t res = (asc_entity_handle_t)((ctx->entity_queue.entity_gen[id] << 8) | (id + 1));
+  if(ctx->entity_queue.submit_track && ctx->entity_queue.submit_thread == asc_port_thread()) *ctx->entity_queue.submit_track = res;
+  ASC_CRITICAL_EXIT(ctx)
+  ASC_DEBUG(ctx, "[ASC][INFO] Entity enqueued to lane %d. Queue count: %d. Memory used: %d/%d. User data at %d. ", 
+             lane, ctx->entity_queue.entity_cnt, o1heapGetDiagnostics(ctx->init_struct.heap).allocated, o1heapGetDiagnostics(ctx->init_struct.heap).capacity, cur_entity->data);
+  return res;
 
   error_exit:
     ASC_DEBUG(ctx, "[ASC][ERROR] Queue failed", NULL); 
     asc_deinit(ctx);        
-    ASC_CRITICAL_EXIT
-    return false; 
+    return ASC_ENTITY_HANDLE_NONE; 
 }
 
 /*******************************************************************************
- ** @brief  Clear first entity from the queue 
- ** @param  ctx core context
- ** @return false: some errors; true: ok
+ ** @brief  Build single concatenated request AT+A;+B;+C\r\n for batch sub-items.
+ **         Result is saved in lib memory with ASC_CMD_SAVE so it will be freed
+ **         with the entity.
+ ** @param  ctx       core context
+ ** @param  item      first sub-item of the batch
+ ** @param  item_cnt  amount of sub-items
+ ** @return ptr to new request or NULL if items could not be merged
  ******************************************************************************/
-bool asc_entity_dequeue(asc_context_t* const ctx)
+static char* asc_entity_batch_req_build(asc_context_t* const ctx, const asc_item_t* const item, const uint8_t item_cnt)
 {
-  ASC_CRITICAL_ENTER
-  DBC_REQUIRE(500, ctx);
-  DBC_REQUIRE(501, ctx->init_struct.init);
-  asc_entity_t* cur_entity = &ctx->entity_queue.entity[ctx->entity_queue.entity_tail];
-  uint8_t item_amount = cur_entity->item_cnt;
-  if(ctx->entity_queue.entity_cnt == 0)
+  DBC_REQUIRE(410, ctx);
+  DBC_REQUIRE(411, item);
+  const size_t save_len = strlen(ASC_CMD_SAVE);
+  const size_t crlf_len = strlen(ASC_CMD_CRLF);
+  size_t size = save_len + strlen("AT") + crlf_len + 1;
+  for(uint8_t i = 0; i < item_cnt; i++)
   {
-    ASC_DEBUG(ctx, "[ASC][ERROR] Entity queue is already empty", NULL);
-    ASC_CRITICAL_EXIT
-    return false;
+    const char* req = item[i].req;
+    if(!req || item[i].parce_type != ASC_PARCE_SIMCOM || item[i].meta.batch_cnt) return NULL; //only plain simcom cmds
+    if(item[i].answ.prefix && !strncmp(item[i].answ.prefix, ASC_CMD_FORCE, strlen(ASC_CMD_FORCE))) return NULL;
+    if(!strncmp(req, ASC_CMD_SAVE, save_len)) req += save_len;
+    size_t len = strlen(req);
+    if(len <= strlen("AT") + crlf_len || strncmp(req, "AT", strlen("AT")) || strcmp(req + len - crlf_len, ASC_CMD_CRLF)) return NULL; //AT<CMD>\r\n only
+    size += len - strlen("AT") - crlf_len + 1;
   }
-  ASC_DEBUG(ctx, "[ASC][INFO] Dequeueing entity with %d items", cur_entity->item_cnt);
+  char* res = asc_malloc(ctx, size);
+  if(!res) return NULL;
+  size_t pos = 0;
+  memcpy(res, ASC_CMD_SAVE"AT", save_len + strlen("AT"));
+  pos += save_len + strlen("AT");
+  for(uint8_t i = 0; i < item_cnt; i++)
+  {
+    const char* req = item[i].req;
+    if(!strncmp(req, ASC_CMD_SAVE, save_len)) req += save_len;
+    size_t len = strlen(req) - strlen("AT") - crlf_len;
+    if(i) res[pos++] = ';';
+    memcpy(&res[pos], req + strlen("AT"), len);
+    pos += len;
+  }
+  memcpy(&res[pos], ASC_CMD_CRLF, crlf_len + 1);
+  return res;
+}
+
+/**
+ * @brief Get id of the first entity of the highest not empty lane
+ */
+static uint8_t asc_entity_first(asc_context_t* const ctx)
+{
+  for(uint8_t lane = 0; lane < ASC_ENTITY_LANES; lane++)
+  {
+    if(ctx->entity_queue.lane_cnt[lane]) return ctx->entity_queue.lane[lane][ctx->entity_queue.lane_tail[lane]];
+  }
+  return ASC_ENTITY_NONE;
+}
+
+/**
+ * @brief Unlink entity from its lane, so it is not executed anymore. Call it in critical section
+ */
+static void asc_entity_unlink(asc_context_t* const ctx, const uint8_t id)
+{
+  asc_entity_queue_t* const queue = &ctx->entity_queue;
+  const uint8_t lane = queue->entity[id].lane;
+  uint8_t pos = queue->lane_tail[lane];
+  for(uint8_t i = 0; i < queue->lane_cnt[lane] && queue->lane[lane][pos] != id; i++) pos = (pos + 1) % ASC_ENTITY_QUEUE_SIZE;
+  DBC_ASSERT(502, queue->lane[lane][pos] == id);
+  for(uint8_t next = (pos + 1) % ASC_ENTITY_QUEUE_SIZE; next != queue->lane_head[lane]; next = (next + 1) % ASC_ENTITY_QUEUE_SIZE) //close the gap
+  {
+    queue->lane[lane][pos] = queue->lane[lane][next];
+    pos = next;
+  }
+  queue->lane_head[lane] = pos;
+  --queue->lane_cnt[lane];
+  if(queue->entity_cur == id) queue->entity_cur = ASC_ENTITY_NONE;
+  if(queue->entity_last == id) queue->entity_last = ASC_ENTITY_NONE;
+  asc_tx_cancel(ctx, &queue->entity[id].tx); //not in flight here, abort of entity is deferred till end of tx
+  asc_timer_stop(ctx, &queue->entity[id].timer);
+  asc_timer_stop(ctx, &queue->entity[id].deadline);
+}
+
+/**
+ * @brief Free memory of entity: copies of items and strings, data. Entity itself is not changed
+ */
+static void asc_entity_free(asc_context_t* const ctx, asc_entity_t* const cur_entity)
+{
+  uint8_t item_amount = cur_entity->item_cnt;
   while(item_amount)
   {
     asc_item_t* item = &cur_entity->item[cur_entity->item_cnt -item_amount];
@@ -580,15 +1033,271 @@ bool asc_entity_dequeue(asc_context_t* const ctx)
   }
   if(cur_entity->data && cur_entity->data_size) asc_free(ctx, cur_entity->data);
   if(cur_entity->item) asc_free(ctx, cur_entity->item);
+}
+
+/**
+ * @brief Free memory of unlinked entity and its place in the queue. Call it out of critical section,
+ *        the place is busy till its publication at the end
+ */
+static void asc_entity_release(asc_context_t* const ctx, const uint8_t id)
+{
+  asc_entity_t* cur_entity = &ctx->entity_queue.entity[id];
+  ASC_DEBUG(ctx, "[ASC][INFO] Dequeueing entity with %d items", cur_entity->item_cnt);
+  asc_entity_free(ctx, cur_entity);
+  ASC_CRITICAL_ENTER(ctx)
   memset(cur_entity, 0, sizeof(asc_entity_t));  
-  ctx->entity_queue.entity_tail = (ctx->entity_queue.entity_tail +1) % ASC_ENTITY_QUEUE_SIZE;
   --ctx->entity_queue.entity_cnt;
+  ASC_CRITICAL_EXIT(ctx)
   ASC_DEBUG(ctx, "[ASC][INFO] Entity dequeued. Queue count: %d. Memory used: %d/%d", 
              ctx->entity_queue.entity_cnt, o1heapGetDiagnostics(ctx->init_struct.heap).allocated, o1heapGetDiagnostics(ctx->init_struct.heap).capacity);
-  ASC_CRITICAL_EXIT
+}
+
+/**
+ * @brief Abort entity: unlink it, call its cb with false result and free it. Call it out of critical section
+ */
+static void asc_entity_abort(asc_context_t* const ctx, const uint8_t id)
+{
+  asc_entity_t* const entity = &ctx->entity_queue.entity[id];
+  ASC_CRITICAL_ENTER(ctx)
+  ++ctx->entity_queue.entity_gen[id]; //handle is not valid anymore
+  const bool reading = ctx->entity_queue.entity_cur == id && entity->state == ASC_STATE_READ;
+  asc_entity_unlink(ctx, id);
+  ASC_CRITICAL_EXIT(ctx) //cb can enqueue new entities
+  if(reading) //drop answer of cmd in progress if it is complete, else parser resyncs on echo of the next cmd. Urcs after it are kept
+  {
+    const asc_ring_buffer_t* const rx = ctx->init_struct.rx_buff;
+    const ringslice_t rs_me = ringslice_initializer(rx->buffer, rx->size, ctx->rx_read, asc_ring_head(rx));
+    ringslice_t rs_req = {0};
+    ringslice_t rs_res = {0};
+    asc_simcom_parcer_find_rs_req(&rs_me, &rs_req, entity->item[entity->item_id].req);
+    asc_simcom_parcer_find_rs_res(&rs_me, &rs_req, &rs_res);
+    if(!ringslice_is_empty(&rs_res)) asc_ring_read(ctx, rs_res.last);
+  }
+  asc_event_entity(ctx, entity, false);
+  asc_entity_release(ctx, id);
+}
+
+/**
+ * @brief Get id of entity by handle
+ */
+static uint8_t asc_entity_id(asc_context_t* const ctx, const asc_entity_handle_t handle)
+{
+  uint8_t id = (uint8_t)(handle & 0xFF) - 1;
+  if(id >= ASC_ENTITY_QUEUE_SIZE || !ctx->entity_queue.entity[id].state) return ASC_ENTITY_NONE;
+  if(ctx->entity_queue.entity_gen[id] != (uint8_t)(handle >> 8)) return ASC_ENTITY_NONE;
+  return id;
+}
+
+/*******************************************************************************
+ ** @brief  Clear current entity from the queue, or first entity of the highest
+ **         lane if nothing is executing
+ ** @param  ctx core context
+ ** @return false: some errors; true: ok
+ ******************************************************************************/
+bool asc_entity_dequeue(asc_context_t* const ctx)
+{
+  DBC_REQUIRE(500, ctx);
+  ASC_CRITICAL_ENTER(ctx)
+  DBC_REQUIRE(501, ctx->init_struct.init);
+  if(ctx->entity_queue.entity_cnt == 0)
+  {
+    ASC_CRITICAL_EXIT(ctx)
+    ASC_DEBUG(ctx, "[ASC][ERROR] Entity queue is already empty", NULL);
+    return false;
+  }
+  uint8_t id = ctx->entity_queue.entity_cur != ASC_ENTITY_NONE ? ctx->entity_queue.entity_cur : asc_entity_first(ctx);
+  asc_entity_unlink(ctx, id);
+  ASC_CRITICAL_EXIT(ctx)
+  asc_entity_release(ctx, id);
   return true;
 }
 
+/*******************************************************************************
+ ** @brief  Cancel entity. Its cb is called with false result, memory and place
+ **         in the queue are freed at once. If its cmd is in progress, the answer
+ **         is dropped when it is got completely, data after it such as urcs is
+ **         kept. Call it from the same context as @asc_core_proc or from cbs.
+ **         From deferred cbs the entity is aborted by the next asc_core_proc,
+ **         as it can run in other thread than @asc_event_dispatch
+ ** @param  ctx    core context
+ ** @param  handle handle got from @asc_entity_enqueue or @asc_entity_last
+ ** @return true: cancelled, false: entity is already done or handle is wrong
+ ******************************************************************************/
+bool asc_entity_cancel(asc_context_t* const ctx, const asc_entity_handle_t handle)
+{
+  DBC_REQUIRE(550, ctx);
+  ASC_CRITICAL_ENTER(ctx)
+  DBC_REQUIRE(551, ctx->init_struct.init);
+  uint8_t id = asc_entity_id(ctx, handle);
+  const bool dispatched = asc_event_in_dispatch(ctx); //asc_core_proc can use the entity outside of lock
+  const bool deferred = id != ASC_ENTITY_NONE && (dispatched || !asc_tx_cancel(ctx, &ctx->entity_queue.entity[id].tx)); //port sends its cmd, abort it after that
+  if(deferred) ctx->entity_queue.entity[id].expired = true;
+  ASC_CRITICAL_EXIT(ctx)
+  if(deferred)
+  {
+    ASC_DEBUG(ctx, dispatched ? "[ASC][INFO] Entity cancel is deferred to core proc" : "[ASC][INFO] Entity cancel is deferred till end of tx", NULL);
+  }
+  else if(id != ASC_ENTITY_NONE)
+  {
+    ASC_DEBUG(ctx, "[ASC][INFO] Entity cancelled", NULL);
+    asc_entity_abort(ctx, id);
+  }
+  return id != ASC_ENTITY_NONE;
+}
+
+/** * @brief Deadline of entity */
+static void asc_entity_deadline_cb(void* const arg)
+{
+  ((asc_entity_t*)arg)->expired = true;
+}
+
+/*******************************************************************************
+ ** @brief  Set deadline of the whole entity. If it is not done by this moment,
+ **         it is aborted like with @asc_entity_cancel, so the whole group is
+ **         bounded in time regardless of waits and retries of its cmds
+ ** @param  ctx      core context
+ ** @param  handle   handle got from @asc_entity_enqueue or @asc_entity_last
+ ** @param  deadline absolute moment in units of @asc_get_cur_time_ms
+ ** @return true: ok, false: entity is already done or handle is wrong
+ ******************************************************************************/
+bool asc_entity_deadline_set(asc_context_t* const ctx, const asc_entity_handle_t handle, const uint32_t deadline)
+{
+  DBC_REQUIRE(560, ctx);
+  ASC_CRITICAL_ENTER(ctx)
+  DBC_REQUIRE(561, ctx->init_struct.init);
+  uint8_t id = asc_entity_id(ctx, handle);
+  if(id != ASC_ENTITY_NONE)
+  {
+    int32_t left = (int32_t)(deadline - ctx->time * ASC_CORE_TICK_MS);
+    asc_timer_start(ctx, &ctx->entity_queue.entity[id].deadline, left > 0 ? (uint32_t)left : 0, asc_entity_deadline_cb, &ctx->entity_queue.entity[id]);
+  }
+  ASC_CRITICAL_EXIT(ctx)
+  return id != ASC_ENTITY_NONE;
+}
+
+/*******************************************************************************
+ ** @brief  Get handle of the last enqueued entity. Used to get handles of
+ **         entities enqueued by modules
+ ** @param  ctx core context
+ ** @return handle or @ASC_ENTITY_HANDLE_NONE if it is already done
+ ******************************************************************************/
+asc_entity_handle_t asc_entity_last(asc_context_t* const ctx)
+{
+  DBC_REQUIRE(570, ctx);
+  ASC_CRITICAL_ENTER(ctx)
+  uint8_t id = ctx->entity_queue.entity_last;
+  asc_entity_handle_t res = id == ASC_ENTITY_NONE ? ASC_ENTITY_HANDLE_NONE : (asc_entity_handle_t)((ctx->entity_queue.entity_gen[id] << 8) | (id + 1));
+  ASC_CRITICAL_EXIT(ctx)
+  return res;
+}
+
+/*******************************************************************************
+ ** @brief  Get usefull data of the last enqueued entity. Used by modules to 
+ **         prefill the data before execution of the entity
+ ** @param  ctx core context
+ ** @return ptr to data or NULL if queue is empty or entity has no data
+ ******************************************************************************/
+void* asc_entity_last_data(asc_context_t* const ctx)
+{
+  DBC_REQUIRE(510, ctx);
+  ASC_CRITICAL_ENTER(ctx)
+  void* res = NULL;
+  uint8_t id = ctx->entity_queue.entity_last;
+  if(id != ASC_ENTITY_NONE && ctx->entity_queue.entity[id].data_size) res = ctx->entity_queue.entity[id].data;
+  ASC_CRITICAL_EXIT(ctx)
+  return res;
+}
+
+/*******************************************************************************
+ ** @brief  Get amount of free places in the entity queue. Used by chain
+ **         scheduler to hold back steps instead of failing them on full queue
+ ** @param  ctx core context
+ ** @return amount of entities which can be enqueued now
+ ******************************************************************************/
+uint8_t asc_entity_free_cnt(asc_context_t* const ctx)
+{
+  DBC_REQUIRE(520, ctx);
+  ASC_CRITICAL_ENTER(ctx)
+  uint8_t res = ASC_ENTITY_QUEUE_SIZE - ctx->entity_queue.entity_cnt;
+  ASC_CRITICAL_EXIT(ctx)
+  return res;
+}
+
+/*******************************************************************************
+ ** @brief  Set priority lane for next enqueued entities. Entity of higher lane
+ **         preempts current one before its next cmd is written, current one is
+ **         resumed from the same cmd afterwards. Use it around module calls:
+ **         prev = asc_entity_lane_set(ctx, 0); asc_mdl_...(); asc_entity_lane_set(ctx, prev);
+ ** @param  ctx  core context
+ ** @param  lane lane less than @ASC_ENTITY_LANES, 0 - the highest
+ ** @return previous lane
+ ******************************************************************************/
+uint8_t asc_entity_lane_set(asc_context_t* const ctx, const uint8_t lane)
+{
+  DBC_REQUIRE(530, ctx);
+  ASC_CRITICAL_ENTER(ctx)
+  DBC_REQUIRE(531, lane < ASC_ENTITY_LANES);
+  uint8_t res = ctx->entity_queue.submit_lane;
+  ctx->entity_queue.submit_lane = lane;
+  ASC_CRITICAL_EXIT(ctx)
+  return res;
+}
+
+/*******************************************************************************
+ ** @brief  Keep next enqueued entities from preemption by higher lanes between
+ **         their cmds, e.g. when the first cmd sets a mode the next ones rely
+ **         on (AT+CMGF=0 and AT+CMGS). They are preempted only before their
+ **         first cmd. Use it around module calls like @asc_entity_lane_set
+ ** @param  ctx        core context
+ ** @param  nopreempt  true - entities run from the first to the last cmd
+ ** @return previous value
+ ******************************************************************************/
+bool asc_entity_nopreempt_set(asc_context_t* const ctx, const bool nopreempt)
+{
+  DBC_REQUIRE(535, ctx);
+  ASC_CRITICAL_ENTER(ctx)
+  const bool res = ctx->entity_queue.submit_nopreempt;
+  ctx->entity_queue.submit_nopreempt = nopreempt;
+  ASC_CRITICAL_EXIT(ctx)
+  return res;
+}
+
+/*******************************************************************************
+ ** @brief  Store handles of next entities enqueued by the calling thread to
+ **         slot, so their enqueuer gets the handle from a module call which
+ **         returns only bool. Entities enqueued meanwhile by other threads
+ **         are not stored. Use it around module calls like @asc_entity_lane_set
+ ** @param  ctx   core context
+ ** @param  slot  where to store handles, NULL - stop storing
+ ** @return previous slot
+ ******************************************************************************/
+asc_entity_handle_t* asc_entity_track_set(asc_context_t* const ctx, asc_entity_handle_t* const slot)
+{
+  DBC_REQUIRE(536, ctx);
+  ASC_CRITICAL_ENTER(ctx)
+  asc_entity_handle_t* const res = ctx->entity_queue.submit_track;
+  ctx->entity_queue.submit_track = slot;
+  ctx->entity_queue.submit_thread = asc_port_thread();
+  ASC_CRITICAL_EXIT(ctx)
+  return res;
+}
+
+/*******************************************************************************
+ ** @brief  Get wait stats of priority lane. Cleared by @asc_init
+ ** @param  ctx  core context
+ ** @param  lane lane less than @ASC_ENTITY_LANES
+ ** @return copy of stats
+ ******************************************************************************/
+asc_entity_lane_stats_t asc_entity_lane_stats(asc_context_t* const ctx, const uint8_t lane)
+{
+  DBC_REQUIRE(540, ctx);
+  ASC_CRITICAL_ENTER(ctx)
+  DBC_REQUIRE(541, lane < ASC_ENTITY_LANES);
+  asc_entity_lane_stats_t res = ctx->entity_queue.stats[lane];
+  ASC_CRITICAL_EXIT(ctx)
+  return res;
+}
+
 /*******************************************************************************
  ** @brief  Function to append URC queue
  ** @param  ctx  core context
@@ -597,8 +1306,8 @@ bool asc_entity_dequeue(asc_context_t* const ctx)
  ******************************************************************************/
 bool asc_urc_enqueue(asc_context_t* const ctx, const asc_urc_queue_t* const urc)  
 {
-  ASC_CRITICAL_ENTER
   DBC_REQUIRE(600, ctx);
+  ASC_CRITICAL_ENTER(ctx)
   DBC_REQUIRE(601, urc);
   asc_urc_queue_t* tmp = NULL;
   for(uint8_t i = 0; i <= ASC_URC_QUEUE_SIZE; ++i)
@@ -612,12 +1321,169 @@ bool asc_urc_enqueue(asc_context_t* const ctx, const asc_urc_queue_t* const urc)
   if(!tmp) 
   {
     ASC_DEBUG(ctx, "[ASC][ERROR] URC queue is full", NULL);
-    ASC_CRITICAL_EXIT
+    ASC_CRITICAL_EXIT(ctx)
     return false;
   }
   memcpy(tmp, urc, ASC_URC_SIZE);
   ASC_DEBUG(ctx, "[ASC][INFO] URC enqueued successfully", NULL);
-  ASC_CRITICAL_EXIT
+  ASC_CRITICAL_EXIT(ctx)
+  return true;
+}
+
+/**
+ * @brief Push descriptor to submission queue: one swap of tail, then link from
+ *        previous one. Producers never wait for each other or for core
+ */
+static void asc_submit_push(asc_context_t* const ctx, asc_submit_t* const sub)
+{
+  sub->next = NULL;
+  #ifndef __STDC_NO_ATOMICS__
+  asc_submit_t* const prev = atomic_exchange_explicit(&ctx->submit_tail, sub, memory_order_acq_rel);
+  #else
+  ASC_CRITICAL_ENTER(ctx)
+  asc_submit_t* const prev = ctx->submit_tail;
+  ctx->submit_tail = sub;
+  ASC_CRITICAL_EXIT(ctx)
+  #endif
+  prev->next = sub; //core sees descriptor from here
+}
+
+/**
+ * @brief Take the oldest descriptor of submission queue, only core calls it. NULL
+ *        if queue is empty or producer has swapped tail and hasn't linked it yet
+ */
+static asc_submit_t* asc_submit_pop(asc_context_t* const ctx)
+{
+  asc_submit_t* head = ctx->submit_head;
+  asc_submit_t* next = head->next;
+  if(head == &ctx->submit_stub)
+  {
+    if(!next) return NULL;
+    ctx->submit_head = next;
+    head = next;
+    next = head->next;
+  }
+  if(next)
+  {
+    ctx->submit_head = next;
+    return head;
+  }
+  if(head != ctx->submit_tail) return NULL; //producer is linking the next one, take it next proc
+  asc_submit_push(ctx, &ctx->submit_stub); //the last descriptor is taken only when stub is behind it
+  next = head->next;
+  if(!next) return NULL;
+  ctx->submit_head = next;
+  return head;
+}
+
+/**
+ * @brief Pass submitted descriptors to entity and urc queues in order of push.
+ *        Entity which doesn't fit to entity queue is held with the rest behind it
+ */
+static void asc_submit_drain(asc_context_t* const ctx)
+{
+  while(ctx->init_struct.init)
+  {
+    asc_submit_t* const sub = ctx->submit_held ? ctx->submit_held : asc_submit_pop(ctx);
+    if(!sub) return;
+    ctx->submit_held = NULL;
+    if(sub->type == ASC_SUBMIT_ENTITY)
+    {
+      if(!asc_entity_free_cnt(ctx)) { ctx->submit_held = sub; return; }
+      const uint8_t prev = asc_entity_lane_set(ctx, sub->lane);
+      sub->handle = asc_entity_enqueue(ctx, sub->item, sub->item_amount, sub->cb, sub->data_size, sub->meta);
+      if(ctx->init_struct.init) asc_entity_lane_set(ctx, prev); //enqueue deinits context on error
+      sub->result = sub->handle != ASC_ENTITY_HANDLE_NONE;
+    }
+    else
+    {
+      sub->result = asc_urc_enqueue(ctx, &sub->urc);
+    }
+    sub->queued = false; //owner can reuse descriptor
+  }
+}
+
+/**
+ * @brief Release all submitted descriptors with false result on deinit. Descriptor
+ *        of producer, which is still linking it, stays in the queue and is drained
+ *        after the next @asc_init
+ */
+static void asc_submit_flush(asc_context_t* const ctx)
+{
+  asc_submit_t* sub = ctx->submit_held;
+  ctx->submit_held = NULL;
+  if(!sub) sub = asc_submit_pop(ctx);
+  for(; sub; sub = asc_submit_pop(ctx))
+  {
+    sub->handle = ASC_ENTITY_HANDLE_NONE;
+    sub->result = false;
+    sub->queued = false;
+  }
+}
+
+/*******************************************************************************
+ ** @brief  Submit entity from a foreign thread or ISR while @asc_core_proc runs.
+ **         Lock-free: push is one atomic swap, so it doesn't contend on the
+ **         critical section of context. asc_core_proc drains the submission
+ **         queue at its start in order of push and passes each descriptor to
+ **         @asc_entity_enqueue with its lane. If entity queue is full, the rest
+ **         waits for the next proc
+ ** @param  ctx          core context, inited
+ ** @param  sub          descriptor, should exist until core clears its queued
+ ** @param  item         items like for @asc_entity_enqueue, should exist until
+ **                      core clears queued of descriptor
+ ** @param  item_amount  amount of items
+ ** @param  cb           cb of entity. Can be NULL
+ ** @param  data_size    size of usefull data
+ ** @param  meta         meta of entity. Can be NULL
+ ** @param  lane         lane less than @ASC_ENTITY_LANES, 0 - the highest
+ ** @return true - submitted, false - descriptor is already in queue or context
+ **         is deinited
+ ******************************************************************************/
+bool asc_entity_submit(asc_context_t* const ctx, asc_submit_t* const sub, const asc_item_t* const item, const uint8_t item_amount, const asc_entity_cb_t cb, const uint16_t data_size, void* const meta, const uint8_t lane)
+{
+  DBC_REQUIRE(840, ctx);
+  DBC_REQUIRE(841, ctx->submit_tail); //queue is set up by the first asc_init
+  DBC_REQUIRE(842, sub);
+  DBC_REQUIRE(843, item && item_amount > 0 && item_amount <= ASC_MAX_ITEMS_PER_ENTITY);
+  DBC_REQUIRE(844, lane < ASC_ENTITY_LANES);
+  if(sub->queued || ctx->submit_closed) return false;
+  sub->type = ASC_SUBMIT_ENTITY;
+  sub->item = item;
+  sub->item_amount = item_amount;
+  sub->lane = lane;
+  sub->data_size = data_size;
+  sub->cb = cb;
+  sub->meta = meta;
+  sub->handle = ASC_ENTITY_HANDLE_NONE;
+  sub->result = false;
+  sub->queued = true;
+  asc_submit_push(ctx, sub);
+  return true;
+}
+
+/*******************************************************************************
+ ** @brief  Submit URC from a foreign thread or ISR while @asc_core_proc runs,
+ **         see @asc_entity_submit. URC is copied, core passes it to
+ **         @asc_urc_enqueue
+ ** @param  ctx  core context, inited
+ ** @param  sub  descriptor, should exist until core clears its queued
+ ** @param  urc  ptr to your URC
+ ** @return true - submitted, false - descriptor is already in queue or context
+ **         is deinited
+ ******************************************************************************/
+bool asc_urc_submit(asc_context_t* const ctx, asc_submit_t* const sub, const asc_urc_queue_t* const urc)
+{
+  DBC_REQUIRE(850, ctx);
+  DBC_REQUIRE(851, ctx->submit_tail); //queue is set up by the first asc_init
+  DBC_REQUIRE(852, sub);
+  DBC_REQUIRE(853, urc);
+  if(sub->queued || ctx->submit_closed) return false;
+  sub->type = ASC_SUBMIT_URC;
+  sub->urc = *urc;
+  sub->result = false;
+  sub->queued = true;
+  asc_submit_push(ctx, sub);
   return true;
 }
 
@@ -629,8 +1495,8 @@ bool asc_urc_enqueue(asc_context_t* const ctx, const asc_urc_queue_t* const urc)
  ******************************************************************************/
 bool asc_urc_dequeue(asc_context_t* const ctx, char* prefix)  
 {
-  ASC_CRITICAL_ENTER
   DBC_REQUIRE(700, ctx);
+  ASC_CRITICAL_ENTER(ctx)
   DBC_REQUIRE(701, prefix);
   for(uint8_t i = 0; i <= ASC_URC_QUEUE_SIZE; ++i)
   {
@@ -639,15 +1505,290 @@ bool asc_urc_dequeue(asc_context_t* const ctx, char* prefix)
     {
       memset(&ctx->urc_queue[i], 0, ASC_URC_SIZE);
       ASC_DEBUG(ctx,"[ASC][INFO] URC dequeued successfully", NULL);
-      ASC_CRITICAL_EXIT
+      ASC_CRITICAL_EXIT(ctx)
       return true;
     }
   }
   ASC_DEBUG(ctx, "[ASC][INFO] URC dequeued fail", NULL);
-  ASC_CRITICAL_EXIT
+  ASC_CRITICAL_EXIT(ctx)
   return false;
 }
 
+/*******************************************************************************
+ ** @brief  Wait for URC once. Waiter is removed when URC is found or timeout
+ **         expires, cb is called from @asc_core_proc. Start of active waiter
+ **         restarts it
+ ** @param  ctx    core context
+ ** @param  wait   waiter, should exist until cb or stop
+ ** @param  prefix prefix of URC, e.g. "+CREG: 1" or "CONNECT OK"
+ ** @param  ms     timeout in ms, 0 - no timeout
+ ** @param  cb     cb with true on URC, false on timeout
+ ** @param  arg    arg for cb. Can be NULL
+ ** @return none
+ ******************************************************************************/
+void asc_urc_wait_start(asc_context_t* const ctx, asc_urc_wait_t* const wait, const char* const prefix, const uint32_t ms, const asc_urc_wait_cb_t cb, void* const arg)
+{
+  DBC_REQUIRE(710, ctx);
+  ASC_CRITICAL_ENTER(ctx)
+  DBC_REQUIRE(711, wait);
+  DBC_REQUIRE(712, prefix);
+  if(wait->active) asc_urc_wait_unlink(ctx, wait);
+  wait->prefix = prefix;
+  wait->cb = cb;
+  wait->arg = arg;
+  wait->ctx = ctx;
+  wait->active = true;
+  wait->fresh = ctx->urc_proc; //not matched by URC which was found just now
+  wait->next = ctx->urc_wait;
+  ctx->urc_wait = wait;
+  if(ms) asc_timer_start(ctx, &wait->timer, ms, asc_urc_wait_timeout_cb, wait);
+  ASC_DEBUG(ctx, "[ASC][INFO] Waiting for URC: %s", prefix);
+  ASC_CRITICAL_EXIT(ctx)
+}
+
+/*******************************************************************************
+ ** @brief  Stop waiting for URC if waiter is active, cb is not called
+ ** @param  ctx  core context
+ ** @param  wait waiter
+ ** @return none
+ ******************************************************************************/
+void asc_urc_wait_stop(asc_context_t* const ctx, asc_urc_wait_t* const wait)
+{
+  DBC_REQUIRE(720, ctx);
+  ASC_CRITICAL_ENTER(ctx)
+  DBC_REQUIRE(721, wait);
+  if(wait->active) asc_urc_wait_unlink(ctx, wait);
+  ASC_CRITICAL_EXIT(ctx)
+}
+
+/*******************************************************************************
+ ** @brief  Defer cbs of entities, URCs and URC waiters. asc_core_proc only
+ **         parses and moves entities, and puts completions to the event ring
+ **         of context, the application calls them by @asc_event_dispatch in
+ **         thread context. Cbs of items stay in asc_core_proc, they parse data
+ **         of rx ring for the cb of entity. While the ring is full, answers,
+ **         URCs and deadlines wait in asc_core_proc. Cbs which can't wait
+ **         (@asc_entity_cancel, timeout of URC waiter, more URCs in one check
+ **         than free places) are called in place and counted in overflow.
+ **         Can be called before asc_init
+ ** @param  ctx    core context
+ ** @param  defer  true - queue cbs, false - call them from asc_core_proc
+ ** @return previous value
+ ******************************************************************************/
+bool asc_event_defer_set(asc_context_t* const ctx, const bool defer)
+{
+  DBC_REQUIRE(860, ctx);
+  ASC_CRITICAL_ENTER(ctx)
+  const bool res = ctx->events.defer;
+  ctx->events.defer = defer;
+  ASC_CRITICAL_EXIT(ctx)
+  return res;
+}
+
+/*******************************************************************************
+ ** @brief  Call deferred cbs in order of completion. Single consumer: call it
+ **         only from one thread. Cbs can enqueue entities. Cb of URC gets a
+ **         slice of its copy, up to @ASC_EVENT_URC_SIZE bytes, which is valid
+ **         until cb returns. Usefull data of entity is freed after its cb.
+ **         @asc_deinit of other thread waits for its end
+ ** @param  ctx  core context
+ ** @param  max  max amount of cbs per call, 0 - all
+ ** @return amount of called cbs
+ ******************************************************************************/
+uint8_t asc_event_dispatch(asc_context_t* const ctx, const uint8_t max)
+{
+  DBC_REQUIRE(870, ctx);
+  asc_event_ring_t* const ring = &ctx->events;
+  ASC_CRITICAL_ENTER(ctx)
+  const uint8_t head = ctx->init_struct.init ? ring->head : ring->tail; //events completed by cbs of this call wait for the next one
+  const bool outer = ring->dispatch; //dispatch from a cb
+  ring->dispatch = true; //asc_deinit waits for the end
+  ring->dispatcher = asc_port_thread();
+  ASC_CRITICAL_EXIT(ctx)
+  ASC_RING_ACQUIRE()
+  uint8_t res = 0;
+  while(ring->tail != head && ring->tail != ring->head && (!max || res < max)) //cb can drop the rest by asc_deinit
+  {
+    const uint8_t tail = ring->tail;
+    asc_event_t event = ring->event[tail]; //copy, place is released before cb
+    ASC_RING_RELEASE()
+    ring->tail = (uint8_t)((tail + 1u) % ASC_EVENT_RING_SIZE);
+    switch(event.type)
+    {
+      case ASC_EVENT_ENTITY:
+           event.entity_cb(event.result, event.meta, event.data);
+           if(event.data) asc_free(ctx, event.data);
+           break;
+      case ASC_EVENT_URC:
+           event.urc_cb(ringslice_initializer((uint8_t*)event.urc, sizeof(event.urc), 0, event.urc_len));
+           break;
+      case ASC_EVENT_URC_WAIT:
+           event.wait_cb(event.result, event.meta);
+           break;
+      default:
+           break;
+    }
+    res++;
+  }
+  ASC_CRITICAL_ENTER(ctx)
+  ring->dispatch = outer;
+  ASC_CRITICAL_EXIT(ctx)
+  return res;
+}
+
+/*******************************************************************************
+ ** @brief  Submit data to tx queue of context. asc_core_proc passes it to
+ **         asc_write outside of critical section, short writes are resumed
+ **         from the first not accepted byte
+ ** @param  ctx   core context
+ ** @param  tx    descriptor, should exist until cb
+ ** @param  data  data, should exist until cb
+ ** @param  len   length of data
+ ** @param  cb    cb when all data is sent or descriptor is dropped. Can be NULL
+ ** @param  arg   arg for cb. Can be NULL
+ ** @return true - submitted, false - descriptor is already in queue
+ ******************************************************************************/
+bool asc_tx_submit(asc_context_t* const ctx, asc_tx_t* const tx, const uint8_t* const data, const uint16_t len, const asc_tx_cb_t cb, void* const arg)
+{
+  DBC_REQUIRE(810, ctx);
+  ASC_CRITICAL_ENTER(ctx)
+  DBC_REQUIRE(811, tx);
+  DBC_REQUIRE(812, data || !len);
+  if(tx->queued) { ASC_CRITICAL_EXIT(ctx) return false; }
+  tx->next = NULL;
+  tx->data = data;
+  tx->len = len;
+  tx->sent = 0;
+  tx->cb = cb;
+  tx->arg = arg;
+  tx->ctx = ctx;
+  tx->queued = true;
+  if(ctx->tx_tail) ctx->tx_tail->next = tx;
+  else ctx->tx_head = tx;
+  ctx->tx_tail = tx;
+  ASC_CRITICAL_EXIT(ctx)
+  return true;
+}
+
+/*******************************************************************************
+ ** @brief  Remove descriptor from tx queue, cb is not called
+ ** @param  ctx  core context
+ ** @param  tx   descriptor
+ ** @return true - removed or not queued, false - port is sending its data now
+ ******************************************************************************/
+bool asc_tx_cancel(asc_context_t* const ctx, asc_tx_t* const tx)
+{
+  DBC_REQUIRE(820, ctx);
+  ASC_CRITICAL_ENTER(ctx)
+  DBC_REQUIRE(821, tx);
+  bool res = true;
+  if(tx->queued && tx == ctx->tx_head && ctx->tx_flight) res = false;
+  else if(tx->queued)
+  {
+    asc_tx_t* prev = NULL;
+    for(asc_tx_t* it = ctx->tx_head; it != tx; it = it->next) prev = it;
+    if(prev) prev->next = tx->next;
+    else ctx->tx_head = tx->next;
+    if(ctx->tx_tail == tx) ctx->tx_tail = prev;
+    tx->next = NULL;
+    tx->queued = false;
+  }
+  ASC_CRITICAL_EXIT(ctx)
+  return res;
+}
+
+/*******************************************************************************
+ ** @brief  Report that data accepted by the last asc_write is sent. Call it from
+ **         TX complete IRQ of port when @ASC_TX_ASYNC is 1
+ ** @param  ctx  core context
+ ** @return none
+ ******************************************************************************/
+void asc_tx_done(asc_context_t* const ctx)
+{
+  DBC_REQUIRE(830, ctx);
+  ctx->tx_flight = false;
+}
+
+/**
+ * @brief Pass head of tx queue to port. Sync port sends all it can right now,
+ *        async port gets next part only after asc_tx_done of previous one
+ */
+static void asc_tx_proc(asc_context_t* const ctx)
+{
+  ASC_CRITICAL_ENTER(ctx)
+  while(ctx->tx_head && !ctx->tx_flight)
+  {
+    asc_tx_t* const tx = ctx->tx_head;
+    if(tx->sent == tx->len) //all data is sent
+    {
+      ctx->tx_head = tx->next;
+      if(!ctx->tx_head) ctx->tx_tail = NULL;
+      tx->next = NULL;
+      tx->queued = false;
+      ASC_CRITICAL_EXIT(ctx)
+      if(tx->cb) tx->cb(true, tx->arg);
+      ASC_CRITICAL_ENTER(ctx)
+      continue;
+    }
+    #if ASC_TX_ASYNC
+    ctx->tx_flight = true; //before write, TX complete IRQ can come before return
+    #endif
+    ASC_CRITICAL_EXIT(ctx) //port may block or start DMA, ISRs and rx ring keep working
+    uint16_t res = ctx->init_struct.asc_write((uint8_t*)tx->data + tx->sent, tx->len - tx->sent);
+    ASC_CRITICAL_ENTER(ctx)
+    if(res > tx->len - tx->sent) res = tx->len - tx->sent;
+    tx->sent += res;
+    if(!res)
+    {
+      ctx->tx_flight = false;
+      break; //port is busy, try next tick
+    }
+  }
+  ASC_CRITICAL_EXIT(ctx)
+}
+
+/*******************************************************************************
+ ** @brief  Put received data to rx ring. Single producer: call it only from one
+ **         place, e.g. UART ISR or DMA handler, without critical section. Core
+ **         is the single consumer, so neither side blocks the other
+ ** @param  ring  rx ring buffer
+ ** @param  data  received data
+ ** @param  len   length of data
+ ** @return amount of stored bytes, the rest is dropped as the ring is full
+ ******************************************************************************/
+uint16_t asc_ring_write(asc_ring_buffer_t* const ring, const uint8_t* const data, const uint16_t len)
+{
+  DBC_REQUIRE(730, ring && ring->buffer && ring->size > 1);
+  DBC_REQUIRE(731, data || !len);
+  uint16_t head = ring->head; //own index
+  const uint16_t tail = ring->tail;
+  ASC_RING_ACQUIRE() //place of released data is free only after core has read it
+  uint16_t res = 0;
+  while(res < len)
+  {
+    const uint16_t next = (uint16_t)(head + 1u) % ring->size;
+    if(next == tail) break; //full
+    ring->buffer[head] = data[res++];
+    head = next;
+  }
+  ASC_RING_RELEASE() //data is written before core sees new head
+  ring->head = head;
+  return res;
+}
+
+/*******************************************************************************
+ ** @brief  Amount of data in rx ring which is not processed by core yet
+ ** @param  ring  rx ring buffer
+ ** @return amount of bytes
+ ******************************************************************************/
+uint16_t asc_ring_count(const asc_ring_buffer_t* const ring)
+{
+  DBC_REQUIRE(740, ring && ring->size);
+  const uint16_t head = ring->head;
+  const uint16_t tail = ring->tail;
+  return (uint16_t)((head + ring->size - tail) % ring->size);
+}
+
 /*******************************************************************************
  ** @brief  Function get init. 
  ** @param  ctx  core context
@@ -655,10 +1796,10 @@ bool asc_urc_dequeue(asc_context_t* const ctx, char* prefix)
  ******************************************************************************/
 asc_init_t asc_get_init(asc_context_t* const ctx)
 {
-  ASC_CRITICAL_ENTER
   DBC_REQUIRE(750, ctx);
+  ASC_CRITICAL_ENTER(ctx)
   asc_init_t res = ctx->init_struct;
-  ASC_CRITICAL_EXIT
+  ASC_CRITICAL_EXIT(ctx)
   return res;
 }
 
@@ -669,10 +1810,24 @@ asc_init_t asc_get_init(asc_context_t* const ctx)
  ******************************************************************************/
 uint32_t asc_get_cur_time(asc_context_t* const ctx)
 {
-  ASC_CRITICAL_ENTER
   DBC_REQUIRE(760, ctx);
+  ASC_CRITICAL_ENTER(ctx)
   uint32_t res = ctx->time;
-  ASC_CRITICAL_EXIT
+  ASC_CRITICAL_EXIT(ctx)
+  return res;
+}
+
+/*******************************************************************************
+ ** @brief  Function get time in ms with @ASC_CORE_TICK_MS resolution
+ ** @param  ctx  core context
+ ** @return time
+ ******************************************************************************/
+uint32_t asc_get_cur_time_ms(asc_context_t* const ctx)
+{
+  DBC_REQUIRE(761, ctx);
+  ASC_CRITICAL_ENTER(ctx)
+  uint32_t res = ctx->time * ASC_CORE_TICK_MS;
+  ASC_CRITICAL_EXIT(ctx)
   return res;
 }
 
@@ -684,11 +1839,11 @@ uint32_t asc_get_cur_time(asc_context_t* const ctx)
  ******************************************************************************/
 void* asc_malloc(asc_context_t* const ctx, size_t size)
 {
-  ASC_CRITICAL_ENTER
   DBC_REQUIRE(770, ctx);
-  if(!ctx->init_struct.init) { ASC_CRITICAL_EXIT return NULL; }
+  ASC_CRITICAL_ENTER(ctx)
+  if(!ctx->init_struct.init) { ASC_CRITICAL_EXIT(ctx) return NULL; }
   void* res = o1heapAllocate(ctx->init_struct.heap, size);
-  ASC_CRITICAL_EXIT
+  ASC_CRITICAL_EXIT(ctx)
   return res;
 }
 
@@ -700,11 +1855,42 @@ void* asc_malloc(asc_context_t* const ctx, size_t size)
  ******************************************************************************/
 void asc_free(asc_context_t* ctx, void* ptr)
 {
-  ASC_CRITICAL_ENTER
   DBC_REQUIRE(780, ctx);
-  if(!ctx->init_struct.init) { ASC_CRITICAL_EXIT return; }
+  ASC_CRITICAL_ENTER(ctx)
+  if(!ctx->init_struct.init) { ASC_CRITICAL_EXIT(ctx) return; }
   o1heapFree(ctx->init_struct.heap, ptr);
-  ASC_CRITICAL_EXIT
+  ASC_CRITICAL_EXIT(ctx)
+}
+
+/*******************************************************************************
+ ** @brief  Get storage of a module in context, e.g. cache kept between calls.
+ **         It is allocated zeroed in mem_pool on the first call and dropped by
+ **         @asc_deinit after its release cb
+ ** @param  ctx      core context
+ ** @param  key      owner of storage, address of its static
+ ** @param  size     size of storage, 0 - don't allocate, only look for it
+ ** @param  release  cb called by @asc_deinit, can be NULL
+ ** @return ptr to storage, NULL - no free slot or memory
+ ******************************************************************************/
+void* asc_storage_get(asc_context_t* const ctx, const void* const key, const uint16_t size, const asc_storage_release_t release)
+{
+  DBC_REQUIRE(790, ctx);
+  DBC_REQUIRE(791, key);
+  void* res = NULL;
+  ASC_CRITICAL_ENTER(ctx)
+  asc_storage_t* slot = NULL;
+  for(uint8_t i = 0; i < ASC_STORAGE_SLOTS && !res; i++)
+  {
+    if(ctx->storage[i].key == key) res = ctx->storage[i].storage;
+    else if(!ctx->storage[i].key && !slot) slot = &ctx->storage[i];
+  }
+  if(!res && slot && size && ctx->init_struct.init && (res = o1heapAllocate(ctx->init_struct.heap, size)))
+  {
+    memset(res, 0, size);
+    *slot = (asc_storage_t){.key = key, .storage = res, .release = release};
+  }
+  ASC_CRITICAL_EXIT(ctx)
+  return res;
 }
 
 /*******************************************************************************
@@ -719,12 +1905,14 @@ static void asc_proc_handle_cmd_result(asc_context_t* const ctx, asc_entity_t* c
   DBC_REQUIRE(802, entity);
   DBC_REQUIRE(803, item);
   int step = success ? item->meta.ok_step : item->meta.err_step;
-  if(entity->item_id < entity->item_cnt - 1) // not last
+  int item_id = entity->item_id + item->meta.batch_cnt; //batch head steps from its last sub-item
+  if(item_id < entity->item_cnt - 1) // not last
   {
-    if (step != 0 || (step > 0 && entity->item_id + step < entity->item_cnt) || (step < 0 && entity->item_id + step >= 0)) 
+    if (step != 0 || (step > 0 && item_id + step < entity->item_cnt) || (step < 0 && item_id + step >= 0)) 
     {
       ASC_DEBUG(ctx, "[ASC][INFO] Next cmd of entity", NULL);
-      entity->item_id += (step == 0) ? 1 : step;
+      entity->item_id = item_id + ((step == 0) ? 1 : step);
+      entity->atomic = success && item->answ.prefix && item->answ.prefix[0] && item->answ.prefix[strlen(item->answ.prefix) - 1] == '>';
       return;
     }
   }  
@@ -733,44 +1921,121 @@ static void asc_proc_handle_cmd_result(asc_context_t* const ctx, asc_entity_t* c
   #ifndef ASC_TEST
   if(!success) //debug
   {
-    uint16_t data_start = ctx->init_struct.rx_buff->head < 250
-                          ? ctx->init_struct.rx_buff->size - (250 - ctx->init_struct.rx_buff->head)
-                          : ctx->init_struct.rx_buff->head - 250;
-    ringslice_t rs_me = ringslice_initializer(ctx->init_struct.rx_buff->buffer, ctx->init_struct.rx_buff->size, data_start, ctx->init_struct.rx_buff->head);
+    const uint16_t head = asc_ring_head(ctx->init_struct.rx_buff);
+    uint16_t data_start = head < 250
+                          ? ctx->init_struct.rx_buff->size - (250 - head)
+                          : head - 250;
+    ringslice_t rs_me = ringslice_initializer(ctx->init_struct.rx_buff->buffer, ctx->init_struct.rx_buff->size, data_start, head);
     asc_printf_from_ring(ctx, rs_me, "Failed last 250 bytes of data: ");
   }
   #endif
-  if(entity->cb) entity->cb(success, entity->meta, entity->data);
+  asc_event_entity(ctx, entity, success);
   asc_entity_dequeue(ctx);
 }
 
-/** * @brief Function to proc ATL core proccesses. Call it each 10ms */
+/**
+ * @brief Select entity to execute. Entity of higher lane preempts current one
+ *        only before write of its next cmd, position of current one is kept.
+ *        Entity with nopreempt is preempted only between groups
+ */
+static asc_entity_t* asc_entity_select(asc_context_t* const ctx)
+{
+  asc_entity_queue_t* const queue = &ctx->entity_queue;
+  uint8_t id = asc_entity_first(ctx);
+  if(queue->entity_cur != ASC_ENTITY_NONE && queue->entity_cur != id)
+  {
+    asc_entity_t* const cur = &queue->entity[queue->entity_cur];
+    if(cur->state != ASC_STATE_WRITE || cur->atomic || cur->nopreempt) return cur; //answer or data of cmd is expected, or next cmd relies on mode set by previous one
+    ASC_DEBUG(ctx, "[ASC][INFO] Entity of lane %d preempted by lane %d", cur->lane, queue->entity[id].lane);
+    ++queue->stats[cur->lane].preempt_cnt;
+  }
+  queue->entity_cur = id;
+  asc_entity_t* const entity = &queue->entity[id];
+  if(!entity->started)
+  {
+    entity->started = true;
+    asc_entity_lane_stats_t* const stats = &queue->stats[entity->lane];
+    uint32_t wait = ctx->time * ASC_CORE_TICK_MS - entity->enq_time;
+    ++stats->cnt;
+    stats->wait_sum_ms += wait;
+    if(wait > stats->wait_max_ms) stats->wait_max_ms = wait;
+  }
+  return entity;
+}
+
+/** * @brief Timeout of current item of entity */
+static void asc_entity_timeout_cb(void* const arg)
+{
+  ((asc_entity_t*)arg)->timeout = true;
+}
+
+/** * @brief Cmd of entity is sent, start timeout of answer */
+static void asc_entity_read_start(asc_context_t* const ctx, asc_entity_t* const entity)
+{
+  const asc_item_t* const item = &entity->item[entity->item_id];
+  entity->timeout = false;
+  asc_timer_start(ctx, &entity->timer, (uint32_t)item->meta.wait * 10, asc_entity_timeout_cb, entity);
+  entity->state = ASC_STATE_READ;
+}
+
+/** * @brief Tx complete of cmd of entity */
+static void asc_entity_tx_cb(const bool result, void* const arg)
+{
+  asc_entity_t* const entity = (asc_entity_t*)arg;
+  if(result) asc_entity_read_start(entity->tx.ctx, entity);
+}
+
+/** * @brief Function to proc ATL core proccesses. Call it each ASC_CORE_TICK_MS */
 void asc_core_proc(asc_context_t* const ctx)
 {
-  ASC_CRITICAL_ENTER
   DBC_REQUIRE(901, ctx);
+  ASC_CRITICAL_ENTER(ctx)
   if(ctx->time >= UINT32_MAX) ctx->time = 0;
   else ctx->time += 1;
-  ringslice_t rs_me = ringslice_initializer(ctx->init_struct.rx_buff->buffer, ctx->init_struct.rx_buff->size, ctx->init_struct.rx_buff->tail, ctx->init_struct.rx_buff->head);
-  if(ctx->time % ASC_URC_FREQ_CHECK == 0) asc_process_urcs(ctx, &rs_me); //check URC each 100ms
-  if(!ctx->entity_queue.entity_cnt) { ASC_CRITICAL_EXIT return; }
-  asc_entity_t* entity = &ctx->entity_queue.entity[ctx->entity_queue.entity_tail];
-  ASC_CRITICAL_EXIT //we work with exclusive memory field for this entity bcs of ring buffer
+  ASC_CRITICAL_EXIT(ctx)
+  asc_submit_drain(ctx); //entities and urcs of foreign threads
+  asc_timer_proc(ctx); //expired item timeouts, chain delays and etc.
+  for(uint8_t id = 0; id < ASC_ENTITY_QUEUE_SIZE; id++) //abort entities with expired deadline
+  {
+    ASC_CRITICAL_ENTER(ctx)
+    const bool expired = ctx->entity_queue.entity[id].expired && !asc_event_full(ctx) && asc_tx_cancel(ctx, &ctx->entity_queue.entity[id].tx); //port sends its cmd, try next time
+    ASC_CRITICAL_EXIT(ctx)
+    if(!expired) continue;
+    ASC_DEBUG(ctx, "[ASC][ERROR] Entity deadline expired", NULL);
+    asc_entity_abort(ctx, id);
+  }
+  ringslice_t rs_me = ringslice_initializer(ctx->init_struct.rx_buff->buffer, ctx->init_struct.rx_buff->size, ctx->rx_read, asc_ring_head(ctx->init_struct.rx_buff)); //UART ISR only appends after head, tail is moved only by asc_ring_consume at the end
+  if(ctx->time - ctx->urc_time >= ASC_URC_FREQ_CHECK && !asc_event_full(ctx)) //check URC each 100ms
+  {
+    ctx->urc_time = ctx->time;
+    ctx->urc_head = (uint16_t)rs_me.last;
+    asc_process_urcs(ctx, &rs_me);
+  }
+  ASC_CRITICAL_ENTER(ctx)
+  if(!ctx->entity_queue.entity_cnt || asc_event_full(ctx)) //nothing to do or cbs of completed ones are not dispatched yet
+  { 
+    ASC_CRITICAL_EXIT(ctx) 
+    asc_ring_consume(ctx);
+    asc_tx_proc(ctx);
+    return; 
+  }
+  asc_entity_t* entity = asc_entity_select(ctx);
+  ASC_CRITICAL_EXIT(ctx) //we work with exclusive memory field for this entity bcs of ring buffer
   asc_item_t* item = &entity->item[entity->item_id];
-  if(entity->timer) --entity->timer;
   switch(entity->state)
   {
     case ASC_STATE_WRITE:
          if(item->req)
          {
-           ASC_CRITICAL_ENTER
            uint16_t offset = strncmp(item->req, ASC_CMD_SAVE, strlen(ASC_CMD_SAVE)) ? 0 : strlen(ASC_CMD_SAVE);
-           ctx->init_struct.asc_write((uint8_t*)item->req +offset, strlen(item->req+offset));
            ASC_DEBUG(ctx, "[ASC][INFO] [TX] %s", item->req +offset);    
-           ASC_CRITICAL_EXIT
+           entity->state = ASC_STATE_SEND;
+           asc_tx_submit(ctx, &entity->tx, (uint8_t*)item->req +offset, strlen(item->req+offset), asc_entity_tx_cb, entity);
+           break;
          }         
-         entity->timer = item->meta.wait;
-         entity->state = ASC_STATE_READ;
+         asc_entity_read_start(ctx, entity);
+         break;
+    case ASC_STATE_SEND: //waiting for tx complete
          break;
     case ASC_STATE_READ:
          if(asc_cmd_ring_parcer(ctx, entity, item, rs_me) == 1) 
@@ -779,31 +2044,84 @@ void asc_core_proc(asc_context_t* const ctx)
            ASC_DEBUG(ctx, "[ASC][INFO] Successful entity cmd %d/%d", entity->item_id+1, entity->item_cnt);
            asc_proc_handle_cmd_result(ctx, entity, item, true);  
          } 
-         else if(!entity->timer && item->meta.rpt_cnt) 
+         else if(entity->timeout && item->meta.rpt_cnt) 
          {
            entity->state = ASC_STATE_WRITE;
            ASC_DEBUG(ctx, "[ASC][INFO] Timeout, retries left: %d", item->meta.rpt_cnt - 1);
            if(--item->meta.rpt_cnt == 0) 
            {
-             ASC_CRITICAL_ENTER
              #ifndef ASC_TEST
-             ctx->init_struct.rx_buff->tail = ctx->init_struct.rx_buff->head;
-             ctx->init_struct.rx_buff->count = 0;
+             asc_ring_read(ctx, rs_me.last); //drop what was got for the failed cmd, data after the slice is kept
              #endif
-             ASC_CRITICAL_EXIT
              ASC_DEBUG(ctx, "[ASC][INFO] Failure entity cmd %d/%d", entity->item_id+1, entity->item_cnt);
              asc_proc_handle_cmd_result(ctx, entity, item, false);  
            }
          }
          else
          {
-           if(entity->timer == item->meta.wait/2) ASC_DEBUG(ctx, "[ASC][INFO] Waiting......", NULL);
+           if(asc_timer_left_ms(ctx, &entity->timer) == (uint32_t)(item->meta.wait/2) * 10) ASC_DEBUG(ctx, "[ASC][INFO] Waiting......", NULL);
          }
          break;
     default: 
          ASC_DEBUG(ctx, "[ASC][INFO] Unknown state: %d", entity->state);
+         asc_ring_consume(ctx);
          return;
   }
+  asc_ring_consume(ctx); //cbs are done with their slices
+  asc_tx_proc(ctx);
+}
+
+/*******************************************************************************
+ ** @brief  Get moment when @asc_core_proc has work to do. Until it the context
+ **         is idle and ticks can be skipped with @asc_core_advance, unless new
+ **         data comes to rx ring or a foreign thread submits an entity
+ ** @param  ctx  core context
+ ** @return time in units of @asc_get_cur_time_ms: the next tick if the core is
+ **         busy, expiry of the nearest timer or urc check of new rx data,
+ **         @ASC_CORE_NO_WAKEUP if the context waits only for rx
+ ******************************************************************************/
+uint32_t asc_core_next_wakeup(asc_context_t* const ctx)
+{
+  DBC_REQUIRE(910, ctx);
+  ASC_CRITICAL_ENTER(ctx)
+  if(!ctx->init_struct.init) { ASC_CRITICAL_EXIT(ctx) return ASC_CORE_NO_WAKEUP; }
+  const uint32_t now = ctx->time * ASC_CORE_TICK_MS;
+  const asc_entity_queue_t* const queue = &ctx->entity_queue;
+  bool busy = ctx->tx_head && !ctx->tx_flight; //write is resumed each tick
+  busy |= asc_event_full(ctx); //parse is held till dispatch
+  busy |= ctx->submit_held ? queue->entity_cnt < ASC_ENTITY_QUEUE_SIZE : ctx->submit_tail != &ctx->submit_stub; //submitted descriptors are drained by proc
+  if(queue->entity_cnt)
+  {
+    const asc_entity_t* const cur = queue->entity_cur != ASC_ENTITY_NONE ? &queue->entity[queue->entity_cur] : NULL;
+    busy |= !cur || cur->state == ASC_STATE_WRITE || cur->timeout; //next cmd or retry is due, READ and SEND wait for rx, timer or tx
+    for(uint8_t id = 0; id < ASC_ENTITY_QUEUE_SIZE && !busy; id++) busy |= queue->entity[id].expired;
+  }
+  uint32_t res = ASC_CORE_NO_WAKEUP;
+  const asc_ring_buffer_t* const rx = ctx->init_struct.rx_buff;
+  const uint16_t head = asc_ring_head(rx);
+  if(head != ctx->rx_read && (head != ctx->urc_head || ctx->urc_wait)) res = (ctx->urc_time + ASC_URC_FREQ_CHECK) * ASC_CORE_TICK_MS; //not checked data for urcs
+  ASC_CRITICAL_EXIT(ctx)
+  if(busy) return now + ASC_CORE_TICK_MS;
+  const uint32_t left = asc_timer_next_ms(ctx);
+  if(left != UINT32_MAX && now + left < res) res = now + left;
+  if(res != ASC_CORE_NO_WAKEUP && res <= now) res = now + ASC_CORE_TICK_MS; //the current tick is done
+  return res;
+}
+
+/*******************************************************************************
+ ** @brief  Advance time of context over idle ticks without proc. Call it before
+ **         @asc_core_proc when its calls were skipped, not farther than one tick
+ **         before @asc_core_next_wakeup. Timers see all skipped ticks
+ ** @param  ctx    core context
+ ** @param  ticks  amount of skipped ticks
+ ** @return none
+ ******************************************************************************/
+void asc_core_advance(asc_context_t* const ctx, const uint32_t ticks)
+{
+  DBC_REQUIRE(920, ctx);
+  ASC_CRITICAL_ENTER(ctx)
+  ctx->time += ticks;
+  ASC_CRITICAL_EXIT(ctx)
 }
 
 #ifdef ASC_TEST
@@ -18,6 +18,7 @@
 #include <assert.h>
 #include "o1heap.h"
 #include "ringslice.h"
+#include "asc_timer.h"
 
 /*******************************************************************************
  * Config
@@ -25,6 +26,10 @@
 #define ASC_MAX_ITEMS_PER_ENTITY   50     //Max amount of AT cmds in one group (if you need to change, check step field sizes also)
   
 #define ASC_ENTITY_QUEUE_SIZE      10     //Max amount of groups 
+
+#define ASC_ENTITY_LANES           2      //Amount of priority lanes of groups (1..4), lane 0 - the highest
+
+#define ASC_ENTITY_LANE_DEFAULT    1      //Lane of groups by default, see @asc_entity_lane_set
   
 #define ASC_URC_QUEUE_SIZE         10     //Amount of handled URC
 
@@ -32,7 +37,17 @@
 
 #define ASC_MEMORY_POOL_SIZE       4096   //Memory pool for custom heap
 
-#ifndef ASC_TEST  
+#define ASC_TX_ASYNC               0      //0 - asc_write returns when data is sent, 1 - port sends by DMA/IRQ and calls asc_tx_done
+
+#define ASC_CRIT_STATS             0      //1 - port measures hold time of critical sections per call site, see asc_crit_stats.h
+
+#define ASC_EVENT_RING_SIZE        16     //Places for deferred cbs of context (2..255), one is kept free, see @asc_event_defer_set
+
+#define ASC_EVENT_URC_SIZE         48     //Copy of URC for its deferred cb (1..254), longer URC is cut
+
+#define ASC_STORAGE_SLOTS          2      //Per-context storages of modules, see @asc_storage_get
+
+#if !defined(ASC_TEST) && !defined(ASC_DEBUG_ENABLED)
   #define ASC_DEBUG_ENABLED        1      //Recommend to turn on DEBUG logs
 #endif
 
@@ -48,6 +63,10 @@
 #define ASC_CMD_OK               ASC_CMD_CRLF"OK"ASC_CMD_CRLF
 #define ASC_CMD_ERROR            ASC_CMD_CRLF"ERROR"ASC_CMD_CRLF
 
+#define ASC_ENTITY_NONE          0xFF
+#define ASC_CORE_NO_WAKEUP       UINT32_MAX  //Context has nothing to do by time, only rx can wake it
+#define ASC_ENTITY_HANDLE_NONE   0
+
 #define ASC_ITEM_SIZE            sizeof(asc_item_t)
 #define ASC_URC_SIZE             sizeof(asc_urc_queue_t)
 
@@ -71,11 +90,47 @@
   } \
 }
 
+#define ASC_ITEM_BATCH(items_cnt_, retries_, timeout_, err_step_, ok_step_) \
+{ \
+  .req = NULL, \
+  .parce_type = ASC_PARCE_SIMCOM_BATCH, \
+  .answ = \
+  { \
+    .prefix = NULL, \
+    .format = NULL, \
+    .ptrs = NULL, \
+    .cb = NULL \
+  }, \
+  .meta = \
+  { \
+    .wait = timeout_, \
+    .rpt_cnt = retries_, \
+    .err_step = err_step_, \
+    .ok_step = ok_step_, \
+    .batch_cnt = items_cnt_ \
+  } \
+}
+
 #define ASC_ARG(src, field) ((void*)offsetof(src, field))
 #define ASC_NO_ARG           (void*)0xFFFF
 
-#define ASC_CRITICAL_ENTER  _asc_crit_enter();
-#define ASC_CRITICAL_EXIT   _asc_crit_exit();
+#define ASC_CRIT_STR_(x)    #x
+#define ASC_CRIT_STR(x)     ASC_CRIT_STR_(x)
+#define ASC_CRIT_SITE       __FILE__ ":" ASC_CRIT_STR(__LINE__) //call site of critical section
+
+#define ASC_CRITICAL_ENTER(ctx)  _asc_crit_enter((ctx), ASC_CRIT_SITE); //lock of context, contexts don't block each other
+#define ASC_CRITICAL_EXIT(ctx)   _asc_crit_exit(ctx);
+
+#ifndef __STDC_NO_ATOMICS__ //ordering of data and index of rx ring between UART ISR and core
+  #include <stdatomic.h>
+  #define ASC_RING_ACQUIRE()  atomic_thread_fence(memory_order_acquire);
+  #define ASC_RING_RELEASE()  atomic_thread_fence(memory_order_release);
+  #define ASC_ATOMIC          _Atomic //links of submission queue, see @asc_entity_submit
+#else
+  #define ASC_RING_ACQUIRE()  __asm volatile("" ::: "memory");
+  #define ASC_RING_RELEASE()  __asm volatile("" ::: "memory");
+  #define ASC_ATOMIC          volatile //swap of submission queue is done in critical section
+#endif
 
 /*******************************************************************************
  * Global type definitions ('typedef')
@@ -88,6 +143,8 @@ enum
 {
   ASC_PARCE_SIMCOM = 1,  //ECHO\r\r\nRES\r\nDATA\r\n
   ASC_PARCE_RAW,         //> RAW DATA
+  ASC_PARCE_SIMCOM_BATCH,//ECHO(AT+A;+B)\r\r\nDATA_A\r\n\r\nDATA_B\r\n\r\nRES\r\n
+  ASC_PARCE_SIMCOM_LINES,//ECHO\r\r\nDATA_1\r\nDATA_2\r\n\r\nRES\r\n, cb for each line
 };
 
 typedef struct asc_urc_queue_t{
@@ -95,6 +152,32 @@ typedef struct asc_urc_queue_t{
   asc_urc_cb cb; // Callback for this URC
 } asc_urc_queue_t;
 
+typedef void (*asc_urc_wait_cb_t)(const bool result, void* const arg); //one-shot urc callback type
+
+typedef struct asc_urc_wait_t {
+  struct asc_urc_wait_t* next;  // Next waiter of context
+  const char* prefix;           // Char prefix to find the URC
+  asc_urc_wait_cb_t cb;         // Callback on URC (true) or timeout (false)
+  void* arg;                    // Arg for cb
+  asc_timer_t timer;            // Timeout
+  struct asc_context_t* ctx;    // Core context
+  bool active;                  // Waiter is registered
+  bool fresh;                   // Registered while URCs are processed, checked next time
+} asc_urc_wait_t;
+
+typedef void (*asc_tx_cb_t)(const bool result, void* const arg); //tx complete callback type
+
+typedef struct asc_tx_t {
+  struct asc_tx_t* next;  // Next descriptor in tx queue of context
+  const uint8_t* data;    // Data to send, should exist until cb
+  uint16_t len;           // Length of data
+  uint16_t sent;          // Amount of data accepted by port
+  asc_tx_cb_t cb;         // Callback when all data is sent (true) or descriptor is dropped (false)
+  void* arg;              // Arg for cb
+  struct asc_context_t* ctx; // Core context
+  bool queued;            // Descriptor is in tx queue
+} asc_tx_t;
+
 typedef struct asc_item_t
 {
   char* req;  //Sended request, could be string or literal
@@ -106,10 +189,11 @@ typedef struct asc_item_t
     answ_parce_cb_t cb;  //Callback by the end
   } answ;
   struct {
-    uint16_t wait;    // wait time (up to 65535) in 10ms
+    uint16_t wait;    // wait time (up to 65535) in 10ms, deadline is registered in the timer wheel
     uint8_t rpt_cnt;  // repeat counter (up to 255)
     int8_t err_step;  // error step (-127 to 127)  
     int8_t ok_step;   // success step (-127 to 127)
+    uint8_t batch_cnt;// amount of sub-items after the batch head, 0 for plain items
   } meta;
 } asc_item_t;
 
@@ -125,19 +209,21 @@ typedef void (*asc_entity_cb_t)(const bool result,       //result
                                 void* const meta,        //passed meta from @asc_entity_t
                                 const void* const data); //data ptr from @asc_entity_t
 
+typedef uint16_t asc_entity_handle_t; //generation of place in queue << 8 | place + 1
+
 typedef uint8_t asc_proc_states_t;
 enum
 {
   ASC_STATE_READ = 1,
   ASC_STATE_WRITE,
+  ASC_STATE_SEND,  //cmd is in tx queue, timeout starts when it is sent
 };
 
 typedef struct {
-  uint8_t *buffer;      
-  uint16_t size;   
-  uint16_t head;       
-  uint16_t tail;       
-  uint16_t count;     
+  uint8_t *buffer;         //storage of received data
+  uint16_t size;           //size of storage, one byte is kept free to tell full ring from empty one
+  volatile uint16_t head;  //write position, written only by producer (UART ISR), see @asc_ring_write
+  volatile uint16_t tail;  //read position, written only by core
 } asc_ring_buffer_t;
 
 typedef struct asc_init_t{
@@ -152,27 +238,139 @@ typedef struct asc_entity_t{
   asc_item_t*       item;       //list of items
   uint8_t           item_cnt;   //amount of items
   uint8_t           item_id;    //current id of executionable items
-  uint16_t          timer;      //timer
+  asc_timer_t       timer;      //timeout of current item
+  bool              timeout;    //timeout of current item expired
+  asc_timer_t       deadline;   //deadline of the whole entity
+  bool              expired;    //deadline of the whole entity expired
+  bool              atomic;     //modem waits for data of next item (prompt '>'), can't be preempted
+  bool              nopreempt;  //group isn't preempted between its cmds, see @asc_entity_nopreempt_set
+  bool              started;    //execution started
+  uint8_t           lane;       //priority lane
+  uint32_t          enq_time;   //enqueue moment in ms
   asc_entity_cb_t   cb;         //cb for item
   void*             data;       //usefull data from execution
   void*             meta;       //meta data
   uint16_t          data_size;  //usefull data size
   asc_proc_states_t state;      //state
+  asc_tx_t          tx;         //tx descriptor of current cmd
 } asc_entity_t;
 
+typedef struct asc_entity_lane_stats_t{
+  uint32_t cnt;         //amount of started entities
+  uint32_t wait_sum_ms; //sum of waits from enqueue to start
+  uint32_t wait_max_ms; //max wait from enqueue to start
+  uint32_t preempt_cnt; //amount of preemptions of entities of lane
+} asc_entity_lane_stats_t;
+
 typedef struct asc_entity_queue_t{
-  asc_entity_t entity[ASC_ENTITY_QUEUE_SIZE]; //entity queue
-  uint8_t entity_head;  //entitiy head
-  uint8_t entity_tail;  //entity tail
+  asc_entity_t entity[ASC_ENTITY_QUEUE_SIZE];                   //entities, shared by all lanes
+  uint8_t lane[ASC_ENTITY_LANES][ASC_ENTITY_QUEUE_SIZE];        //rings of entity ids in order of enqueue
+  uint8_t lane_head[ASC_ENTITY_LANES];                          //lane head
+  uint8_t lane_tail[ASC_ENTITY_LANES];                          //lane tail
+  uint8_t lane_cnt[ASC_ENTITY_LANES];                           //lane counter
+  uint8_t entity_gen[ASC_ENTITY_QUEUE_SIZE];                    //generations of places, part of handles
+  asc_entity_lane_stats_t stats[ASC_ENTITY_LANES];              //wait stats of lanes
   uint8_t entity_cnt;   //entity counter
+  uint8_t entity_cur;   //id of executing entity, ASC_ENTITY_NONE - no one
+  uint8_t entity_last;  //id of last enqueued entity
+  uint8_t submit_lane;  //lane for next enqueued entities
+  bool submit_nopreempt; //next enqueued entities aren't preempted between their cmds
+  asc_entity_handle_t* submit_track; //handles of next entities enqueued by submit_thread are stored here
+  uintptr_t submit_thread; //thread of @asc_entity_track_set
 } asc_entity_queue_t;
 
+typedef uint8_t asc_submit_type_t;
+enum
+{
+  ASC_SUBMIT_ENTITY = 1, //descriptor is passed to asc_entity_enqueue
+  ASC_SUBMIT_URC,        //descriptor is passed to asc_urc_enqueue
+};
+
+typedef struct asc_submit_t {
+  struct asc_submit_t* ASC_ATOMIC next; // Next descriptor in submission queue of context
+  asc_submit_type_t type;    // Type of descriptor
+  const asc_item_t* item;    // Items of entity, should exist until descriptor is drained
+  uint8_t item_amount;       // Amount of items
+  uint8_t lane;              // Priority lane of entity
+  uint16_t data_size;        // Size of usefull data of entity
+  asc_entity_cb_t cb;        // Cb of entity
+  void* meta;                // Meta of entity
+  asc_urc_queue_t urc;       // URC
+  asc_entity_handle_t handle; // Handle of enqueued entity, @ASC_ENTITY_HANDLE_NONE on error, set by core
+  bool result;               // Result of enqueue, set by core
+  ASC_ATOMIC bool queued;    // Descriptor is in submission queue, owner can reuse it when core clears it
+} asc_submit_t;
+
+typedef uint8_t asc_event_type_t;
+enum
+{
+  ASC_EVENT_ENTITY = 1, //cb of entity
+  ASC_EVENT_URC,        //cb of URC
+  ASC_EVENT_URC_WAIT,   //cb of URC waiter
+};
+
+typedef struct asc_event_t {
+  asc_event_type_t type;     // Type of event
+  bool result;               // Result for cbs of entity and URC waiter
+  uint8_t urc_len;           // Length of URC copy
+  asc_entity_cb_t entity_cb; // Cb of entity
+  asc_urc_cb urc_cb;         // Cb of URC
+  asc_urc_wait_cb_t wait_cb; // Cb of URC waiter
+  void* meta;                // Meta of entity or arg of URC waiter
+  void* data;                // Usefull data of entity, freed after cb
+  char urc[ASC_EVENT_URC_SIZE + 1]; // Copy of URC from rx ring, one place is kept free for the slice
+} asc_event_t;
+
+typedef struct asc_event_ring_t {
+  asc_event_t event[ASC_EVENT_RING_SIZE]; //events in order of completion
+  volatile uint8_t head;  //write position, written by core in critical section
+  volatile uint8_t tail;  //read position, written only by @asc_event_dispatch
+  uint32_t overflow;      //amount of cbs called in place as the ring was full
+  bool defer;             //cbs are queued, see @asc_event_defer_set
+  bool dispatch;          //@asc_event_dispatch runs, written by it in critical section
+  uintptr_t dispatcher;   //thread of running @asc_event_dispatch, see @asc_port_thread
+} asc_event_ring_t;
+
+typedef void (*asc_storage_release_t)(struct asc_context_t* const ctx, //context being deinited
+                                      void* const storage);            //storage, its mem_pool is kept until next asc_init
+
+typedef struct asc_storage_t {
+  const void* key;               //owner of storage, address of its static
+  void* storage;                 //allocated in mem_pool
+  asc_storage_release_t release; //called by @asc_deinit, can be NULL
+} asc_storage_t;
+
+typedef struct asc_lock_t {
+  volatile uint32_t nest; //nesting of critical sections of context
+  uint32_t state;         //saved state of port lock, e.g. PRIMASK
+  void* port;             //lock object of port, e.g. mutex of RTOS or pthread
+  const char* site;       //call site of the outermost critical section
+  uint32_t start;         //enter moment of the outermost critical section, @ASC_CRIT_STATS
+} asc_lock_t;
+
 typedef struct asc_context_t {
+  asc_lock_t lock; //critical section of context, see asc_port.c
   asc_entity_queue_t entity_queue; //entity queue
   asc_urc_queue_t urc_queue[ASC_URC_QUEUE_SIZE]; //urc queue
+  asc_urc_wait_t* urc_wait; //one-shot urc waiters
+  bool urc_proc; //urcs are processed now
+  uint32_t urc_time; //time of the last urc check
+  uint16_t urc_head; //head of rx ring at the last urc check
+  uint16_t rx_read; //read position of rx ring, data before it is released to producer at the end of asc_core_proc
   asc_init_t init_struct; //init struct
   uint8_t mem_pool[ASC_MEMORY_POOL_SIZE] __attribute__((aligned(O1HEAP_ALIGNMENT)));
   uint32_t time;
+  asc_timer_wheel_t timers; //timer wheel of context
+  asc_tx_t* tx_head; //tx queue, head is sent now
+  asc_tx_t* tx_tail; //tail of tx queue
+  volatile bool tx_flight; //data of head is accepted by port and is not sent yet, cleared by @asc_tx_done
+  asc_submit_t* ASC_ATOMIC submit_tail; //the last pushed descriptor of submission queue, swapped by producers
+  asc_submit_t* submit_head; //the oldest not drained descriptor, only core moves it
+  asc_submit_t* submit_held; //drained entity which waits for free place in entity queue
+  asc_submit_t submit_stub; //stub of submission queue, queue is empty when tail is stub
+  ASC_ATOMIC bool submit_closed; //context is deinited, producers fail fast, see @asc_entity_submit
+  asc_event_ring_t events; //deferred cbs
+  asc_storage_t storage[ASC_STORAGE_SLOTS]; //per-context storages of modules, see @asc_storage_get
 } asc_context_t;
 
 /*******************************************************************************
@@ -192,7 +390,8 @@ typedef struct asc_context_t {
 void asc_init(asc_context_t* const ctx, const asc_printf_t asc_printf, const asc_write_t asc_write, asc_ring_buffer_t* rx_buff);
 
 /*******************************************************************************
- ** @brief  DeInit atl lib  
+ ** @brief  DeInit atl lib. Waits for @asc_event_dispatch of other thread,
+ **         deferred cbs not dispatched yet are dropped
  ** @param  ctx core context
  ** @return none
  ******************************************************************************/
@@ -208,17 +407,124 @@ void asc_deinit(asc_context_t* const ctx);
  **                      And pass the ptr of this data to VA ARGS of each item with proper format to
  **                      get this data. If no need pass the 0.
  ** @param  meta         Ptr to some meta data of execution. Will be called in CB. Can be NULL.
- ** @return true: ok false: error while trying to append
+ ** @return handle of entity, @ASC_ENTITY_HANDLE_NONE (false) on error while trying to append.
+ **         Full queue is not an error of context, try again later
+ ******************************************************************************/
+asc_entity_handle_t asc_entity_enqueue(asc_context_t* const ctx, const asc_item_t* const item, const uint8_t item_amount, const asc_entity_cb_t cb, uint16_t data_size, void* const meta);
+
+/*******************************************************************************
+ ** @brief  Append queue with new group like @asc_entity_enqueue, usefull data
+ **         is filled from prefill before publication, so cbs of items see it
+ **         even when asc_core_proc runs in other thread. Use it instead of
+ **         writing to data after enqueue
+ ** @param  ctx          core context
+ ** @param  item         ptr to your group of at cmds
+ ** @param  item_amount  amount of your at cmds in group
+ ** @param  cb           callback function for the whole group
+ ** @param  data_size    size of usefull data
+ ** @param  meta         meta of entity. Can be NULL
+ ** @param  prefill      initial usefull data of data_size bytes. NULL - zeros
+ ** @return handle of entity, @ASC_ENTITY_HANDLE_NONE (false) on error
  ******************************************************************************/
-bool asc_entity_enqueue(asc_context_t* const ctx, const asc_item_t* const item, const uint8_t item_amount, const asc_entity_cb_t cb, uint16_t data_size, void* const meta);
+asc_entity_handle_t asc_entity_enqueue_prefill(asc_context_t* const ctx, const asc_item_t* const item, const uint8_t item_amount, const asc_entity_cb_t cb, const uint16_t data_size, void* const meta, const void* const prefill);
 
 /*******************************************************************************
- ** @brief  Clear first entity from the queue 
+ ** @brief  Clear current entity from the queue, or first entity of the highest
+ **         lane if nothing is executing
  ** @param  ctx core context
  ** @return false: some errors; true: ok
  ******************************************************************************/
 bool asc_entity_dequeue(asc_context_t* const ctx);
 
+/*******************************************************************************
+ ** @brief  Set priority lane for next enqueued entities. Entity of higher lane
+ **         preempts current one before its next cmd is written, current one is
+ **         resumed from the same cmd afterwards. Use it around module calls:
+ **         prev = asc_entity_lane_set(ctx, 0); asc_mdl_...(); asc_entity_lane_set(ctx, prev);
+ ** @param  ctx  core context
+ ** @param  lane lane less than @ASC_ENTITY_LANES, 0 - the highest
+ ** @return previous lane
+ ******************************************************************************/
+uint8_t asc_entity_lane_set(asc_context_t* const ctx, const uint8_t lane);
+
+/*******************************************************************************
+ ** @brief  Keep next enqueued entities from preemption by higher lanes between
+ **         their cmds, e.g. when the first cmd sets a mode the next ones rely
+ **         on (AT+CMGF=0 and AT+CMGS). They are preempted only before their
+ **         first cmd. Use it around module calls like @asc_entity_lane_set
+ ** @param  ctx        core context
+ ** @param  nopreempt  true - entities run from the first to the last cmd
+ ** @return previous value
+ ******************************************************************************/
+bool asc_entity_nopreempt_set(asc_context_t* const ctx, const bool nopreempt);
+
+/*******************************************************************************
+ ** @brief  Store handles of next entities enqueued by the calling thread to
+ **         slot, so their enqueuer gets the handle from a module call which
+ **         returns only bool. Entities enqueued meanwhile by other threads
+ **         are not stored. Use it around module calls like @asc_entity_lane_set
+ ** @param  ctx   core context
+ ** @param  slot  where to store handles, NULL - stop storing
+ ** @return previous slot
+ ******************************************************************************/
+asc_entity_handle_t* asc_entity_track_set(asc_context_t* const ctx, asc_entity_handle_t* const slot);
+
+/*******************************************************************************
+ ** @brief  Cancel entity. Its cb is called with false result, memory and place
+ **         in the queue are freed at once. If its cmd is in progress, the answer
+ **         is dropped when it is got completely, data after it such as urcs is
+ **         kept. Call it from the same context as @asc_core_proc or from cbs.
+ **         From deferred cbs the entity is aborted by the next asc_core_proc,
+ **         as it can run in other thread than @asc_event_dispatch
+ ** @param  ctx    core context
+ ** @param  handle handle got from @asc_entity_enqueue or @asc_entity_last
+ ** @return true: cancelled, false: entity is already done or handle is wrong
+ ******************************************************************************/
+bool asc_entity_cancel(asc_context_t* const ctx, const asc_entity_handle_t handle);
+
+/*******************************************************************************
+ ** @brief  Set deadline of the whole entity. If it is not done by this moment,
+ **         it is aborted like with @asc_entity_cancel, so the whole group is
+ **         bounded in time regardless of waits and retries of its cmds
+ ** @param  ctx      core context
+ ** @param  handle   handle got from @asc_entity_enqueue or @asc_entity_last
+ ** @param  deadline absolute moment in units of @asc_get_cur_time_ms
+ ** @return true: ok, false: entity is already done or handle is wrong
+ ******************************************************************************/
+bool asc_entity_deadline_set(asc_context_t* const ctx, const asc_entity_handle_t handle, const uint32_t deadline);
+
+/*******************************************************************************
+ ** @brief  Get handle of the last enqueued entity. Used to get handles of
+ **         entities enqueued by modules
+ ** @param  ctx core context
+ ** @return handle or @ASC_ENTITY_HANDLE_NONE if it is already done
+ ******************************************************************************/
+asc_entity_handle_t asc_entity_last(asc_context_t* const ctx);
+
+/*******************************************************************************
+ ** @brief  Get wait stats of priority lane. Cleared by @asc_init
+ ** @param  ctx  core context
+ ** @param  lane lane less than @ASC_ENTITY_LANES
+ ** @return copy of stats
+ ******************************************************************************/
+asc_entity_lane_stats_t asc_entity_lane_stats(asc_context_t* const ctx, const uint8_t lane);
+
+/*******************************************************************************
+ ** @brief  Get usefull data of the last enqueued entity. Used by modules to 
+ **         prefill the data before execution of the entity
+ ** @param  ctx core context
+ ** @return ptr to data or NULL if queue is empty or entity has no data
+ ******************************************************************************/
+void* asc_entity_last_data(asc_context_t* const ctx);
+
+/*******************************************************************************
+ ** @brief  Get amount of free places in the entity queue. Used by chain
+ **         scheduler to hold back steps instead of failing them on full queue
+ ** @param  ctx core context
+ ** @return amount of entities which can be enqueued now
+ ******************************************************************************/
+uint8_t asc_entity_free_cnt(asc_context_t* const ctx);
+
 /*******************************************************************************
  ** @brief  Function to append URC queue
  ** @param  ctx  core context
@@ -227,6 +533,39 @@ bool asc_entity_dequeue(asc_context_t* const ctx);
  ******************************************************************************/
 bool asc_urc_enqueue(asc_context_t* const ctx, const asc_urc_queue_t* const urc);
 
+/*******************************************************************************
+ ** @brief  Submit entity from a foreign thread or ISR while @asc_core_proc runs.
+ **         Lock-free: push is one atomic swap, so it doesn't contend on the
+ **         critical section of context. asc_core_proc drains the submission
+ **         queue at its start in order of push and passes each descriptor to
+ **         @asc_entity_enqueue with its lane. If entity queue is full, the rest
+ **         waits for the next proc
+ ** @param  ctx          core context, inited
+ ** @param  sub          descriptor, should exist until core clears its queued
+ ** @param  item         items like for @asc_entity_enqueue, should exist until
+ **                      core clears queued of descriptor
+ ** @param  item_amount  amount of items
+ ** @param  cb           cb of entity. Can be NULL
+ ** @param  data_size    size of usefull data
+ ** @param  meta         meta of entity. Can be NULL
+ ** @param  lane         lane less than @ASC_ENTITY_LANES, 0 - the highest
+ ** @return true - submitted, false - descriptor is already in queue or context
+ **         is deinited
+ ******************************************************************************/
+bool asc_entity_submit(asc_context_t* const ctx, asc_submit_t* const sub, const asc_item_t* const item, const uint8_t item_amount, const asc_entity_cb_t cb, const uint16_t data_size, void* const meta, const uint8_t lane);
+
+/*******************************************************************************
+ ** @brief  Submit URC from a foreign thread or ISR while @asc_core_proc runs,
+ **         see @asc_entity_submit. URC is copied, core passes it to
+ **         @asc_urc_enqueue
+ ** @param  ctx  core context, inited
+ ** @param  sub  descriptor, should exist until core clears its queued
+ ** @param  urc  ptr to your URC
+ ** @return true - submitted, false - descriptor is already in queue or context
+ **         is deinited
+ ******************************************************************************/
+bool asc_urc_submit(asc_context_t* const ctx, asc_submit_t* const sub, const asc_urc_queue_t* const urc);
+
 /*******************************************************************************
  ** @brief  Function to delete URC from queue
  ** @param  ctx  core context
@@ -235,6 +574,28 @@ bool asc_urc_enqueue(asc_context_t* const ctx, const asc_urc_queue_t* const urc)
  ******************************************************************************/
 bool asc_urc_dequeue(asc_context_t* const ctx, char* prefix);
 
+/*******************************************************************************
+ ** @brief  Wait for URC once. Waiter is removed when URC is found or timeout
+ **         expires, cb is called from @asc_core_proc. Start of active waiter
+ **         restarts it
+ ** @param  ctx    core context
+ ** @param  wait   waiter, should exist until cb or stop
+ ** @param  prefix prefix of URC, e.g. "+CREG: 1" or "CONNECT OK"
+ ** @param  ms     timeout in ms, 0 - no timeout
+ ** @param  cb     cb with true on URC, false on timeout
+ ** @param  arg    arg for cb. Can be NULL
+ ** @return none
+ ******************************************************************************/
+void asc_urc_wait_start(asc_context_t* const ctx, asc_urc_wait_t* const wait, const char* const prefix, const uint32_t ms, const asc_urc_wait_cb_t cb, void* const arg);
+
+/*******************************************************************************
+ ** @brief  Stop waiting for URC if waiter is active, cb is not called
+ ** @param  ctx  core context
+ ** @param  wait waiter
+ ** @return none
+ ******************************************************************************/
+void asc_urc_wait_stop(asc_context_t* const ctx, asc_urc_wait_t* const wait);
+
 /*******************************************************************************
  ** @brief  Function to proc ATL core proccesses. 
  ** @param  ctx  core context
@@ -242,6 +603,103 @@ bool asc_urc_dequeue(asc_context_t* const ctx, char* prefix);
  ******************************************************************************/
 void asc_core_proc(asc_context_t* const ctx);
 
+/*******************************************************************************
+ ** @brief  Get moment when @asc_core_proc has work to do. Until it the context
+ **         is idle and ticks can be skipped with @asc_core_advance, unless new
+ **         data comes to rx ring or a foreign thread submits an entity
+ ** @param  ctx  core context
+ ** @return time in units of @asc_get_cur_time_ms: the next tick if the core is
+ **         busy, expiry of the nearest timer or urc check of new rx data,
+ **         @ASC_CORE_NO_WAKEUP if the context waits only for rx
+ ******************************************************************************/
+uint32_t asc_core_next_wakeup(asc_context_t* const ctx);
+
+/*******************************************************************************
+ ** @brief  Advance time of context over idle ticks without proc. Call it before
+ **         @asc_core_proc when its calls were skipped, not farther than one tick
+ **         before @asc_core_next_wakeup. Timers see all skipped ticks
+ ** @param  ctx    core context
+ ** @param  ticks  amount of skipped ticks
+ ** @return none
+ ******************************************************************************/
+void asc_core_advance(asc_context_t* const ctx, const uint32_t ticks);
+
+/*******************************************************************************
+ ** @brief  Defer cbs of entities, URCs and URC waiters. asc_core_proc only
+ **         parses and moves entities, and puts completions to the event ring
+ **         of context, the application calls them by @asc_event_dispatch in
+ **         thread context. Cbs of items stay in asc_core_proc, they parse data
+ **         of rx ring for the cb of entity. While the ring is full, answers,
+ **         URCs and deadlines wait in asc_core_proc. Cbs which can't wait
+ **         (@asc_entity_cancel, timeout of URC waiter, more URCs in one check
+ **         than free places) are called in place and counted in overflow.
+ **         Can be called before asc_init
+ ** @param  ctx    core context
+ ** @param  defer  true - queue cbs, false - call them from asc_core_proc
+ ** @return previous value
+ ******************************************************************************/
+bool asc_event_defer_set(asc_context_t* const ctx, const bool defer);
+
+/*******************************************************************************
+ ** @brief  Call deferred cbs in order of completion. Single consumer: call it
+ **         only from one thread. Cbs can enqueue entities. Cb of URC gets a
+ **         slice of its copy, up to @ASC_EVENT_URC_SIZE bytes, which is valid
+ **         until cb returns. Usefull data of entity is freed after its cb.
+ **         @asc_deinit of other thread waits for its end
+ ** @param  ctx  core context
+ ** @param  max  max amount of cbs per call, 0 - all
+ ** @return amount of called cbs
+ ******************************************************************************/
+uint8_t asc_event_dispatch(asc_context_t* const ctx, const uint8_t max);
+
+/*******************************************************************************
+ ** @brief  Submit data to tx queue of context. asc_core_proc passes it to
+ **         asc_write outside of critical section, short writes are resumed
+ **         from the first not accepted byte
+ ** @param  ctx   core context
+ ** @param  tx    descriptor, should exist until cb
+ ** @param  data  data, should exist until cb
+ ** @param  len   length of data
+ ** @param  cb    cb when all data is sent or descriptor is dropped. Can be NULL
+ ** @param  arg   arg for cb. Can be NULL
+ ** @return true - submitted, false - descriptor is already in queue
+ ******************************************************************************/
+bool asc_tx_submit(asc_context_t* const ctx, asc_tx_t* const tx, const uint8_t* const data, const uint16_t len, const asc_tx_cb_t cb, void* const arg);
+
+/*******************************************************************************
+ ** @brief  Remove descriptor from tx queue, cb is not called
+ ** @param  ctx  core context
+ ** @param  tx   descriptor
+ ** @return true - removed or not queued, false - port is sending its data now
+ ******************************************************************************/
+bool asc_tx_cancel(asc_context_t* const ctx, asc_tx_t* const tx);
+
+/*******************************************************************************
+ ** @brief  Report that data accepted by the last asc_write is sent. Call it from
+ **         TX complete IRQ of port when @ASC_TX_ASYNC is 1
+ ** @param  ctx  core context
+ ** @return none
+ ******************************************************************************/
+void asc_tx_done(asc_context_t* const ctx);
+
+/*******************************************************************************
+ ** @brief  Put received data to rx ring. Single producer: call it only from one
+ **         place, e.g. UART ISR or DMA handler, without critical section. Core
+ **         is the single consumer, so neither side blocks the other
+ ** @param  ring  rx ring buffer
+ ** @param  data  received data
+ ** @param  len   length of data
+ ** @return amount of stored bytes, the rest is dropped as the ring is full
+ ******************************************************************************/
+uint16_t asc_ring_write(asc_ring_buffer_t* const ring, const uint8_t* const data, const uint16_t len);
+
+/*******************************************************************************
+ ** @brief  Amount of data in rx ring which is not processed by core yet
+ ** @param  ring  rx ring buffer
+ ** @return amount of bytes
+ ******************************************************************************/
+uint16_t asc_ring_count(const asc_ring_buffer_t* const ring);
+
 /*******************************************************************************
  ** @brief  Function get time in 10ms. 
  ** @param  ctx  core context
@@ -249,6 +707,13 @@ void asc_core_proc(asc_context_t* const ctx);
  ******************************************************************************/
 uint32_t asc_get_cur_time(asc_context_t* const ctx);
 
+/*******************************************************************************
+ ** @brief  Function get time in ms with @ASC_CORE_TICK_MS resolution
+ ** @param  ctx  core context
+ ** @return time
+ ******************************************************************************/
+uint32_t asc_get_cur_time_ms(asc_context_t* const ctx);
+
 /*******************************************************************************
  ** @brief  Function get init. 
  ** @param  ctx  core context
@@ -272,6 +737,18 @@ void* asc_malloc(asc_context_t* const ctx, size_t size);
  ******************************************************************************/
 void asc_free(asc_context_t* const ctx, void* ptr);
 
+/*******************************************************************************
+ ** @brief  Get storage of a module in context, e.g. cache kept between calls.
+ **         It is allocated zeroed in mem_pool on the first call and dropped by
+ **         @asc_deinit after its release cb
+ ** @param  ctx      core context
+ ** @param  key      owner of storage, address of its static
+ ** @param  size     size of storage, 0 - don't allocate, only look for it
+ ** @param  release  cb called by @asc_deinit, can be NULL
+ ** @return ptr to storage, NULL - no free slot or memory
+ ******************************************************************************/
+void* asc_storage_get(asc_context_t* const ctx, const void* const key, const uint16_t size, const asc_storage_release_t release);
+
 #ifdef ASC_TEST
 void _asc_core_proc(asc_context_t* const ctx);
 int _asc_cmd_ring_parcer(asc_context_t* const ctx, const asc_entity_t* const entity, const asc_item_t* const item, const ringslice_t rs_me);
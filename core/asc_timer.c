@@ -0,0 +1,232 @@
+/******************************************************************************
+ *                              _    ____   ____                              *
+ *                   ======    / \  / ___| / ___| ======       (c)03.10.2025  *
+ *                   ======   / _ \ \___ \| |     ======           v1.0.0     *
+ *                   ======  / ___ \ ___) | |___  ======                      *
+ *                   ====== /_/   \_\____/ \____| ======                      *
+ *                                                                            *
+ ******************************************************************************/
+/*******************************************************************************
+ * Include files
+ ******************************************************************************/
+#include "asc_timer.h"
+#include "asc_core.h"
+#include "dbc_assert.h"
+#include "asc_port.h"
+
+/*******************************************************************************
+ * Local pre-processor symbols/macros ('#define')
+ ******************************************************************************/
+DBC_MODULE_NAME("ASC_TIMER")
+
+/*******************************************************************************
+ * Global variable definitions (declared in header file with 'extern')
+ ******************************************************************************/
+/*******************************************************************************
+ * Local function prototypes ('static')
+ ******************************************************************************/
+/*******************************************************************************
+ * Local types definitions
+ ******************************************************************************/
+/*******************************************************************************
+ * Local variable definitions ('static')
+ ******************************************************************************/
+/*******************************************************************************
+ * Function implementation - global ('extern') and local ('static')
+ ******************************************************************************/
+/**
+ * @brief Link timer to the slot of wheel according to its expire moment
+ */
+static void asc_timer_link(asc_timer_wheel_t* const wheel, asc_timer_t* const timer)
+{
+  uint32_t delta = timer->expire - wheel->now;
+  uint8_t level = 0;
+  while(level < ASC_TIMER_WHEEL_LEVELS - 1 && (delta >> (ASC_TIMER_WHEEL_BITS * (level + 1)))) level++;
+  uint32_t id = (timer->expire >> (ASC_TIMER_WHEEL_BITS * level)) & ASC_TIMER_WHEEL_MASK;
+  if(delta >> (ASC_TIMER_WHEEL_BITS * ASC_TIMER_WHEEL_LEVELS)) //too far, park in the last visited slot of the top level
+  {
+    id = ((wheel->now >> (ASC_TIMER_WHEEL_BITS * level)) - 1) & ASC_TIMER_WHEEL_MASK;
+  }
+  asc_timer_t** head = &wheel->slot[level][id];
+  timer->next = *head;
+  if(*head) (*head)->pprev = &timer->next;
+  *head = timer;
+  timer->pprev = head;
+}
+
+/**
+ * @brief Unlink timer from its slot
+ */
+static void asc_timer_unlink(asc_timer_t* const timer)
+{
+  *timer->pprev = timer->next;
+  if(timer->next) timer->next->pprev = timer->pprev;
+  timer->next = NULL;
+  timer->pprev = NULL;
+}
+
+/**
+ * @brief Move timers of the slot of upper level to lower levels
+ */
+static void asc_timer_cascade(asc_timer_wheel_t* const wheel, const uint8_t level)
+{
+  uint32_t id = (wheel->now >> (ASC_TIMER_WHEEL_BITS * level)) & ASC_TIMER_WHEEL_MASK;
+  asc_timer_t* timer = wheel->slot[level][id];
+  wheel->slot[level][id] = NULL;
+  while(timer)
+  {
+    asc_timer_t* next = timer->next;
+    asc_timer_link(wheel, timer);
+    timer = next;
+  }
+}
+
+/*******************************************************************************
+ ** @brief  Start (or restart) timer of context. Timer is a deadline in the
+ **         context timer wheel, so cost of each tick is O(expired timers)
+ ** @param  ctx   core context
+ ** @param  timer timer, should exist until expiry or stop
+ ** @param  ms    time to expiry in ms, rounded up to @ASC_CORE_TICK_MS
+ ** @param  cb    cb on expiry. Can be NULL
+ ** @param  arg   arg for cb. Can be NULL
+ ** @return none
+ ******************************************************************************/
+void asc_timer_start(asc_context_t* const ctx, asc_timer_t* const timer, const uint32_t ms, const asc_timer_cb_t cb, void* const arg)
+{
+  DBC_REQUIRE(100, ctx);
+  ASC_CRITICAL_ENTER(ctx)
+  DBC_REQUIRE(101, timer);
+  if(timer->pprev) asc_timer_unlink(timer);
+  uint32_t ticks = (ms + ASC_CORE_TICK_MS - 1) / ASC_CORE_TICK_MS;
+  timer->expire = ctx->time + (ticks ? ticks : 1); //wheel can be behind core time after asc_core_advance
+  timer->cb = cb;
+  timer->arg = arg;
+  asc_timer_link(&ctx->timers, timer);
+  ASC_CRITICAL_EXIT(ctx)
+}
+
+/*******************************************************************************
+ ** @brief  Stop timer if it is active
+ ** @param  ctx   core context
+ ** @param  timer timer
+ ** @return none
+ ******************************************************************************/
+void asc_timer_stop(asc_context_t* const ctx, asc_timer_t* const timer)
+{
+  DBC_REQUIRE(200, ctx);
+  ASC_CRITICAL_ENTER(ctx)
+  DBC_REQUIRE(201, timer);
+  if(timer->pprev) asc_timer_unlink(timer);
+  ASC_CRITICAL_EXIT(ctx)
+}
+
+/*******************************************************************************
+ ** @brief  Check if timer is active
+ ** @param  timer timer
+ ** @return true - timer is waiting for expiry
+ ******************************************************************************/
+bool asc_timer_is_active(const asc_timer_t* const timer)
+{
+  DBC_REQUIRE(300, timer);
+  return timer->pprev != NULL;
+}
+
+/*******************************************************************************
+ ** @brief  Get time left to expiry of timer
+ ** @param  ctx   core context
+ ** @param  timer timer
+ ** @return time in ms, 0 if timer is not active
+ ******************************************************************************/
+uint32_t asc_timer_left_ms(asc_context_t* const ctx, const asc_timer_t* const timer)
+{
+  DBC_REQUIRE(400, ctx);
+  ASC_CRITICAL_ENTER(ctx)
+  DBC_REQUIRE(401, timer);
+  const int32_t ticks = (int32_t)(timer->expire - ctx->time);
+  uint32_t res = (timer->pprev && ticks > 0) ? (uint32_t)ticks * ASC_CORE_TICK_MS : 0;
+  ASC_CRITICAL_EXIT(ctx)
+  return res;
+}
+
+/*******************************************************************************
+ ** @brief  Reset timer wheel, all timers become unlinked
+ ** @param  ctx  core context
+ ** @return none
+ ******************************************************************************/
+void asc_timer_reset(asc_context_t* const ctx)
+{
+  DBC_REQUIRE(500, ctx);
+  ASC_CRITICAL_ENTER(ctx)
+  for(uint8_t level = 0; level < ASC_TIMER_WHEEL_LEVELS; level++)
+  {
+    for(uint8_t id = 0; id < ASC_TIMER_WHEEL_SLOTS; id++)
+    {
+      while(ctx->timers.slot[level][id]) asc_timer_unlink(ctx->timers.slot[level][id]);
+    }
+  }
+  ctx->timers.now = ctx->time;
+  ASC_CRITICAL_EXIT(ctx)
+}
+
+/*******************************************************************************
+ ** @brief  Advance timer wheel to the current time of context and call cbs of
+ **         expired timers. Called by asc_core_proc
+ ** @param  ctx  core context
+ ** @return none
+ ******************************************************************************/
+void asc_timer_proc(asc_context_t* const ctx)
+{
+  DBC_REQUIRE(600, ctx);
+  asc_timer_wheel_t* const wheel = &ctx->timers;
+  ASC_CRITICAL_ENTER(ctx)
+  while(wheel->now != ctx->time)
+  {
+    wheel->now++;
+    for(uint8_t level = ASC_TIMER_WHEEL_LEVELS - 1; level; level--) //upper levels first, they may fill the current slots of lower ones
+    {
+      if(!(wheel->now & ((1u << (ASC_TIMER_WHEEL_BITS * level)) - 1u))) asc_timer_cascade(wheel, level);
+    }
+    asc_timer_t** head = &wheel->slot[0][wheel->now & ASC_TIMER_WHEEL_MASK];
+    while(*head)
+    {
+      asc_timer_t* timer = *head;
+      asc_timer_unlink(timer);
+      if(timer->expire != wheel->now) //parked far timer, not yet
+      {
+        asc_timer_link(wheel, timer);
+        continue;
+      }
+      ASC_CRITICAL_EXIT(ctx) //cb can start timers again
+      if(timer->cb) timer->cb(timer->arg);
+      ASC_CRITICAL_ENTER(ctx)
+    }
+  }
+  ASC_CRITICAL_EXIT(ctx)
+}
+
+/*******************************************************************************
+ ** @brief  Get time left to expiry of the nearest timer of context. Lets the
+ **         caller skip idle ticks, see @asc_core_next_wakeup
+ ** @param  ctx   core context
+ ** @return time in ms, UINT32_MAX if no timer is active
+ ******************************************************************************/
+uint32_t asc_timer_next_ms(asc_context_t* const ctx)
+{
+  DBC_REQUIRE(700, ctx);
+  uint32_t res = UINT32_MAX;
+  ASC_CRITICAL_ENTER(ctx)
+  for(uint8_t level = 0; level < ASC_TIMER_WHEEL_LEVELS; level++)
+  {
+    for(uint8_t id = 0; id < ASC_TIMER_WHEEL_SLOTS; id++)
+    {
+      for(const asc_timer_t* timer = ctx->timers.slot[level][id]; timer; timer = timer->next)
+      {
+        const int32_t ticks = (int32_t)(timer->expire - ctx->time); //wheel can be behind core time till the next asc_timer_proc
+        const uint32_t left = ticks > 0 ? (uint32_t)ticks * ASC_CORE_TICK_MS : 0;
+        if(left < res) res = left;
+      }
+    }
+  }
+  ASC_CRITICAL_EXIT(ctx)
+  return res;
+}
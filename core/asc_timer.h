@@ -0,0 +1,114 @@
+/******************************************************************************
+ *                              _    ____   ____                              *
+ *                   ======    / \  / ___| / ___| ======       (c)03.10.2025  *
+ *                   ======   / _ \ \___ \| |     ======           v1.0.0     *
+ *                   ======  / ___ \ ___) | |___  ======                      *
+ *                   ====== /_/   \_\____/ \____| ======                      *
+ *                                                                            *
+ ******************************************************************************/
+#ifndef __ASC_TIMER_H
+#define __ASC_TIMER_H
+
+/*******************************************************************************
+ * Include files
+ ******************************************************************************/
+#include <stdint.h>
+#include <stdbool.h>
+
+/*******************************************************************************
+ * Config
+ ******************************************************************************/
+#define ASC_CORE_TICK_MS         10     //Period of asc_core_proc calls in ms, resolution of timers
+
+#define ASC_TIMER_WHEEL_BITS     4      //Slots per wheel level = 1 << ASC_TIMER_WHEEL_BITS
+
+#define ASC_TIMER_WHEEL_LEVELS   4      //Levels cover (1 << (BITS*LEVELS)) ticks, longer timers are recascaded
+
+/*******************************************************************************
+ * Global pre-processor symbols/macros ('#define')
+ ******************************************************************************/
+#define ASC_TIMER_WHEEL_SLOTS    (1u << ASC_TIMER_WHEEL_BITS)
+#define ASC_TIMER_WHEEL_MASK     (ASC_TIMER_WHEEL_SLOTS - 1u)
+
+/*******************************************************************************
+ * Global type definitions ('typedef')
+ ******************************************************************************/
+struct asc_context_t;
+
+typedef void (*asc_timer_cb_t)(void* const arg);
+
+typedef struct asc_timer_t {
+  struct asc_timer_t*  next;    //next timer in wheel slot
+  struct asc_timer_t** pprev;   //link to this timer in wheel slot, NULL - timer is not active
+  uint32_t             expire;  //expire moment in core ticks
+  asc_timer_cb_t       cb;      //cb on expiry, called from asc_core_proc
+  void*                arg;     //arg for cb
+} asc_timer_t;
+
+typedef struct asc_timer_wheel_t {
+  asc_timer_t* slot[ASC_TIMER_WHEEL_LEVELS][ASC_TIMER_WHEEL_SLOTS]; //lists of timers
+  uint32_t     now;                                                  //last processed tick
+} asc_timer_wheel_t;
+
+/*******************************************************************************
+ * Global function prototypes (definition in C source)
+ ******************************************************************************/
+/*******************************************************************************
+ ** @brief  Start (or restart) timer of context. Timer is a deadline in the
+ **         context timer wheel, so cost of each tick is O(expired timers)
+ ** @param  ctx   core context
+ ** @param  timer timer, should exist until expiry or stop
+ ** @param  ms    time to expiry in ms, rounded up to @ASC_CORE_TICK_MS
+ ** @param  cb    cb on expiry. Can be NULL
+ ** @param  arg   arg for cb. Can be NULL
+ ** @return none
+ ******************************************************************************/
+void asc_timer_start(struct asc_context_t* const ctx, asc_timer_t* const timer, const uint32_t ms, const asc_timer_cb_t cb, void* const arg);
+
+/*******************************************************************************
+ ** @brief  Stop timer if it is active
+ ** @param  ctx   core context
+ ** @param  timer timer
+ ** @return none
+ ******************************************************************************/
+void asc_timer_stop(struct asc_context_t* const ctx, asc_timer_t* const timer);
+
+/*******************************************************************************
+ ** @brief  Check if timer is active
+ ** @param  timer timer
+ ** @return true - timer is waiting for expiry
+ ******************************************************************************/
+bool asc_timer_is_active(const asc_timer_t* const timer);
+
+/*******************************************************************************
+ ** @brief  Get time left to expiry of timer
+ ** @param  ctx   core context
+ ** @param  timer timer
+ ** @return time in ms, 0 if timer is not active
+ ******************************************************************************/
+uint32_t asc_timer_left_ms(struct asc_context_t* const ctx, const asc_timer_t* const timer);
+
+/*******************************************************************************
+ ** @brief  Reset timer wheel, all timers become unlinked
+ ** @param  ctx  core context
+ ** @return none
+ ******************************************************************************/
+void asc_timer_reset(struct asc_context_t* const ctx);
+
+/*******************************************************************************
+ ** @brief  Advance timer wheel to the current time of context and call cbs of
+ **         expired timers. Called by asc_core_proc
+ ** @param  ctx  core context
+ ** @return none
+ ******************************************************************************/
+void asc_timer_proc(struct asc_context_t* const ctx);
+
+/*******************************************************************************
+ ** @brief  Get time left to expiry of the nearest timer of context. Lets the
+ **         caller skip idle ticks, see @asc_core_next_wakeup
+ ** @param  ctx   core context
+ ** @return time in ms, UINT32_MAX if no timer is active
+ ******************************************************************************/
+uint32_t asc_timer_next_ms(struct asc_context_t* const ctx);
+
+#endif //__ASC_TIMER_H
@@ -0,0 +1,135 @@
+/*******************************************************************************
+ *                              ASC Example                         19.10.2026 *
+ *                                 v1.0                                        *
+ *       This example is showing how to run ASC on Linux with POSIX port:      *
+ *       tty in raw mode, rx thread, pthread critical sections and the same    *
+ *       chain style as tcp.c. Without args it talks to emulated modem on pty, *
+ *       with path of tty (e.g. /dev/ttyUSB0) - to real modem.                 *
+ ******************************************************************************/
+/*******************************************************************************
+ * Include files
+ ******************************************************************************/
+#include <stdio.h>
+#include <string.h>
+#include "asc_core.h"
+#include "asc_mdl_general.h"
+#include "asc_chain.h"
+#include "asc_port_posix.h"
+#include "asc_posix_emu.h"
+
+/*******************************************************************************
+ * Local variable definitions ('static')
+ ******************************************************************************/
+static asc_context_t posix_ctx = {0};
+static asc_chain_sched_t posix_sched = {0};
+static asc_posix_serial_t posix_serial = {.fd = -1};
+static asc_posix_emu_t posix_emu = {.master = -1};
+static uint8_t posix_rx_storage[1024];
+static asc_ring_buffer_t posix_rx = {.buffer = posix_rx_storage, .size = sizeof(posix_rx_storage)};
+
+/*******************************************************************************
+ * Function implementation - global ('extern') and local ('static')
+ ******************************************************************************/
+/*******************************************************************************
+ ** \brief  Methods and statics for port
+ ** \param  None
+ ** \retval None
+ ******************************************************************************/
+static void posix_printf(const char* string)
+{
+  fputs(string, stdout);
+}
+
+static uint16_t posix_write(uint8_t* buff, uint16_t len)
+{
+  return asc_posix_serial_write(&posix_serial, buff, len);
+}
+
+/*******************************************************************************
+ ** \brief  Methods and statics for rtd
+ ** \param  None
+ ** \retval None
+ ******************************************************************************/
+static asc_mdl_rtd_t asc_rtd = {0};
+
+/* Get rtd */
+static void asc_rtd_cb(const bool result, void* const ctx, const void* const data)
+{
+  (void)ctx;
+  if(data && result) asc_rtd = *(asc_mdl_rtd_t*)data;
+}
+
+/* Print rtd */
+static bool asc_rtd_print(void)
+{
+  printf("[DEMO] %u ms imei %s model %s rev %s clock %s iccid %s oper %s rssi %d\n",
+         (unsigned)asc_posix_time_ms(), asc_rtd.modem_imei, asc_rtd.modem_id, asc_rtd.modem_rev,
+         asc_rtd.modem_clock, asc_rtd.sim_iccid, asc_rtd.sim_operator, asc_rtd.sim_rssi);
+  return strlen(asc_rtd.modem_imei) != 0;
+}
+
+/* End of demo */
+static bool asc_demo_done(void)
+{
+  return true;
+}
+
+/*******************************************************************************
+ ** \brief  Chain of demo
+ ** \param  None
+ ** \retval None
+ ******************************************************************************/
+static asc_chain_t* posix_chain_init(void)
+{
+  static const chain_step_t posix_steps[] =
+  {
+    //Main
+    ASC_CHAIN("INIT_MODEM", "NEXT", "STOP", asc_mdl_modem_init, NULL, NULL, NULL, 1),
+    ASC_CHAIN_LOOP_START(5),
+      ASC_CHAIN("GET RTD", "NEXT", "STOP", asc_mdl_rtd_delta, asc_rtd_cb, NULL, NULL, 1),
+      ASC_CHAIN_EXEC("PRINT RTD", "NEXT", "STOP", asc_rtd_print),
+      ASC_CHAIN_DELAY(1000),
+    ASC_CHAIN_LOOP_END,
+    ASC_CHAIN_EXEC("DONE", "STOP", "STOP", asc_demo_done),
+  };
+  return asc_chain_create("POSIX", posix_steps, sizeof(posix_steps)/sizeof(chain_step_t), &posix_ctx);
+}
+
+/*******************************************************************************
+ ** \brief  Main function of project
+ ** \param  argc  1 - emulated modem, 2 - path of tty of real modem
+ ** \param  argv  args
+ ** \retval 0 - chain was done
+ ******************************************************************************/
+int main(int argc, char** argv)
+{
+  const char* path = argc > 1 ? argv[1] : (asc_posix_emu_open(&posix_emu) && asc_posix_emu_start(&posix_emu) ? posix_emu.path : NULL);
+  if(!path || !asc_posix_lock_init(&posix_ctx) || !asc_posix_serial_open(&posix_serial, path, 115200, &posix_rx, true))
+  {
+    perror("[DEMO] open");
+    return 1;
+  }
+  printf("[DEMO] modem on %s\n", path);
+  asc_init(&posix_ctx, posix_printf, posix_write, &posix_rx);
+  asc_chain_t* chain = posix_chain_init();
+  asc_chain_sched_init(&posix_sched, &posix_ctx);
+  asc_chain_sched_add(&posix_sched, chain, 0);
+  asc_chain_start(chain);
+  struct timespec tick = {0};
+  while(chain && posix_serial.running)
+  {
+    asc_posix_tick_wait(&tick); //late ticks run back to back, so core time follows CLOCK_MONOTONIC
+    asc_core_proc(&posix_ctx);
+    if(asc_get_cur_time_ms(&posix_ctx) >= asc_chain_sched_next_wakeup(&posix_sched) && !asc_chain_sched_run(&posix_sched))
+    {
+      asc_chain_destroy(chain);
+      chain = NULL;
+    }
+  }
+  if(chain) asc_chain_destroy(chain);
+  asc_deinit(&posix_ctx);
+  asc_posix_serial_close(&posix_serial); //emulator exits as its slave is closed
+  asc_posix_lock_deinit(&posix_ctx);
+  printf("[DEMO] rx dropped %u bytes\n", (unsigned)posix_serial.rx_drop);
+  return 0;
+}
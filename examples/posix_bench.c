@@ -0,0 +1,275 @@
+/*******************************************************************************
+ *                              ASC Example                         19.10.2026 *
+ *                                 v1.0                                        *
+ *       This example is a benchmark of gateway with many modems on Linux.     *
+ *       Each emulated modem on pty is polled by its own chain: rtd each       *
+ *       second. CPU% of ASC side is printed against amount of modems for      *
+ *       tick mode (asc_core_proc of each context each 10ms, rx threads) and   *
+ *       loop mode (asc_posix_loop: rx readiness and timer deadlines only),    *
+ *       with rtd groups completed per modem per second, to see modems work.   *
+ *       Usage: simcom_asc_bench [max modems] [workers] [seconds]              *
+ ******************************************************************************/
+/*******************************************************************************
+ * Include files
+ ******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include "asc_core.h"
+#include "asc_mdl_general.h"
+#include "asc_chain.h"
+#include "asc_port_posix.h"
+#include "asc_posix_emu.h"
+#include "asc_posix_loop.h"
+
+/*******************************************************************************
+ * Local pre-processor symbols/macros ('#define')
+ ******************************************************************************/
+#define BENCH_MODEMS_MAX   64
+#define BENCH_RX_SIZE      1024
+
+/*******************************************************************************
+ * Local type definitions ('typedef')
+ ******************************************************************************/
+typedef struct bench_modem_t {
+  asc_context_t ctx;
+  asc_chain_sched_t sched;
+  asc_chain_t* chain;
+  asc_posix_serial_t serial;
+  asc_posix_loop_ctx_t entry;
+  asc_ring_buffer_t rx;
+  uint8_t rx_storage[BENCH_RX_SIZE];
+} bench_modem_t;
+
+/*******************************************************************************
+ * Local variable definitions ('static')
+ ******************************************************************************/
+static bench_modem_t bench_modem[BENCH_MODEMS_MAX];
+static asc_posix_emu_t bench_emu[BENCH_MODEMS_MAX];
+static asc_posix_loop_t bench_loop;
+static bench_modem_t* bench_cur = NULL; //modem processed now in tick mode
+static atomic_uint bench_done; //rtd groups completed with success by all modems
+
+/*******************************************************************************
+ * Function implementation - global ('extern') and local ('static')
+ ******************************************************************************/
+/*******************************************************************************
+ ** \brief  Methods for port
+ ** \param  None
+ ** \retval None
+ ******************************************************************************/
+static void bench_printf(const char* string)
+{
+  (void)string;
+}
+
+static uint16_t bench_tick_write(uint8_t* buff, uint16_t len)
+{
+  return asc_posix_serial_write(&bench_cur->serial, buff, len);
+}
+
+/* Chain scheduler of modem, cb of loop */
+static uint32_t bench_sched_cb(asc_context_t* const ctx, void* const arg)
+{
+  asc_chain_sched_t* const sched = (asc_chain_sched_t*)arg;
+  if(asc_get_cur_time_ms(ctx) >= asc_chain_sched_next_wakeup(sched)) asc_chain_sched_run(sched);
+  return asc_chain_sched_next_wakeup(sched);
+}
+
+/* Step cb of rtd, counts answered groups */
+static void bench_rtd_cb(const bool result, void* const meta, const void* const data)
+{
+  (void)meta;
+  (void)data;
+  if(result) atomic_fetch_add_explicit(&bench_done, 1, memory_order_relaxed);
+}
+
+/* Rtd groups per modem per second since count was reset */
+static double bench_done_rate(const int cnt, const int seconds)
+{
+  return (double)atomic_exchange_explicit(&bench_done, 0, memory_order_relaxed) / cnt / seconds;
+}
+
+/* CPU time of process, emulated modems are in child process */
+static uint64_t bench_cpu_ns(void)
+{
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return ((uint64_t)usage.ru_utime.tv_sec + (uint64_t)usage.ru_stime.tv_sec) * 1000000000u +
+         ((uint64_t)usage.ru_utime.tv_usec + (uint64_t)usage.ru_stime.tv_usec) * 1000u;
+}
+
+/*******************************************************************************
+ ** \brief  Chain of modem
+ ** \param  ctx  context of modem
+ ** \retval chain
+ ******************************************************************************/
+static asc_chain_t* bench_chain_init(asc_context_t* const ctx)
+{
+  static const chain_step_t bench_steps[] =
+  {
+    ASC_CHAIN("INIT_MODEM", "NEXT", "INIT_MODEM", asc_mdl_modem_init, NULL, NULL, NULL, 1),
+    ASC_CHAIN_LOOP_START(0),
+      ASC_CHAIN("GET RTD", "NEXT", "INIT_MODEM", asc_mdl_rtd, bench_rtd_cb, NULL, NULL, 1),
+      ASC_CHAIN_DELAY(1000),
+    ASC_CHAIN_LOOP_END,
+  };
+  return asc_chain_create("BENCH", bench_steps, sizeof(bench_steps)/sizeof(chain_step_t), ctx);
+}
+
+/*******************************************************************************
+ ** \brief  Open modems and start their chains
+ ** \param  cnt   amount of modems
+ ** \param  loop  true - loop mode, false - tick mode
+ ** \retval true - all opened
+ ******************************************************************************/
+static bool bench_open(const int cnt, const bool loop)
+{
+  for(int i = 0; i < cnt; i++)
+  {
+    bench_modem_t* const modem = &bench_modem[i];
+    memset(modem, 0, sizeof(*modem));
+    modem->serial.fd = -1;
+    modem->rx.buffer = modem->rx_storage;
+    modem->rx.size = sizeof(modem->rx_storage);
+    if(!asc_posix_serial_open(&modem->serial, bench_emu[i].path, 115200, &modem->rx, !loop)) return false;
+    asc_init(&modem->ctx, bench_printf, loop ? asc_posix_loop_write : bench_tick_write, &modem->rx);
+    modem->chain = bench_chain_init(&modem->ctx);
+    asc_chain_sched_init(&modem->sched, &modem->ctx);
+    asc_chain_sched_add(&modem->sched, modem->chain, 0);
+    asc_chain_start(modem->chain);
+    if(loop && !asc_posix_loop_add(&bench_loop, &modem->entry, &modem->ctx, &modem->serial, bench_sched_cb, &modem->sched)) return false;
+  }
+  return true;
+}
+
+/*******************************************************************************
+ ** \brief  Stop chains and close modems
+ ** \param  cnt  amount of modems
+ ** \retval None
+ ******************************************************************************/
+static void bench_close(const int cnt)
+{
+  for(int i = 0; i < cnt; i++)
+  {
+    bench_modem_t* const modem = &bench_modem[i];
+    if(modem->chain) asc_chain_destroy(modem->chain);
+    modem->chain = NULL;
+    if(asc_get_init(&modem->ctx).init) asc_deinit(&modem->ctx);
+    asc_posix_serial_close(&modem->serial);
+  }
+}
+
+/*******************************************************************************
+ ** \brief  Run tick mode: one thread procs each context each tick
+ ** \param  cnt      amount of modems
+ ** \param  seconds  duration
+ ** \param  done     rtd groups per modem per second, output
+ ** \retval CPU%
+ ******************************************************************************/
+static double bench_tick(const int cnt, const int seconds, double* const done)
+{
+  if(!bench_open(cnt, false))
+  {
+    bench_close(cnt);
+    return -1;
+  }
+  const uint64_t cpu = bench_cpu_ns();
+  bench_done_rate(cnt, seconds);
+  const uint32_t ticks = (uint32_t)seconds * 1000u / ASC_CORE_TICK_MS;
+  struct timespec tick = {0};
+  for(uint32_t t = 0; t < ticks; t++)
+  {
+    asc_posix_tick_wait(&tick);
+    for(int i = 0; i < cnt; i++)
+    {
+      bench_cur = &bench_modem[i];
+      asc_core_proc(&bench_cur->ctx);
+      bench_sched_cb(&bench_cur->ctx, &bench_cur->sched);
+    }
+  }
+  const double res = (double)(bench_cpu_ns() - cpu) / ((double)seconds * 1e7);
+  *done = bench_done_rate(cnt, seconds);
+  bench_close(cnt);
+  return res;
+}
+
+/*******************************************************************************
+ ** \brief  Run loop mode
+ ** \param  cnt      amount of modems
+ ** \param  workers  amount of workers
+ ** \param  seconds  duration
+ ** \param  procs    amount of asc_core_proc calls per second, output
+ ** \param  done     rtd groups per modem per second, output
+ ** \retval CPU%
+ ******************************************************************************/
+static double bench_loop_run(const int cnt, const int workers, const int seconds, double* const procs, double* const done)
+{
+  if(!asc_posix_loop_init(&bench_loop, (uint8_t)workers, true)) return -1;
+  if(!bench_open(cnt, true) || !asc_posix_loop_start(&bench_loop))
+  {
+    bench_close(cnt);
+    asc_posix_loop_deinit(&bench_loop);
+    return -1;
+  }
+  const uint64_t cpu = bench_cpu_ns();
+  bench_done_rate(cnt, seconds);
+  sleep((unsigned)seconds);
+  const double res = (double)(bench_cpu_ns() - cpu) / ((double)seconds * 1e7);
+  asc_posix_loop_stop(&bench_loop);
+  *done = bench_done_rate(cnt, seconds);
+  uint32_t cnt_proc = 0;
+  for(int i = 0; i < cnt; i++) cnt_proc += bench_modem[i].entry.proc_cnt;
+  *procs = (double)cnt_proc / seconds;
+  bench_close(cnt);
+  asc_posix_loop_deinit(&bench_loop);
+  return res;
+}
+
+/*******************************************************************************
+ ** \brief  Main function of benchmark
+ ** \param  argc  args
+ ** \param  argv  [max modems] [workers] [seconds]
+ ** \retval 0 - done
+ ******************************************************************************/
+int main(int argc, char** argv)
+{
+  const int max = argc > 1 ? atoi(argv[1]) : BENCH_MODEMS_MAX;
+  const int workers = argc > 2 ? atoi(argv[2]) : 4;
+  const int seconds = argc > 3 ? atoi(argv[3]) : 10;
+  if(max < 1 || max > BENCH_MODEMS_MAX || workers < 1 || workers > ASC_POSIX_LOOP_WORKERS || seconds < 1) return 1;
+  for(int i = 0; i < BENCH_MODEMS_MAX; i++) bench_modem[i].serial.fd = -1;
+  for(int i = 0; i < max; i++)
+  {
+    if(!asc_posix_emu_open(&bench_emu[i])) { perror("[BENCH] pty"); return 1; }
+    if(open(bench_emu[i].path, O_RDWR | O_NOCTTY) < 0) return 1; //slave stays open between runs, so emulator doesn't see hangup
+  }
+  const pid_t emu = fork(); //modems run in child, so CPU of parent is ASC side only
+  if(emu < 0) return 1;
+  if(emu == 0)
+  {
+    for(int i = 0; i < max; i++) asc_posix_emu_start(&bench_emu[i]);
+    pause();
+    return 0;
+  }
+  for(int i = 0; i < max; i++) close(bench_emu[i].master); //emulators keep their copies
+  printf("modems  tick cpu%%  tick rtd/s  loop cpu%%  loop rtd/s  loop procs/s  (rtd/s per modem, workers %d, %d s)\n", workers, seconds);
+  for(int cnt = 1; cnt <= max; cnt = cnt < max && cnt * 2 > max ? max : cnt * 2) //the last row is max
+  {
+    double procs = 0;
+    double tick_done = 0;
+    double loop_done = 0;
+    const double tick = bench_tick(cnt, seconds, &tick_done);
+    const double loop = bench_loop_run(cnt, workers, seconds, &procs, &loop_done);
+    printf("%6d  %9.2f  %10.2f  %9.2f  %10.2f  %12.0f\n", cnt, tick, tick_done, loop, loop_done, procs);
+  }
+  kill(emu, SIGTERM);
+  waitpid(emu, NULL, 0);
+  return 0;
+}
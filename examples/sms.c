@@ -1,8 +1,8 @@
 /*******************************************************************************
  *                              ASC Example                         26.11.2025 *
  *                                 v1.0                                        *
- *       This example is showing how to catch incoming sms URC, get msg from   *
- *       it and send back as echo.                                             *
+ *       This example is showing how to catch incoming sms URC, get all new    *
+ *       msgs with one listing and send them back as echo.                     *
  ******************************************************************************/
 /*******************************************************************************
  * Include files
@@ -21,7 +21,8 @@
  * Local function prototypes ('static')
  ******************************************************************************/
 static void asc_sms_urc_cb(const ringslice_t urc_slice);
-static void asc_sms_read_cb(const bool result, void* const ctx, const void* const data);
+static void asc_sms_list_msg_cb(const asc_mdl_sms_msg_t* const sms, void* const user);
+static void asc_sms_list_cb(const bool result, void* const ctx, const void* const data);
 
 /*******************************************************************************
  * Local variable definitions ('static')
@@ -37,23 +38,41 @@ asc_context_t simcom_ctx = {0};
  ** @return None
  ******************************************************************************/
 static asc_urc_queue_t test_urc_sms = {"+CMTI:", asc_sms_urc_cb};
+static asc_mdl_sms_list_t sms_list = {"REC UNREAD", 1, asc_sms_list_msg_cb, NULL, 0};
+static bool sms_list_busy = false;
+static bool sms_list_pending = false;
 
-/* Get sms */
+/* Get all new sms with one listing, read ones are deleted after it */
 static void asc_sms_urc_cb(const ringslice_t urc_slice)
 {
-  asc_mdl_sms_msg_t sms = {0};
-  ringslice_scanf(&urc_slice, "+CMTI:%*[^,],%d\x0d", &sms.index);
-  if(0 != sms.index) asc_mdl_sms_read(&simcom_ctx, asc_sms_read_cb, &sms, NULL);
+  (void)urc_slice;
+  if(sms_list_busy) //msg can come after CMGL answer is captured, list again when it is done
+  {
+    sms_list_pending = true;
+    return;
+  }
+  sms_list_busy = asc_mdl_sms_list(&simcom_ctx, asc_sms_list_cb, &sms_list, NULL);
 }
 
 /* Send echo sms */
-static void asc_sms_read_cb(const bool result, void* const ctx, const void* const data)
+static void asc_sms_list_msg_cb(const asc_mdl_sms_msg_t* const sms, void* const user)
 {
-  if(!result) return;
-  asc_mdl_sms_msg_t* sms = (asc_mdl_sms_msg_t*)data;
+  (void)user;
   asc_mdl_sms_send_text(&simcom_ctx, NULL, sms, NULL);
 }
 
+/* Listing is done */
+static void asc_sms_list_cb(const bool result, void* const ctx, const void* const data)
+{
+  (void)result;
+  (void)ctx;
+  (void)data;
+  sms_list_busy = false;
+  if(!sms_list_pending) return;
+  sms_list_pending = false;
+  sms_list_busy = asc_mdl_sms_list(&simcom_ctx, asc_sms_list_cb, &sms_list, NULL);
+}
+
 /*******************************************************************************
  ** \brief  Main function of project
  ** \param  None
@@ -27,6 +27,8 @@
  * Local variable definitions ('static')
  ******************************************************************************/
 asc_context_t simcom_ctx = {0};
+asc_chain_sched_t simcom_sched = {0};
+static asc_chain_checkpoint_t simcom_checkpoint __attribute__((section(".noinit"))); //retained RAM, survives watchdog reset
 
 /*******************************************************************************
  * Function implementation - global ('extern') and local ('static')
@@ -126,24 +128,25 @@ static bool asc_server_data_wialon_packet(void)
  ******************************************************************************/ 
 asc_chain_t* test_chain_init(void)
 {
-  chain_step_t tcp_steps[] = 
+  static const chain_step_t tcp_steps[] = 
   {   
     //Main
-    ASC_CHAIN("INIT_MODEM", "NEXT", "MODEM_RESTART", asc_mdl_modem_init, NULL, NULL, NULL, 1),
+    ASC_CHAIN("INIT_MODEM", "NEXT", "MODEM RESTART", asc_mdl_modem_init, NULL, NULL, NULL, 1),
     ASC_CHAIN("GPRS INIT", "NEXT", "GPRS DEINIT", asc_mdl_gprs_init, NULL, NULL, NULL, 1),
     ASC_CHAIN("SOCKET CONFIG", "NEXT", "GPRS INIT", asc_mdl_gprs_socket_config, NULL, NULL, NULL, 1),
     ASC_CHAIN("CONNECT TO SERVER", "NEXT", "SOCKET CONFIG", asc_mdl_gprs_socket_connect, NULL, &asc_server_connect, NULL, 1),
-    ASC_CHAIN("GET RTD", "NEXT", "DISCONNECT FROM SERVER", asc_mdl_rtd, asc_rtd_cb, NULL, NULL, 1),
+    ASC_CHAIN("GET RTD", "NEXT", "DISCONNECT FROM SERVER", asc_mdl_rtd_delta, asc_rtd_cb, NULL, NULL, 1),
     ASC_CHAIN_EXEC("CHECK RTD", "NEXT", "GET RTD", asc_rtd_check),
     
     ASC_CHAIN_EXEC("CREATE WIALON LOGIN", "NEXT", "DISCONNECT FROM SERVER", asc_server_data_wialon_login),
     ASC_CHAIN("SEND WIALON LOGIN", "NEXT", "DISCONNECT FROM SERVER", asc_mdl_gprs_socket_send_recieve, NULL, &asc_server_data, NULL, 3),
     
     ASC_CHAIN_LOOP_START(10),
-      ASC_CHAIN("GET RTD", "NEXT", "DISCONNECT FROM SERVER", asc_mdl_rtd, asc_rtd_cb, NULL, NULL, 1),
+      ASC_CHAIN_CHECKPOINT("CHECKPOINT", &simcom_checkpoint, asc_rtd.modem_imei, sizeof(asc_rtd.modem_imei)),
+      ASC_CHAIN("GET RTD", "NEXT", "DISCONNECT FROM SERVER", asc_mdl_rtd_delta, asc_rtd_cb, NULL, NULL, 1),
       ASC_CHAIN_EXEC("CREATE WIALON DATA", "NEXT", "DISCONNECT FROM SERVER", asc_server_data_wialon_packet),
       ASC_CHAIN("SEND WIALON DATA", "NEXT", "DISCONNECT FROM SERVER", asc_mdl_gprs_socket_send_recieve, NULL, &asc_server_data, NULL, 3),
-      ASC_CHAIN_DELAY(1000),
+      ASC_CHAIN_DELAY(10000),
     ASC_CHAIN_LOOP_END,
     
     ASC_CHAIN_EXEC("WIALON DATA CLEAN", "STOP", "HARD RESET", asc_server_data_clean),
@@ -156,9 +159,10 @@ asc_chain_t* test_chain_init(void)
     //Critical
     ASC_CHAIN_EXEC("HARD RESET", "STOP", "STOP", asc_hard_reset),
 
+    //Resume after MCU reset
+    ASC_CHAIN("PROBE SESSION", "STOP", "INIT_MODEM", asc_mdl_gprs_socket_probe, NULL, NULL, NULL, 1),
   };
   asc_chain_t* chain = asc_chain_create("TCP", tcp_steps, sizeof(tcp_steps)/sizeof(chain_step_t), &simcom_ctx);
-  asc_chain_start(chain);
   return chain;
 }
   
@@ -173,13 +177,22 @@ void main(void)
   asc_boot(); //init hardware, pins, uart, clock and etc.
   asc_init(&simcom_ctx, my_printf, gsm_proc_send_data, (asc_ring_buffer_t*)&uart_gsm_ctx.rx_buf); //atl lib init
   asc_chain_t* chain = test_chain_init(); //create behavior scenario using atl chain
+  asc_chain_sched_init(&simcom_sched, &simcom_ctx);
+  asc_chain_sched_add(&simcom_sched, chain, 0);
+  if(!asc_chain_resume(chain, &simcom_checkpoint, "PROBE SESSION", asc_rtd.modem_imei, sizeof(asc_rtd.modem_imei))) //modem is still connected - one AT+CIPSTATUS instead of full bring-up
+  {
+    asc_chain_start(chain);
+  }
   while(1)
   {
     asc_timers_proc(); //proc programm timers (10ms included inside of it)
-    if(asc_chain_is_running(chain))
+    if(chain && asc_get_cur_time_ms(&simcom_ctx) >= asc_chain_sched_next_wakeup(&simcom_sched)) //run chain only when it has work to do
     {
-      asc_chain_run(chain);
-      if(!asc_chain_is_running(chain)) asc_chain_destroy(chain); //chain was done and stop, destroy it
+      if(!asc_chain_sched_run(&simcom_sched)) 
+      {
+        asc_chain_destroy(chain); //chain was done and stop, destroy it
+        chain = NULL;
+      }
     }
   }
 }
\ No newline at end of file
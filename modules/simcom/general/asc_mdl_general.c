@@ -11,11 +11,16 @@
  ******************************************************************************/
 #include "asc_core.h"
 #include "asc_mdl_general.h"
+#include "asc_port.h"
 #include "dbc_assert.h"
 
 /*******************************************************************************
  * Local pre-processor symbols/macros ('#define')
  ******************************************************************************/
+DBC_MODULE_NAME("ASC_MDL_GENERAL")
+
+#define ASC_MDL_RTD_LBS_MODE  (1 << 15) //CENG mode is set, lives until modem power cycle
+
 /*******************************************************************************
  * Global variable definitions (declared in header file with 'extern')
  ******************************************************************************/
@@ -23,13 +28,32 @@
  * Local function prototypes ('static')
  ******************************************************************************/
 static void asc_mdl_general_ceng_cb(ringslice_t rs_data, bool result, void* const data);
+static void asc_mdl_rtd_delta_cb(const bool result, void* const meta, const void* const data);
 
 /*******************************************************************************
  * Local types definitions
  ******************************************************************************/
+typedef struct asc_mdl_rtd_cache_t {
+  asc_context_t* ctx;          // owner context
+  asc_mdl_rtd_t rtd;           // cached identity and last polled dynamic fields
+  asc_mdl_rtd_field_t cached;  // static fields which are already read
+  uint8_t seq;                 // changed by reset, answer of older request is dropped
+  bool busy;                   // request in progress
+} asc_mdl_rtd_cache_t;
+
+typedef struct asc_mdl_rtd_delta_data_t {
+  asc_mdl_rtd_t rtd;           // polled fields, the first one so offsets of ASC_ARG are kept
+  asc_mdl_rtd_cache_t* cache;  // cache of context
+  asc_entity_cb_t cb;          // user cb
+  void* meta;                  // user meta
+  asc_mdl_rtd_field_t poll;    // fields polled by the request
+  uint8_t seq;                 // seq of cache at the start of the request
+} asc_mdl_rtd_delta_data_t;
+
 /*******************************************************************************
  * Local variable definitions ('static')
  ******************************************************************************/
+static const uint8_t asc_mdl_rtd_cache_key = 0; //key of cache in storage of context
 /*******************************************************************************
  * Function implementation - global ('extern') and local ('static')
  ******************************************************************************/
@@ -50,6 +74,7 @@ bool asc_mdl_modem_reset(asc_context_t* const ctx, const asc_entity_cb_t cb, con
     ASC_ITEM("AT+CFUN=1,1"ASC_CMD_CRLF, NULL, ASC_PARCE_SIMCOM, 2, 150, 0, 0, NULL, NULL, ASC_NO_ARG),
   };
   if(!asc_entity_enqueue(ctx, items, sizeof(items)/sizeof(items[0]), cb, 0, meta)) return false;
+  asc_mdl_rtd_delta_reset(ctx);
   return true;
 }
 
@@ -72,6 +97,7 @@ bool asc_mdl_modem_init(asc_context_t* const ctx, const asc_entity_cb_t cb, cons
     ASC_ITEM("ATE1"ASC_CMD_CRLF, NULL, ASC_PARCE_SIMCOM, 5, 100, 0, 0, NULL, NULL, ASC_NO_ARG),  
   };
   if(!asc_entity_enqueue(ctx, items, sizeof(items)/sizeof(items[0]), cb, 0, meta)) return false;
+  asc_mdl_rtd_delta_reset(ctx);
   return true;
 }
 
@@ -90,6 +116,7 @@ bool asc_mdl_rtd(asc_context_t* const ctx, const asc_entity_cb_t cb, const void*
   (void)param;
   asc_item_t items[] = //[REQ][PREFIX][PARCE_TYPE][RPT][WAIT][STEPERROR][STEPOK][CB][FORMAT][...##VA_ARGS]
   {   
+    ASC_ITEM_BATCH(7,                                          10, 100, 0, 1),
     ASC_ITEM("AT+GSN"ASC_CMD_CRLF,       NULL, ASC_PARCE_SIMCOM, 10, 100, 0, 1, NULL,               "%15[^\x0d]", ASC_ARG(asc_mdl_rtd_t, modem_imei)),
     ASC_ITEM("AT+GMM"ASC_CMD_CRLF,       NULL, ASC_PARCE_SIMCOM, 10, 100, 0, 1, NULL,               "%15[^\x0d]", ASC_ARG(asc_mdl_rtd_t, modem_id)),  
     ASC_ITEM("AT+GMR"ASC_CMD_CRLF,       NULL, ASC_PARCE_SIMCOM, 10, 100, 0, 1, NULL,      "Revision:%29[^\x0d]", ASC_ARG(asc_mdl_rtd_t, modem_rev)),                
@@ -98,34 +125,150 @@ bool asc_mdl_rtd(asc_context_t* const ctx, const asc_entity_cb_t cb, const void*
     ASC_ITEM("AT+COPS?"ASC_CMD_CRLF,  "+COPS", ASC_PARCE_SIMCOM, 20, 100, 0, 1, NULL, "+COPS: 0, 0,\"%49[^\"]\"", ASC_ARG(asc_mdl_rtd_t, sim_operator)),            
     ASC_ITEM("AT+CSQ"ASC_CMD_CRLF,     "+CSQ", ASC_PARCE_SIMCOM, 10, 100, 0, 1, NULL,                 "+CSQ: %d", ASC_ARG(asc_mdl_rtd_t, sim_rssi)),             
     ASC_ITEM("AT+CENG=3"ASC_CMD_CRLF,    NULL, ASC_PARCE_SIMCOM, 10, 100, 0, 1, NULL,                       NULL, ASC_NO_ARG),                
-    ASC_ITEM("AT+CENG?"ASC_CMD_CRLF,     NULL, ASC_PARCE_SIMCOM, 10, 100, 0, 0, asc_mdl_general_ceng_cb,    NULL, ASC_NO_ARG),                         
+    ASC_ITEM("AT+CENG?"ASC_CMD_CRLF,  "+CENG", ASC_PARCE_SIMCOM_LINES, 10, 100, 0, 0, asc_mdl_general_ceng_cb,    NULL, ASC_NO_ARG),                         
   };
   if(!asc_entity_enqueue(ctx, items, sizeof(items)/sizeof(items[0]), cb, sizeof(asc_mdl_rtd_t), meta)) return false;
   return true;
 }
 
+/*******************************************************************************
+ ** @brief  Delta variant of @asc_mdl_rtd. Static identity (IMEI, model, revision,
+ **         ICCID) is read once per modem power cycle and cached per context,
+ **         each next call polls only the dynamic fields. Merged @asc_mdl_rtd_t
+ **         from the cache will be passed to the data paramater in callback.
+ **         Only one delta request per context can be in progress.
+ ** @param  ctx    core context
+ ** @param  cb     cb when proc will be done. Can be NULL
+ ** @param  param  input param if function is required them. Here is ptr to 
+ **                @asc_mdl_rtd_field_t mask of fields to get, NULL - all fields
+ ** @param  meta   Meta data of function execution. Will be passe to the cb by the
+ **                end of execution. Can be NULL
+ ** @return true - proc started, false - smthg is wrong
+ ******************************************************************************/
+bool asc_mdl_rtd_delta(asc_context_t* const ctx, const asc_entity_cb_t cb, const void* const param, void* const meta)
+{
+  DBC_REQUIRE(101, ctx);
+  asc_mdl_rtd_cache_t* cache = (asc_mdl_rtd_cache_t*)asc_storage_get(ctx, &asc_mdl_rtd_cache_key, sizeof(asc_mdl_rtd_cache_t), NULL); //dropped with mem_pool
+  if(!cache) return false;
+  ASC_CRITICAL_ENTER(ctx) //claim of cache, one request per context
+  if(cache->busy) { ASC_CRITICAL_EXIT(ctx) return false; }
+  cache->ctx = ctx;
+  cache->busy = true;
+  const uint8_t seq = cache->seq;
+  const asc_mdl_rtd_field_t cached = cache->cached;
+  ASC_CRITICAL_EXIT(ctx)
+  asc_mdl_rtd_field_t fields = param ? *(const asc_mdl_rtd_field_t*)param : ASC_MDL_RTD_ALL;
+  asc_mdl_rtd_field_t poll = (fields & ASC_MDL_RTD_DYNAMIC) | (fields & ASC_MDL_RTD_STATIC & ~cached);
+  if((poll & ASC_MDL_RTD_LBS) && !(cached & ASC_MDL_RTD_LBS_MODE)) poll |= ASC_MDL_RTD_LBS_MODE;
+  struct {
+    asc_mdl_rtd_field_t field;
+    bool batch;
+    asc_item_t item;
+  } table[] = //[FIELD][BATCH][REQ][PREFIX][PARCE_TYPE][RPT][WAIT][STEPERROR][STEPOK][CB][FORMAT][...##VA_ARGS]
+  {
+    {ASC_MDL_RTD_IMEI,      true, ASC_ITEM("AT+GSN"ASC_CMD_CRLF,       NULL, ASC_PARCE_SIMCOM, 10, 100, 0, 1, NULL,               "%15[^\x0d]", ASC_ARG(asc_mdl_rtd_t, modem_imei))},
+    {ASC_MDL_RTD_MODEL,     true, ASC_ITEM("AT+GMM"ASC_CMD_CRLF,       NULL, ASC_PARCE_SIMCOM, 10, 100, 0, 1, NULL,               "%15[^\x0d]", ASC_ARG(asc_mdl_rtd_t, modem_id))},
+    {ASC_MDL_RTD_REV,       true, ASC_ITEM("AT+GMR"ASC_CMD_CRLF,       NULL, ASC_PARCE_SIMCOM, 10, 100, 0, 1, NULL,      "Revision:%29[^\x0d]", ASC_ARG(asc_mdl_rtd_t, modem_rev))},
+    {ASC_MDL_RTD_ICCID,     true, ASC_ITEM("AT+CCID"ASC_CMD_CRLF,      NULL, ASC_PARCE_SIMCOM, 10, 100, 0, 1, NULL,               "%21[^\x0d]", ASC_ARG(asc_mdl_rtd_t, sim_iccid))},
+    {ASC_MDL_RTD_CLOCK,     true, ASC_ITEM("AT+CCLK?"ASC_CMD_CRLF,  "+CCLK", ASC_PARCE_SIMCOM, 10, 100, 0, 1, NULL,      "+CCLK: \"%21[^\"]\"", ASC_ARG(asc_mdl_rtd_t, modem_clock))},
+    {ASC_MDL_RTD_OPERATOR,  true, ASC_ITEM("AT+COPS?"ASC_CMD_CRLF,  "+COPS", ASC_PARCE_SIMCOM, 20, 100, 0, 1, NULL, "+COPS: 0, 0,\"%49[^\"]\"", ASC_ARG(asc_mdl_rtd_t, sim_operator))},
+    {ASC_MDL_RTD_RSSI,      true, ASC_ITEM("AT+CSQ"ASC_CMD_CRLF,     "+CSQ", ASC_PARCE_SIMCOM, 10, 100, 0, 1, NULL,                 "+CSQ: %d", ASC_ARG(asc_mdl_rtd_t, sim_rssi))},
+    {ASC_MDL_RTD_LBS_MODE, false, ASC_ITEM("AT+CENG=3"ASC_CMD_CRLF,    NULL, ASC_PARCE_SIMCOM, 10, 100, 0, 1, NULL,                       NULL, ASC_NO_ARG)},
+    {ASC_MDL_RTD_LBS,      false, ASC_ITEM("AT+CENG?"ASC_CMD_CRLF,  "+CENG", ASC_PARCE_SIMCOM_LINES, 10, 100, 0, 1, asc_mdl_general_ceng_cb,    NULL, ASC_NO_ARG)},
+  };
+  asc_item_t items[sizeof(table)/sizeof(table[0]) + 1] = {ASC_ITEM_BATCH(0, 10, 100, 0, 1)};
+  uint8_t cnt = 1; //items[0] is the batch head
+  for(uint8_t i = 0; i < sizeof(table)/sizeof(table[0]); i++)
+  {
+    if(!(poll & table[i].field)) continue;
+    if(table[i].batch) ++items[0].meta.batch_cnt;
+    items[cnt++] = table[i].item;
+  }
+  asc_mdl_rtd_delta_data_t req = {.cache = cache, .cb = cb, .meta = meta, .poll = poll, .seq = seq};
+  if(cnt == 1) //nothing to poll, everything is in cache
+  {
+    asc_mdl_rtd_delta_cb(true, NULL, &req);
+    return true;
+  }
+  asc_item_t* first = items[0].meta.batch_cnt ? &items[0] : &items[1];
+  uint8_t first_cnt = items[0].meta.batch_cnt ? cnt : cnt - 1;
+  if(first_cnt - 1 == items[0].meta.batch_cnt) items[0].meta.ok_step = 0; //batch is the whole group
+  items[cnt - 1].meta.ok_step = 0;
+  if(asc_entity_enqueue_prefill(ctx, first, first_cnt, asc_mdl_rtd_delta_cb, sizeof(asc_mdl_rtd_delta_data_t), NULL, &req)) return true;
+  if(!asc_get_init(ctx).init) return false; //cache is dropped if enqueue deinits context
+  ASC_CRITICAL_ENTER(ctx) //release of cache, unless it was reset meanwhile
+  if(cache->seq == seq) cache->busy = false;
+  ASC_CRITICAL_EXIT(ctx)
+  return false;
+}
+
+/*******************************************************************************
+ ** @brief  Drop cached rtd identity of the context, next @asc_mdl_rtd_delta
+ **         will read it again. Called by @asc_mdl_modem_reset and 
+ **         @asc_mdl_modem_init, call it by yourself after modem power off.
+ **         Request in progress is done with false result, its answer belongs
+ **         to the previous power cycle.
+ ** @param  ctx    core context
+ ** @return none
+ ******************************************************************************/
+void asc_mdl_rtd_delta_reset(asc_context_t* const ctx)
+{
+  DBC_REQUIRE(103, ctx);
+  asc_mdl_rtd_cache_t* cache = (asc_mdl_rtd_cache_t*)asc_storage_get(ctx, &asc_mdl_rtd_cache_key, 0, NULL);
+  ASC_CRITICAL_ENTER(ctx)
+  if(cache)
+  {
+    memset(&cache->rtd, 0, sizeof(asc_mdl_rtd_t));
+    cache->cached = 0;
+    cache->busy = false;
+    ++cache->seq;
+  }
+  ASC_CRITICAL_EXIT(ctx)
+}
+
 /**
- *  @brief ceng cb
+ *  @brief delta rtd cb, merge polled fields into the cache and pass it to the user
+ */
+static void asc_mdl_rtd_delta_cb(const bool result, void* const meta, const void* const data)
+{
+  (void)meta;
+  const asc_mdl_rtd_delta_data_t* req = (const asc_mdl_rtd_delta_data_t*)data;
+  if(!req || !req->cache) return;
+  asc_mdl_rtd_cache_t* cache = req->cache;
+  const asc_mdl_rtd_t* rtd = &req->rtd;
+  const asc_mdl_rtd_field_t poll = req->poll;
+  ASC_CRITICAL_ENTER(cache->ctx)
+  const bool actual = req->seq == cache->seq; //cache is not reset while the request was in progress
+  if(result && actual)
+  {
+    if(poll & ASC_MDL_RTD_IMEI)     memcpy(cache->rtd.modem_imei, rtd->modem_imei, sizeof(rtd->modem_imei));
+    if(poll & ASC_MDL_RTD_MODEL)    memcpy(cache->rtd.modem_id, rtd->modem_id, sizeof(rtd->modem_id));
+    if(poll & ASC_MDL_RTD_REV)      memcpy(cache->rtd.modem_rev, rtd->modem_rev, sizeof(rtd->modem_rev));
+    if(poll & ASC_MDL_RTD_ICCID)    memcpy(cache->rtd.sim_iccid, rtd->sim_iccid, sizeof(rtd->sim_iccid));
+    if(poll & ASC_MDL_RTD_CLOCK)    memcpy(cache->rtd.modem_clock, rtd->modem_clock, sizeof(rtd->modem_clock));
+    if(poll & ASC_MDL_RTD_OPERATOR) memcpy(cache->rtd.sim_operator, rtd->sim_operator, sizeof(rtd->sim_operator));
+    if(poll & ASC_MDL_RTD_RSSI)     cache->rtd.sim_rssi = rtd->sim_rssi;
+    if(poll & ASC_MDL_RTD_LBS)
+    {
+      memcpy(cache->rtd.modem_lbs, rtd->modem_lbs, sizeof(rtd->modem_lbs));
+      cache->rtd.lbs_cnt = rtd->lbs_cnt;
+    }
+    cache->cached |= poll & (ASC_MDL_RTD_STATIC | ASC_MDL_RTD_LBS_MODE);
+  }
+  if(actual) cache->busy = false;
+  ASC_CRITICAL_EXIT(cache->ctx)
+  if(req->cb) req->cb(result && actual, req->meta, &cache->rtd);
+}
+
+/**
+ *  @brief ceng cb, called for each +CENG line. Header line and cells without lac/cell id are skipped
  */
 static void asc_mdl_general_ceng_cb(ringslice_t rs_data, bool result, void* const data)
 {
   if(!result) return;
-  if(ringslice_is_empty(&rs_data)) return;
-  bool header_skip = false;
   asc_mdl_rtd_t* rtd = (asc_mdl_rtd_t*)data;
-  while(ringslice_scanf(&rs_data, "+CENG: %d,\"%d,%d,%x,%x,", 
-                        &rtd->modem_lbs[rtd->lbs_cnt].cell, &rtd->modem_lbs[rtd->lbs_cnt].mcc,
-                        &rtd->modem_lbs[rtd->lbs_cnt].mnc, &rtd->modem_lbs[rtd->lbs_cnt].lac,
-                        &rtd->modem_lbs[rtd->lbs_cnt].cell_id))
-  {
-    if(header_skip && rtd->modem_lbs[rtd->lbs_cnt].cell_id != 0 && rtd->modem_lbs[rtd->lbs_cnt].lac != 0) ++rtd->lbs_cnt;
-    if(rtd->lbs_cnt >= 7) break;
-    ringslice_t rs_temp = {0}; 
-    if(header_skip) rs_temp = ringslice_strstr(&rs_data, "\r\n");
-    else            rs_temp = ringslice_strstr(&rs_data, "\r\n\r\n");
-    if(ringslice_is_empty(&rs_temp)) break;
-    rs_data = ringslice_subslice_after(&rs_data, &rs_temp, 0);
-    if(ringslice_is_empty(&rs_data)) break;
-    header_skip = true;
-  }
-}
\ No newline at end of file
+  if(rtd->lbs_cnt >= 7) return;
+  asc_mdl_rtd_lbs_t* lbs = &rtd->modem_lbs[rtd->lbs_cnt];
+  if(ringslice_scanf(&rs_data, "+CENG: %d,\"%d,%d,%x,%x,", &lbs->cell, &lbs->mcc, &lbs->mnc, &lbs->lac, &lbs->cell_id) != 5) return;
+  if(lbs->cell_id != 0 && lbs->lac != 0) ++rtd->lbs_cnt;
+}
@@ -48,6 +48,22 @@ typedef struct asc_mdl_rtd_t {
   int lbs_cnt;
 } asc_mdl_rtd_t;
 
+typedef uint16_t asc_mdl_rtd_field_t;
+enum
+{
+  ASC_MDL_RTD_IMEI     = (1 << 0), //static, read once per modem power cycle
+  ASC_MDL_RTD_MODEL    = (1 << 1), //static
+  ASC_MDL_RTD_REV      = (1 << 2), //static
+  ASC_MDL_RTD_ICCID    = (1 << 3), //static
+  ASC_MDL_RTD_CLOCK    = (1 << 4), //dynamic, polled on each call
+  ASC_MDL_RTD_OPERATOR = (1 << 5), //dynamic
+  ASC_MDL_RTD_RSSI     = (1 << 6), //dynamic
+  ASC_MDL_RTD_LBS      = (1 << 7), //dynamic
+  ASC_MDL_RTD_STATIC   = ASC_MDL_RTD_IMEI | ASC_MDL_RTD_MODEL | ASC_MDL_RTD_REV | ASC_MDL_RTD_ICCID,
+  ASC_MDL_RTD_DYNAMIC  = ASC_MDL_RTD_CLOCK | ASC_MDL_RTD_OPERATOR | ASC_MDL_RTD_RSSI | ASC_MDL_RTD_LBS,
+  ASC_MDL_RTD_ALL      = ASC_MDL_RTD_STATIC | ASC_MDL_RTD_DYNAMIC,
+};
+
 /*******************************************************************************
  * Local variable definitions ('static')
  ******************************************************************************/
@@ -88,4 +104,32 @@ bool asc_mdl_modem_init(asc_context_t* const ctx, const asc_entity_cb_t cb, cons
  ******************************************************************************/
 bool asc_mdl_rtd(asc_context_t* const ctx, const asc_entity_cb_t cb, const void* const param, void* const meta);
 
+/*******************************************************************************
+ ** @brief  Delta variant of @asc_mdl_rtd. Static identity (IMEI, model, revision,
+ **         ICCID) is read once per modem power cycle and cached per context,
+ **         each next call polls only the dynamic fields. Merged @asc_mdl_rtd_t
+ **         from the cache will be passed to the data paramater in callback.
+ **         Only one delta request per context can be in progress. Cache is
+ **         kept in memory pool of context and is dropped by @asc_deinit.
+ ** @param  ctx    core context
+ ** @param  cb     cb when proc will be done. Can be NULL
+ ** @param  param  input param if function is required them. Here is ptr to 
+ **                @asc_mdl_rtd_field_t mask of fields to get, NULL - all fields
+ ** @param  meta   Meta data of function execution. Will be passe to the cb by the
+ **                end of execution. Can be NULL
+ ** @return true - proc started, false - smthg is wrong
+ ******************************************************************************/
+bool asc_mdl_rtd_delta(asc_context_t* const ctx, const asc_entity_cb_t cb, const void* const param, void* const meta);
+
+/*******************************************************************************
+ ** @brief  Drop cached rtd identity of the context, next @asc_mdl_rtd_delta
+ **         will read it again. Called by @asc_mdl_modem_reset and 
+ **         @asc_mdl_modem_init, call it by yourself after modem power off.
+ **         Request in progress is done with false result, its answer belongs
+ **         to the previous power cycle.
+ ** @param  ctx    core context
+ ** @return none
+ ******************************************************************************/
+void asc_mdl_rtd_delta_reset(asc_context_t* const ctx);
+
  #endif //__ASC_MDL_GENERAL_H 
\ No newline at end of file
@@ -11,6 +11,7 @@
  ******************************************************************************/
 #include "asc_core.h"
 #include "asc_mdl_sms.h"
+#include "asc_port.h"
 #include "dbc_assert.h"
 #include "ringslice.h" 
 #include <stdio.h>
@@ -27,16 +28,39 @@ DBC_MODULE_NAME("ASC_MDL_SMS")
  * Local function prototypes ('static')
  ******************************************************************************/
 static void asc_mdl_sms_cmgr_cb(ringslice_t rs_data, bool result, void* const data);
+static void asc_mdl_sms_cmgl_cb(ringslice_t rs_data, bool result, void* const data);
+static void asc_mdl_sms_list_cb(const bool result, void* const meta, const void* const data);
+static asc_entity_handle_t asc_mdl_sms_enqueue_nopreempt(asc_context_t* const ctx, const asc_item_t* const item, const uint8_t item_amount, const asc_entity_cb_t cb, const uint16_t data_size, void* const meta, const void* const prefill);
 
 /*******************************************************************************
  * Local types definitions
  ******************************************************************************/
+typedef struct asc_mdl_sms_list_data_t {
+  asc_mdl_sms_msg_t msg;     // message being parsed
+  asc_mdl_sms_list_t* list;  // user list params
+  asc_entity_cb_t cb;        // user cb of the listing
+  void* meta;                // user meta of the listing
+  uint8_t body;              // state of the message text: 0 - none, 1 - expected, 2 - is read
+} asc_mdl_sms_list_data_t;
+
 /*******************************************************************************
  * Local variable definitions ('static')
  ******************************************************************************/
 /*******************************************************************************
  * Function implementation - global ('extern') and local ('static')
  ******************************************************************************/
+/**
+ * @brief Enqueue group which isn't preempted between its cmds: its first cmds
+ *        set a mode or check a state the next ones rely on
+ */
+static asc_entity_handle_t asc_mdl_sms_enqueue_nopreempt(asc_context_t* const ctx, const asc_item_t* const item, const uint8_t item_amount, const asc_entity_cb_t cb, const uint16_t data_size, void* const meta, const void* const prefill)
+{
+  const bool prev = asc_entity_nopreempt_set(ctx, true);
+  const asc_entity_handle_t res = asc_entity_enqueue_prefill(ctx, item, item_amount, cb, data_size, meta, prefill);
+  if(asc_get_init(ctx).init) asc_entity_nopreempt_set(ctx, prev); //enqueue deinits context on error
+  return res;
+}
+
 /*******************************************************************************
  ** @brief  Function to set sms format
  ** @param  ctx    core context
@@ -110,7 +134,7 @@ bool asc_mdl_sms_send_text(asc_context_t* const ctx, const asc_entity_cb_t cb, c
     ASC_ITEM(cmgs,                           ">",    ASC_PARCE_RAW, 1, 150, 0, 1, NULL, NULL, ASC_NO_ARG),
     ASC_ITEM(text,                          NULL,    ASC_PARCE_RAW, 2, 500, 0, 0, NULL, NULL, ASC_NO_ARG),
   };
-  if(!asc_entity_enqueue(ctx, items, sizeof(items)/sizeof(items[0]), cb, 0, meta)) return false;
+  if(!asc_mdl_sms_enqueue_nopreempt(ctx, items, sizeof(items)/sizeof(items[0]), cb, 0, meta, NULL)) return false;
   return true;
 }
 
@@ -135,7 +159,7 @@ bool asc_mdl_sms_read(asc_context_t* const ctx, const asc_entity_cb_t cb, const
     ASC_ITEM("AT+CMGF=1"ASC_CMD_CRLF, NULL, ASC_PARCE_SIMCOM, 1, 150, 0, 1, NULL, NULL, ASC_NO_ARG),
     ASC_ITEM(cmgr,                    NULL, ASC_PARCE_SIMCOM, 2, 150, 0, 0, asc_mdl_sms_cmgr_cb, NULL, ASC_NO_ARG),
   };
-  if(!asc_entity_enqueue(ctx, items, sizeof(items)/sizeof(items[0]), cb, sizeof(asc_mdl_sms_msg_t), meta)) return false;
+  if(!asc_mdl_sms_enqueue_nopreempt(ctx, items, sizeof(items)/sizeof(items[0]), cb, sizeof(asc_mdl_sms_msg_t), meta, NULL)) return false;
   return true;
 }
 
@@ -198,4 +222,101 @@ bool asc_mdl_sms_indicate(asc_context_t* const ctx, const asc_entity_cb_t cb, co
   return true;
 }
 
+/*******************************************************************************
+ ** @brief  Function to list all SMS with one AT+CMGL and bulk delete them with
+ **         AT+CMGD=1,<delflag>. Each message is streamed to the cb of 
+ **         @asc_mdl_sms_list_t, only one message is held at a time. The whole
+ **         listing should fit in the rx ring buffer.
+ ** @param  ctx    core context
+ ** @param  cb     cb when proc will be done. Can be NULL
+ ** @param  param  input param if function is required them. Here is @asc_mdl_sms_list_t
+ **                Should exist all the time while this function is executing
+ ** @param  meta   Meta data of function execution. Will be passe to the cb by the
+ **                end of execution. Can be NULL
+ ** @return true - proc started, false - smthg is wrong
+ ******************************************************************************/
+bool asc_mdl_sms_list(asc_context_t* const ctx, const asc_entity_cb_t cb, const void* const param, void* const meta)
+{
+  DBC_REQUIRE(701, param);
+  char cmgl[64] = {0};
+  char cmgd[32] = {0};
+  asc_mdl_sms_list_t* list = (asc_mdl_sms_list_t*)param;
+  DBC_REQUIRE(702, list->delflag <= 4);
+  snprintf(cmgl, sizeof(cmgl), "%sAT+CMGL=\"%s\"%s", ASC_CMD_SAVE, list->stat ? list->stat : "ALL", ASC_CMD_CRLF);
+  snprintf(cmgd, sizeof(cmgd), "%sAT+CMGD=1,%d%s", ASC_CMD_SAVE, list->delflag, ASC_CMD_CRLF);
+  list->cnt = 0;
+  asc_item_t items[] = //[REQ][PREFIX][PARCE_TYPE][RPT][WAIT][STEPERROR][STEPOK][CB][FORMAT][...##VA_ARGS]
+  { 
+    ASC_ITEM("AT+CMGF=1"ASC_CMD_CRLF, NULL,       ASC_PARCE_SIMCOM, 1, 150, 0, 1, NULL, NULL, ASC_NO_ARG),
+    ASC_ITEM(cmgl,                    NULL, ASC_PARCE_SIMCOM_LINES, 2, 500, 0, 1, asc_mdl_sms_cmgl_cb, NULL, ASC_NO_ARG),
+    ASC_ITEM(cmgd,                    NULL,       ASC_PARCE_SIMCOM, 2, 500, 0, 0, NULL, NULL, ASC_NO_ARG),
+  };
+  uint8_t items_cnt = sizeof(items)/sizeof(items[0]);
+  if(!list->delflag) //no bulk delete, listing is the last cmd
+  {
+    --items_cnt;
+    items[items_cnt - 1].meta.ok_step = 0;
+  }
+  asc_mdl_sms_list_data_t list_data = {.list = list, .cb = cb, .meta = meta};
+  if(!asc_mdl_sms_enqueue_nopreempt(ctx, items, items_cnt, asc_mdl_sms_list_cb, sizeof(asc_mdl_sms_list_data_t), NULL, &list_data)) return false;
+  return true;
+}
+
+/**
+ *  @brief pass the read message to the user, its text ends with the next header or with the list
+ */
+static void asc_mdl_sms_list_msg_done(asc_mdl_sms_list_data_t* const list_data)
+{
+  if(list_data->body != 2) return;
+  list_data->body = 0;
+  ++list_data->list->cnt;
+  if(list_data->list->cb) list_data->list->cb(&list_data->msg, list_data->list->user);
+}
 
+/**
+ *  @brief cmgl cb, called for each line of the list: header line +CMGL and the text lines after it.
+ *         Text with CRLF inside comes as several lines, they are joined back with CRLF
+ */
+static void asc_mdl_sms_cmgl_cb(ringslice_t rs_data, bool result, void* const data)
+{
+  asc_mdl_sms_list_data_t* list_data = (asc_mdl_sms_list_data_t*)data;
+  if(!list_data || !list_data->list) return;
+  if(!result) //list is not complete, the last message can be cut
+  {
+    list_data->body = 0;
+    return;
+  }
+  if(ringslice_strncmp(&rs_data, "+CMGL:", strlen("+CMGL:")) == 0)
+  {
+    int index = 0;
+    asc_mdl_sms_list_msg_done(list_data);
+    memset(&list_data->msg, 0, sizeof(asc_mdl_sms_msg_t));
+    list_data->body = ringslice_scanf(&rs_data, "+CMGL: %d,\"%*[^\"]\",\"%63[^\"]\"", &index, list_data->msg.num) == 2;
+    list_data->msg.index = (uint16_t)index;
+    list_data->msg.format = 1;
+    return;
+  }
+  if(!list_data->body) return;
+  char* text = list_data->msg.msg;
+  size_t pos = strlen(text);
+  if(list_data->body == 2 && pos + strlen(ASC_CMD_CRLF) < sizeof(list_data->msg.msg))
+  {
+    memcpy(&text[pos], ASC_CMD_CRLF, strlen(ASC_CMD_CRLF));
+    pos += strlen(ASC_CMD_CRLF);
+  }
+  list_data->body = 2;
+  for(ringslice_cnt_t i = 0; i < ringslice_len(&rs_data) && pos < sizeof(list_data->msg.msg) - 1; i++) text[pos++] = (char)rs_data.buf[(rs_data.first + i) % rs_data.buf_size];
+  text[pos] = '\0';
+}
+
+/**
+ *  @brief listing is done, pass the last message and call the user cb
+ */
+static void asc_mdl_sms_list_cb(const bool result, void* const meta, const void* const data)
+{
+  (void)meta;
+  asc_mdl_sms_list_data_t* list_data = (asc_mdl_sms_list_data_t*)data;
+  if(!list_data || !list_data->list) return;
+  asc_mdl_sms_list_msg_done(list_data);
+  if(list_data->cb) list_data->cb(result, list_data->meta, NULL);
+}
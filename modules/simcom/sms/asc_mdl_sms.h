@@ -35,6 +35,18 @@ typedef struct asc_mdl_sms_msg_t {
   uint8_t mode;
 } asc_mdl_sms_msg_t;
 
+typedef void (*asc_mdl_sms_list_cb_t)(const asc_mdl_sms_msg_t* const sms, //parsed message, valid only inside of cb
+                                      void* const user);                  //user ptr from @asc_mdl_sms_list_t
+
+typedef struct asc_mdl_sms_list_t {
+  const char* stat;          // CMGL stat: "REC UNREAD", "REC READ", "ALL"... NULL - "ALL"
+  uint8_t delflag;           // CMGD delflag after listing: 0 - no delete, 1 - read, 2 - read and sent,
+                             // 3 - read, sent and unsent, 4 - all
+  asc_mdl_sms_list_cb_t cb;  // cb for each listed message. Can be NULL
+  void* user;                // user ptr passed to cb
+  uint16_t cnt;              // amount of listed messages, filled while executing
+} asc_mdl_sms_list_t;
+
 /*******************************************************************************
  * Function implementation - global ('extern') and local ('static')
  ******************************************************************************/
@@ -109,4 +121,21 @@ bool asc_mdl_sms_delete(asc_context_t* const ctx, const asc_entity_cb_t cb, cons
  ******************************************************************************/
 bool asc_mdl_sms_indicate(asc_context_t* const ctx, const asc_entity_cb_t cb, const void* const param, void* const meta);
 
+/*******************************************************************************
+ ** @brief  Function to list all SMS with one AT+CMGL and bulk delete them with
+ **         AT+CMGD=1,<delflag>. Each message is streamed to the cb of 
+ **         @asc_mdl_sms_list_t, only one message is held at a time. Message is
+ **         passed when its text is complete: at the next header or at the end
+ **         of the listing, text of several lines is joined with CRLF. The whole
+ **         listing should fit in the rx ring buffer.
+ ** @param  ctx    core context
+ ** @param  cb     cb when proc will be done. Can be NULL
+ ** @param  param  input param if function is required them. Here is @asc_mdl_sms_list_t
+ **                Should exist all the time while this function is executing
+ ** @param  meta   Meta data of function execution. Will be passe to the cb by the
+ **                end of execution. Can be NULL
+ ** @return true - proc started, false - smthg is wrong
+ ******************************************************************************/
+bool asc_mdl_sms_list(asc_context_t* const ctx, const asc_entity_cb_t cb, const void* const param, void* const meta);
+
 #endif // __ASC_MDL_SMS_H
\ No newline at end of file
@@ -0,0 +1,441 @@
+/******************************************************************************
+ *                              _    ____   ____                              *
+ *                   ======    / \  / ___| / ___| ======       (c)03.10.2025  *
+ *                   ======   / _ \ \___ \| |     ======           v1.0.0     *
+ *                   ======  / ___ \ ___) | |___  ======                      *
+ *                   ====== /_/   \_\____/ \____| ======                      *
+ *                                                                            *
+ ******************************************************************************/
+/*******************************************************************************
+ * Include files
+ ******************************************************************************/
+#include "asc_core.h"
+#include "asc_mdl_sms_pdu.h"
+#include "dbc_assert.h"
+#include <stdio.h>
+
+/*******************************************************************************
+ * Local pre-processor symbols/macros ('#define')
+ ******************************************************************************/
+DBC_MODULE_NAME("ASC_MDL_SMS_PDU")
+
+#define ASC_MDL_SMS_PDU_TPDU_MAX  176   //SCA + SMS-SUBMIT header with max number + 140 UD
+#define ASC_MDL_SMS_PDU_UD_MAX    140   //Max UD length in octets
+#define ASC_MDL_SMS_PDU_GSM7_ESC  0x1B  //GSM 7 bit escape to extension table
+#define ASC_MDL_SMS_PDU_GSM7_EXT  0x80  //Flag of extension table code in @asc_mdl_sms_pdu_gsm7_enc
+
+/*******************************************************************************
+ * Global variable definitions (declared in header file with 'extern')
+ ******************************************************************************/
+/*******************************************************************************
+ * Local function prototypes ('static')
+ ******************************************************************************/
+static bool asc_mdl_sms_pdu_seg_enqueue(asc_mdl_sms_pdu_t* const pdu);
+static void asc_mdl_sms_pdu_cb(const bool result, void* const meta, const void* const data);
+static bool asc_mdl_sms_pdu_split(asc_mdl_sms_pdu_t* const pdu);
+static uint16_t asc_mdl_sms_pdu_char(const asc_mdl_sms_pdu_t* const pdu, const uint16_t off, uint16_t* const cost, uint16_t* const code);
+static uint16_t asc_mdl_sms_pdu_build(const asc_mdl_sms_pdu_t* const pdu, const uint8_t seg, uint8_t* const tpdu);
+static void asc_mdl_sms_pdu_septet_put(uint8_t* const ud, const uint16_t pos, const uint8_t septet);
+static uint8_t asc_mdl_sms_pdu_septet_get(const uint8_t* const ud, const uint16_t pos);
+static uint16_t asc_mdl_sms_pdu_utf8_put(uint8_t* const out, const uint16_t code);
+static int asc_mdl_sms_pdu_nibble(const char c);
+
+/*******************************************************************************
+ * Local types definitions
+ ******************************************************************************/
+/*******************************************************************************
+ * Local variable definitions ('static')
+ ******************************************************************************/
+/* ASCII -> GSM 7 bit default alphabet, ASC_MDL_SMS_PDU_GSM7_EXT - code in extension table, 0x3F - '?' */
+static const uint8_t asc_mdl_sms_pdu_gsm7_enc[128] =
+{
+  0x3F, 0x3F, 0x3F, 0x3F, 0x3F, 0x3F, 0x3F, 0x3F, 0x3F, 0x3F, 0x0A, 0x3F, 0x3F, 0x0D, 0x3F, 0x3F, //0x00
+  0x3F, 0x3F, 0x3F, 0x3F, 0x3F, 0x3F, 0x3F, 0x3F, 0x3F, 0x3F, 0x3F, 0x3F, 0x3F, 0x3F, 0x3F, 0x3F, //0x10
+  0x20, 0x21, 0x22, 0x23, 0x02, 0x25, 0x26, 0x27, 0x28, 0x29, 0x2A, 0x2B, 0x2C, 0x2D, 0x2E, 0x2F, //0x20
+  0x30, 0x31, 0x32, 0x33, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3A, 0x3B, 0x3C, 0x3D, 0x3E, 0x3F, //0x30
+  0x00, 0x41, 0x42, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49, 0x4A, 0x4B, 0x4C, 0x4D, 0x4E, 0x4F, //0x40
+  0x50, 0x51, 0x52, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5A, 0xBC, 0xAF, 0xBE, 0x94, 0x11, //0x50
+  0x3F, 0x61, 0x62, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69, 0x6A, 0x6B, 0x6C, 0x6D, 0x6E, 0x6F, //0x60
+  0x70, 0x71, 0x72, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7A, 0xA8, 0xC0, 0xA9, 0xBD, 0x3F, //0x70
+};
+
+/* GSM 7 bit default alphabet -> ASCII, not ASCII symbols are '?' */
+static const uint8_t asc_mdl_sms_pdu_gsm7_dec[128] =
+{
+  0x40, 0x3F, 0x24, 0x3F, 0x3F, 0x3F, 0x3F, 0x3F, 0x3F, 0x3F, 0x0A, 0x3F, 0x3F, 0x0D, 0x3F, 0x3F, //0x00
+  0x3F, 0x5F, 0x3F, 0x3F, 0x3F, 0x3F, 0x3F, 0x3F, 0x3F, 0x3F, 0x3F, 0x3F, 0x3F, 0x3F, 0x3F, 0x3F, //0x10
+  0x20, 0x21, 0x22, 0x23, 0x3F, 0x25, 0x26, 0x27, 0x28, 0x29, 0x2A, 0x2B, 0x2C, 0x2D, 0x2E, 0x2F, //0x20
+  0x30, 0x31, 0x32, 0x33, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3A, 0x3B, 0x3C, 0x3D, 0x3E, 0x3F, //0x30
+  0x3F, 0x41, 0x42, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49, 0x4A, 0x4B, 0x4C, 0x4D, 0x4E, 0x4F, //0x40
+  0x50, 0x51, 0x52, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5A, 0x3F, 0x3F, 0x3F, 0x3F, 0x3F, //0x50
+  0x3F, 0x61, 0x62, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69, 0x6A, 0x6B, 0x6C, 0x6D, 0x6E, 0x6F, //0x60
+  0x70, 0x71, 0x72, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7A, 0x3F, 0x3F, 0x3F, 0x3F, 0x3F, //0x70
+};
+
+static const char asc_mdl_sms_pdu_hex[] = "0123456789ABCDEF";
+
+/*******************************************************************************
+ * Function implementation - global ('extern') and local ('static')
+ ******************************************************************************/
+/*******************************************************************************
+ ** @brief  Function to send SMS in PDU mode. Long message is split into up to
+ **         @ASC_MDL_SMS_PDU_SEG_MAX concatenated segments, which are sent back
+ **         to back as AT+CMGS entities. Mode is switched only once before the
+ **         first segment, each next segment is built and queued when the
+ **         previous one is done.
+ ** @param  ctx    core context
+ ** @param  cb     cb when all segments will be sent or on the first error. Can be NULL
+ ** @param  param  input param if function is required them. Here is @asc_mdl_sms_pdu_t
+ **                Should exist all the time while this function is executing
+ ** @param  meta   Meta data of function execution. Will be passe to the cb by the
+ **                end of execution. Can be NULL
+ ** @return true - proc started, false - smthg is wrong
+ ******************************************************************************/
+bool asc_mdl_sms_pdu_send(asc_context_t* const ctx, const asc_entity_cb_t cb, const void* const param, void* const meta)
+{
+  DBC_REQUIRE(101, ctx);
+  DBC_REQUIRE(102, param);
+  asc_mdl_sms_pdu_t* pdu = (asc_mdl_sms_pdu_t*)param;
+  DBC_REQUIRE(103, pdu->data || !pdu->len);
+  const char* num = (pdu->num[0] == '+') ? &pdu->num[1] : pdu->num;
+  size_t digits = strlen(num);
+  if(!digits || digits > ASC_MDL_SMS_PDU_NUM_MAX) return false;
+  for(size_t i = 0; i < digits; i++) if(num[i] < '0' || num[i] > '9') return false;
+  if(!asc_mdl_sms_pdu_split(pdu)) return false;
+  pdu->seg_id = 0;
+  pdu->ctx = ctx;
+  pdu->cb = cb;
+  pdu->meta = meta;
+  return asc_mdl_sms_pdu_seg_enqueue(pdu);
+}
+
+/*******************************************************************************
+ ** @brief  Function to decode SMS-DELIVER PDU got from AT+CMGR/AT+CMGL in PDU mode
+ ** @param  hex   PDU in hex, starts with SCA
+ ** @param  len   length of hex string
+ ** @param  msg   decoded message
+ ** @return true - decoded, false - PDU is broken or not supported
+ ******************************************************************************/
+bool asc_mdl_sms_pdu_decode(const char* const hex, const uint16_t len, asc_mdl_sms_pdu_msg_t* const msg)
+{
+  DBC_REQUIRE(201, hex);
+  DBC_REQUIRE(202, msg);
+  uint8_t tpdu[ASC_MDL_SMS_PDU_TPDU_MAX + 1] = {0}; // +1 for septet reading at the end
+  uint16_t size = len / 2;
+  if((len % 2) || size > ASC_MDL_SMS_PDU_TPDU_MAX) return false;
+  for(uint16_t i = 0; i < size; i++)
+  {
+    int hi = asc_mdl_sms_pdu_nibble(hex[2 * i]);
+    int lo = asc_mdl_sms_pdu_nibble(hex[2 * i + 1]);
+    if(hi < 0 || lo < 0) return false;
+    tpdu[i] = (uint8_t)((hi << 4) | lo);
+  }
+  memset(msg, 0, sizeof(asc_mdl_sms_pdu_msg_t));
+  uint16_t n = 1 + tpdu[0];                              // skip SCA
+  if(n + 3 > size) return false;
+  uint8_t fo = tpdu[n++];
+  if(fo & 0x03) return false;                            // only SMS-DELIVER
+  uint8_t oa_digits = tpdu[n++];
+  uint8_t oa_toa = tpdu[n++];
+  uint16_t oa_size = (oa_digits + 1) / 2;
+  if(oa_digits > ASC_MDL_SMS_PDU_NUM_MAX || n + oa_size + 10 > size) return false;
+  if((oa_toa & 0x70) == 0x50)                            // alphanumeric sender in GSM 7 bit
+  {
+    for(uint16_t i = 0; i < oa_digits * 4 / 7 && i < ASC_MDL_SMS_PDU_NUM_MAX; i++)
+    {
+      msg->num[i] = (char)asc_mdl_sms_pdu_gsm7_dec[asc_mdl_sms_pdu_septet_get(&tpdu[n], i * 7)];
+    }
+  }
+  else
+  {
+    uint8_t pos = 0;
+    if((oa_toa & 0x70) == 0x10) msg->num[pos++] = '+';
+    for(uint8_t i = 0; i < oa_digits; i++) msg->num[pos++] = (char)('0' + ((tpdu[n + i / 2] >> ((i % 2) * 4)) & 0x0F));
+  }
+  n += oa_size;
+  n++;                                                   // PID
+  uint8_t dcs = tpdu[n++];
+  msg->dcs = ((dcs & 0xC0) == 0x00) ? (dcs & 0x0C) : ((dcs & 0xF0) == 0xF0) ? (dcs & 0x04) : ASC_MDL_SMS_PDU_GSM7;
+  if(msg->dcs == 0x0C) return false;                     // reserved coding
+  n += 7;                                                // SCTS
+  uint8_t udl = tpdu[n++];
+  uint8_t* ud = &tpdu[n];
+  uint16_t ud_size = size - n;
+  uint16_t udh_size = 0;
+  if(fo & 0x40)                                          // UDH, find concatenation IE
+  {
+    udh_size = ud[0] + 1;
+    if(udh_size > ud_size) return false;
+    for(uint16_t i = 1; i + 1 < udh_size; i += 2 + ud[i + 1])
+    {
+      if(ud[i] == 0x00 && ud[i + 1] == 3 && i + 4 < udh_size)
+      {
+        msg->ref = ud[i + 2];
+        msg->total = ud[i + 3];
+        msg->seq = ud[i + 4];
+      }
+      else if(ud[i] == 0x08 && ud[i + 1] == 4 && i + 5 < udh_size)
+      {
+        msg->ref = (uint16_t)((ud[i + 2] << 8) | ud[i + 3]);
+        msg->total = ud[i + 4];
+        msg->seq = ud[i + 5];
+      }
+    }
+  }
+  if(msg->dcs == ASC_MDL_SMS_PDU_GSM7)
+  {
+    if((udl * 7 + 7) / 8 > ud_size) return false;
+    bool esc = false;
+    for(uint16_t i = (udh_size * 8 + 6) / 7; i < udl && msg->len < sizeof(msg->data) - 1; i++)
+    {
+      uint8_t septet = asc_mdl_sms_pdu_septet_get(ud, i * 7);
+      if(septet == ASC_MDL_SMS_PDU_GSM7_ESC && !esc) { esc = true; continue; }
+      uint8_t ascii = asc_mdl_sms_pdu_gsm7_dec[septet];
+      if(esc)
+      {
+        ascii = '?';
+        for(uint8_t c = 0; c < sizeof(asc_mdl_sms_pdu_gsm7_enc); c++)
+        {
+          if(asc_mdl_sms_pdu_gsm7_enc[c] == (ASC_MDL_SMS_PDU_GSM7_EXT | septet)) { ascii = c; break; }
+        }
+        esc = false;
+      }
+      msg->data[msg->len++] = ascii;
+    }
+  }
+  else
+  {
+    if(udl > ASC_MDL_SMS_PDU_UD_MAX || udl > ud_size || udh_size > udl) return false;
+    for(uint16_t i = udh_size; i < udl; i += (msg->dcs == ASC_MDL_SMS_PDU_UCS2) ? 2 : 1)
+    {
+      if(msg->dcs == ASC_MDL_SMS_PDU_8BIT)
+      {
+        if(msg->len >= sizeof(msg->data) - 1) break;
+        msg->data[msg->len++] = ud[i];
+      }
+      else if(i + 1 < udl)
+      {
+        uint8_t utf8[3];
+        uint16_t bytes = asc_mdl_sms_pdu_utf8_put(utf8, (uint16_t)((ud[i] << 8) | ud[i + 1]));
+        if(msg->len + bytes > sizeof(msg->data) - 1) break;
+        memcpy(&msg->data[msg->len], utf8, bytes);
+        msg->len += bytes;
+      }
+    }
+  }
+  return true;
+}
+
+/**
+ *  @brief Build current segment and queue it. Each segment switches the modem to PDU mode,
+ *         other groups can switch it back to text mode between segments
+ */
+static bool asc_mdl_sms_pdu_seg_enqueue(asc_mdl_sms_pdu_t* const pdu)
+{
+  DBC_REQUIRE(301, pdu);
+  uint8_t tpdu[ASC_MDL_SMS_PDU_TPDU_MAX] = {0};
+  char cmgs[32] = {0};
+  char hex[sizeof(ASC_CMD_SAVE) + 2 * ASC_MDL_SMS_PDU_TPDU_MAX + sizeof(ASC_CMD_CTRL_Z)] = ASC_CMD_SAVE;
+  uint16_t size = asc_mdl_sms_pdu_build(pdu, pdu->seg_id, tpdu);
+  snprintf(cmgs, sizeof(cmgs), "%sAT+CMGS=%d%s", ASC_CMD_SAVE, size - 1, ASC_CMD_CRLF); // length without SCA
+  char* pos = &hex[strlen(ASC_CMD_SAVE)];
+  for(uint16_t i = 0; i < size; i++)
+  {
+    *pos++ = asc_mdl_sms_pdu_hex[tpdu[i] >> 4];
+    *pos++ = asc_mdl_sms_pdu_hex[tpdu[i] & 0x0F];
+  }
+  memcpy(pos, ASC_CMD_CTRL_Z, sizeof(ASC_CMD_CTRL_Z));
+  asc_item_t items[] = //[REQ][PREFIX][PARCE_TYPE][RPT][WAIT][STEPERROR][STEPOK][CB][FORMAT][...##VA_ARGS]
+  {
+    ASC_ITEM("AT+CMGF=0"ASC_CMD_CRLF,     NULL, ASC_PARCE_SIMCOM, 1, 150, 0, 1, NULL, NULL, ASC_NO_ARG),
+    ASC_ITEM(cmgs,                         ">",    ASC_PARCE_RAW, 1, 150, 0, 1, NULL, NULL, ASC_NO_ARG),
+    ASC_ITEM(hex,                     "+CMGS:",    ASC_PARCE_RAW, 1, 600, 0, 0, NULL, NULL, ASC_NO_ARG),
+  };
+  const bool prev = asc_entity_nopreempt_set(pdu->ctx, true); //length of CMGS is read as a number only in PDU mode
+  const bool res = asc_entity_enqueue(pdu->ctx, items, sizeof(items)/sizeof(items[0]), asc_mdl_sms_pdu_cb, 0, pdu);
+  if(asc_get_init(pdu->ctx).init) asc_entity_nopreempt_set(pdu->ctx, prev); //enqueue deinits context on error
+  return res;
+}
+
+/**
+ *  @brief Segment is done, queue the next one or finish the message
+ */
+static void asc_mdl_sms_pdu_cb(const bool result, void* const meta, const void* const data)
+{
+  (void)data;
+  asc_mdl_sms_pdu_t* pdu = (asc_mdl_sms_pdu_t*)meta;
+  bool res = result;
+  if(res && ++pdu->seg_id < pdu->seg_cnt)
+  {
+    if(asc_mdl_sms_pdu_seg_enqueue(pdu)) return;
+    res = false;
+  }
+  if(pdu->cb) pdu->cb(res, pdu->meta, pdu);
+}
+
+/**
+ *  @brief Split data into segments, fill offsets. false if more than ASC_MDL_SMS_PDU_SEG_MAX segments
+ */
+static bool asc_mdl_sms_pdu_split(asc_mdl_sms_pdu_t* const pdu)
+{
+  DBC_REQUIRE(401, pdu);
+  const uint16_t single = (pdu->dcs == ASC_MDL_SMS_PDU_GSM7) ? 160 : 140; // septets / octets
+  const uint16_t multi  = (pdu->dcs == ASC_MDL_SMS_PDU_GSM7) ? 153 : 134; // minus 6 octets of UDH
+  uint16_t total = 0;
+  uint16_t cost = 0;
+  uint16_t code = 0;
+  for(uint16_t off = 0; off < pdu->len; off += asc_mdl_sms_pdu_char(pdu, off, &cost, &code)) total += cost;
+  memset(pdu->seg_off, 0, sizeof(pdu->seg_off));
+  pdu->seg_cnt = 1;
+  if(total > single)
+  {
+    uint16_t used = 0;
+    for(uint16_t off = 0; off < pdu->len; )
+    {
+      uint16_t size = asc_mdl_sms_pdu_char(pdu, off, &cost, &code);
+      if(used + cost > multi)
+      {
+        if(pdu->seg_cnt >= ASC_MDL_SMS_PDU_SEG_MAX) return false;
+        pdu->seg_off[pdu->seg_cnt++] = off;
+        used = 0;
+      }
+      used += cost;
+      off += size;
+    }
+  }
+  pdu->seg_off[pdu->seg_cnt] = pdu->len;
+  return true;
+}
+
+/**
+ *  @brief Get one char of data: returns its size in data, cost in UD units (septets/octets) and code to put
+ */
+static uint16_t asc_mdl_sms_pdu_char(const asc_mdl_sms_pdu_t* const pdu, const uint16_t off, uint16_t* const cost, uint16_t* const code)
+{
+  const uint8_t* data = &pdu->data[off];
+  const uint16_t left = pdu->len - off;
+  switch(pdu->dcs)
+  {
+    case ASC_MDL_SMS_PDU_GSM7:
+         *code = asc_mdl_sms_pdu_gsm7_enc[data[0] & 0x7F];
+         if(data[0] & 0x80) *code = '?';
+         *cost = (*code & ASC_MDL_SMS_PDU_GSM7_EXT) ? 2 : 1;
+         return 1;
+    case ASC_MDL_SMS_PDU_UCS2:
+         *cost = 2;
+         if(data[0] < 0x80)                                   { *code = data[0]; return 1; }
+         if((data[0] & 0xE0) == 0xC0 && left >= 2)            { *code = (uint16_t)(((data[0] & 0x1F) << 6) | (data[1] & 0x3F)); return 2; }
+         if((data[0] & 0xF0) == 0xE0 && left >= 3)            { *code = (uint16_t)(((data[0] & 0x0F) << 12) | ((data[1] & 0x3F) << 6) | (data[2] & 0x3F)); return 3; }
+         *code = '?';                                         // out of BMP or broken sequence
+         return ((data[0] & 0xF8) == 0xF0 && left >= 4) ? 4 : 1;
+    default:
+         *cost = 1;
+         *code = data[0];
+         return 1;
+  }
+}
+
+/**
+ *  @brief Build SMS-SUBMIT TPDU of segment with SCA from SIM, returns size of TPDU with SCA
+ */
+static uint16_t asc_mdl_sms_pdu_build(const asc_mdl_sms_pdu_t* const pdu, const uint8_t seg, uint8_t* const tpdu)
+{
+  DBC_REQUIRE(501, pdu);
+  DBC_REQUIRE(502, tpdu);
+  DBC_REQUIRE(503, seg < pdu->seg_cnt);
+  const bool udh = pdu->seg_cnt > 1;
+  const char* num = (pdu->num[0] == '+') ? &pdu->num[1] : pdu->num;
+  const uint8_t digits = (uint8_t)strlen(num);
+  uint16_t n = 0;
+  tpdu[n++] = 0x00;                                      // SCA from SIM
+  tpdu[n++] = udh ? 0x41 : 0x01;                         // SMS-SUBMIT, UDHI
+  tpdu[n++] = 0x00;                                      // MR
+  tpdu[n++] = digits;
+  tpdu[n++] = (pdu->num[0] == '+') ? 0x91 : 0x81;        // international / unknown
+  for(uint8_t i = 0; i < digits; i += 2) tpdu[n++] = (uint8_t)((num[i] - '0') | (((i + 1 < digits) ? (num[i + 1] - '0') : 0x0F) << 4));
+  tpdu[n++] = 0x00;                                      // PID
+  tpdu[n++] = pdu->dcs;
+  uint16_t udl_pos = n++;
+  uint8_t* ud = &tpdu[n];
+  uint16_t ud_len = 0;
+  if(udh)                                                // concatenation IE with 8 bit reference
+  {
+    const uint8_t header[] = {0x05, 0x00, 0x03, pdu->ref, pdu->seg_cnt, (uint8_t)(seg + 1)};
+    memcpy(ud, header, sizeof(header));
+    ud_len = sizeof(header);
+  }
+  uint16_t cost = 0;
+  uint16_t code = 0;
+  if(pdu->dcs == ASC_MDL_SMS_PDU_GSM7)
+  {
+    uint16_t septets = (ud_len * 8 + 6) / 7;             // UDH with fill bits
+    for(uint16_t off = pdu->seg_off[seg]; off < pdu->seg_off[seg + 1]; off++)
+    {
+      asc_mdl_sms_pdu_char(pdu, off, &cost, &code);
+      if(code & ASC_MDL_SMS_PDU_GSM7_EXT) asc_mdl_sms_pdu_septet_put(ud, septets++ * 7, ASC_MDL_SMS_PDU_GSM7_ESC);
+      asc_mdl_sms_pdu_septet_put(ud, septets++ * 7, code & 0x7F);
+    }
+    tpdu[udl_pos] = (uint8_t)septets;
+    return n + (septets * 7 + 7) / 8;
+  }
+  for(uint16_t off = pdu->seg_off[seg]; off < pdu->seg_off[seg + 1]; )
+  {
+    off += asc_mdl_sms_pdu_char(pdu, off, &cost, &code);
+    if(pdu->dcs == ASC_MDL_SMS_PDU_UCS2) ud[ud_len++] = (uint8_t)(code >> 8);
+    ud[ud_len++] = (uint8_t)code;
+  }
+  tpdu[udl_pos] = (uint8_t)ud_len;
+  return n + ud_len;
+}
+
+/**
+ *  @brief Put septet to the bit position of packed UD
+ */
+static void asc_mdl_sms_pdu_septet_put(uint8_t* const ud, const uint16_t pos, const uint8_t septet)
+{
+  ud[pos / 8] |= (uint8_t)(septet << (pos % 8));
+  if(pos % 8 > 1) ud[pos / 8 + 1] |= (uint8_t)(septet >> (8 - pos % 8));
+}
+
+/**
+ *  @brief Get septet from the bit position of packed UD
+ */
+static uint8_t asc_mdl_sms_pdu_septet_get(const uint8_t* const ud, const uint16_t pos)
+{
+  uint16_t word = ud[pos / 8];
+  if(pos % 8 > 1) word |= (uint16_t)(ud[pos / 8 + 1] << 8);
+  return (uint8_t)((word >> (pos % 8)) & 0x7F);
+}
+
+/**
+ *  @brief Put UCS2 code as UTF-8, returns amount of bytes
+ */
+static uint16_t asc_mdl_sms_pdu_utf8_put(uint8_t* const out, const uint16_t code)
+{
+  if(code < 0x80)
+  {
+    out[0] = (uint8_t)code;
+    return 1;
+  }
+  if(code < 0x800)
+  {
+    out[0] = (uint8_t)(0xC0 | (code >> 6));
+    out[1] = (uint8_t)(0x80 | (code & 0x3F));
+    return 2;
+  }
+  out[0] = (uint8_t)(0xE0 | (code >> 12));
+  out[1] = (uint8_t)(0x80 | ((code >> 6) & 0x3F));
+  out[2] = (uint8_t)(0x80 | (code & 0x3F));
+  return 3;
+}
+
+/**
+ *  @brief Hex char to nibble, -1 if not hex
+ */
+static int asc_mdl_sms_pdu_nibble(const char c)
+{
+  if(c >= '0' && c <= '9') return c - '0';
+  if(c >= 'A' && c <= 'F') return c - 'A' + 10;
+  if(c >= 'a' && c <= 'f') return c - 'a' + 10;
+  return -1;
+}
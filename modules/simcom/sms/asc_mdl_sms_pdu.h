@@ -0,0 +1,95 @@
+/******************************************************************************
+ *                              _    ____   ____                              *
+ *                   ======    / \  / ___| / ___| ======       (c)03.10.2025  *
+ *                   ======   / _ \ \___ \| |     ======           v1.0.0     *
+ *                   ======  / ___ \ ___) | |___  ======                      *
+ *                   ====== /_/   \_\____/ \____| ======                      *
+ *                                                                            *
+ ******************************************************************************/
+/*******************************************************************************
+ * Include files
+ ******************************************************************************/
+#ifndef __ASC_MDL_SMS_PDU_H
+#define __ASC_MDL_SMS_PDU_H
+
+/*******************************************************************************
+ * Local pre-processor symbols/macros ('#define')
+ ******************************************************************************/
+#define ASC_MDL_SMS_PDU_SEG_MAX   8    //Max amount of segments of one long message
+#define ASC_MDL_SMS_PDU_NUM_MAX   20   //Max amount of digits in the number
+#define ASC_MDL_SMS_PDU_DATA_MAX  211  //Max size of decoded data of one segment (70 UCS2 chars in UTF-8 + 0)
+
+/*******************************************************************************
+ * Global variable definitions (declared in header file with 'extern')
+ ******************************************************************************/
+/*******************************************************************************
+ * Local function prototypes ('static')
+ ******************************************************************************/
+/*******************************************************************************
+ * Local types definitions
+ ******************************************************************************/
+typedef uint8_t asc_mdl_sms_pdu_dcs_t;
+enum
+{
+  ASC_MDL_SMS_PDU_GSM7 = 0x00, //ASCII text, packed to GSM 7 bit default alphabet
+  ASC_MDL_SMS_PDU_8BIT = 0x04, //binary data
+  ASC_MDL_SMS_PDU_UCS2 = 0x08, //UTF-8 text (BMP only), converted to UCS2
+};
+
+typedef struct asc_mdl_sms_pdu_t {
+  char num[ASC_MDL_SMS_PDU_NUM_MAX + 2];         // destination number, starts with '+' for international
+  const uint8_t* data;                           // message data, see @asc_mdl_sms_pdu_dcs_t
+  uint16_t len;                                  // data length in bytes
+  asc_mdl_sms_pdu_dcs_t dcs;                     // data coding
+  uint8_t ref;                                   // concatenation reference, change it for each long message
+  //Filled while executing
+  uint16_t seg_off[ASC_MDL_SMS_PDU_SEG_MAX + 1]; // data offsets of segments
+  uint8_t seg_cnt;                               // amount of segments
+  uint8_t seg_id;                                // current segment
+  asc_context_t* ctx;                            // core context
+  asc_entity_cb_t cb;                            // cb for the whole message
+  void* meta;                                    // meta for the whole message
+} asc_mdl_sms_pdu_t;
+
+typedef struct asc_mdl_sms_pdu_msg_t {
+  char num[ASC_MDL_SMS_PDU_NUM_MAX + 2];         // originating number
+  uint8_t data[ASC_MDL_SMS_PDU_DATA_MAX];        // decoded data: ASCII, binary or UTF-8, zero terminated for text
+  uint16_t len;                                  // decoded data length in bytes
+  asc_mdl_sms_pdu_dcs_t dcs;                     // data coding
+  uint16_t ref;                                  // concatenation reference
+  uint8_t total;                                 // amount of segments, 0 - not concatenated
+  uint8_t seq;                                   // number of this segment, starts from 1
+} asc_mdl_sms_pdu_msg_t;
+
+/*******************************************************************************
+ * Local variable definitions ('static')
+ ******************************************************************************/
+/*******************************************************************************
+ * Function implementation - global ('extern') and local ('static')
+ ******************************************************************************/
+/*******************************************************************************
+ ** @brief  Function to send SMS in PDU mode. Long message is split into up to
+ **         @ASC_MDL_SMS_PDU_SEG_MAX concatenated segments, which are sent back
+ **         to back as AT+CMGS entities. Mode is switched only once before the
+ **         first segment, each next segment is built and queued when the
+ **         previous one is done.
+ ** @param  ctx    core context
+ ** @param  cb     cb when all segments will be sent or on the first error. Can be NULL
+ ** @param  param  input param if function is required them. Here is @asc_mdl_sms_pdu_t
+ **                Should exist all the time while this function is executing
+ ** @param  meta   Meta data of function execution. Will be passe to the cb by the
+ **                end of execution. Can be NULL
+ ** @return true - proc started, false - smthg is wrong
+ ******************************************************************************/
+bool asc_mdl_sms_pdu_send(asc_context_t* const ctx, const asc_entity_cb_t cb, const void* const param, void* const meta);
+
+/*******************************************************************************
+ ** @brief  Function to decode SMS-DELIVER PDU got from AT+CMGR/AT+CMGL in PDU mode
+ ** @param  hex   PDU in hex, starts with SCA
+ ** @param  len   length of hex string
+ ** @param  msg   decoded message
+ ** @return true - decoded, false - PDU is broken or not supported
+ ******************************************************************************/
+bool asc_mdl_sms_pdu_decode(const char* const hex, const uint16_t len, asc_mdl_sms_pdu_msg_t* const msg);
+
+#endif // __ASC_MDL_SMS_PDU_H
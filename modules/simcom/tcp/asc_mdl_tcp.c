@@ -25,6 +25,7 @@ DBC_MODULE_NAME("ASC_MDL_TCP")
 /*******************************************************************************
  * Local function prototypes ('static')
  ******************************************************************************/
+static asc_entity_handle_t asc_mdl_tcp_enqueue_nopreempt(asc_context_t* const ctx, const asc_item_t* const item, const uint8_t item_amount, const asc_entity_cb_t cb, const uint16_t data_size, void* const meta);
 /*******************************************************************************
  * Local types definitions
  ******************************************************************************/
@@ -34,6 +35,18 @@ DBC_MODULE_NAME("ASC_MDL_TCP")
 /*******************************************************************************
  * Function implementation - global ('extern') and local ('static')
  ******************************************************************************/
+/**
+ * @brief Enqueue group which isn't preempted between its cmds: its first cmds
+ *        set a mode or check a state the next ones rely on
+ */
+static asc_entity_handle_t asc_mdl_tcp_enqueue_nopreempt(asc_context_t* const ctx, const asc_item_t* const item, const uint8_t item_amount, const asc_entity_cb_t cb, const uint16_t data_size, void* const meta)
+{
+  const bool prev = asc_entity_nopreempt_set(ctx, true);
+  const asc_entity_handle_t res = asc_entity_enqueue(ctx, item, item_amount, cb, data_size, meta);
+  if(asc_get_init(ctx).init) asc_entity_nopreempt_set(ctx, prev); //enqueue deinits context on error
+  return res;
+}
+
 /*******************************************************************************
  ** @brief  Function init GPRS
  ** @param  ctx    core context
@@ -88,7 +101,7 @@ bool asc_mdl_gprs_socket_config(asc_context_t* const ctx, const asc_entity_cb_t
     ASC_ITEM("AT+CIPSHOWTP?"ASC_CMD_CRLF,    "+CIPSHOWTP: 1", ASC_PARCE_SIMCOM,  1, 100, 1, 0, NULL, NULL, ASC_NO_ARG),
     ASC_ITEM("AT+CIPSHOWTP=1"ASC_CMD_CRLF,              NULL, ASC_PARCE_SIMCOM, 10, 100, 0, 0, NULL, NULL, ASC_NO_ARG),
   };
-  if(!asc_entity_enqueue(ctx, items, sizeof(items)/sizeof(items[0]), cb, 0, meta)) return false;
+  if(!asc_mdl_tcp_enqueue_nopreempt(ctx, items, sizeof(items)/sizeof(items[0]), cb, 0, meta)) return false;
   return true;
 }
 
@@ -117,7 +130,7 @@ bool asc_mdl_gprs_socket_connect(asc_context_t* const ctx, const asc_entity_cb_t
     ASC_ITEM("AT+CIPQSEND?"ASC_CMD_CRLF,                       "+CIPQSEND: 0", ASC_PARCE_SIMCOM,  1, 100,  1, 0, NULL, NULL, ASC_NO_ARG),
     ASC_ITEM("AT+CIPQSEND=0"ASC_CMD_CRLF,                                NULL, ASC_PARCE_SIMCOM, 10, 100,  0, 0, NULL, NULL, ASC_NO_ARG),
   };
-  if(!asc_entity_enqueue(ctx, items, sizeof(items)/sizeof(items[0]), cb, 0, meta)) return false;
+  if(!asc_mdl_tcp_enqueue_nopreempt(ctx, items, sizeof(items)/sizeof(items[0]), cb, 0, meta)) return false;
   return true;
 }
 
@@ -153,7 +166,7 @@ bool asc_mdl_gprs_socket_send_recieve(asc_context_t* const ctx, const asc_entity
     ASC_ITEM(cipsend,                        "AT+CIPSEND=&>",     ASC_PARCE_RAW, 3, 500,  0, 1, NULL, NULL, ASC_NO_ARG),
     ASC_ITEM(datacmd,                              tcp->answ,     ASC_PARCE_RAW, 3, 500,  0, 1, NULL, NULL, ASC_NO_ARG),
   };
-  if(!asc_entity_enqueue(ctx, items, sizeof(items)/sizeof(items[0]), cb, 0, meta)) res = false;
+  if(!asc_mdl_tcp_enqueue_nopreempt(ctx, items, sizeof(items)/sizeof(items[0]), cb, 0, meta)) res = false;
   else res = true;
   asc_free(ctx, datacmd);
   return res;
@@ -198,3 +211,24 @@ bool asc_mdl_gprs_deinit(asc_context_t* const ctx, const asc_entity_cb_t cb, con
   if(!asc_entity_enqueue(ctx, items, sizeof(items)/sizeof(items[0]), cb, 0, meta)) return false;
   return true;
 }
+
+/*******************************************************************************
+ ** @brief  Function to probe socket session by one request, e.g. after MCU reset
+ **         while modem stayed powered and connected
+ ** @param  ctx    core context
+ ** @param  cb     cb when proc will be done. Can be NULL
+ ** @param  param  input param if function is required them. Here is NULL
+ ** @param  meta   Meta data of function execution. Will be passe to the cb by the
+ **                end of execution. Can be NULL
+ ** @return true - proc started, false - smthg is wrong
+ ******************************************************************************/
+bool asc_mdl_gprs_socket_probe(asc_context_t* const ctx, const asc_entity_cb_t cb, const void* const param, void* const meta)
+{
+  (void)param;
+  asc_item_t items[] = //[REQ][PREFIX][PARCE_TYPE][RPT][WAIT][STEPERROR][STEPOK][CB][FORMAT][...##VA_ARGS]
+  {
+    ASC_ITEM("AT+CIPSTATUS"ASC_CMD_CRLF, "STATE: CONNECT OK", ASC_PARCE_SIMCOM, 2, 100, 0, 0, NULL, NULL, ASC_NO_ARG),
+  };
+  if(!asc_entity_enqueue(ctx, items, sizeof(items)/sizeof(items[0]), cb, 0, meta)) return false;
+  return true;
+}
@@ -113,4 +113,16 @@ bool asc_mdl_gprs_socket_disconnect(asc_context_t* const ctx, const asc_entity_c
  ******************************************************************************/
 bool asc_mdl_gprs_deinit(asc_context_t* const ctx, const asc_entity_cb_t cb, const void* const param, void* const meta);
 
+/*******************************************************************************
+ ** @brief  Function to probe socket session by one request, e.g. after MCU reset
+ **         while modem stayed powered and connected
+ ** @param  ctx    core context
+ ** @param  cb     cb when proc will be done. Can be NULL
+ ** @param  param  input param if function is required them. Here is NULL
+ ** @param  meta   Meta data of function execution. Will be passe to the cb by the
+ **                end of execution. Can be NULL
+ ** @return true - proc started, false - smthg is wrong
+ ******************************************************************************/
+bool asc_mdl_gprs_socket_probe(asc_context_t* const ctx, const asc_entity_cb_t cb, const void* const param, void* const meta);
+
 #endif //__ASC_MDL_TCP_H
\ No newline at end of file
@@ -146,7 +146,7 @@ void asc_tcp_stream_ctx_cleanup(asc_context_t* const asc_ctx, asc_tcp_stream_ctx
  ******************************************************************************/
 bool asc_mld_tcp_server_stream_data_handler(asc_context_t* const asc_ctx, asc_tcp_stream_ctx_t* stream_ctx, uint8_t* data, uint16_t len, asc_stream_data_cb cb)
 {
-  ASC_CRITICAL_ENTER
+  ASC_CRITICAL_ENTER(asc_ctx)
   DBC_REQUIRE(201, asc_get_init(asc_ctx).init);
   DBC_REQUIRE(202, stream_ctx != NULL);
   DBC_REQUIRE(203, stream_ctx->buffer != NULL);
@@ -158,7 +158,7 @@ bool asc_mld_tcp_server_stream_data_handler(asc_context_t* const asc_ctx, asc_tc
     stream_ctx->expected_len = -1;
     stream_ctx->header_len = 0;
     stream_ctx->packet_in_progress = false;
-    ASC_CRITICAL_EXIT
+    ASC_CRITICAL_EXIT(asc_ctx)
     return false;
   }
   // Append new data to buffer
@@ -217,7 +217,7 @@ bool asc_mld_tcp_server_stream_data_handler(asc_context_t* const asc_ctx, asc_tc
     }
   }
   
-  ASC_CRITICAL_EXIT
+  ASC_CRITICAL_EXIT(asc_ctx)
   return true;
 }
 
@@ -0,0 +1,148 @@
+/******************************************************************************
+ *                              _    ____   ____                              *
+ *                   ======    / \  / ___| / ___| ======       (c)03.10.2025  *
+ *                   ======   / _ \ \___ \| |     ======           v1.0.0     *
+ *                   ======  / ___ \ ___) | |___  ======                      *
+ *                   ====== /_/   \_\____/ \____| ======                      *
+ *                                                                            *
+ ******************************************************************************/
+/*******************************************************************************
+ * Include files
+ ******************************************************************************/
+#include "asc_crit_stats.h"
+#include "asc_port.h"
+#include "dbc_assert.h"
+#include <stdio.h>
+#include <string.h>
+
+/*******************************************************************************
+ * Local pre-processor symbols/macros ('#define')
+ ******************************************************************************/
+DBC_MODULE_NAME("ASC_CRIT_STATS")
+
+#ifndef __STDC_NO_ATOMICS__ //contexts of different threads exit their sections in parallel
+  #include <stdatomic.h>
+  static atomic_flag asc_crit_stats_guard = ATOMIC_FLAG_INIT;
+  #define ASC_CRIT_STATS_LOCK()    while(atomic_flag_test_and_set_explicit(&asc_crit_stats_guard, memory_order_acquire)) {}
+  #define ASC_CRIT_STATS_UNLOCK()  atomic_flag_clear_explicit(&asc_crit_stats_guard, memory_order_release);
+#else //single core: add runs in critical section of context, dump and reset mask interrupts
+  #define ASC_CRIT_STATS_LOCK()
+  #define ASC_CRIT_STATS_UNLOCK()
+#endif
+
+/*******************************************************************************
+ * Local variable definitions ('static')
+ ******************************************************************************/
+static asc_crit_stat_t asc_crit_stats[ASC_CRIT_STATS_SITES] = {0};
+static uint16_t asc_crit_stats_cnt = 0;
+
+/*******************************************************************************
+ * Function implementation - global ('extern') and local ('static')
+ ******************************************************************************/
+/**
+ * @brief Histogram bin of hold time
+ */
+static uint8_t asc_crit_stats_bin(uint32_t cycles)
+{
+  cycles >>= ASC_CRIT_STATS_SHIFT;
+  uint8_t bin = 0;
+  while(cycles && bin < ASC_CRIT_STATS_BINS - 1)
+  {
+    cycles >>= 1;
+    bin++;
+  }
+  return bin;
+}
+
+/*******************************************************************************
+ ** @brief  Account hold time of critical section. Called by port on exit of the
+ **         outermost section when @ASC_CRIT_STATS is 1
+ ** @param  site   call site
+ ** @param  cycles hold time, units of @asc_crit_cycles
+ ** @return none
+ ******************************************************************************/
+void asc_crit_stats_add(const char* const site, const uint32_t cycles)
+{
+  if(!site) return;
+  ASC_CRIT_STATS_LOCK()
+  uint16_t id = 0;
+  while(id < asc_crit_stats_cnt && asc_crit_stats[id].site != site) id++; //site is a string literal, its address is the key
+  if(id == asc_crit_stats_cnt && id < ASC_CRIT_STATS_SITES) asc_crit_stats[asc_crit_stats_cnt++].site = site;
+  if(id < asc_crit_stats_cnt)
+  {
+    asc_crit_stat_t* const stat = &asc_crit_stats[id];
+    stat->cnt++;
+    if(cycles > stat->max) stat->max = cycles;
+    stat->hist[asc_crit_stats_bin(cycles)]++;
+  }
+  ASC_CRIT_STATS_UNLOCK()
+}
+
+/*******************************************************************************
+ ** @brief  Dump stats of all call sites
+ ** @param  cb   cb for each call site, gets a copy of its stats
+ ** @param  arg  arg for cb. Can be NULL
+ ** @return amount of call sites
+ ******************************************************************************/
+uint16_t asc_crit_stats_dump(const asc_crit_stats_cb_t cb, void* const arg)
+{
+  DBC_REQUIRE(100, cb);
+  uint16_t id = 0;
+  for(;; id++)
+  {
+    const uint32_t irq = asc_port_irq_mask(); //ISR exiting its section would spin on the guard held here
+    ASC_CRIT_STATS_LOCK()
+    const bool valid = id < asc_crit_stats_cnt;
+    asc_crit_stat_t stat;
+    if(valid) stat = asc_crit_stats[id];
+    ASC_CRIT_STATS_UNLOCK()
+    asc_port_irq_restore(irq);
+    if(!valid) break;
+    cb(&stat, arg); //cb can take locks and add stats
+  }
+  return id;
+}
+
+/*******************************************************************************
+ ** @brief  Clear stats of all call sites
+ ** @param  none
+ ** @return none
+ ******************************************************************************/
+void asc_crit_stats_reset(void)
+{
+  const uint32_t irq = asc_port_irq_mask();
+  ASC_CRIT_STATS_LOCK()
+  memset(asc_crit_stats, 0, sizeof(asc_crit_stats));
+  asc_crit_stats_cnt = 0;
+  ASC_CRIT_STATS_UNLOCK()
+  asc_port_irq_restore(irq);
+}
+
+/**
+ * @brief Print stats of one call site
+ */
+static void asc_crit_stats_print_cb(const asc_crit_stat_t* const stat, void* const arg)
+{
+  const asc_printf_t asc_printf = asc_get_init((asc_context_t*)arg).asc_printf;
+  if(!asc_printf) return;
+  char buffer[256];
+  int pos = snprintf(buffer, sizeof(buffer), "[ASC][CRIT] %s cnt %lu max %lu:", stat->site, (unsigned long)stat->cnt, (unsigned long)stat->max);
+  for(uint8_t bin = 0; bin < ASC_CRIT_STATS_BINS && pos > 0 && pos < (int)sizeof(buffer); bin++)
+  {
+    if(!stat->hist[bin]) continue;
+    pos += snprintf(&buffer[pos], sizeof(buffer) - pos, " >=%lu:%lu", (unsigned long)(bin ? 1ul << (bin - 1 + ASC_CRIT_STATS_SHIFT) : 0ul), (unsigned long)stat->hist[bin]);
+  }
+  if(pos > 0 && pos < (int)sizeof(buffer) - 1) memcpy(&buffer[pos], "\n", 2);
+  asc_printf(buffer);
+}
+
+/*******************************************************************************
+ ** @brief  Print max, count and not empty bins of each call site
+ ** @param  ctx   core context for printf
+ ** @return none
+ ******************************************************************************/
+void asc_crit_stats_print(asc_context_t* const ctx)
+{
+  DBC_REQUIRE(200, ctx);
+  asc_crit_stats_dump(asc_crit_stats_print_cb, ctx);
+}
@@ -0,0 +1,74 @@
+/******************************************************************************
+ *                              _    ____   ____                              *
+ *                   ======    / \  / ___| / ___| ======       (c)03.10.2025  *
+ *                   ======   / _ \ \___ \| |     ======           v1.0.0     *
+ *                   ======  / ___ \ ___) | |___  ======                      *
+ *                   ====== /_/   \_\____/ \____| ======                      *
+ *                                                                            *
+ ******************************************************************************/
+#ifndef __ASC_CRIT_STATS_H
+#define __ASC_CRIT_STATS_H
+
+/*******************************************************************************
+ * Include files
+ ******************************************************************************/
+#include <stdint.h>
+#include <stdbool.h>
+#include "asc_core.h"
+
+/*******************************************************************************
+ * Config
+ ******************************************************************************/
+#define ASC_CRIT_STATS_SITES   32   //Amount of call sites of critical sections in stats
+
+#define ASC_CRIT_STATS_BINS    16   //Histogram bins, bin 0 - 0, bin N - [2^(N-1), 2^N), the last one - the rest
+
+#define ASC_CRIT_STATS_SHIFT   0    //Hold time is divided by (1 << ASC_CRIT_STATS_SHIFT) before binning
+
+/*******************************************************************************
+ * Global type definitions ('typedef')
+ ******************************************************************************/
+typedef struct asc_crit_stat_t {
+  const char* site;                    //call site, see @ASC_CRIT_SITE
+  uint32_t cnt;                        //amount of sections
+  uint32_t max;                        //max hold time, units of @asc_crit_cycles
+  uint32_t hist[ASC_CRIT_STATS_BINS];  //histogram of hold time
+} asc_crit_stat_t;
+
+typedef void (*asc_crit_stats_cb_t)(const asc_crit_stat_t* const stat, void* const arg); //dump callback type
+
+/*******************************************************************************
+ * Global function prototypes (definition in C source)
+ ******************************************************************************/
+/*******************************************************************************
+ ** @brief  Account hold time of critical section. Called by port on exit of the
+ **         outermost section when @ASC_CRIT_STATS is 1
+ ** @param  site   call site
+ ** @param  cycles hold time, units of @asc_crit_cycles
+ ** @return none
+ ******************************************************************************/
+void asc_crit_stats_add(const char* const site, const uint32_t cycles);
+
+/*******************************************************************************
+ ** @brief  Dump stats of all call sites
+ ** @param  cb   cb for each call site, gets a copy of its stats
+ ** @param  arg  arg for cb. Can be NULL
+ ** @return amount of call sites
+ ******************************************************************************/
+uint16_t asc_crit_stats_dump(const asc_crit_stats_cb_t cb, void* const arg);
+
+/*******************************************************************************
+ ** @brief  Clear stats of all call sites
+ ** @param  none
+ ** @return none
+ ******************************************************************************/
+void asc_crit_stats_reset(void);
+
+/*******************************************************************************
+ ** @brief  Print max, count and not empty bins of each call site
+ ** @param  ctx   core context for printf
+ ** @return none
+ ******************************************************************************/
+void asc_crit_stats_print(asc_context_t* const ctx);
+
+#endif //__ASC_CRIT_STATS_H
@@ -9,13 +9,28 @@
 /*******************************************************************************
  * Include files
  ******************************************************************************/
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+  #define _GNU_SOURCE //clock_gettime and CLOCK_MONOTONIC_RAW in strict C modes
+#endif
 #include "asc_port.h"
 #include "asc_core.h"
+#include "asc_crit_stats.h"
 
 #ifndef ASC_TEST
   #include "stdarg.h"
   #include <stdio.h>
-  #include "hc32f460_utility.h"
+  #if defined(ASC_PORT_POSIX)
+    #include <stdlib.h>
+    #include <pthread.h>
+    #include <sched.h>
+    #include "asc_port_posix.h"
+  #else
+    #include "hc32f460_utility.h"
+  #endif
+#endif
+
+#if ASC_CRIT_STATS && defined(__linux__)
+  #include <time.h>
 #endif
 
 /*******************************************************************************
@@ -43,34 +58,131 @@
  ******************************************************************************/
 DBC_NORETURN void DBC_fault_handler(char const* module, int label) 
 {
+  #if defined(ASC_PORT_POSIX) && !defined(ASC_TEST)
+  fprintf(stderr, "[ASC][DBC] %s:%d\n", module, label);
+  abort();
+  #else
   (void)module;
   (void)label;
   while (1) 
   {
     /* Typically you would trigger a system reset or safe state here */
   }
+  #endif
 }
 
 /*******************************************************************************
- ** @brief  Weak function to enter into critical section
- ** @param  none
+ ** @brief  Lock context. Called on each enter before nest of context is 
+ **         incremented, so it should nest: PRIMASK on bare metal, recursive 
+ **         mutex of context with RTOS
+ ** @param  ctx  core context
  ** @return none
  ******************************************************************************/
-static void asc_crit_enter(void) 
+static void asc_crit_enter(asc_context_t* const ctx) 
 { 
+  #if defined(ASC_PORT_POSIX) && !defined(ASC_TEST)
+  asc_posix_lock(ctx);
+  #else
+  (void)ctx;
+  #endif
+  //uint32_t primask = __get_PRIMASK();
   //__disable_irq();
+  //if(!ctx->lock.nest) ctx->lock.state = primask;
+}
+
+/*******************************************************************************
+ ** @brief  Unlock context. Called on each exit after nest of context is 
+ **         decremented
+ ** @param  ctx  core context
+ ** @return none
+ ******************************************************************************/
+static void asc_crit_exit(asc_context_t* const ctx)  
+{
+  #if defined(ASC_PORT_POSIX) && !defined(ASC_TEST)
+  asc_posix_unlock(ctx);
+  #else
+  (void)ctx;
+  #endif
+  //if(!ctx->lock.nest) __set_PRIMASK(ctx->lock.state);
 }
 
 /*******************************************************************************
- ** @brief  Weak function to exit critical section
+ ** @brief  Mask interrupts of the core. Used by data shared with critical 
+ **         sections of ISRs, which are not bound to a context
  ** @param  none
+ ** @return state for @asc_port_irq_restore
+ ******************************************************************************/
+uint32_t asc_port_irq_mask(void)
+{
+  //uint32_t primask = __get_PRIMASK();
+  //__disable_irq();
+  //return primask;
+  return 0; //host builds have no ISRs, rx threads take locks of contexts
+}
+
+/*******************************************************************************
+ ** @brief  Restore interrupts masked by @asc_port_irq_mask
+ ** @param  state  state got from @asc_port_irq_mask
  ** @return none
  ******************************************************************************/
-static void asc_crit_exit(void)  
+void asc_port_irq_restore(const uint32_t state)
 {
-  //__enable_irq();
+  (void)state;
+  //__set_PRIMASK(state);
 }
 
+/*******************************************************************************
+ ** @brief  Id of the current thread. Tells @asc_event_dispatch of the caller
+ **         from one of other thread
+ ** @param  none
+ ** @return id, 0 without threads
+ ******************************************************************************/
+uintptr_t asc_port_thread(void)
+{
+  #if defined(ASC_PORT_POSIX) && !defined(ASC_TEST)
+  return (uintptr_t)pthread_self();
+  #else
+  //return (uintptr_t)xTaskGetCurrentTaskHandle();
+  return 0; //bare metal calls dispatch and core from the main loop
+  #endif
+}
+
+/*******************************************************************************
+ ** @brief  Give CPU to other threads while waiting for them, e.g. in
+ **         @asc_deinit for @asc_event_dispatch of other thread
+ ** @param  none
+ ** @return none
+ ******************************************************************************/
+void asc_port_yield(void)
+{
+  #if defined(ASC_PORT_POSIX) && !defined(ASC_TEST)
+  sched_yield();
+  #else
+  //taskYIELD();
+  #endif
+}
+
+#if ASC_CRIT_STATS
+/*******************************************************************************
+ ** @brief  Cycle counter for hold time of critical sections. Host builds on 
+ **         Linux count ns of CLOCK_MONOTONIC_RAW, it is not slewed by NTP.
+ **         Weak, MCU port defines its own one, e.g. DWT->CYCCNT enabled with
+ **         CoreDebug->DEMCR |= TRCENA and DWT->CTRL |= CYCCNTENA
+ ** @param  none
+ ** @return cycles
+ ******************************************************************************/
+__attribute__((weak)) uint32_t asc_crit_cycles(void)
+{
+  #if defined(__linux__)
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+  return (uint32_t)((uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec);
+  #else
+  return 0; //no counter, all sections get to bin 0
+  #endif
+}
+#endif
+
 /*******************************************************************************
  ** @brief  Printf
  ** @param  none
@@ -101,7 +213,7 @@ void asc_printf_safe(asc_context_t* const ctx, const char *fmt, ...)
     if(fragment_len <= 0) break;
     
     char escaped[sizeof(buffer)]; 
-    int escaped_pos = 0;
+    size_t escaped_pos = 0;
     
     for(int i = 0; i < fragment_len && buffer[i] != '\0'; i++) 
     {
@@ -172,25 +284,34 @@ void asc_printf_from_ring(asc_context_t* const ctx, ringslice_t rs_me, char* tex
  ** @param  none
  ** @return none
  ******************************************************************************/
-#ifndef ASC_TEST
-static volatile uint32_t asc_crit_counter = 0;
-#endif
-
-void _asc_crit_enter(void) 
+void _asc_crit_enter(asc_context_t* const ctx, const char* const site) 
 { 
   #ifndef ASC_TEST
-  asc_crit_enter();
-  asc_crit_counter++;
+  asc_crit_enter(ctx);
+  if(ctx->lock.nest++) return;
+  ctx->lock.site = site;
+  #if ASC_CRIT_STATS
+  ctx->lock.start = asc_crit_cycles();
+  #endif
+  #else
+  (void)ctx;
+  (void)site;
   #endif
 }
 
-void _asc_crit_exit(void)  
+void _asc_crit_exit(asc_context_t* const ctx)  
 {
   #ifndef ASC_TEST
-  if(asc_crit_counter > 0) 
+  if(!ctx->lock.nest) return;
+  if(--ctx->lock.nest == 0)
   {
-    asc_crit_counter--;
-    if (asc_crit_counter == 0) asc_crit_exit();
+    #if ASC_CRIT_STATS
+    asc_crit_stats_add(ctx->lock.site, asc_crit_cycles() - ctx->lock.start);
+    #endif
+    ctx->lock.site = NULL;
   }
+  asc_crit_exit(ctx);
+  #else
+  (void)ctx;
   #endif
 }
@@ -49,18 +49,58 @@
 DBC_NORETURN void DBC_fault_handler(char const* module, int label); 
 
 /*******************************************************************************
- ** @brief  Weak function to enter into critical section
+ ** @brief  Enter into critical section of context. Sections nest
+ ** @param  ctx   core context
+ ** @param  site  call site, see @ASC_CRIT_SITE
+ ** @return none
+ ******************************************************************************/
+void _asc_crit_enter(asc_context_t* const ctx, const char* const site); 
+
+/*******************************************************************************
+ ** @brief  Exit critical section of context
+ ** @param  ctx   core context
+ ** @return none
+ ******************************************************************************/
+void _asc_crit_exit(asc_context_t* const ctx);
+
+/*******************************************************************************
+ ** @brief  Cycle counter for hold time of critical sections, provided by port
+ **         when @ASC_CRIT_STATS is 1. Wraps around. Weak, can be overridden
  ** @param  none
+ ** @return cycles
+ ******************************************************************************/
+uint32_t asc_crit_cycles(void);
+
+/*******************************************************************************
+ ** @brief  Mask interrupts of the core. Used by data shared with critical 
+ **         sections of ISRs, which are not bound to a context
+ ** @param  none
+ ** @return state for @asc_port_irq_restore
+ ******************************************************************************/
+uint32_t asc_port_irq_mask(void);
+
+/*******************************************************************************
+ ** @brief  Restore interrupts masked by @asc_port_irq_mask
+ ** @param  state  state got from @asc_port_irq_mask
  ** @return none
  ******************************************************************************/
-void _asc_crit_enter(void); 
+void asc_port_irq_restore(const uint32_t state);
+
+/*******************************************************************************
+ ** @brief  Id of the current thread. Tells @asc_event_dispatch of the caller
+ **         from one of other thread
+ ** @param  none
+ ** @return id, 0 without threads
+ ******************************************************************************/
+uintptr_t asc_port_thread(void);
 
 /*******************************************************************************
- ** @brief  Weak function to exit critical section
+ ** @brief  Give CPU to other threads while waiting for them, e.g. in
+ **         @asc_deinit for @asc_event_dispatch of other thread
  ** @param  none
  ** @return none
  ******************************************************************************/
-void _asc_crit_exit(void);
+void asc_port_yield(void);
 
 /*******************************************************************************
  ** @brief  Printf
@@ -0,0 +1,274 @@
+/******************************************************************************
+ *                              _    ____   ____                              *
+ *                   ======    / \  / ___| / ___| ======       (c)03.10.2025  *
+ *                   ======   / _ \ \___ \| |     ======           v1.0.0     *
+ *                   ======  / ___ \ ___) | |___  ======                      *
+ *                   ====== /_/   \_\____/ \____| ======                      *
+ *                                                                            *
+ ******************************************************************************/
+/*******************************************************************************
+ * Include files
+ ******************************************************************************/
+#ifndef _GNU_SOURCE
+  #define _GNU_SOURCE //cfmakeraw, pthread_mutexattr_settype
+#endif
+#include "asc_port_posix.h"
+#include "dbc_assert.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <termios.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+
+/*******************************************************************************
+ * Local pre-processor symbols/macros ('#define')
+ ******************************************************************************/
+DBC_MODULE_NAME("ASC_PORT_POSIX")
+
+/*******************************************************************************
+ * Function implementation - global ('extern') and local ('static')
+ ******************************************************************************/
+/**
+ * @brief Termios speed of baud rate
+ */
+static speed_t asc_posix_speed(const uint32_t baud)
+{
+  switch(baud)
+  {
+    case 9600:   return B9600;
+    case 19200:  return B19200;
+    case 38400:  return B38400;
+    case 57600:  return B57600;
+    case 115200: return B115200;
+    case 230400: return B230400;
+    case 460800: return B460800;
+    case 921600: return B921600;
+    default:     return B0;
+  }
+}
+
+/**
+ * @brief Rx thread: wait for data by epoll and put it to rx ring, the single producer
+ */
+static void* asc_posix_rx_thread(void* arg)
+{
+  asc_posix_serial_t* const serial = (asc_posix_serial_t*)arg;
+  while(serial->running)
+  {
+    struct epoll_event events[2];
+    int cnt = epoll_wait(serial->epoll_fd, events, 2, -1);
+    if(cnt < 0 && errno == EINTR) continue;
+    if(cnt < 0) break;
+    for(int i = 0; i < cnt; i++)
+    {
+      if(events[i].data.fd == serial->stop_fd) return NULL;
+      if(!asc_posix_serial_read(serial) || (events[i].events & (EPOLLHUP | EPOLLERR))) serial->running = false; //tty is gone
+    }
+  }
+  return NULL;
+}
+
+/*******************************************************************************
+ ** @brief  Open tty in raw 8N1 mode without flow control and start rx thread.
+ **         Rx thread waits for data by epoll and puts it to rx ring
+ ** @param  serial     serial, should exist until close
+ ** @param  path       path of tty, e.g. /dev/ttyUSB0 or slave of pty
+ ** @param  baud       baud rate, 9600..921600
+ ** @param  ring       rx ring of context
+ ** @param  rx_thread  false - no rx thread, owner of fd calls @asc_posix_serial_read
+ **                    on its readiness, e.g. asc_posix_loop.c
+ ** @return true - opened, false - see errno
+ ******************************************************************************/
+bool asc_posix_serial_open(asc_posix_serial_t* const serial, const char* const path, const uint32_t baud, asc_ring_buffer_t* const ring, const bool rx_thread)
+{
+  DBC_REQUIRE(100, serial);
+  DBC_REQUIRE(101, path);
+  DBC_REQUIRE(102, ring);
+  const speed_t speed = asc_posix_speed(baud);
+  if(speed == B0) { errno = EINVAL; return false; }
+  serial->ring = ring;
+  serial->rx_drop = 0;
+  serial->rx_threaded = false;
+  serial->epoll_fd = -1;
+  serial->stop_fd = -1;
+  serial->fd = open(path, O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+  if(serial->fd < 0) return false;
+  struct termios tio;
+  if(tcgetattr(serial->fd, &tio) < 0) goto error_exit;
+  cfmakeraw(&tio);
+  tio.c_cflag &= ~(CSTOPB | CRTSCTS | PARENB | CSIZE);
+  tio.c_cflag |= CS8 | CLOCAL | CREAD;
+  tio.c_cc[VMIN] = 0;
+  tio.c_cc[VTIME] = 0;
+  cfsetispeed(&tio, speed);
+  cfsetospeed(&tio, speed);
+  if(tcsetattr(serial->fd, TCSANOW, &tio) < 0) goto error_exit;
+  tcflush(serial->fd, TCIOFLUSH);
+  serial->running = true;
+  if(!rx_thread) return true;
+  serial->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+  serial->stop_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+  if(serial->epoll_fd < 0 || serial->stop_fd < 0) goto error_exit;
+  struct epoll_event event = {.events = EPOLLIN, .data.fd = serial->fd};
+  if(epoll_ctl(serial->epoll_fd, EPOLL_CTL_ADD, serial->fd, &event) < 0) goto error_exit;
+  event.data.fd = serial->stop_fd;
+  if(epoll_ctl(serial->epoll_fd, EPOLL_CTL_ADD, serial->stop_fd, &event) < 0) goto error_exit;
+  if(pthread_create(&serial->rx_thread, NULL, asc_posix_rx_thread, serial) != 0) goto error_exit;
+  serial->rx_threaded = true;
+  return true;
+
+  error_exit:
+    serial->running = false;
+    if(serial->stop_fd >= 0) close(serial->stop_fd);
+    if(serial->epoll_fd >= 0) close(serial->epoll_fd);
+    close(serial->fd);
+    serial->fd = -1;
+    return false;
+}
+
+/*******************************************************************************
+ ** @brief  Stop rx thread and close tty
+ ** @param  serial  serial
+ ** @return none
+ ******************************************************************************/
+void asc_posix_serial_close(asc_posix_serial_t* const serial)
+{
+  DBC_REQUIRE(200, serial);
+  if(serial->fd < 0) return;
+  if(serial->rx_threaded)
+  {
+    const uint64_t stop = 1;
+    if(write(serial->stop_fd, &stop, sizeof(stop)) < 0) serial->running = false;
+    pthread_join(serial->rx_thread, NULL);
+    close(serial->stop_fd);
+    close(serial->epoll_fd);
+    serial->rx_threaded = false;
+  }
+  serial->running = false;
+  close(serial->fd);
+  serial->fd = -1;
+}
+
+/*******************************************************************************
+ ** @brief  Put all data available in tty to rx ring without blocking. Called by
+ **         rx thread or by owner of fd, it is the single producer of the ring
+ ** @param  serial  serial
+ ** @return false - read error, e.g. EIO after hangup. Hangup itself is told
+ **         by EPOLLHUP of fd
+ ******************************************************************************/
+bool asc_posix_serial_read(asc_posix_serial_t* const serial)
+{
+  DBC_REQUIRE(250, serial);
+  uint8_t buff[ASC_POSIX_RX_CHUNK];
+  ssize_t len;
+  while((len = read(serial->fd, buff, sizeof(buff))) > 0)
+  {
+    serial->rx_drop += (uint32_t)len - asc_ring_write(serial->ring, buff, (uint16_t)len);
+  }
+  return len == 0 || errno == EAGAIN || errno == EINTR; //raw tty with VMIN 0 returns 0 when drained
+}
+
+/*******************************************************************************
+ ** @brief  Write data to tty without blocking. Use it in @asc_write_t of context
+ ** @param  serial  serial
+ ** @param  data    data
+ ** @param  len     length of data
+ ** @return amount of bytes accepted by tty, the rest is written by next call
+ ******************************************************************************/
+uint16_t asc_posix_serial_write(asc_posix_serial_t* const serial, const uint8_t* const data, const uint16_t len)
+{
+  DBC_REQUIRE(300, serial);
+  if(serial->fd < 0) return 0;
+  ssize_t res = write(serial->fd, data, len);
+  return res > 0 ? (uint16_t)res : 0;
+}
+
+/*******************************************************************************
+ ** @brief  Create recursive pthread mutex of context. Critical sections of the
+ **         context lock it, so contexts of different threads don't block each
+ **         other. Call it before @asc_init
+ ** @param  ctx  core context
+ ** @return true - created
+ ******************************************************************************/
+bool asc_posix_lock_init(asc_context_t* const ctx)
+{
+  DBC_REQUIRE(400, ctx);
+  DBC_REQUIRE(401, !ctx->lock.port);
+  pthread_mutex_t* const mutex = malloc(sizeof(pthread_mutex_t));
+  if(!mutex) return false;
+  pthread_mutexattr_t attr;
+  pthread_mutexattr_init(&attr);
+  pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE); //sections of context nest
+  const bool res = pthread_mutex_init(mutex, &attr) == 0;
+  pthread_mutexattr_destroy(&attr);
+  if(!res) { free(mutex); return false; }
+  ctx->lock.port = mutex;
+  return true;
+}
+
+/*******************************************************************************
+ ** @brief  Destroy mutex of context. Call it after @asc_deinit
+ ** @param  ctx  core context
+ ** @return none
+ ******************************************************************************/
+void asc_posix_lock_deinit(asc_context_t* const ctx)
+{
+  DBC_REQUIRE(500, ctx);
+  if(!ctx->lock.port) return;
+  pthread_mutex_destroy((pthread_mutex_t*)ctx->lock.port);
+  free(ctx->lock.port);
+  ctx->lock.port = NULL;
+}
+
+/*******************************************************************************
+ ** @brief  Lock mutex of context, called by asc_port.c. No-op without mutex
+ ** @param  ctx  core context
+ ** @return none
+ ******************************************************************************/
+void asc_posix_lock(asc_context_t* const ctx)
+{
+  if(ctx->lock.port) pthread_mutex_lock((pthread_mutex_t*)ctx->lock.port);
+}
+
+/*******************************************************************************
+ ** @brief  Unlock mutex of context, called by asc_port.c
+ ** @param  ctx  core context
+ ** @return none
+ ******************************************************************************/
+void asc_posix_unlock(asc_context_t* const ctx)
+{
+  if(ctx->lock.port) pthread_mutex_unlock((pthread_mutex_t*)ctx->lock.port);
+}
+
+/*******************************************************************************
+ ** @brief  Time by CLOCK_MONOTONIC
+ ** @param  none
+ ** @return time in ms
+ ******************************************************************************/
+uint32_t asc_posix_time_ms(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint32_t)((uint64_t)ts.tv_sec * 1000u + (uint64_t)ts.tv_nsec / 1000000u);
+}
+
+/*******************************************************************************
+ ** @brief  Sleep till the next @ASC_CORE_TICK_MS period by CLOCK_MONOTONIC
+ **         absolute deadlines, so period doesn't drift with the work of tick
+ ** @param  next  deadline of the previous tick, zero - start from now
+ ** @return none
+ ******************************************************************************/
+void asc_posix_tick_wait(struct timespec* const next)
+{
+  DBC_REQUIRE(600, next);
+  if(!next->tv_sec && !next->tv_nsec) clock_gettime(CLOCK_MONOTONIC, next);
+  next->tv_nsec += ASC_CORE_TICK_MS * 1000000L;
+  while(next->tv_nsec >= 1000000000L)
+  {
+    next->tv_nsec -= 1000000000L;
+    next->tv_sec++;
+  }
+  while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, next, NULL) == EINTR) {}
+}
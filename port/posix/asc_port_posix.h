@@ -0,0 +1,125 @@
+/******************************************************************************
+ *                              _    ____   ____                              *
+ *                   ======    / \  / ___| / ___| ======       (c)03.10.2025  *
+ *                   ======   / _ \ \___ \| |     ======           v1.0.0     *
+ *                   ======  / ___ \ ___) | |___  ======                      *
+ *                   ====== /_/   \_\____/ \____| ======                      *
+ *                                                                            *
+ ******************************************************************************/
+#ifndef __ASC_PORT_POSIX_H
+#define __ASC_PORT_POSIX_H
+
+/*******************************************************************************
+ * Include files
+ ******************************************************************************/
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <time.h>
+#include "asc_core.h"
+
+/*******************************************************************************
+ * Config
+ ******************************************************************************/
+#define ASC_POSIX_RX_CHUNK   256    //Size of read() chunk of rx thread
+
+/*******************************************************************************
+ * Global type definitions ('typedef')
+ ******************************************************************************/
+typedef struct asc_posix_serial_t {
+  int fd;                    //fd of tty, -1 - closed
+  int epoll_fd;              //epoll of rx thread
+  int stop_fd;               //eventfd to stop rx thread
+  pthread_t rx_thread;       //rx thread, the single producer of rx ring
+  bool rx_threaded;          //rx thread is started
+  asc_ring_buffer_t* ring;   //rx ring of context
+  volatile bool running;     //rx thread works, false after hangup of tty
+  volatile uint32_t rx_drop; //bytes dropped as rx ring was full
+} asc_posix_serial_t;
+
+/*******************************************************************************
+ * Global function prototypes (definition in C source)
+ ******************************************************************************/
+/*******************************************************************************
+ ** @brief  Open tty in raw 8N1 mode without flow control and start rx thread.
+ **         Rx thread waits for data by epoll and puts it to rx ring
+ ** @param  serial     serial, should exist until close
+ ** @param  path       path of tty, e.g. /dev/ttyUSB0 or slave of pty
+ ** @param  baud       baud rate, 9600..921600
+ ** @param  ring       rx ring of context
+ ** @param  rx_thread  false - no rx thread, owner of fd calls @asc_posix_serial_read
+ **                    on its readiness, e.g. asc_posix_loop.c
+ ** @return true - opened, false - see errno
+ ******************************************************************************/
+bool asc_posix_serial_open(asc_posix_serial_t* const serial, const char* const path, const uint32_t baud, asc_ring_buffer_t* const ring, const bool rx_thread);
+
+/*******************************************************************************
+ ** @brief  Put all data available in tty to rx ring without blocking. Called by
+ **         rx thread or by owner of fd, it is the single producer of the ring
+ ** @param  serial  serial
+ ** @return false - tty is gone (hangup or error)
+ ******************************************************************************/
+bool asc_posix_serial_read(asc_posix_serial_t* const serial);
+
+/*******************************************************************************
+ ** @brief  Stop rx thread and close tty
+ ** @param  serial  serial
+ ** @return none
+ ******************************************************************************/
+void asc_posix_serial_close(asc_posix_serial_t* const serial);
+
+/*******************************************************************************
+ ** @brief  Write data to tty without blocking. Use it in @asc_write_t of context
+ ** @param  serial  serial
+ ** @param  data    data
+ ** @param  len     length of data
+ ** @return amount of bytes accepted by tty, the rest is written by next call
+ ******************************************************************************/
+uint16_t asc_posix_serial_write(asc_posix_serial_t* const serial, const uint8_t* const data, const uint16_t len);
+
+/*******************************************************************************
+ ** @brief  Create recursive pthread mutex of context. Critical sections of the
+ **         context lock it, so contexts of different threads don't block each
+ **         other. Call it before @asc_init
+ ** @param  ctx  core context
+ ** @return true - created
+ ******************************************************************************/
+bool asc_posix_lock_init(asc_context_t* const ctx);
+
+/*******************************************************************************
+ ** @brief  Destroy mutex of context. Call it after @asc_deinit
+ ** @param  ctx  core context
+ ** @return none
+ ******************************************************************************/
+void asc_posix_lock_deinit(asc_context_t* const ctx);
+
+/*******************************************************************************
+ ** @brief  Lock mutex of context, called by asc_port.c. No-op without mutex
+ ** @param  ctx  core context
+ ** @return none
+ ******************************************************************************/
+void asc_posix_lock(asc_context_t* const ctx);
+
+/*******************************************************************************
+ ** @brief  Unlock mutex of context, called by asc_port.c
+ ** @param  ctx  core context
+ ** @return none
+ ******************************************************************************/
+void asc_posix_unlock(asc_context_t* const ctx);
+
+/*******************************************************************************
+ ** @brief  Time by CLOCK_MONOTONIC
+ ** @param  none
+ ** @return time in ms
+ ******************************************************************************/
+uint32_t asc_posix_time_ms(void);
+
+/*******************************************************************************
+ ** @brief  Sleep till the next @ASC_CORE_TICK_MS period by CLOCK_MONOTONIC
+ **         absolute deadlines, so period doesn't drift with the work of tick
+ ** @param  next  deadline of the previous tick, zero - start from now
+ ** @return none
+ ******************************************************************************/
+void asc_posix_tick_wait(struct timespec* const next);
+
+#endif //__ASC_PORT_POSIX_H
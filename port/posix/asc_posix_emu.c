@@ -0,0 +1,132 @@
+/******************************************************************************
+ *                              _    ____   ____                              *
+ *                   ======    / \  / ___| / ___| ======       (c)03.10.2025  *
+ *                   ======   / _ \ \___ \| |     ======           v1.0.0     *
+ *                   ======  / ___ \ ___) | |___  ======                      *
+ *                   ====== /_/   \_\____/ \____| ======                      *
+ *                                                                            *
+ ******************************************************************************/
+/*******************************************************************************
+ * Include files
+ ******************************************************************************/
+#ifndef _GNU_SOURCE
+  #define _GNU_SOURCE //posix_openpt, ptsname_r
+#endif
+#include "asc_posix_emu.h"
+#include "dbc_assert.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/*******************************************************************************
+ * Local pre-processor symbols/macros ('#define')
+ ******************************************************************************/
+DBC_MODULE_NAME("ASC_POSIX_EMU")
+
+/*******************************************************************************
+ * Local variable definitions ('static')
+ ******************************************************************************/
+static const struct {
+  const char* cmd;
+  const char* answ;
+} asc_posix_emu_answers[] = {
+  {"+GSN",   "869000000000001"},
+  {"+GMM",   "SIMCOM_SIM868"},
+  {"+GMR",   "Revision:1418B06SIM868M32_EMU"},
+  {"+CCLK?", "+CCLK: \"26/10/19,12:00:00+12\""},
+  {"+CCID",  "8970100000000000001"},
+  {"+COPS?", "+COPS: 0, 0,\"Emulated\""},
+  {"+CSQ",   "+CSQ: 20,0"},
+  {"+CENG?", "+CENG: 0,\"250,01,1a2b,3c4d,30,20\""},
+};
+
+/*******************************************************************************
+ * Function implementation - global ('extern') and local ('static')
+ ******************************************************************************/
+/**
+ * @brief Answer one line "AT<CMD>[;<CMD>...]": echo, data lines of known cmds, OK
+ */
+static void asc_posix_emu_answer(const int fd, char* const line)
+{
+  char out[512];
+  int pos = snprintf(out, sizeof(out), "%s\r", line);
+  char* const cmd = strncmp(line, "AT", 2) ? line : line + 2;
+  char* save = NULL;
+  for(char* part = strtok_r(cmd, ";", &save); part; part = strtok_r(NULL, ";", &save))
+  {
+    for(size_t i = 0; i < sizeof(asc_posix_emu_answers)/sizeof(asc_posix_emu_answers[0]); i++)
+    {
+      if(strcmp(part, asc_posix_emu_answers[i].cmd) || pos >= (int)sizeof(out)) continue;
+      pos += snprintf(&out[pos], sizeof(out) - pos, "\r\n%s\r\n", asc_posix_emu_answers[i].answ);
+    }
+  }
+  if(pos < (int)sizeof(out)) pos += snprintf(&out[pos], sizeof(out) - pos, "\r\nOK\r\n");
+  if(pos > (int)sizeof(out)) pos = sizeof(out);
+  if(write(fd, out, pos) < 0) return; //slave is gone, next read fails
+}
+
+/**
+ * @brief Thread of emulated modem, reads cmd lines till slave side is closed
+ */
+static void* asc_posix_emu_thread(void* arg)
+{
+  asc_posix_emu_t* const emu = (asc_posix_emu_t*)arg;
+  char line[256];
+  size_t len = 0;
+  char c;
+  while(read(emu->master, &c, 1) == 1) //EIO when slave is closed
+  {
+    if(c == '\n') continue;
+    if(c != '\r')
+    {
+      if(len < sizeof(line) - 1) line[len++] = c;
+      continue;
+    }
+    line[len] = 0;
+    len = 0;
+    if(!line[0]) continue;
+    asc_posix_emu_answer(emu->master, line);
+    emu->cmd_cnt++;
+  }
+  close(emu->master);
+  emu->master = -1;
+  return NULL;
+}
+
+/*******************************************************************************
+ ** @brief  Create pty of emulated SIMCOM modem for demos and benchmarks on host
+ ** @param  emu  emulator
+ ** @return true - created, @path is valid
+ ******************************************************************************/
+bool asc_posix_emu_open(asc_posix_emu_t* const emu)
+{
+  DBC_REQUIRE(100, emu);
+  emu->cmd_cnt = 0;
+  emu->master = posix_openpt(O_RDWR | O_NOCTTY | O_CLOEXEC);
+  if(emu->master < 0) return false;
+  if(grantpt(emu->master) < 0 || unlockpt(emu->master) < 0 || ptsname_r(emu->master, emu->path, sizeof(emu->path)) != 0)
+  {
+    close(emu->master);
+    emu->master = -1;
+    return false;
+  }
+  return true;
+}
+
+/*******************************************************************************
+ ** @brief  Start thread of emulated modem. It echoes cmds and answers cmds of
+ **         asc_mdl_modem_init and asc_mdl_rtd, batch included, the rest gets OK.
+ **         The thread closes pty and exits when slave side is closed
+ ** @param  emu  emulator, should exist until the thread exits
+ ** @return true - started
+ ******************************************************************************/
+bool asc_posix_emu_start(asc_posix_emu_t* const emu)
+{
+  DBC_REQUIRE(200, emu);
+  DBC_REQUIRE(201, emu->master >= 0);
+  if(pthread_create(&emu->thread, NULL, asc_posix_emu_thread, emu) != 0) return false;
+  pthread_detach(emu->thread);
+  return true;
+}
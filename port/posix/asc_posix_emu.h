@@ -0,0 +1,48 @@
+/******************************************************************************
+ *                              _    ____   ____                              *
+ *                   ======    / \  / ___| / ___| ======       (c)03.10.2025  *
+ *                   ======   / _ \ \___ \| |     ======           v1.0.0     *
+ *                   ======  / ___ \ ___) | |___  ======                      *
+ *                   ====== /_/   \_\____/ \____| ======                      *
+ *                                                                            *
+ ******************************************************************************/
+#ifndef __ASC_POSIX_EMU_H
+#define __ASC_POSIX_EMU_H
+
+/*******************************************************************************
+ * Include files
+ ******************************************************************************/
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+/*******************************************************************************
+ * Global type definitions ('typedef')
+ ******************************************************************************/
+typedef struct asc_posix_emu_t {
+  int master;                 //master side of pty, the modem
+  char path[64];              //slave side of pty, open it as tty of modem
+  pthread_t thread;           //thread of modem
+  volatile uint32_t cmd_cnt;  //amount of answered cmd lines
+} asc_posix_emu_t;
+
+/*******************************************************************************
+ * Global function prototypes (definition in C source)
+ ******************************************************************************/
+/*******************************************************************************
+ ** @brief  Create pty of emulated SIMCOM modem for demos and benchmarks on host
+ ** @param  emu  emulator
+ ** @return true - created, @path is valid
+ ******************************************************************************/
+bool asc_posix_emu_open(asc_posix_emu_t* const emu);
+
+/*******************************************************************************
+ ** @brief  Start thread of emulated modem. It echoes cmds and answers cmds of
+ **         asc_mdl_modem_init and asc_mdl_rtd, batch included, the rest gets OK.
+ **         The thread closes pty and exits when slave side is closed
+ ** @param  emu  emulator, should exist until the thread exits
+ ** @return true - started
+ ******************************************************************************/
+bool asc_posix_emu_start(asc_posix_emu_t* const emu);
+
+#endif //__ASC_POSIX_EMU_H
@@ -0,0 +1,323 @@
+/******************************************************************************
+ *                              _    ____   ____                              *
+ *                   ======    / \  / ___| / ___| ======       (c)03.10.2025  *
+ *                   ======   / _ \ \___ \| |     ======           v1.0.0     *
+ *                   ======  / ___ \ ___) | |___  ======                      *
+ *                   ====== /_/   \_\____/ \____| ======                      *
+ *                                                                            *
+ ******************************************************************************/
+/*******************************************************************************
+ * Include files
+ ******************************************************************************/
+#ifndef _GNU_SOURCE
+  #define _GNU_SOURCE //pthread_setaffinity_np
+#endif
+#include "asc_posix_loop.h"
+#include "dbc_assert.h"
+#include <errno.h>
+#include <sched.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+
+/*******************************************************************************
+ * Local pre-processor symbols/macros ('#define')
+ ******************************************************************************/
+DBC_MODULE_NAME("ASC_POSIX_LOOP")
+
+/*******************************************************************************
+ * Local variable definitions ('static')
+ ******************************************************************************/
+static _Thread_local asc_posix_loop_ctx_t* asc_posix_loop_cur = NULL; //context processed by worker now, for asc_write
+
+/*******************************************************************************
+ * Function implementation - global ('extern') and local ('static')
+ ******************************************************************************/
+/**
+ * @brief CLOCK_MONOTONIC in ms, 64 bits
+ */
+static uint64_t asc_posix_loop_now(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000u + (uint64_t)ts.tv_nsec / 1000000u;
+}
+
+/**
+ * @brief Proc context if its tick is due, then plan the next wakeup
+ */
+static void asc_posix_loop_proc(asc_posix_loop_ctx_t* const entry, const uint64_t now)
+{
+  asc_context_t* const ctx = entry->ctx;
+  const uint32_t target = (uint32_t)((now - entry->origin) / ASC_CORE_TICK_MS);
+  const uint32_t time = asc_get_cur_time(ctx);
+  if((int32_t)(target - time) <= 0) //this tick is done, rx or kick waits for the next one
+  {
+    entry->wakeup = entry->origin + (uint64_t)(time + 1) * ASC_CORE_TICK_MS;
+    return;
+  }
+  if(target - time > 1) asc_core_advance(ctx, target - time - 1); //idle ticks, nothing was due
+  asc_posix_loop_cur = entry;
+  asc_core_proc(ctx);
+  entry->proc_cnt++;
+  uint32_t wakeup = entry->cb ? entry->cb(ctx, entry->arg) : ASC_CORE_NO_WAKEUP;
+  const uint32_t core = asc_core_next_wakeup(ctx); //after cb, it can enqueue
+  asc_posix_loop_cur = NULL;
+  if(core < wakeup) wakeup = core;
+  if(wakeup == ASC_CORE_NO_WAKEUP) { entry->wakeup = UINT64_MAX; return; }
+  const uint32_t next = (target + 1) * ASC_CORE_TICK_MS;
+  entry->wakeup = entry->origin + ((int32_t)(wakeup - next) > 0 ? wakeup : next);
+}
+
+/**
+ * @brief Worker: proc due contexts, then sleep till rx, wake or the nearest wakeup
+ */
+static void* asc_posix_loop_thread(void* arg)
+{
+  asc_posix_loop_worker_t* const worker = (asc_posix_loop_worker_t*)arg;
+  struct epoll_event events[ASC_POSIX_LOOP_EVENTS];
+  while(atomic_load_explicit(worker->running, memory_order_acquire))
+  {
+    uint64_t now = asc_posix_loop_now();
+    uint64_t next = UINT64_MAX;
+    for(asc_posix_loop_ctx_t* entry = worker->ctxs; entry; entry = entry->next)
+    {
+      if(atomic_exchange_explicit(&entry->kick, false, memory_order_acquire)) entry->wakeup = now;
+      if(entry->wakeup <= now) asc_posix_loop_proc(entry, now);
+      if(entry->wakeup < next) next = entry->wakeup;
+    }
+    now = asc_posix_loop_now();
+    const int timeout = next == UINT64_MAX ? -1 : next <= now ? 0 : (int)(next - now);
+    const int cnt = epoll_wait(worker->epoll_fd, events, ASC_POSIX_LOOP_EVENTS, timeout);
+    if(cnt < 0 && errno != EINTR) break;
+    now = asc_posix_loop_now();
+    for(int i = 0; i < cnt; i++)
+    {
+      asc_posix_loop_ctx_t* const entry = (asc_posix_loop_ctx_t*)events[i].data.ptr;
+      if(!entry) //wake_fd, one read resets its counter, so wakes are merged
+      {
+        uint64_t val;
+        const ssize_t drained = read(worker->wake_fd, &val, sizeof(val));
+        (void)drained; //only this worker reads it, on error there is nothing to retry
+        continue;
+      }
+      if(!asc_posix_serial_read(entry->serial) || (events[i].events & (EPOLLHUP | EPOLLERR))) //tty is gone, context runs on timers only
+      {
+        entry->serial->running = false;
+        epoll_ctl(worker->epoll_fd, EPOLL_CTL_DEL, entry->serial->fd, NULL);
+      }
+      entry->wakeup = now; //rx is parsed on the next tick
+    }
+  }
+  struct timespec ts;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  worker->cpu_ns = (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+  return NULL;
+}
+
+/*******************************************************************************
+ ** @brief  Init event loop for many contexts. Each context is pinned to one
+ **         worker and is processed only on rx readiness of its tty, its next
+ **         timer deadline (@asc_core_next_wakeup) or @asc_posix_loop_wake
+ ** @param  loop     loop
+ ** @param  workers  amount of worker threads, 1..@ASC_POSIX_LOOP_WORKERS
+ ** @param  pin      true - pin worker N to cpu N % amount of cpus
+ ** @return true - inited
+ ******************************************************************************/
+bool asc_posix_loop_init(asc_posix_loop_t* const loop, const uint8_t workers, const bool pin)
+{
+  DBC_REQUIRE(100, loop);
+  DBC_REQUIRE(101, workers && workers <= ASC_POSIX_LOOP_WORKERS);
+  const long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+  loop->worker_cnt = 0;
+  atomic_init(&loop->running, false);
+  for(uint8_t id = 0; id < workers; id++)
+  {
+    asc_posix_loop_worker_t* const worker = &loop->worker[id];
+    worker->ctxs = NULL;
+    worker->ctx_cnt = 0;
+    worker->running = &loop->running;
+    worker->cpu = pin && cpus > 0 ? (int)(id % cpus) : -1;
+    worker->cpu_ns = 0;
+    worker->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    worker->wake_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    struct epoll_event event = {.events = EPOLLIN, .data.ptr = NULL};
+    if(worker->epoll_fd < 0 || worker->wake_fd < 0 || epoll_ctl(worker->epoll_fd, EPOLL_CTL_ADD, worker->wake_fd, &event) < 0)
+    {
+      if(worker->wake_fd >= 0) close(worker->wake_fd);
+      if(worker->epoll_fd >= 0) close(worker->epoll_fd);
+      asc_posix_loop_deinit(loop);
+      return false;
+    }
+    loop->worker_cnt++;
+  }
+  return true;
+}
+
+/*******************************************************************************
+ ** @brief  Add context to the least loaded worker. Call it before start.
+ **         Pass @asc_posix_loop_write to asc_init of the context
+ ** @param  loop    loop
+ ** @param  entry   entry of context, should exist until deinit of loop
+ ** @param  ctx     core context, inited
+ ** @param  serial  tty of context opened with rx_thread false
+ ** @param  cb      cb after each proc, e.g. chain scheduler. Can be NULL
+ ** @param  arg     arg for cb. Can be NULL
+ ** @return true - added
+ ******************************************************************************/
+bool asc_posix_loop_add(asc_posix_loop_t* const loop, asc_posix_loop_ctx_t* const entry, asc_context_t* const ctx, asc_posix_serial_t* const serial, const asc_posix_loop_cb_t cb, void* const arg)
+{
+  DBC_REQUIRE(200, loop);
+  DBC_REQUIRE(201, !loop->running);
+  DBC_REQUIRE(202, loop->worker_cnt);
+  DBC_REQUIRE(203, entry && ctx && serial);
+  DBC_REQUIRE(204, serial->fd >= 0 && !serial->rx_threaded);
+  asc_posix_loop_worker_t* worker = &loop->worker[0];
+  for(uint8_t id = 1; id < loop->worker_cnt; id++)
+  {
+    if(loop->worker[id].ctx_cnt < worker->ctx_cnt) worker = &loop->worker[id];
+  }
+  entry->ctx = ctx;
+  entry->serial = serial;
+  entry->cb = cb;
+  entry->arg = arg;
+  entry->worker = worker;
+  entry->wakeup = 0;
+  entry->proc_cnt = 0;
+  atomic_init(&entry->kick, false);
+  struct epoll_event event = {.events = EPOLLIN, .data.ptr = entry};
+  if(epoll_ctl(worker->epoll_fd, EPOLL_CTL_ADD, serial->fd, &event) < 0) return false;
+  entry->next = worker->ctxs;
+  worker->ctxs = entry;
+  worker->ctx_cnt++;
+  return true;
+}
+
+/*******************************************************************************
+ ** @brief  Start worker threads
+ ** @param  loop  loop
+ ** @return true - started
+ ******************************************************************************/
+bool asc_posix_loop_start(asc_posix_loop_t* const loop)
+{
+  DBC_REQUIRE(300, loop);
+  DBC_REQUIRE(301, !loop->running);
+  const uint64_t now = asc_posix_loop_now();
+  for(uint8_t id = 0; id < loop->worker_cnt; id++)
+  {
+    for(asc_posix_loop_ctx_t* entry = loop->worker[id].ctxs; entry; entry = entry->next)
+    {
+      entry->origin = now - (uint64_t)asc_get_cur_time_ms(entry->ctx); //time of context goes on from here
+      entry->wakeup = now;
+    }
+  }
+  atomic_store_explicit(&loop->running, true, memory_order_release);
+  for(uint8_t id = 0; id < loop->worker_cnt; id++)
+  {
+    asc_posix_loop_worker_t* const worker = &loop->worker[id];
+    if(pthread_create(&worker->thread, NULL, asc_posix_loop_thread, worker) != 0)
+    {
+      loop->worker_cnt = id; //stop only started ones
+      asc_posix_loop_stop(loop);
+      return false;
+    }
+    if(worker->cpu >= 0)
+    {
+      cpu_set_t set;
+      CPU_ZERO(&set);
+      CPU_SET(worker->cpu, &set);
+      pthread_setaffinity_np(worker->thread, sizeof(set), &set); //not fatal, e.g. cpu is not allowed by cgroup
+    }
+  }
+  return true;
+}
+
+/*******************************************************************************
+ ** @brief  Stop and join worker threads
+ ** @param  loop  loop
+ ** @return none
+ ******************************************************************************/
+void asc_posix_loop_stop(asc_posix_loop_t* const loop)
+{
+  DBC_REQUIRE(400, loop);
+  if(!atomic_exchange_explicit(&loop->running, false, memory_order_acq_rel)) return;
+  const uint64_t val = 1;
+  for(uint8_t id = 0; id < loop->worker_cnt; id++)
+  {
+    if(write(loop->worker[id].wake_fd, &val, sizeof(val)) < 0) continue;
+  }
+  for(uint8_t id = 0; id < loop->worker_cnt; id++) pthread_join(loop->worker[id].thread, NULL);
+}
+
+/*******************************************************************************
+ ** @brief  Release fds of stopped loop
+ ** @param  loop  loop
+ ** @return none
+ ******************************************************************************/
+void asc_posix_loop_deinit(asc_posix_loop_t* const loop)
+{
+  DBC_REQUIRE(500, loop);
+  DBC_REQUIRE(501, !loop->running);
+  for(uint8_t id = 0; id < loop->worker_cnt; id++)
+  {
+    close(loop->worker[id].wake_fd);
+    close(loop->worker[id].epoll_fd);
+    loop->worker[id].ctxs = NULL;
+    loop->worker[id].ctx_cnt = 0;
+  }
+  loop->worker_cnt = 0;
+}
+
+/*******************************************************************************
+ ** @brief  Request proc of context on its next tick, e.g. after @asc_entity_submit
+ **         from a foreign thread. Can be called from any thread
+ ** @param  entry  entry of context
+ ** @return none
+ ******************************************************************************/
+void asc_posix_loop_wake(asc_posix_loop_ctx_t* const entry)
+{
+  DBC_REQUIRE(600, entry && entry->worker);
+  atomic_store_explicit(&entry->kick, true, memory_order_release);
+  const uint64_t val = 1;
+  if(write(entry->worker->wake_fd, &val, sizeof(val)) < 0) return; //counter is full, worker is woken anyway
+}
+
+/*******************************************************************************
+ ** @brief  Write function of contexts in loop, writes to tty of the context
+ **         which is processed by the calling worker now
+ ** @param  buff  data
+ ** @param  len   length of data
+ ** @return amount of bytes accepted by tty
+ ******************************************************************************/
+uint16_t asc_posix_loop_write(uint8_t* buff, uint16_t len)
+{
+  DBC_REQUIRE(700, asc_posix_loop_cur);
+  return asc_posix_serial_write(asc_posix_loop_cur->serial, buff, len);
+}
+
+/*******************************************************************************
+ ** @brief  CPU time spent by worker threads
+ ** @param  loop  loop
+ ** @return time in ns
+ ******************************************************************************/
+uint64_t asc_posix_loop_cpu_ns(asc_posix_loop_t* const loop)
+{
+  DBC_REQUIRE(800, loop);
+  uint64_t res = 0;
+  for(uint8_t id = 0; id < loop->worker_cnt; id++)
+  {
+    const asc_posix_loop_worker_t* const worker = &loop->worker[id];
+    clockid_t clock;
+    struct timespec ts;
+    if(atomic_load_explicit(&loop->running, memory_order_acquire) && pthread_getcpuclockid(worker->thread, &clock) == 0 && clock_gettime(clock, &ts) == 0)
+    {
+      res += (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+    }
+    else
+    {
+      res += worker->cpu_ns;
+    }
+  }
+  return res;
+}
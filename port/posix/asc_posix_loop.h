@@ -0,0 +1,140 @@
+/******************************************************************************
+ *                              _    ____   ____                              *
+ *                   ======    / \  / ___| / ___| ======       (c)03.10.2025  *
+ *                   ======   / _ \ \___ \| |     ======           v1.0.0     *
+ *                   ======  / ___ \ ___) | |___  ======                      *
+ *                   ====== /_/   \_\____/ \____| ======                      *
+ *                                                                            *
+ ******************************************************************************/
+#ifndef __ASC_POSIX_LOOP_H
+#define __ASC_POSIX_LOOP_H
+
+/*******************************************************************************
+ * Include files
+ ******************************************************************************/
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include "asc_core.h"
+#include "asc_port_posix.h"
+
+/*******************************************************************************
+ * Config
+ ******************************************************************************/
+#define ASC_POSIX_LOOP_WORKERS   16   //Max amount of worker threads
+
+#define ASC_POSIX_LOOP_EVENTS    16   //Epoll events taken by one wait of worker
+
+/*******************************************************************************
+ * Global type definitions ('typedef')
+ ******************************************************************************/
+typedef uint32_t (*asc_posix_loop_cb_t)(asc_context_t* const ctx, //context after asc_core_proc, e.g. to run chain scheduler
+                                        void* const arg);         //arg of context in loop
+                                        //return own next wakeup in units of asc_get_cur_time_ms or ASC_CORE_NO_WAKEUP
+
+struct asc_posix_loop_worker_t;
+
+typedef struct asc_posix_loop_ctx_t {
+  struct asc_posix_loop_ctx_t* next;       //next context of worker
+  asc_context_t* ctx;                      //core context
+  asc_posix_serial_t* serial;              //tty opened without rx thread, worker reads it
+  asc_posix_loop_cb_t cb;                  //cb after each proc. Can be NULL
+  void* arg;                               //arg for cb
+  struct asc_posix_loop_worker_t* worker;  //worker the context is pinned to
+  uint64_t origin;                         //CLOCK_MONOTONIC ms of time 0 of context
+  uint64_t wakeup;                         //CLOCK_MONOTONIC ms of the next proc, UINT64_MAX - only rx
+  atomic_bool kick;                        //proc is requested by @asc_posix_loop_wake
+  uint32_t proc_cnt;                       //amount of asc_core_proc calls
+} asc_posix_loop_ctx_t;
+
+typedef struct asc_posix_loop_worker_t {
+  asc_posix_loop_ctx_t* ctxs;  //contexts pinned to worker
+  uint16_t ctx_cnt;            //amount of contexts
+  int epoll_fd;                //ttys of contexts and wake_fd
+  int wake_fd;                 //eventfd to wake worker
+  pthread_t thread;            //worker thread
+  atomic_bool* running;        //run flag of loop
+  int cpu;                     //cpu the thread is pinned to, -1 - not pinned
+  uint64_t cpu_ns;             //cpu time of thread when it exits
+} asc_posix_loop_worker_t;
+
+typedef struct asc_posix_loop_t {
+  asc_posix_loop_worker_t worker[ASC_POSIX_LOOP_WORKERS]; //workers
+  uint8_t worker_cnt;  //amount of workers
+  atomic_bool running;   //workers are started
+} asc_posix_loop_t;
+
+/*******************************************************************************
+ * Global function prototypes (definition in C source)
+ ******************************************************************************/
+/*******************************************************************************
+ ** @brief  Init event loop for many contexts. Each context is pinned to one
+ **         worker and is processed only on rx readiness of its tty, its next
+ **         timer deadline (@asc_core_next_wakeup) or @asc_posix_loop_wake
+ ** @param  loop     loop
+ ** @param  workers  amount of worker threads, 1..@ASC_POSIX_LOOP_WORKERS
+ ** @param  pin      true - pin worker N to cpu N % amount of cpus
+ ** @return true - inited
+ ******************************************************************************/
+bool asc_posix_loop_init(asc_posix_loop_t* const loop, const uint8_t workers, const bool pin);
+
+/*******************************************************************************
+ ** @brief  Add context to the least loaded worker. Call it before start.
+ **         Pass @asc_posix_loop_write to asc_init of the context
+ ** @param  loop    loop
+ ** @param  entry   entry of context, should exist until deinit of loop
+ ** @param  ctx     core context, inited
+ ** @param  serial  tty of context opened with rx_thread false
+ ** @param  cb      cb after each proc, e.g. chain scheduler. Can be NULL
+ ** @param  arg     arg for cb. Can be NULL
+ ** @return true - added
+ ******************************************************************************/
+bool asc_posix_loop_add(asc_posix_loop_t* const loop, asc_posix_loop_ctx_t* const entry, asc_context_t* const ctx, asc_posix_serial_t* const serial, const asc_posix_loop_cb_t cb, void* const arg);
+
+/*******************************************************************************
+ ** @brief  Start worker threads
+ ** @param  loop  loop
+ ** @return true - started
+ ******************************************************************************/
+bool asc_posix_loop_start(asc_posix_loop_t* const loop);
+
+/*******************************************************************************
+ ** @brief  Stop and join worker threads
+ ** @param  loop  loop
+ ** @return none
+ ******************************************************************************/
+void asc_posix_loop_stop(asc_posix_loop_t* const loop);
+
+/*******************************************************************************
+ ** @brief  Release fds of stopped loop
+ ** @param  loop  loop
+ ** @return none
+ ******************************************************************************/
+void asc_posix_loop_deinit(asc_posix_loop_t* const loop);
+
+/*******************************************************************************
+ ** @brief  Request proc of context on its next tick, e.g. after @asc_entity_submit
+ **         from a foreign thread. Can be called from any thread
+ ** @param  entry  entry of context
+ ** @return none
+ ******************************************************************************/
+void asc_posix_loop_wake(asc_posix_loop_ctx_t* const entry);
+
+/*******************************************************************************
+ ** @brief  Write function of contexts in loop, writes to tty of the context
+ **         which is processed by the calling worker now
+ ** @param  buff  data
+ ** @param  len   length of data
+ ** @return amount of bytes accepted by tty
+ ******************************************************************************/
+uint16_t asc_posix_loop_write(uint8_t* buff, uint16_t len);
+
+/*******************************************************************************
+ ** @brief  CPU time spent by worker threads
+ ** @param  loop  loop
+ ** @return time in ns
+ ******************************************************************************/
+uint64_t asc_posix_loop_cpu_ns(asc_posix_loop_t* const loop);
+
+#endif //__ASC_POSIX_LOOP_H
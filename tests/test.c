@@ -6,8 +6,11 @@
 #include "asc_core.h" // 
 #include "o1heap.h" // 
 #include "asc_port.h" // 
+#include "asc_crit_stats.h"
 #include "asc_chain.h"  // ET: embedded test
 #include "asc_mdl_general.h"
+#include "asc_mdl_sms.h"
+#include "asc_mdl_sms_pdu.h"
 #include <stdio.h>
 
 static asc_context_t test_ctx = {0};
@@ -18,7 +21,6 @@ const uint16_t test_buffer_tail = 0;
 
 asc_ring_buffer_t asc_ring_buffer = {
   .buffer = test_buffer,
-  .count = 0,
   .head = test_buffer_head,
   .tail = test_buffer_tail,
   .size = 2048,
@@ -30,6 +32,34 @@ uint16_t test_write(uint8_t* buff, uint16_t len) {
   return 1;
 }
 
+static char test_tx_out[32] = {0};
+static uint8_t test_tx_pos = 0;
+static uint8_t test_tx_calls = 0;
+uint16_t test_write_part(uint8_t* buff, uint16_t len) { //port accepts up to 3 bytes, each second call it is busy
+  if(test_tx_calls++ % 2) return 0;
+  uint16_t res = len < 3 ? len : 3;
+  memcpy(&test_tx_out[test_tx_pos], buff, res);
+  test_tx_pos += res;
+  return res;
+}
+
+static uint8_t test_tx_done_cnt = 0;
+void testTxCB(const bool result, void* const arg)
+{
+  (void)arg;
+  VERIFY(result);
+  test_tx_done_cnt++;
+}
+
+static uint8_t test_crit_sites = 0;
+void testCritStatsCB(const asc_crit_stat_t* const stat, void* const arg)
+{
+  (void)arg;
+  test_crit_sites++;
+  if(strcmp(stat->site, "a.c:1") == 0) VERIFY(stat->cnt == 3 && stat->max == 7 && stat->hist[0] == 1 && stat->hist[3] == 2);
+  else VERIFY(stat->cnt == 1 && stat->max == 100000 && stat->hist[ASC_CRIT_STATS_BINS - 1] == 1); //out of range goes to the last bin
+}
+
 void test_printf(const char* string) {
   (void)string;
   return;
@@ -51,6 +81,23 @@ void testItemCB(ringslice_t data_slice, bool result, void* const data)
   VERIFY(strcmp(real_data->modem_imei, "5235") == 0);
 }
 
+static int test_lines_cnt = 0;
+void testLinesCB(ringslice_t data_slice, bool result, void* const data)
+{
+  (void)data;
+  VERIFY(result);
+  VERIFY(ringslice_strncmp(&data_slice, "+CENG", strlen("+CENG")) == 0);
+  ++test_lines_cnt;
+}
+
+void testSmsListCB(const asc_mdl_sms_msg_t* const sms, void* const user)
+{
+  VERIFY(user == test_buffer);
+  if(sms->index == 1)      VERIFY(strcmp(sms->num, "+79001112233") == 0 && strcmp(sms->msg, "Hello") == 0);
+  else if(sms->index == 2) VERIFY(strcmp(sms->msg, "World") == 0);
+  else                     VERIFY(sms->index == 3 && strcmp(sms->msg, "Multi\r\nline") == 0);
+}
+
 void testEntityCB(const bool result, void* const meta, const void* const data)
 {
   VERIFY(result);
@@ -59,9 +106,92 @@ void testEntityCB(const bool result, void* const meta, const void* const data)
   VERIFY(strcmp(real_data->modem_imei, "5235") == 0);
 }
 
+/* SMS-SUBMIT of the last queued segment is turned into SMS-DELIVER from the same number and decoded */
+static bool testPduDecodeSent(const asc_entity_t* const entity, asc_mdl_sms_pdu_msg_t* const msg)
+{
+  const char* hex = entity->item[entity->item_cnt - 1].req + strlen(ASC_CMD_SAVE);
+  size_t len = strlen(hex) - strlen(ASC_CMD_CTRL_Z);
+  char deliver[2 * 180] = {0};
+  unsigned int fo = 0, digits = 0;
+  sscanf(&hex[2], "%2x", &fo);
+  sscanf(&hex[6], "%2x", &digits);
+  size_t head = 2 * (2 + (digits + 1) / 2 + 2);           // OA length, TOA, OA, PID, DCS
+  snprintf(deliver, sizeof(deliver), "00%02X%.*s00000000000000%.*s", fo & 0x40, (int)head, &hex[6], (int)(len - 6 - head), &hex[6 + head]);
+  return asc_mdl_sms_pdu_decode(deliver, (uint16_t)strlen(deliver), msg);
+}
+
+static uint8_t test_rtd_cnt = 0;
+static char test_rtd_imei[16] = {0};
+void testRtdCB(const bool result, void* const meta, const void* const data)
+{
+  VERIFY(meta == test_buffer);
+  if(result) strcpy(test_rtd_imei, ((const asc_mdl_rtd_t*)data)->modem_imei);
+  test_rtd_cnt++;
+}
+
+static uint8_t test_timer_order[4] = {0};
+static uint8_t test_timer_cnt = 0;
+void testTimerCB(void* const arg)
+{
+  test_timer_order[test_timer_cnt++] = *(uint8_t*)arg;
+}
+
+static const uint8_t test_storage_key = 0;
+static uint8_t test_storage_released = 0;
+void testStorageRelease(asc_context_t* const ctx, void* const storage)
+{
+  VERIFY(!asc_get_init(ctx).init);
+  test_storage_released += *(uint8_t*)storage;
+}
+
+static char test_lane_order[8] = {0};
+void testLaneCB(const bool result, void* const meta, const void* const data)
+{
+  (void)data;
+  VERIFY(result);
+  strncat(test_lane_order, (const char*)meta, 1);
+}
+
+static char test_cancel_order[8] = {0};
+void testCancelCB(const bool result, void* const meta, const void* const data)
+{
+  (void)data;
+  strncat(test_cancel_order, (const char*)meta, 1);
+  strncat(test_cancel_order, result ? "+" : "-", 1);
+}
+
+static uint8_t test_urc_cnt = 0;
 void testUrcCB(ringslice_t urc_slice)
 {
   VERIFY(ringslice_strncmp(&urc_slice, "+TEST", strlen("TEST")) == 0);
+  test_urc_cnt++;
+}
+
+static asc_ring_buffer_t* test_urc_ring = NULL;
+static uint16_t test_urc_written = 0;
+void testUrcRingCB(ringslice_t urc_slice)
+{
+  test_urc_written += asc_ring_write(test_urc_ring, (const uint8_t*)"ZZZZ", 4); //UART ISR meanwhile
+  VERIFY(ringslice_strncmp(&urc_slice, "+A: 1", 5) == 0 || ringslice_strncmp(&urc_slice, "+B: 2", 5) == 0);
+  test_urc_cnt++;
+}
+
+static uint8_t test_event_cnt = 0;
+void testEventCB(const bool result, void* const meta, const void* const data)
+{
+  (void)meta;
+  (void)data;
+  VERIFY(!result);
+  test_event_cnt++;
+}
+
+void testDispatchCB(const bool result, void* const meta, const void* const data)
+{
+  (void)result;
+  (void)data;
+  test_event_cnt++;
+  if(meta) VERIFY(asc_entity_cancel(&test_ctx, *(asc_entity_handle_t*)meta));
+  else asc_deinit(&test_ctx);
 }
 
 bool testChainFunc(asc_context_t* const ctx, const asc_entity_cb_t cb, const void* const param, void* const meta)
@@ -82,6 +212,34 @@ bool testChainFunc(asc_context_t* const ctx, const asc_entity_cb_t cb, const voi
   return res;
 }
 
+static char test_chain_order[16] = {0};
+bool testChainOrderFunc(asc_context_t* const ctx, const asc_entity_cb_t cb, const void* const param, void* const meta)
+{
+  (void)ctx;
+  strncat(test_chain_order, (const char*)param, sizeof(test_chain_order) - strlen(test_chain_order) - 1);
+  cb(true, meta, NULL);
+  return true;
+}
+
+bool testChainFailFunc(asc_context_t* const ctx, const asc_entity_cb_t cb, const void* const param, void* const meta)
+{
+  (void)ctx;
+  (void)cb;
+  (void)meta;
+  strncat(test_chain_order, (const char*)param, sizeof(test_chain_order) - strlen(test_chain_order) - 1);
+  return false;
+}
+
+bool testChainSilentFunc(asc_context_t* const ctx, const asc_entity_cb_t cb, const void* const param, void* const meta)
+{
+  (void)param;
+  asc_item_t items[] = //[REQ][PREFIX][PARCE_TYPE][RPT][WAIT][STEPERROR][STEPOK][CB][FORMAT][...##VA_ARGS]
+  {
+    ASC_ITEM(NULL, "+TEST", ASC_PARCE_SIMCOM, 2, 150, 0, 1, NULL, NULL, ASC_NO_ARG),
+  };
+  return asc_entity_enqueue(ctx, items, 1, cb, 0, meta);
+}
+
 bool testChainCond(void)
 {
   return true;
@@ -151,10 +309,13 @@ TEST_GROUP("ATL") {
       };         
       bool res = asc_entity_enqueue(&test_ctx, items, sizeof(items)/sizeof(items[0]), NULL, sizeof(asc_mdl_rtd_t), NULL);
       VERIFY(res);
-      res = asc_entity_enqueue(&test_ctx, items, sizeof(items)/sizeof(items[0]), NULL, sizeof(asc_mdl_rtd_t), NULL);
+      asc_mdl_rtd_t prefill = {.modem_imei = "123456789012345", .sim_rssi = 17};
+      res = asc_entity_enqueue_prefill(&test_ctx, items, sizeof(items)/sizeof(items[0]), NULL, sizeof(asc_mdl_rtd_t), NULL, &prefill);
       VERIFY(res);
       asc_entity_queue_t* queue =_asc_get_entity_queue(&test_ctx);
       VERIFY(queue->entity_cnt == 2);
+      VERIFY((asc_mdl_rtd_t*){queue->entity[0].data}->sim_rssi == 0);
+      VERIFY(memcmp(queue->entity[1].data, &prefill, sizeof(prefill)) == 0);
       VERIFY(queue->entity[0].item_cnt == sizeof(items)/sizeof(items[0]));
       VERIFY(queue->entity[1].item_cnt == sizeof(items)/sizeof(items[0]));
       VERIFY(queue->entity[0].data);
@@ -602,7 +763,6 @@ TEST_GROUP("ATL") {
 
       asc_ring_buffer_t ring = {
         .buffer = (uint8_t*)parce_buffer,
-        .count = 0,
         .head = parce_buffer_head,
         .tail = parce_buffer_tail,
         .size = 2048,
@@ -630,7 +790,6 @@ TEST_GROUP("ATL") {
 
       asc_ring_buffer_t ring = {
         .buffer = (uint8_t*)parce_buffer,
-        .count = 0,
         .head = parce_buffer_head,
         .tail = parce_buffer_tail,
         .size = 2048,
@@ -658,7 +817,6 @@ TEST_GROUP("ATL") {
 
       asc_ring_buffer_t ring = {
         .buffer = (uint8_t*)parce_buffer,
-        .count = 0,
         .head = parce_buffer_head,
         .tail = parce_buffer_tail,
         .size = 2048,
@@ -685,7 +843,6 @@ TEST_GROUP("ATL") {
 
       asc_ring_buffer_t ring = {
         .buffer = (uint8_t*)parce_buffer,
-        .count = 0,
         .head = parce_buffer_head,
         .tail = parce_buffer_tail,
         .size = 2048,
@@ -712,7 +869,6 @@ TEST_GROUP("ATL") {
 
       asc_ring_buffer_t ring = {
         .buffer = (uint8_t*)parce_buffer,
-        .count = 0,
         .head = parce_buffer_head,
         .tail = parce_buffer_tail,
         .size = 2048,
@@ -739,7 +895,6 @@ TEST_GROUP("ATL") {
 
       asc_ring_buffer_t ring = {
         .buffer = (uint8_t*)parce_buffer,
-        .count = 0,
         .head = parce_buffer_head,
         .tail = parce_buffer_tail,
         .size = 2048,
@@ -766,7 +921,6 @@ TEST_GROUP("ATL") {
 
       asc_ring_buffer_t ring = {
         .buffer = (uint8_t*)parce_buffer,
-        .count = 0,
         .head = parce_buffer_head,
         .tail = parce_buffer_tail,
         .size = 2048,
@@ -793,7 +947,6 @@ TEST_GROUP("ATL") {
 
       asc_ring_buffer_t ring = {
         .buffer = (uint8_t*)parce_buffer,
-        .count = 0,
         .head = parce_buffer_head,
         .tail = parce_buffer_tail,
         .size = 2048,
@@ -820,7 +973,6 @@ TEST_GROUP("ATL") {
 
       asc_ring_buffer_t ring = {
         .buffer = (uint8_t*)parce_buffer,
-        .count = 0,
         .head = parce_buffer_head,
         .tail = parce_buffer_tail,
         .size = 2048,
@@ -847,7 +999,6 @@ TEST_GROUP("ATL") {
 
       asc_ring_buffer_t ring = {
         .buffer = (uint8_t*)parce_buffer,
-        .count = 0,
         .head = parce_buffer_head,
         .tail = parce_buffer_tail,
         .size = 2048,
@@ -867,6 +1018,230 @@ TEST_GROUP("ATL") {
       VERIFY(!_asc_get_init(&test_ctx).init);
     }   
 
+  TEST("asc_cmd_ring_parcer() SIMCOM batch") {
+      char parce_buffer[2048] = "AT+GSN;+GMM;+CSQ\r\r\n5235\r\n\r\nSIM868\r\n\r\n+CSQ: 17,0\r\n\r\nOK\r\nFFFFFFF";
+      uint16_t parce_buffer_tail = 0;
+      uint16_t parce_buffer_head = strlen(parce_buffer);
+
+      asc_ring_buffer_t ring = {
+        .buffer = (uint8_t*)parce_buffer,
+        .head = parce_buffer_head,
+        .tail = parce_buffer_tail,
+        .size = 2048,
+      };
+      asc_init(&test_ctx, test_printf, test_write, &ring);
+      asc_item_t items[] = //[REQ][PREFIX][PARCE_TYPE][RPT][WAIT][STEPERROR][STEPOK][CB][FORMAT][...##VA_ARGS]
+      {
+        ASC_ITEM_BATCH(3, 2, 150, 0, 1),
+        ASC_ITEM("AT+GSN"ASC_CMD_CRLF,   NULL, ASC_PARCE_SIMCOM, 2, 150, 0, 1, testItemCB, "%4[^\x0d]", ASC_ARG(asc_mdl_rtd_t, modem_imei)),
+        ASC_ITEM("AT+GMM"ASC_CMD_CRLF,   NULL, ASC_PARCE_SIMCOM, 2, 150, 0, 1, NULL,      "%15[^\x0d]", ASC_ARG(asc_mdl_rtd_t, modem_id)),
+        ASC_ITEM("AT+CSQ"ASC_CMD_CRLF, "+CSQ", ASC_PARCE_SIMCOM, 2, 150, 0, 1, NULL,        "+CSQ: %d", ASC_ARG(asc_mdl_rtd_t, sim_rssi)),
+      };
+      bool res = asc_entity_enqueue(&test_ctx, items, sizeof(items)/sizeof(items[0]), NULL, sizeof(asc_mdl_rtd_t), test_buffer);
+      VERIFY(res);
+      asc_entity_queue_t* queue =_asc_get_entity_queue(&test_ctx);
+      VERIFY(strcmp(queue->entity[0].item[0].req, ASC_CMD_SAVE"AT+GSN;+GMM;+CSQ"ASC_CMD_CRLF) == 0);
+      ringslice_t rs_me = ringslice_initializer((uint8_t*)parce_buffer, 2048, parce_buffer_tail, parce_buffer_head);
+      int res_p = _asc_cmd_ring_parcer(&test_ctx, &queue->entity[0], &queue->entity->item[0], rs_me);
+      VERIFY(res_p);
+      asc_mdl_rtd_t* rtd = (asc_mdl_rtd_t*)queue->entity[0].data;
+      VERIFY(strcmp(rtd->modem_id, "SIM868") == 0);
+      VERIFY(rtd->sim_rssi == 17);
+      asc_deinit(&test_ctx);
+      VERIFY(!_asc_get_init(&test_ctx).init);
+    }
+
+  TEST("asc_cmd_ring_parcer() SIMCOM lines") {
+      char parce_buffer[2048] = "AT+CENG?\r\r\n+CENG: 3,0\r\n\r\n+CENG: 0,\"250,01,1a2b,3c4d,45\"\r\nNOISE\r\n+CENG: 1,\"250,01,1a2c,3c4e,40\"\r\n\r\nOK\r\nFFFFFFF";
+      uint16_t parce_buffer_tail = 0;
+      uint16_t parce_buffer_head = strlen(parce_buffer);
+
+      asc_ring_buffer_t ring = {
+        .buffer = (uint8_t*)parce_buffer,
+        .head = parce_buffer_head,
+        .tail = parce_buffer_tail,
+        .size = 2048,
+      };
+      asc_init(&test_ctx, test_printf, test_write, &ring);
+      asc_item_t items[] = //[REQ][PREFIX][PARCE_TYPE][RPT][WAIT][STEPERROR][STEPOK][CB][FORMAT][...##VA_ARGS]
+      {
+        ASC_ITEM("AT+CENG?"ASC_CMD_CRLF, "+CENG", ASC_PARCE_SIMCOM_LINES, 2, 150, 0, 1, testLinesCB, NULL, ASC_NO_ARG),
+      };
+      bool res = asc_entity_enqueue(&test_ctx, items, sizeof(items)/sizeof(items[0]), NULL, sizeof(asc_mdl_rtd_t), NULL);
+      VERIFY(res);
+      asc_entity_queue_t* queue =_asc_get_entity_queue(&test_ctx);
+      ringslice_t rs_me = ringslice_initializer((uint8_t*)parce_buffer, 2048, parce_buffer_tail, parce_buffer_head);
+      test_lines_cnt = 0;
+      int res_p = _asc_cmd_ring_parcer(&test_ctx, &queue->entity[0], &queue->entity->item[0], rs_me);
+      VERIFY(res_p);
+      VERIFY(test_lines_cnt == 3);
+      asc_deinit(&test_ctx);
+      VERIFY(!_asc_get_init(&test_ctx).init);
+    }
+
+  TEST("asc_mdl_sms_list() streaming CMGL") {
+      char parce_buffer[2048] = "AT+CMGL=\"ALL\"\r\r\n+CMGL: 1,\"REC UNREAD\",\"+79001112233\",\"\",\"25/01/01,12:00:00+12\"\r\nHello\r\n"
+                                "+CMGL: 2,\"REC READ\",\"+79004445566\",\"\",\"25/01/01,12:01:00+12\"\r\nWorld\r\n"
+                                "+CMGL: 3,\"REC READ\",\"+79004445566\",\"\",\"25/01/01,12:02:00+12\"\r\nMulti\r\nline\r\n\r\nOK\r\nFFFFFFF";
+      uint16_t parce_buffer_tail = 0;
+      uint16_t parce_buffer_head = strlen(parce_buffer);
+
+      asc_ring_buffer_t ring = {
+        .buffer = (uint8_t*)parce_buffer,
+        .head = parce_buffer_head,
+        .tail = parce_buffer_tail,
+        .size = 2048,
+      };
+      asc_init(&test_ctx, test_printf, test_write, &ring);
+      asc_mdl_sms_list_t list = {NULL, 4, testSmsListCB, test_buffer, 0};
+      bool res = asc_mdl_sms_list(&test_ctx, NULL, &list, NULL);
+      VERIFY(res);
+      asc_entity_queue_t* queue =_asc_get_entity_queue(&test_ctx);
+      VERIFY(queue->entity[0].item_cnt == 3);
+      VERIFY(strcmp(queue->entity[0].item[2].req, ASC_CMD_SAVE"AT+CMGD=1,4"ASC_CMD_CRLF) == 0);
+      ringslice_t rs_me = ringslice_initializer((uint8_t*)parce_buffer, 2048, parce_buffer_tail, parce_buffer_head);
+      int res_p = _asc_cmd_ring_parcer(&test_ctx, &queue->entity[0], &queue->entity->item[1], rs_me);
+      VERIFY(res_p);
+      VERIFY(list.cnt == 2); //text of the last one can go on till the end of the list
+      queue->entity[0].cb(true, queue->entity[0].meta, queue->entity[0].data);
+      VERIFY(list.cnt == 3);
+      asc_deinit(&test_ctx);
+      VERIFY(!_asc_get_init(&test_ctx).init);
+    }
+
+  TEST("asc_mdl_sms_pdu_send()/asc_mdl_sms_pdu_decode()") {
+      asc_init(&test_ctx, test_printf, test_write, &asc_ring_buffer);
+      asc_entity_queue_t* queue =_asc_get_entity_queue(&test_ctx);
+      asc_mdl_sms_pdu_t pdu = {.num = "+79001112233", .data = (const uint8_t*)"hellohello", .len = 10, .dcs = ASC_MDL_SMS_PDU_GSM7};
+      bool res = asc_mdl_sms_pdu_send(&test_ctx, testEntityCB, &pdu, test_buffer);
+      VERIFY(res);
+      VERIFY(pdu.seg_cnt == 1);
+      VERIFY(queue->entity[0].item_cnt == 3);
+      VERIFY(strcmp(queue->entity[0].item[1].req, ASC_CMD_SAVE"AT+CMGS=22"ASC_CMD_CRLF) == 0);
+      VERIFY(strcmp(queue->entity[0].item[2].req, ASC_CMD_SAVE"0001000B919700112132F300000AE8329BFD4697D9EC37"ASC_CMD_CTRL_Z) == 0);
+      asc_mdl_sms_pdu_msg_t msg;
+      const char* deliver = "07917283010010F5040BC87238880900F10000993092516195800AE8329BFD4697D9EC37";
+      VERIFY(asc_mdl_sms_pdu_decode(deliver, strlen(deliver), &msg));
+      VERIFY(strcmp(msg.num, "27838890001") == 0);
+      VERIFY(msg.len == 10);
+      VERIFY(strcmp((char*)msg.data, "hellohello") == 0);
+      VERIFY(msg.total == 0);
+      asc_entity_dequeue(&test_ctx);
+      asc_deinit(&test_ctx);
+      VERIFY(!_asc_get_init(&test_ctx).init);
+    }
+
+  TEST("asc_mdl_sms_pdu_send() concatenation with escape at segment boundary") {
+      asc_init(&test_ctx, test_printf, test_write, &asc_ring_buffer);
+      asc_entity_queue_t* queue =_asc_get_entity_queue(&test_ctx);
+      char text[180] = {0};
+      memset(text, 'a', 152);
+      text[152] = '[';                                     // 2 septets, doesn't fit into 153 of the first segment
+      memset(&text[153], 'b', 20);
+      asc_mdl_sms_pdu_t pdu = {.num = "+79001112233", .data = (const uint8_t*)text, .len = 173, .dcs = ASC_MDL_SMS_PDU_GSM7, .ref = 0x42};
+      VERIFY(asc_mdl_sms_pdu_send(&test_ctx, NULL, &pdu, NULL));
+      VERIFY(pdu.seg_cnt == 2);
+      VERIFY(pdu.seg_off[1] == 152 && pdu.seg_off[2] == 173);
+      char joined[180] = {0};
+      for(uint8_t seg = 0; seg < pdu.seg_cnt; seg++)
+      {
+        asc_mdl_sms_pdu_msg_t msg;
+        VERIFY(testPduDecodeSent(&queue->entity[0], &msg));
+        VERIFY(strcmp(queue->entity[0].item[0].req, "AT+CMGF=0"ASC_CMD_CRLF) == 0 && queue->entity[0].nopreempt); //text mode can be set between segments
+        VERIFY(msg.ref == 0x42 && msg.total == 2 && msg.seq == seg + 1);
+        VERIFY(msg.len == pdu.seg_off[seg + 1] - pdu.seg_off[seg]);
+        strcat(joined, (char*)msg.data);
+        asc_entity_cb_t cb = queue->entity[0].cb;
+        void* meta = queue->entity[0].meta;
+        asc_entity_dequeue(&test_ctx);
+        cb(true, meta, NULL);                                // queues the next segment
+      }
+      VERIFY(strcmp(joined, text) == 0);
+      VERIFY(queue->entity_cnt == 0);
+      asc_deinit(&test_ctx);
+      VERIFY(!_asc_get_init(&test_ctx).init);
+    }
+
+  TEST("asc_mdl_sms_pdu_send()/asc_mdl_sms_pdu_decode() UCS2 and 8 bit") {
+      asc_init(&test_ctx, test_printf, test_write, &asc_ring_buffer);
+      asc_entity_queue_t* queue =_asc_get_entity_queue(&test_ctx);
+      const char* text = "\xD0\x9F\xD1\x80\xD0\xB8\xD0\xB2\xD0\xB5\xD1\x82 \xE2\x82\xAC"; // "Привет €"
+      asc_mdl_sms_pdu_t pdu = {.num = "+79001112233", .data = (const uint8_t*)text, .len = (uint16_t)strlen(text), .dcs = ASC_MDL_SMS_PDU_UCS2};
+      VERIFY(asc_mdl_sms_pdu_send(&test_ctx, NULL, &pdu, NULL));
+      VERIFY(pdu.seg_cnt == 1);
+      VERIFY(strstr(queue->entity[0].item[2].req, "000810041F04400438043204350442002020AC"ASC_CMD_CTRL_Z));
+      asc_mdl_sms_pdu_msg_t msg;
+      VERIFY(testPduDecodeSent(&queue->entity[0], &msg));
+      VERIFY(msg.dcs == ASC_MDL_SMS_PDU_UCS2 && msg.total == 0);
+      VERIFY(msg.len == strlen(text) && strcmp((char*)msg.data, text) == 0);
+      asc_entity_dequeue(&test_ctx);
+      const uint8_t bin[] = {0x00, 0xFF, 0x1B, 0x80};
+      asc_mdl_sms_pdu_t pdu_bin = {.num = "79001112233", .data = bin, .len = sizeof(bin), .dcs = ASC_MDL_SMS_PDU_8BIT};
+      VERIFY(asc_mdl_sms_pdu_send(&test_ctx, NULL, &pdu_bin, NULL));
+      VERIFY(strstr(queue->entity[0].item[2].req, "00040400FF1B80"ASC_CMD_CTRL_Z));
+      VERIFY(testPduDecodeSent(&queue->entity[0], &msg));
+      VERIFY(msg.dcs == ASC_MDL_SMS_PDU_8BIT && strcmp(msg.num, "79001112233") == 0);
+      VERIFY(msg.len == sizeof(bin) && memcmp(msg.data, bin, sizeof(bin)) == 0);
+      asc_entity_dequeue(&test_ctx);
+      char deliver[2 * 180] = "00040B919700112132F3000800000000000000"; // UCS2, UDL 156 > 140
+      strcat(deliver, "9C");
+      for(uint8_t i = 0; i < 78; i++) strcat(deliver, "FFFF");
+      VERIFY(!asc_mdl_sms_pdu_decode(deliver, (uint16_t)strlen(deliver), &msg));
+      deliver[38] = '8'; deliver[39] = 'C';                 // UDL 140 of 156 fits
+      VERIFY(asc_mdl_sms_pdu_decode(deliver, (uint16_t)strlen(deliver), &msg));
+      VERIFY(msg.len == 70 * 3 && msg.len < sizeof(msg.data));
+      asc_deinit(&test_ctx);
+      VERIFY(!_asc_get_init(&test_ctx).init);
+    }
+
+  TEST("asc_mdl_rtd_delta()/asc_storage_get() static identity cache") {
+      asc_init(&test_ctx, test_printf, test_write, &asc_ring_buffer);
+      asc_entity_queue_t* queue =_asc_get_entity_queue(&test_ctx);
+      test_rtd_cnt = 0;
+      bool res = asc_mdl_rtd_delta(&test_ctx, testRtdCB, NULL, test_buffer);
+      VERIFY(res);
+      VERIFY(!asc_mdl_rtd_delta(&test_ctx, testRtdCB, NULL, test_buffer));
+      VERIFY(queue->entity[0].item_cnt == 10);
+      VERIFY(strcmp(queue->entity[0].item[0].req, ASC_CMD_SAVE"AT+GSN;+GMM;+GMR;+CCID;+CCLK?;+COPS?;+CSQ"ASC_CMD_CRLF) == 0);
+      strcpy((asc_mdl_rtd_t*){queue->entity[0].data}->modem_imei, "5235");
+      queue->entity[0].cb(true, queue->entity[0].meta, queue->entity[0].data);
+      VERIFY(test_rtd_cnt == 1 && strcmp(test_rtd_imei, "5235") == 0);
+      asc_entity_dequeue(&test_ctx);
+      res = asc_mdl_rtd_delta(&test_ctx, testRtdCB, NULL, test_buffer);
+      VERIFY(res);
+      VERIFY(queue->entity[0].item_cnt == 5);
+      VERIFY(strcmp(queue->entity[0].item[0].req, ASC_CMD_SAVE"AT+CCLK?;+COPS?;+CSQ"ASC_CMD_CRLF) == 0);
+      VERIFY(strcmp(queue->entity[0].item[4].req, "AT+CENG?"ASC_CMD_CRLF) == 0);
+      memset(test_rtd_imei, 0, sizeof(test_rtd_imei));
+      queue->entity[0].cb(true, queue->entity[0].meta, queue->entity[0].data);
+      VERIFY(test_rtd_cnt == 2 && strcmp(test_rtd_imei, "5235") == 0); //IMEI is not polled, it comes from the cache
+      asc_entity_dequeue(&test_ctx);
+      asc_mdl_rtd_field_t fields = ASC_MDL_RTD_IMEI;
+      VERIFY(asc_mdl_rtd_delta(&test_ctx, testRtdCB, &fields, test_buffer)); //everything is in cache, cb at once
+      VERIFY(test_rtd_cnt == 3 && !queue->entity_cnt);
+      VERIFY(asc_mdl_rtd_delta(&test_ctx, testRtdCB, NULL, test_buffer));
+      asc_mdl_rtd_delta_reset(&test_ctx); //request in progress is stale, busy is dropped
+      VERIFY(asc_mdl_rtd_delta(&test_ctx, testRtdCB, NULL, test_buffer));
+      VERIFY(queue->entity[1].item_cnt == 10);
+      queue->entity[0].cb(true, queue->entity[0].meta, queue->entity[0].data);
+      VERIFY(test_rtd_cnt == 4 && !asc_mdl_rtd_delta(&test_ctx, testRtdCB, NULL, test_buffer)); //stale answer doesn't free the new request
+      uint8_t* storage = asc_storage_get(&test_ctx, &test_storage_key, 1, testStorageRelease);
+      VERIFY(storage && *storage == 0);
+      *storage = 7;
+      VERIFY(asc_storage_get(&test_ctx, &test_storage_key, 0, NULL) == storage);
+      VERIFY(!asc_storage_get(&test_ctx, test_buffer, 1, NULL)); //slots are taken by the cache and by the test
+      test_storage_released = 0;
+      asc_deinit(&test_ctx);
+      VERIFY(!_asc_get_init(&test_ctx).init);
+      VERIFY(test_storage_released == 7);
+      asc_init(&test_ctx, test_printf, test_write, &asc_ring_buffer);
+      VERIFY(!asc_storage_get(&test_ctx, &test_storage_key, 0, NULL));
+      VERIFY(asc_mdl_rtd_delta(&test_ctx, testRtdCB, NULL, test_buffer)); //cache is dropped with context, nothing is busy
+      VERIFY(queue->entity[0].item_cnt == 10);
+      asc_deinit(&test_ctx);
+      VERIFY(!_asc_get_init(&test_ctx).init);
+    }
+
   TEST("asc_process_urcs()") {
       char parce_buffer[2048] = "\r\n+TEST: 523566, text\r\nFFFFFFFFFFF";
       uint16_t parce_buffer_tail = 0;
@@ -874,7 +1249,6 @@ TEST_GROUP("ATL") {
 
       asc_ring_buffer_t ring = {
         .buffer = (uint8_t*)parce_buffer,
-        .count = 0,
         .head = parce_buffer_head,
         .tail = parce_buffer_tail,
         .size = 2048,
@@ -888,6 +1262,29 @@ TEST_GROUP("ATL") {
       VERIFY(!_asc_get_init(&test_ctx).init);
     }
 
+  TEST("asc_process_urcs() rx ring is nearly full while urc is handled") {
+      char parce_buffer[32] = "\r\n+A: 1\r\n\r\n+B: 2\r\nxxxxxxxxxxxx"; //30 of 31 bytes are used
+      asc_ring_buffer_t ring = {
+        .buffer = (uint8_t*)parce_buffer,
+        .head = 30,
+        .tail = 0,
+        .size = 32,
+      };
+      asc_init(&test_ctx, test_printf, test_write, &ring);
+      asc_urc_queue_t urc_b = {"+B", testUrcRingCB};
+      asc_urc_queue_t urc_a = {"+A", testUrcRingCB};
+      asc_urc_enqueue(&test_ctx, &urc_b); //later in the ring, but checked first
+      asc_urc_enqueue(&test_ctx, &urc_a);
+      test_urc_ring = &ring;
+      test_urc_cnt = 0;
+      test_urc_written = 0;
+      while(test_urc_cnt < 2) _asc_core_proc(&test_ctx);
+      VERIFY(test_urc_written == 1); //place of urcs is released only when both cbs are done
+      VERIFY(ring.tail == 13);       //end of the furthest urc, never backwards
+      asc_deinit(&test_ctx);
+      VERIFY(!_asc_get_init(&test_ctx).init);
+    }
+
   TEST("asc_core_proc() first cmd fail, second success") {
       char parce_buffer[2048] = "\r\n+TEST: 523566, text\r\nFFFFFFFFFFF";
       uint16_t parce_buffer_tail = 0;
@@ -895,7 +1292,6 @@ TEST_GROUP("ATL") {
 
       asc_ring_buffer_t ring = {
         .buffer = (uint8_t*)parce_buffer,
-        .count = 0,
         .head = parce_buffer_head,
         .tail = parce_buffer_tail,
         .size = 2048,
@@ -916,6 +1312,348 @@ TEST_GROUP("ATL") {
       asc_deinit(&test_ctx);
       VERIFY(!_asc_get_init(&test_ctx).init);
     }
+
+  TEST("asc_entity_lane_set() preemption between cmds of group") {
+      char parce_buffer[2048] = "\r\n+TEST: 523566, text\r\nFFFFFFFFFFF";
+      asc_ring_buffer_t ring = {
+        .buffer = (uint8_t*)parce_buffer,
+        .head = strlen(parce_buffer),
+        .tail = 0,
+        .size = 2048,
+      };
+      asc_init(&test_ctx, test_printf, test_write, &ring);
+      asc_item_t items[] = //[REQ][PREFIX][PARCE_TYPE][RPT][WAIT][STEPERROR][STEPOK][CB][FORMAT][...##VA_ARGS]
+      {
+        ASC_ITEM(NULL, "+TEST", ASC_PARCE_SIMCOM, 2, 150, 0, 1, NULL, NULL, ASC_NO_ARG),
+        ASC_ITEM(NULL, "+TEST", ASC_PARCE_SIMCOM, 2, 150, 0, 1, NULL, NULL, ASC_NO_ARG),
+      };
+      test_lane_order[0] = 0;
+      VERIFY(asc_entity_enqueue(&test_ctx, items, 2, testLaneCB, 0, "N"));
+      _asc_core_proc(&test_ctx); //write of first cmd
+      VERIFY(asc_entity_lane_set(&test_ctx, 0) == ASC_ENTITY_LANE_DEFAULT);
+      VERIFY(asc_entity_enqueue(&test_ctx, items, 1, testLaneCB, 0, "U"));
+      VERIFY(asc_entity_lane_set(&test_ctx, ASC_ENTITY_LANE_DEFAULT) == 0);
+      asc_entity_queue_t* queue =_asc_get_entity_queue(&test_ctx);
+      _asc_core_proc(&test_ctx); //answer of first cmd, urgent one waits for it
+      VERIFY(queue->entity[0].item_id == 1 && queue->entity_cur == 0);
+      _asc_core_proc(&test_ctx); //preemption before second cmd
+      VERIFY(queue->entity_cur == 1 && queue->entity[0].item_id == 1);
+      while(queue->entity_cnt) _asc_core_proc(&test_ctx);
+      VERIFY(strcmp(test_lane_order, "UN") == 0);
+      asc_entity_lane_stats_t stats = asc_entity_lane_stats(&test_ctx, ASC_ENTITY_LANE_DEFAULT);
+      VERIFY(stats.cnt == 1 && stats.preempt_cnt == 1);
+      stats = asc_entity_lane_stats(&test_ctx, 0);
+      VERIFY(stats.cnt == 1 && stats.preempt_cnt == 0 && stats.wait_max_ms == 2 * ASC_CORE_TICK_MS);
+      test_lane_order[0] = 0;
+      VERIFY(!asc_entity_nopreempt_set(&test_ctx, true));
+      VERIFY(asc_entity_enqueue(&test_ctx, items, 2, testLaneCB, 0, "N"));
+      VERIFY(asc_entity_nopreempt_set(&test_ctx, false));
+      _asc_core_proc(&test_ctx); //write of first cmd
+      asc_entity_lane_set(&test_ctx, 0);
+      VERIFY(asc_entity_enqueue(&test_ctx, items, 1, testLaneCB, 0, "U"));
+      asc_entity_lane_set(&test_ctx, ASC_ENTITY_LANE_DEFAULT);
+      while(queue->entity_cnt) _asc_core_proc(&test_ctx);
+      VERIFY(strcmp(test_lane_order, "NU") == 0); //second cmd relies on the first one, group isn't preempted
+      VERIFY(asc_entity_lane_stats(&test_ctx, ASC_ENTITY_LANE_DEFAULT).preempt_cnt == 1);
+      asc_deinit(&test_ctx);
+      VERIFY(!_asc_get_init(&test_ctx).init);
+    }
+
+  TEST("asc_entity_cancel()/asc_entity_deadline_set() bounded groups") {
+      char parce_buffer[64] = {0}; //modem is silent
+      asc_ring_buffer_t ring = {
+        .buffer = (uint8_t*)parce_buffer,
+        .head = 0,
+        .tail = 0,
+        .size = 64,
+      };
+      asc_init(&test_ctx, test_printf, test_write, &ring);
+      asc_item_t items[] = //[REQ][PREFIX][PARCE_TYPE][RPT][WAIT][STEPERROR][STEPOK][CB][FORMAT][...##VA_ARGS]
+      {
+        ASC_ITEM(NULL, "+TEST", ASC_PARCE_SIMCOM, 2, 150, 0, 1, NULL, NULL, ASC_NO_ARG),
+      };
+      test_cancel_order[0] = 0;
+      asc_entity_handle_t tracked = ASC_ENTITY_HANDLE_NONE;
+      VERIFY(asc_entity_track_set(&test_ctx, &tracked) == NULL);
+      asc_entity_handle_t first = asc_entity_enqueue(&test_ctx, items, 1, testCancelCB, 0, "A");
+      VERIFY(tracked == first);
+      VERIFY(asc_entity_track_set(&test_ctx, NULL) == &tracked);
+      asc_entity_handle_t second = asc_entity_enqueue(&test_ctx, items, 1, testCancelCB, 0, "B");
+      VERIFY(first != ASC_ENTITY_HANDLE_NONE && second != ASC_ENTITY_HANDLE_NONE && first != second);
+      VERIFY(tracked == first); //not stored after the slot is cleared
+      VERIFY(asc_entity_last(&test_ctx) == second);
+      VERIFY(asc_entity_cancel(&test_ctx, second));
+      VERIFY(!asc_entity_cancel(&test_ctx, second)); //stale handle
+      VERIFY(strcmp(test_cancel_order, "B-") == 0);
+      asc_entity_queue_t* queue =_asc_get_entity_queue(&test_ctx);
+      VERIFY(queue->entity_cnt == 1);
+      uint32_t start = asc_get_cur_time_ms(&test_ctx);
+      VERIFY(asc_entity_deadline_set(&test_ctx, first, start + 200));
+      while(queue->entity_cnt) _asc_core_proc(&test_ctx);
+      VERIFY(asc_get_cur_time_ms(&test_ctx) - start == 200); //instead of 2 * 1500 ms of retries
+      VERIFY(strcmp(test_cancel_order, "B-A-") == 0);
+      VERIFY(!asc_entity_cancel(&test_ctx, first));
+      VERIFY(asc_entity_enqueue(&test_ctx, items, 1, testCancelCB, 0, "C") != first); //place is reused with new handle
+      asc_deinit(&test_ctx);
+      VERIFY(!_asc_get_init(&test_ctx).init);
+    }
+
+  TEST("asc_entity_cancel() of cmd in progress keeps urcs after its answer") {
+      char parce_buffer[64] = "AT+CSQ\r\r\n+CSQ: 20,0\r\n\r\nOK\r\n\r\n+TEST: 1\r\n";
+      asc_ring_buffer_t ring = {
+        .buffer = (uint8_t*)parce_buffer,
+        .head = 0,
+        .tail = 0,
+        .size = 64,
+      };
+      asc_init(&test_ctx, test_printf, test_write, &ring);
+      asc_item_t items[] = //[REQ][PREFIX][PARCE_TYPE][RPT][WAIT][STEPERROR][STEPOK][CB][FORMAT][...##VA_ARGS]
+      {
+        ASC_ITEM("AT+CSQ\r\n", "+CSQ", ASC_PARCE_SIMCOM, 1, 150, 0, 1, NULL, NULL, ASC_NO_ARG),
+      };
+      asc_entity_handle_t handle = asc_entity_enqueue(&test_ctx, items, 1, testCancelCB, 0, "A");
+      asc_entity_t* entity = &_asc_get_entity_queue(&test_ctx)->entity[0];
+      while(entity->state != ASC_STATE_READ) _asc_core_proc(&test_ctx);
+      ring.head = (uint16_t)strlen(parce_buffer); //answer and urc come at once
+      test_cancel_order[0] = 0;
+      VERIFY(asc_entity_cancel(&test_ctx, handle));
+      VERIFY(strcmp(test_cancel_order, "A-") == 0);
+      VERIFY(test_ctx.rx_read == strstr(parce_buffer, "OK") + 4 - parce_buffer); //only the answer is dropped
+      asc_urc_queue_t urc = {"+TEST", testUrcCB};
+      asc_urc_enqueue(&test_ctx, &urc);
+      test_urc_cnt = 0;
+      for(uint8_t i = 0; i <= ASC_URC_FREQ_CHECK && !test_urc_cnt; i++) _asc_core_proc(&test_ctx);
+      VERIFY(test_urc_cnt == 1);
+      VERIFY(ring.tail == strstr(parce_buffer, "+TEST") + 5 - parce_buffer);
+      asc_deinit(&test_ctx);
+      VERIFY(!_asc_get_init(&test_ctx).init);
+    }
+
+  TEST("asc_timer_start()/asc_timer_stop() timer wheel") {
+      asc_init(&test_ctx, test_printf, test_write, &asc_ring_buffer);
+      static uint8_t ids[] = {1, 2, 3, 4};
+      asc_timer_t timers[4] = {0};
+      test_timer_cnt = 0;
+      asc_timer_start(&test_ctx, &timers[0], 1500, testTimerCB, &ids[0]);
+      asc_timer_start(&test_ctx, &timers[1], 5, testTimerCB, &ids[1]);       //rounded up to one tick
+      asc_timer_start(&test_ctx, &timers[2], 700000, testTimerCB, &ids[2]);  //out of the wheel range
+      asc_timer_start(&test_ctx, &timers[3], 300, testTimerCB, &ids[3]);
+      VERIFY(asc_timer_left_ms(&test_ctx, &timers[1]) == ASC_CORE_TICK_MS);
+      VERIFY(asc_timer_left_ms(&test_ctx, &timers[0]) == 1500);
+      asc_timer_stop(&test_ctx, &timers[3]);
+      VERIFY(!asc_timer_is_active(&timers[3]));
+      VERIFY(asc_timer_left_ms(&test_ctx, &timers[3]) == 0);
+      uint32_t start = asc_get_cur_time_ms(&test_ctx);
+      while(test_timer_cnt < 2) _asc_core_proc(&test_ctx);
+      VERIFY(asc_get_cur_time_ms(&test_ctx) - start == 1500);
+      VERIFY(test_timer_order[0] == 2 && test_timer_order[1] == 1);
+      while(test_timer_cnt < 3) _asc_core_proc(&test_ctx);
+      VERIFY(asc_get_cur_time_ms(&test_ctx) - start == 700000);
+      VERIFY(test_timer_order[2] == 3);
+      VERIFY(!asc_timer_is_active(&timers[0]) && !asc_timer_is_active(&timers[2]));
+      asc_core_advance(&test_ctx, 100);                                     //wheel lags till the next proc
+      asc_timer_start(&test_ctx, &timers[1], 5 * ASC_CORE_TICK_MS, testTimerCB, &ids[1]);
+      VERIFY(asc_timer_left_ms(&test_ctx, &timers[1]) == 5 * ASC_CORE_TICK_MS);
+      _asc_core_proc(&test_ctx);
+      VERIFY(test_timer_cnt == 3 && asc_timer_left_ms(&test_ctx, &timers[1]) == 4 * ASC_CORE_TICK_MS);
+      while(test_timer_cnt < 4) _asc_core_proc(&test_ctx);
+      VERIFY(asc_get_cur_time_ms(&test_ctx) - start == 700000 + 105 * ASC_CORE_TICK_MS);
+      asc_deinit(&test_ctx);
+      VERIFY(!_asc_get_init(&test_ctx).init);
+    }
+
+  TEST("asc_ring_write()/asc_ring_count() SPSC rx ring") {
+      uint8_t buffer[8] = {0};
+      asc_ring_buffer_t ring = {
+        .buffer = buffer,
+        .head = 0,
+        .tail = 0,
+        .size = 8,
+      };
+      VERIFY(asc_ring_write(&ring, (const uint8_t*)"ABCDE", 5) == 5);
+      VERIFY(asc_ring_count(&ring) == 5 && ring.head == 5);
+      ring.tail = 4; //core processed "ABCD"
+      VERIFY(asc_ring_write(&ring, (const uint8_t*)"FGHIJKL", 7) == 6); //one byte is kept free, "L" is dropped
+      VERIFY(asc_ring_count(&ring) == 7 && ring.head == 3);
+      VERIFY(memcmp(buffer, "IJKDEFGH", 8) == 0);
+      VERIFY(asc_ring_write(&ring, (const uint8_t*)"X", 1) == 0); //full
+      ring.tail = ring.head; //core dropped all
+      VERIFY(asc_ring_count(&ring) == 0);
+    }
+
+  TEST("asc_crit_stats_add()/asc_crit_stats_dump() hold time histogram") {
+      static const char site_a[] = "a.c:1";
+      static const char site_b[] = "b.c:2";
+      asc_crit_stats_reset();
+      asc_crit_stats_add(site_a, 0);
+      asc_crit_stats_add(site_a, 5);
+      asc_crit_stats_add(site_b, 100000);
+      asc_crit_stats_add(site_a, 7);
+      test_crit_sites = 0;
+      VERIFY(asc_crit_stats_dump(testCritStatsCB, NULL) == 2 && test_crit_sites == 2);
+      asc_crit_stats_reset();
+      VERIFY(asc_crit_stats_dump(testCritStatsCB, NULL) == 0);
+    }
+
+  TEST("asc_tx_submit() partial writes and answer timeout after tx complete") {
+      char parce_buffer[64] = {0}; //modem is silent
+      asc_ring_buffer_t ring = {
+        .buffer = (uint8_t*)parce_buffer,
+        .head = 0,
+        .tail = 0,
+        .size = 64,
+      };
+      asc_init(&test_ctx, test_printf, test_write_part, &ring);
+      asc_tx_t tx[2] = {0};
+      VERIFY(asc_tx_submit(&test_ctx, &tx[0], (const uint8_t*)"HELLO", 5, testTxCB, NULL));
+      VERIFY(!asc_tx_submit(&test_ctx, &tx[0], (const uint8_t*)"HELLO", 5, testTxCB, NULL)); //already queued
+      VERIFY(asc_tx_submit(&test_ctx, &tx[1], (const uint8_t*)"DROP", 4, testTxCB, NULL));
+      VERIFY(asc_tx_cancel(&test_ctx, &tx[1]) && !tx[1].queued);
+      _asc_core_proc(&test_ctx);
+      VERIFY(test_tx_pos == 3 && !test_tx_done_cnt); //port got "HEL" and became busy
+      _asc_core_proc(&test_ctx);
+      VERIFY(test_tx_pos == 5 && test_tx_done_cnt == 1 && !tx[0].queued); //resumed from "L"
+      VERIFY(memcmp(test_tx_out, "HELLO", 5) == 0);
+      asc_item_t items[] = //[REQ][PREFIX][PARCE_TYPE][RPT][WAIT][STEPERROR][STEPOK][CB][FORMAT][...##VA_ARGS]
+      {
+        ASC_ITEM("AT+CSQ\r\n", "+CSQ", ASC_PARCE_SIMCOM, 1, 10, 0, 1, NULL, NULL, ASC_NO_ARG),
+      };
+      VERIFY(asc_entity_enqueue(&test_ctx, items, 1, NULL, 0, NULL) != ASC_ENTITY_HANDLE_NONE);
+      asc_entity_queue_t* queue =_asc_get_entity_queue(&test_ctx);
+      asc_entity_t* entity = &queue->entity[0];
+      _asc_core_proc(&test_ctx);
+      VERIFY(entity->state == ASC_STATE_SEND && !asc_timer_is_active(&entity->timer));
+      while(entity->state == ASC_STATE_SEND) _asc_core_proc(&test_ctx);
+      VERIFY(memcmp(&test_tx_out[5], "AT+CSQ\r\n", 8) == 0);
+      VERIFY(asc_timer_left_ms(&test_ctx, &entity->timer) == 100); //timeout starts when cmd is sent
+      uint32_t start = asc_get_cur_time_ms(&test_ctx);
+      while(queue->entity_cnt) _asc_core_proc(&test_ctx);
+      VERIFY(asc_get_cur_time_ms(&test_ctx) - start == 100);
+      asc_deinit(&test_ctx);
+      VERIFY(!_asc_get_init(&test_ctx).init);
+    }
+
+  TEST("asc_entity_submit()/asc_urc_submit() submission queue of foreign threads") {
+      char parce_buffer[64] = {0}; //modem is silent
+      asc_ring_buffer_t ring = {
+        .buffer = (uint8_t*)parce_buffer,
+        .head = 0,
+        .tail = 0,
+        .size = 64,
+      };
+      asc_init(&test_ctx, test_printf, test_write, &ring);
+      asc_item_t items[] = //[REQ][PREFIX][PARCE_TYPE][RPT][WAIT][STEPERROR][STEPOK][CB][FORMAT][...##VA_ARGS]
+      {
+        ASC_ITEM(NULL, "+TEST", ASC_PARCE_SIMCOM, 1, 150, 0, 1, NULL, NULL, ASC_NO_ARG),
+      };
+      asc_urc_queue_t urc = {.prefix = "+SUBMIT", .cb = testUrcCB};
+      asc_submit_t sub[ASC_ENTITY_QUEUE_SIZE + 2] = {0};
+      for(uint8_t i = 0; i <= ASC_ENTITY_QUEUE_SIZE; i++) VERIFY(asc_entity_submit(&test_ctx, &sub[i], items, 1, testCancelCB, 0, i ? "B" : "A", 0));
+      VERIFY(!asc_entity_submit(&test_ctx, &sub[0], items, 1, testCancelCB, 0, "A", 0)); //already queued
+      VERIFY(asc_urc_submit(&test_ctx, &sub[ASC_ENTITY_QUEUE_SIZE + 1], &urc));
+      asc_entity_queue_t* queue =_asc_get_entity_queue(&test_ctx);
+      VERIFY(queue->entity_cnt == 0); //nothing is enqueued until proc
+      VERIFY(asc_core_next_wakeup(&test_ctx) == asc_get_cur_time_ms(&test_ctx) + ASC_CORE_TICK_MS);
+      _asc_core_proc(&test_ctx);
+      VERIFY(queue->entity_cnt == ASC_ENTITY_QUEUE_SIZE && queue->entity[0].lane == 0);
+      VERIFY(!sub[0].queued && sub[0].result && asc_entity_last(&test_ctx) == sub[ASC_ENTITY_QUEUE_SIZE - 1].handle);
+      VERIFY(sub[ASC_ENTITY_QUEUE_SIZE].queued && sub[ASC_ENTITY_QUEUE_SIZE + 1].queued); //entity queue is full, urc keeps order behind it
+      VERIFY(asc_entity_enqueue(&test_ctx, items, 1, NULL, 0, NULL) == ASC_ENTITY_HANDLE_NONE && _asc_get_init(&test_ctx).init); //backpressure keeps context
+      test_cancel_order[0] = 0;
+      VERIFY(asc_entity_cancel(&test_ctx, sub[0].handle));
+      VERIFY(strcmp(test_cancel_order, "A-") == 0);
+      _asc_core_proc(&test_ctx);
+      VERIFY(!sub[ASC_ENTITY_QUEUE_SIZE].queued && sub[ASC_ENTITY_QUEUE_SIZE].result);
+      VERIFY(!sub[ASC_ENTITY_QUEUE_SIZE + 1].queued && sub[ASC_ENTITY_QUEUE_SIZE + 1].result);
+      VERIFY(asc_urc_dequeue(&test_ctx, "+SUBMIT"));
+      VERIFY(asc_entity_submit(&test_ctx, &sub[0], items, 1, testCancelCB, 0, "C", 1)); //reused, queue is full
+      _asc_core_proc(&test_ctx);
+      VERIFY(sub[0].queued);
+      asc_deinit(&test_ctx);
+      VERIFY(!sub[0].queued && !sub[0].result && sub[0].handle == ASC_ENTITY_HANDLE_NONE); //released on deinit
+      VERIFY(!_asc_get_init(&test_ctx).init);
+    }
+
+  TEST("asc_deinit() keeps descriptor of producer which is linking it") {
+      char parce_buffer[64] = {0}; //modem is silent
+      asc_ring_buffer_t ring = {
+        .buffer = (uint8_t*)parce_buffer,
+        .head = 0,
+        .tail = 0,
+        .size = 64,
+      };
+      asc_init(&test_ctx, test_printf, test_write, &ring);
+      asc_item_t items[] = //[REQ][PREFIX][PARCE_TYPE][RPT][WAIT][STEPERROR][STEPOK][CB][FORMAT][...##VA_ARGS]
+      {
+        ASC_ITEM(NULL, "+TEST", ASC_PARCE_SIMCOM, 1, 150, 0, 1, NULL, NULL, ASC_NO_ARG),
+      };
+      asc_submit_t pending = {.type = ASC_SUBMIT_ENTITY, .item = items, .item_amount = 1, .queued = true};
+      asc_submit_t* prev = test_ctx.submit_tail;
+      test_ctx.submit_tail = &pending; //producer has swapped tail and is preempted before the link
+      asc_deinit(&test_ctx);
+      VERIFY(pending.queued); //flush doesn't see it, the queue is kept
+      asc_submit_t late = {0};
+      VERIFY(!asc_entity_submit(&test_ctx, &late, items, 1, NULL, 0, NULL, 0)); //context is closed
+      VERIFY(!late.queued);
+      asc_init(&test_ctx, test_printf, test_write, &ring);
+      VERIFY(test_ctx.submit_tail == &pending); //re-init doesn't reset the queue under producer
+      prev->next = &pending;
+      _asc_core_proc(&test_ctx);
+      VERIFY(!pending.queued && pending.result && pending.handle != ASC_ENTITY_HANDLE_NONE);
+      VERIFY(asc_entity_cancel(&test_ctx, pending.handle));
+      asc_deinit(&test_ctx);
+    }
+
+  TEST("asc_event_defer_set()/asc_event_dispatch() deferred cbs") {
+      char parce_buffer[64] = "\r\n+TEST: 1\r\n";
+      asc_ring_buffer_t ring = {
+        .buffer = (uint8_t*)parce_buffer,
+        .head = strlen(parce_buffer),
+        .tail = 0,
+        .size = 64,
+      };
+      asc_init(&test_ctx, test_printf, test_write, &ring);
+      VERIFY(!asc_event_defer_set(&test_ctx, true));
+      asc_urc_queue_t urc = {"+TEST", testUrcCB};
+      VERIFY(asc_urc_enqueue(&test_ctx, &urc));
+      asc_item_t items[] = //[REQ][PREFIX][PARCE_TYPE][RPT][WAIT][STEPERROR][STEPOK][CB][FORMAT][...##VA_ARGS]
+      {
+        ASC_ITEM(NULL, "+NONE", ASC_PARCE_SIMCOM, 1, 150, 0, 1, NULL, NULL, ASC_NO_ARG),
+      };
+      O1HeapInstance* heap = asc_get_init(&test_ctx).heap;
+      size_t allocated = o1heapGetDiagnostics(heap).allocated;
+      test_event_cnt = 0;
+      test_urc_cnt = 0;
+      VERIFY(asc_entity_cancel(&test_ctx, asc_entity_enqueue(&test_ctx, items, 1, testEventCB, 16, NULL)));
+      ringslice_t rs_me = ringslice_initializer((uint8_t*)parce_buffer, 64, 0, strlen(parce_buffer));
+      _asc_process_urcs(&test_ctx, &rs_me);
+      memset(parce_buffer, 0, sizeof(parce_buffer)); //deferred cb of URC gets its copy
+      VERIFY(!test_event_cnt && !test_urc_cnt);
+      VERIFY(o1heapGetDiagnostics(heap).allocated > allocated); //data of entity waits for its cb
+      VERIFY(asc_event_dispatch(&test_ctx, 1) == 1 && test_event_cnt == 1 && !test_urc_cnt);
+      VERIFY(o1heapGetDiagnostics(heap).allocated == allocated);
+      VERIFY(asc_event_dispatch(&test_ctx, 0) == 1 && test_urc_cnt == 1);
+      VERIFY(asc_event_dispatch(&test_ctx, 0) == 0);
+      test_event_cnt = 0;
+      for(uint8_t i = 0; i < ASC_EVENT_RING_SIZE; i++) VERIFY(asc_entity_cancel(&test_ctx, asc_entity_enqueue(&test_ctx, items, 1, testEventCB, 0, NULL)));
+      VERIFY(test_event_cnt == 1 && test_ctx.events.overflow == 1); //ring is full, the last cb is called in place
+      VERIFY(asc_event_dispatch(&test_ctx, 0) == ASC_EVENT_RING_SIZE - 1 && test_event_cnt == ASC_EVENT_RING_SIZE);
+      asc_entity_queue_t* queue =_asc_get_entity_queue(&test_ctx);
+      asc_entity_handle_t victim = asc_entity_enqueue(&test_ctx, items, 1, testEventCB, 0, NULL);
+      VERIFY(asc_entity_cancel(&test_ctx, asc_entity_enqueue(&test_ctx, items, 1, testDispatchCB, 0, &victim)));
+      test_event_cnt = 0;
+      VERIFY(asc_event_dispatch(&test_ctx, 0) == 1 && test_event_cnt == 1);
+      VERIFY(queue->entity_cnt == 1); //cancel from deferred cb is done by core proc
+      _asc_core_proc(&test_ctx);
+      VERIFY(queue->entity_cnt == 0);
+      VERIFY(asc_event_dispatch(&test_ctx, 0) == 1 && test_event_cnt == 2);
+      VERIFY(asc_entity_cancel(&test_ctx, asc_entity_enqueue(&test_ctx, items, 1, testDispatchCB, 0, NULL)));
+      VERIFY(asc_entity_cancel(&test_ctx, asc_entity_enqueue(&test_ctx, items, 1, testEventCB, 0, NULL)));
+      VERIFY(asc_event_dispatch(&test_ctx, 0) == 1 && test_event_cnt == 3); //asc_deinit from cb drops the rest
+      VERIFY(!_asc_get_init(&test_ctx).init);
+      VERIFY(test_ctx.events.head == test_ctx.events.tail && !test_ctx.events.dispatch);
+      VERIFY(asc_event_defer_set(&test_ctx, false));
+    }
   } //ASC_CORE=====================================================================
 
   { //ASC_CHAIN====================================================================
@@ -926,7 +1664,6 @@ TEST_GROUP("ATL") {
 
       asc_ring_buffer_t ring = {
         .buffer = (uint8_t*)parce_buffer,
-        .count = 0,
         .head = parce_buffer_head,
         .tail = parce_buffer_tail,
         .size = 2048,
@@ -964,7 +1701,6 @@ TEST_GROUP("ATL") {
 
       asc_ring_buffer_t ring = {
         .buffer = (uint8_t*)parce_buffer,
-        .count = 0,
         .head = parce_buffer_head,
         .tail = parce_buffer_tail,
         .size = 2048,
@@ -1008,7 +1744,6 @@ TEST_GROUP("ATL") {
 
       asc_ring_buffer_t ring = {
         .buffer = (uint8_t*)parce_buffer,
-        .count = 0,
         .head = parce_buffer_head,
         .tail = parce_buffer_tail,
         .size = 2048,
@@ -1046,6 +1781,7 @@ TEST_GROUP("ATL") {
       {
         bool res = asc_chain_run(chain);
         if(asc_chain_is_running(chain)) VERIFY(res);
+        _asc_core_proc(&test_ctx); //timers of delay steps
       }
       asc_chain_destroy(chain);
       asc_deinit(&test_ctx);
@@ -1059,7 +1795,6 @@ TEST_GROUP("ATL") {
 
       asc_ring_buffer_t ring = {
         .buffer = (uint8_t*)parce_buffer,
-        .count = 0,
         .head = parce_buffer_head,
         .tail = parce_buffer_tail,
         .size = 2048,
@@ -1068,20 +1803,20 @@ TEST_GROUP("ATL") {
 
       chain_step_t server_steps[] = 
       {   
-        ASC_CHAIN("1",     "4", "MODEM RESET", testChainFunc, testEntityCB, test_buffer, test_buffer, 3),
-        ASC_CHAIN("2",      "3", "MODEM RESET", testChainFunc, testEntityCB, test_buffer, test_buffer, 3),
+        ASC_CHAIN("1",     "4", "STOP", testChainFunc, testEntityCB, test_buffer, test_buffer, 3),
+        ASC_CHAIN("2",      "3", "STOP", testChainFunc, testEntityCB, test_buffer, test_buffer, 3),
 
         ASC_CHAIN_LOOP_START(3), 
-            ASC_CHAIN("3", "5", "SOCKET DISCONNECT", testChainFunc, testEntityCB, test_buffer, test_buffer, 3),
+            ASC_CHAIN("3", "5", "STOP", testChainFunc, testEntityCB, test_buffer, test_buffer, 3),
             ASC_CHAIN_LOOP_START(3), 
-                ASC_CHAIN("4", "2", "SOCKET DISCONNECT", testChainFunc, testEntityCB, test_buffer, test_buffer, 3),
+                ASC_CHAIN("4", "2", "STOP", testChainFunc, testEntityCB, test_buffer, test_buffer, 3),
             ASC_CHAIN_LOOP_END,
         ASC_CHAIN_LOOP_END,
 
-        ASC_CHAIN_EXEC("5",  "NEXT", "MODEM RESET", testChainCond),
+        ASC_CHAIN_EXEC("5",  "NEXT", "STOP", testChainCond),
         ASC_CHAIN("6",       "NEXT", "PREV", testChainFunc, testEntityCB, test_buffer, test_buffer, 3),
-        ASC_CHAIN("7",       "NEXT", "MODEM RESET", testChainFunc, testEntityCB, test_buffer, test_buffer, 3),
-        ASC_CHAIN("8",       "NEXT", "MODEM RESET", testChainFunc, testEntityCB, test_buffer, test_buffer, 3),
+        ASC_CHAIN("7",       "NEXT", "STOP", testChainFunc, testEntityCB, test_buffer, test_buffer, 3),
+        ASC_CHAIN("8",       "NEXT", "STOP", testChainFunc, testEntityCB, test_buffer, test_buffer, 3),
       };
 
       asc_chain_t* chain = asc_chain_create("TCP", server_steps, sizeof(server_steps)/sizeof(chain_step_t), &test_ctx);
@@ -1099,6 +1834,354 @@ TEST_GROUP("ATL") {
       VERIFY(!asc_get_init(&test_ctx).init);
     }
 
+    TEST("asc_chain_create() targets resolving") {
+      asc_init(&test_ctx, test_printf, test_write, &asc_ring_buffer);
+      chain_step_t server_steps[] = 
+      {   
+        ASC_CHAIN("MODEM INIT", NULL, "MODEM RESET", testChainFunc, testEntityCB, test_buffer, test_buffer, 3),
+        ASC_CHAIN_EXEC("CHECK", "PREV", "STOP", testChainCond),
+        ASC_CHAIN("MODEM RESET", "MODEM INIT", "UNKNOWN", testChainFunc, testEntityCB, test_buffer, test_buffer, 3),
+      };
+      asc_chain_t* chain = asc_chain_create("TCP", server_steps, sizeof(server_steps)/sizeof(chain_step_t), &test_ctx);
+      VERIFY(chain == NULL);
+      server_steps[2].action.func.error_target = "STOP";
+      chain = asc_chain_create("TCP", server_steps, sizeof(server_steps)/sizeof(chain_step_t), &test_ctx);
+      VERIFY(chain != NULL);
+      VERIFY(chain->step_state[0].targets[0] == ASC_CHAIN_TARGET_NEXT);
+      VERIFY(chain->step_state[0].targets[1] == 2);
+      VERIFY(chain->step_state[1].targets[0] == ASC_CHAIN_TARGET_PREV);
+      VERIFY(chain->step_state[1].targets[1] == ASC_CHAIN_TARGET_STOP);
+      VERIFY(chain->step_state[2].targets[0] == 0);
+      asc_chain_destroy(chain);
+      VERIFY(o1heapGetDiagnostics(asc_get_init(&test_ctx).heap).allocated == 0);
+      asc_deinit(&test_ctx);
+      VERIFY(!asc_get_init(&test_ctx).init);
+    }
+
+    TEST("asc_chain_create() const steps in place") {
+      char parce_buffer[2048] = "\r\n+TEST: 523566, text\r\nFFFFFFFFFFF";
+      asc_ring_buffer_t ring = {
+        .buffer = (uint8_t*)parce_buffer,
+        .head = strlen(parce_buffer),
+        .tail = 0,
+        .size = 2048,
+      };
+      asc_init(&test_ctx, test_printf, test_write, &ring);
+      const size_t allocated = o1heapGetDiagnostics(asc_get_init(&test_ctx).heap).allocated;
+      static const chain_step_t server_steps[] = 
+      {   
+        ASC_CHAIN("MODEM INIT", "NEXT", "STOP", testChainFunc, testEntityCB, test_buffer, test_buffer, 3),
+        ASC_CHAIN_LOOP_START(2), 
+          ASC_CHAIN("MODEM RTD", "NEXT", "STOP", testChainFunc, testEntityCB, test_buffer, test_buffer, 3),
+          ASC_CHAIN_DELAY(50),
+        ASC_CHAIN_LOOP_END,
+      };
+      asc_chain_t* chain = asc_chain_create("TCP", server_steps, sizeof(server_steps)/sizeof(chain_step_t), &test_ctx);
+      VERIFY(chain->steps == server_steps);
+      const size_t states = sizeof(server_steps)/sizeof(chain_step_t);
+      const size_t compact = sizeof(asc_chain_t) + sizeof(asc_chain_frame_t) + sizeof(asc_loop_stack_item_t) + states * sizeof(asc_chain_step_state_t); //steps are not copied
+      VERIFY(o1heapGetDiagnostics(asc_get_init(&test_ctx).heap).allocated - allocated <= 2 * (compact + O1HEAP_ALIGNMENT)); //fragment is rounded up to power of two
+      asc_chain_start(chain);
+      while(asc_chain_is_running(chain))
+      {
+        bool res = asc_chain_run(chain);
+        if(asc_chain_is_running(chain)) VERIFY(res);
+        _asc_core_proc(&test_ctx); //timers of delay steps
+      }
+      VERIFY(chain->step_state[1].state == ASC_CHAIN_STEP_IDLE);
+      asc_chain_destroy(chain);
+      asc_deinit(&test_ctx);
+      VERIFY(!asc_get_init(&test_ctx).init);
+    }
+
+    TEST("asc_chain_sched_run() event driven chain") {
+      char parce_buffer[2048] = "\r\n+TEST: 523566, text\r\nFFFFFFFFFFF";
+      asc_ring_buffer_t ring = {
+        .buffer = (uint8_t*)parce_buffer,
+        .head = strlen(parce_buffer),
+        .tail = 0,
+        .size = 2048,
+      };
+      asc_init(&test_ctx, test_printf, test_write, &ring);
+      static const chain_step_t server_steps[] = 
+      {   
+        ASC_CHAIN("MODEM INIT", "NEXT", "STOP", testChainFunc, testEntityCB, test_buffer, test_buffer, 3),
+        ASC_CHAIN_DELAY(50),
+        ASC_CHAIN("MODEM RTD",  "NEXT", "STOP", testChainFunc, testEntityCB, test_buffer, test_buffer, 3),
+      };
+      asc_chain_sched_t sched;
+      asc_chain_sched_init(&sched, &test_ctx);
+      asc_chain_t* chain = asc_chain_create("TCP", server_steps, sizeof(server_steps)/sizeof(chain_step_t), &test_ctx);
+      VERIFY(asc_chain_sched_next_wakeup(&sched) == ASC_CHAIN_SCHED_NO_WAKEUP);
+      VERIFY(asc_chain_sched_add(&sched, chain, 0));
+      asc_chain_start(chain);
+      VERIFY(asc_chain_sched_next_wakeup(&sched) == asc_get_cur_time_ms(&test_ctx));
+      VERIFY(asc_chain_sched_run(&sched)); //the first step is done, chain sleeps in delay
+      const uint32_t fire = asc_get_cur_time_ms(&test_ctx) + 50;
+      VERIFY(chain->current_step == 1);
+      while(asc_chain_sched_run(&sched))
+      {
+        VERIFY(asc_chain_sched_next_wakeup(&sched) == fire);
+        VERIFY(asc_get_cur_time_ms(&test_ctx) < fire); //nothing runs before the delay fires
+        _asc_core_proc(&test_ctx);
+      }
+      VERIFY(asc_get_cur_time_ms(&test_ctx) >= fire);
+      VERIFY(!asc_chain_is_running(chain));
+      VERIFY(asc_chain_sched_next_wakeup(&sched) == ASC_CHAIN_SCHED_NO_WAKEUP);
+      asc_chain_destroy(chain);
+      VERIFY(sched.chains == NULL);
+      asc_deinit(&test_ctx);
+      VERIFY(!asc_get_init(&test_ctx).init);
+    }
+
+    TEST("asc_chain_sched_run() priorities and full entity queue") {
+      asc_init(&test_ctx, test_printf, test_write, &asc_ring_buffer);
+      asc_item_t items[] = //[REQ][PREFIX][PARCE_TYPE][RPT][WAIT][STEPERROR][STEPOK][CB][FORMAT][...##VA_ARGS]
+      {
+        ASC_ITEM(NULL, "+TEST", ASC_PARCE_SIMCOM, 2, 150, 0, 1, NULL, NULL, ASC_NO_ARG),
+      };
+      while(asc_entity_free_cnt(&test_ctx)) VERIFY(asc_entity_enqueue(&test_ctx, items, 1, NULL, 0, NULL));
+      static const chain_step_t low_steps[] = 
+      {   
+        ASC_CHAIN("LOW 1", "NEXT", "STOP", testChainOrderFunc, NULL, "L", NULL, 1),
+        ASC_CHAIN("LOW 2", "NEXT", "STOP", testChainOrderFunc, NULL, "L", NULL, 1),
+      };
+      static const chain_step_t high_steps[] = 
+      {   
+        ASC_CHAIN("HIGH 1", "NEXT", "STOP", testChainOrderFunc, NULL, "H", NULL, 1),
+        ASC_CHAIN("HIGH 2", "NEXT", "STOP", testChainOrderFunc, NULL, "H", NULL, 1),
+      };
+      asc_chain_sched_t sched;
+      asc_chain_sched_init(&sched, &test_ctx);
+      asc_chain_t* low = asc_chain_create("LOW", low_steps, 2, &test_ctx);
+      asc_chain_t* high = asc_chain_create("HIGH", high_steps, 2, &test_ctx);
+      VERIFY(asc_chain_sched_add(&sched, low, 2));
+      VERIFY(asc_chain_sched_add(&sched, high, 0));
+      asc_chain_start(low);
+      asc_chain_start(high);
+      test_chain_order[0] = 0;
+      VERIFY(asc_chain_sched_run(&sched)); //queue is full, steps are held back instead of failing
+      VERIFY(test_chain_order[0] == 0);
+      VERIFY(asc_chain_get_current_step(low) == 0 && asc_chain_get_current_step(high) == 0);
+      VERIFY(asc_chain_sched_next_wakeup(&sched) == asc_get_cur_time_ms(&test_ctx) + ASC_CORE_TICK_MS);
+      while(_asc_get_entity_queue(&test_ctx)->entity_cnt) asc_entity_dequeue(&test_ctx);
+      VERIFY(asc_chain_sched_next_wakeup(&sched) == asc_get_cur_time_ms(&test_ctx));
+      while(asc_chain_sched_run(&sched));
+      VERIFY(strcmp(test_chain_order, "HHLL") == 0);
+      asc_chain_destroy(low);
+      asc_chain_destroy(high);
+      asc_deinit(&test_ctx);
+      VERIFY(!asc_get_init(&test_ctx).init);
+    }
+
+    TEST("asc_chain_sched_run() fork/join of branches on two contexts") {
+      static asc_context_t test_ctx_gnss = {0};
+      asc_init(&test_ctx, test_printf, test_write, &asc_ring_buffer);
+      asc_init(&test_ctx_gnss, test_printf, test_write, &asc_ring_buffer);
+      static asc_chain_t* branches[2];
+      static const chain_step_t gprs_steps[] = 
+      {   
+        ASC_CHAIN("GPRS", "NEXT", "STOP", testChainOrderFunc, NULL, "G", NULL, 1),
+      };
+      static const chain_step_t gnss_steps[] = 
+      {   
+        ASC_CHAIN("GNSS", "NEXT", "STOP", testChainFailFunc, NULL, "N", NULL, 1),
+      };
+      static const chain_step_t main_steps[] = 
+      {   
+        ASC_CHAIN_FORK("START", branches, 2),
+        ASC_CHAIN_JOIN("ANY", ASC_CHAIN_JOIN_ANY, "NEXT", "STOP"),
+        ASC_CHAIN("READY", "NEXT", "STOP", testChainOrderFunc, NULL, "R", NULL, 1),
+        ASC_CHAIN_FORK("RESTART", branches, 2),
+        ASC_CHAIN_JOIN("ALL", ASC_CHAIN_JOIN_ALL, "NEXT", "FAILED"),
+        ASC_CHAIN("DONE", "STOP", "STOP", testChainOrderFunc, NULL, "D", NULL, 1),
+        ASC_CHAIN("FAILED", "STOP", "STOP", testChainOrderFunc, NULL, "F", NULL, 1),
+      };
+      asc_chain_sched_t sched_gsm, sched_gnss;
+      asc_chain_sched_init(&sched_gsm, &test_ctx);
+      asc_chain_sched_init(&sched_gnss, &test_ctx_gnss);
+      branches[0] = asc_chain_create("GPRS", gprs_steps, 1, &test_ctx);
+      branches[1] = asc_chain_create("GNSS", gnss_steps, 1, &test_ctx_gnss);
+      asc_chain_t* chain = asc_chain_create("MAIN", main_steps, 7, &test_ctx);
+      VERIFY(branches[0] && branches[1] && chain);
+      VERIFY(asc_chain_sched_add(&sched_gsm, branches[0], 1));
+      VERIFY(asc_chain_sched_add(&sched_gnss, branches[1], 1));
+      VERIFY(asc_chain_sched_add(&sched_gsm, chain, 0));
+      test_chain_order[0] = 0;
+      asc_chain_start(chain);
+      while(asc_chain_sched_run(&sched_gsm) | asc_chain_sched_run(&sched_gnss));
+      VERIFY(strcmp(test_chain_order, "NGRNF") == 0); //any: failed GNSS waits for GPRS, all: fails fast, GPRS is stopped
+      VERIFY(strcmp(asc_chain_get_current_step_name(chain), "FAILED") == 0);
+      asc_chain_destroy(chain);
+      asc_chain_destroy(branches[0]);
+      asc_chain_destroy(branches[1]);
+      asc_deinit(&test_ctx_gnss);
+      asc_deinit(&test_ctx);
+      VERIFY(!asc_get_init(&test_ctx).init);
+    }
+
+    TEST("asc_chain_sched_run() wait for URC step") {
+      char parce_buffer[64] = "\r\n+CREG: 1\r\n";
+      asc_ring_buffer_t ring = {
+        .buffer = (uint8_t*)parce_buffer,
+        .head = strlen(parce_buffer),
+        .tail = 0,
+        .size = 64,
+      };
+      asc_init(&test_ctx, test_printf, test_write, &ring);
+      static const chain_step_t steps[] = 
+      {   
+        ASC_CHAIN_WAIT_URC("+CREG: 1", 3000, "NEXT", "STOP"),
+        ASC_CHAIN_WAIT_URC("CONNECT OK", 500, "NEXT", "TIMEOUT"),
+        ASC_CHAIN("DONE", "STOP", "STOP", testChainOrderFunc, NULL, "D", NULL, 1),
+        ASC_CHAIN("TIMEOUT", "STOP", "STOP", testChainOrderFunc, NULL, "T", NULL, 1),
+      };
+      asc_chain_sched_t sched;
+      asc_chain_sched_init(&sched, &test_ctx);
+      asc_chain_t* chain = asc_chain_create("URC", steps, 4, &test_ctx);
+      VERIFY(asc_chain_sched_add(&sched, chain, 0));
+      test_chain_order[0] = 0;
+      asc_chain_start(chain);
+      uint32_t start = asc_get_cur_time_ms(&test_ctx);
+      while(asc_chain_sched_run(&sched))
+      {
+        VERIFY(_asc_get_entity_queue(&test_ctx)->entity_cnt == 0); //no modem traffic while waiting
+        _asc_core_proc(&test_ctx);
+      }
+      uint32_t elapsed = asc_get_cur_time_ms(&test_ctx) - start;
+      VERIFY(strcmp(test_chain_order, "T") == 0);
+      VERIFY(elapsed >= 500 && elapsed <= 500 + (ASC_URC_FREQ_CHECK + 1) * ASC_CORE_TICK_MS); //+CREG is found on the first URC check
+      VERIFY(test_ctx.urc_wait == NULL);
+      asc_chain_destroy(chain);
+      asc_deinit(&test_ctx);
+      VERIFY(!asc_get_init(&test_ctx).init);
+    }
+
+    TEST("asc_chain_sched_run() retry backoff and step watchdog") {
+      char parce_buffer[64] = {0}; //modem is silent
+      asc_ring_buffer_t ring = {
+        .buffer = (uint8_t*)parce_buffer,
+        .head = 0,
+        .tail = 0,
+        .size = 64,
+      };
+      asc_init(&test_ctx, test_printf, test_write, &ring);
+      static const asc_chain_backoff_t backoff = { .type = ASC_CHAIN_BACKOFF_EXP, .jitter = 0, .base = 100, .cap = 150 };
+      static const chain_step_t steps[] = 
+      {   
+        ASC_CHAIN_RETRY("REG", "STOP", "SILENT", testChainFailFunc, NULL, "F", NULL, 3, &backoff, 0),
+        ASC_CHAIN_RETRY("SILENT", "STOP", "STUCK", testChainSilentFunc, NULL, NULL, NULL, 1, NULL, 200),
+        ASC_CHAIN("STUCK", "STOP", "STOP", testChainOrderFunc, NULL, "W", NULL, 1),
+      };
+      asc_chain_sched_t sched;
+      asc_chain_sched_init(&sched, &test_ctx);
+      asc_chain_t* chain = asc_chain_create("RETRY", steps, 3, &test_ctx);
+      VERIFY(asc_chain_sched_add(&sched, chain, 0));
+      test_chain_order[0] = 0;
+      asc_chain_start(chain);
+      uint32_t start = asc_get_cur_time_ms(&test_ctx);
+      while(asc_chain_sched_run(&sched)) _asc_core_proc(&test_ctx);
+      VERIFY(strcmp(test_chain_order, "FFFW") == 0);
+      VERIFY(asc_get_cur_time_ms(&test_ctx) - start == 100 + 150 + 200); //exponential capped backoff, then watchdog instead of 2 * 1500 ms of retries
+      VERIFY(_asc_get_entity_queue(&test_ctx)->entity_cnt == 0); //hung entity is cancelled by watchdog
+      asc_chain_destroy(chain);
+      asc_deinit(&test_ctx);
+      VERIFY(!asc_get_init(&test_ctx).init);
+    }
+
+    TEST("asc_chain_sched_run() sub-chain call steps") {
+      char parce_buffer[64] = {0};
+      asc_ring_buffer_t ring = {
+        .buffer = (uint8_t*)parce_buffer,
+        .head = 0,
+        .tail = 0,
+        .size = 64,
+      };
+      asc_init(&test_ctx, test_printf, test_write, &ring);
+      static const chain_step_t attach_steps[] = 
+      {   
+        ASC_CHAIN_LOOP_START(2),
+        ASC_CHAIN("POLL", "NEXT", "STOP", testChainOrderFunc, NULL, "p", NULL, 1),
+        ASC_CHAIN_LOOP_END,
+        ASC_CHAIN("ATTACH", "NEXT", "STOP", testChainOrderFunc, NULL, "a", NULL, 1),
+      };
+      static const asc_chain_sub_t attach = ASC_CHAIN_SUB("ATTACH", attach_steps);
+      static const chain_step_t fail_steps[] = 
+      {   
+        ASC_CHAIN("FAIL", "NEXT", "STOP", testChainFailFunc, NULL, "F", NULL, 1),
+        ASC_CHAIN("NEVER", "NEXT", "STOP", testChainOrderFunc, NULL, "N", NULL, 1),
+      };
+      static const asc_chain_sub_t fail = ASC_CHAIN_SUB("FAIL", fail_steps);
+      static const chain_step_t steps[] = 
+      {   
+        ASC_CHAIN_LOOP_START(2),
+        ASC_CHAIN_CALL("CALL ATTACH", &attach, "NEXT", "STOP"),
+        ASC_CHAIN_LOOP_END,
+        ASC_CHAIN_CALL("CALL FAIL", &fail, "STOP", "RECOVER"),
+        ASC_CHAIN("RECOVER", "NEXT", "STOP", testChainOrderFunc, NULL, "R", NULL, 1),
+      };
+      asc_chain_sched_t sched;
+      asc_chain_sched_init(&sched, &test_ctx);
+      asc_chain_t* chain = asc_chain_create("CALL", steps, 5, &test_ctx);
+      VERIFY(chain && chain->state_cnt == 5 + 4 + 2);
+      VERIFY(asc_chain_sched_add(&sched, chain, 0));
+      test_chain_order[0] = 0;
+      asc_chain_start(chain);
+      while(asc_chain_sched_run(&sched)) _asc_core_proc(&test_ctx);
+      VERIFY(strcmp(test_chain_order, "ppappaFR") == 0); //loops of sub-chain nest in loop of caller, error returns to error target
+      VERIFY(chain->call_ptr == 0 && chain->steps == steps);
+      asc_chain_destroy(chain);
+      asc_deinit(&test_ctx);
+      VERIFY(!asc_get_init(&test_ctx).init);
+    }
+
+    TEST("asc_chain_resume() from checkpoint after MCU reset") {
+      char parce_buffer[64] = {0};
+      asc_ring_buffer_t ring = {
+        .buffer = (uint8_t*)parce_buffer,
+        .head = 0,
+        .tail = 0,
+        .size = 64,
+      };
+      asc_init(&test_ctx, test_printf, test_write, &ring);
+      static asc_chain_checkpoint_t checkpoint; //retained RAM
+      static char session[8] = "IP";
+      static const chain_step_t steps[] = 
+      {   
+        ASC_CHAIN("INIT", "NEXT", "STOP", testChainOrderFunc, NULL, "I", NULL, 1),
+        ASC_CHAIN_LOOP_START(2),
+        ASC_CHAIN_CHECKPOINT("CHECKPOINT", &checkpoint, session, sizeof(session)),
+        ASC_CHAIN("WORK", "NEXT", "STOP", testChainOrderFunc, NULL, "W", NULL, 1),
+        ASC_CHAIN_LOOP_END,
+        ASC_CHAIN("RESET", "STOP", "STOP", testChainFailFunc, NULL, "!", NULL, 1),
+        ASC_CHAIN("PROBE", "STOP", "INIT", testChainOrderFunc, NULL, "?", NULL, 1),
+      };
+      asc_chain_sched_t sched;
+      asc_chain_sched_init(&sched, &test_ctx);
+      asc_chain_t* chain = asc_chain_create("RESUME", steps, 7, &test_ctx);
+      VERIFY(asc_chain_sched_add(&sched, chain, 0));
+      memset(&checkpoint, 0xA5, sizeof(checkpoint)); //garbage after power on
+      VERIFY(!asc_chain_resume(chain, &checkpoint, "PROBE", NULL, 0));
+      test_chain_order[0] = 0;
+      asc_chain_start(chain);
+      while(asc_chain_sched_run(&sched)) _asc_core_proc(&test_ctx);
+      VERIFY(strcmp(test_chain_order, "IWW!") == 0);
+      asc_chain_destroy(chain); //MCU reset, checkpoint is kept
+      chain = asc_chain_create("RESUME", steps, 7, &test_ctx);
+      VERIFY(asc_chain_sched_add(&sched, chain, 0));
+      char restored[8] = {0};
+      test_chain_order[0] = 0;
+      VERIFY(asc_chain_resume(chain, &checkpoint, "PROBE", restored, sizeof(restored)));
+      while(asc_chain_sched_run(&sched)) _asc_core_proc(&test_ctx);
+      VERIFY(strcmp(test_chain_order, "?W!") == 0); //one probe, then the last iteration of loop instead of INIT
+      VERIFY(strcmp(restored, "IP") == 0);
+      checkpoint.data[0] ^= 1; //damaged
+      VERIFY(!asc_chain_checkpoint_valid(chain, &checkpoint));
+      asc_chain_destroy(chain);
+      asc_deinit(&test_ctx);
+      VERIFY(!asc_get_init(&test_ctx).init);
+    }
+
   } //ASC_CHAIN====================================================================
 
 } // TEST_GROUP()